@@ -0,0 +1,56 @@
+/*
+Copyright (c) 1998-2018 University Corporation for Atmospheric Research/Unidata
+See COPYRIGHT for license information.
+*/
+
+#ifndef NCBLOCKCACHE_H
+#define NCBLOCKCACHE_H
+
+#include "nclist.h"
+
+/*
+This is a read-only cache of the fixed size, aligned blocks of a
+remote object for which each read is expensive, such as an object
+accessed using HTTP byte ranges. Missing blocks that are adjacent
+are read with a single request, and once access is sequential the
+following blocks are read along with them. Bytes past the end of the
+object read as zero.
+*/
+
+/* Read count bytes at offset of the object into buf; the range never
+   extends past the end of the object */
+typedef int (*NCblockreader)(void* state, size64_t offset, size64_t count, void* buf);
+
+typedef struct NCblockcache {
+    size_t blocksize;
+    size_t maxblocks; /* max no. of cached blocks */
+    size_t readahead; /* blocks to read ahead once access is sequential */
+    size64_t objsize; /* size of the object */
+    NCblockreader reader;
+    void* state; /* passed to reader */
+    NClist* blocks; /* NClist<NCblock*>; least recently used first */
+    size64_t next; /* block following the last one accessed */
+    void* span; /* holds a region that crosses blocks */
+    size_t spansize;
+    void* scratch; /* receives the blocks read by one request */
+    size_t scratchsize;
+    struct NCblockstats {
+	size64_t requests; /* calls to reader */
+	size64_t bytes; /* bytes read */
+	size64_t hits; /* blocks found in the cache */
+	size64_t misses; /* blocks that were read */
+    } stats;
+} NCblockcache;
+
+/* Create a cache: 0 => use the default for blocksize, maxblocks */
+EXTERNL int ncblockcachenew(size64_t objsize, size_t blocksize, size_t maxblocks, size_t readahead,
+                            NCblockreader reader, void* state, NCblockcache** cachep);
+
+/* Free cache. */
+EXTERNL void ncblockcachefree(NCblockcache* cache);
+
+/* Make extent bytes at offset available in *datap, which is valid
+   until the next call */
+EXTERNL int ncblockcacheget(NCblockcache* cache, size64_t offset, size_t extent, void** datap);
+
+#endif /*NCBLOCKCACHE_H*/
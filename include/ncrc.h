@@ -51,6 +51,7 @@ typedef struct NCRCglobalstate {
     NCRCinfo rcinfo; /* Currently only one rc file per session */
     struct GlobalZarr { /* Zarr specific parameters */
 	char dimension_separator;
+	size_t threads; /* default no. of chunk I/O worker threads */
     } zarr;
     struct S3credentials {
 	NClist* profiles; /* NClist<struct AWSprofile*> */
@@ -18,6 +18,8 @@ EXTERNL int NC_s3sdkbucketcreate(void* s3client, const char* region, const char*
 EXTERNL int NC_s3sdkbucketdelete(void* s3client, const char* region, const char* bucket, char** errmsgp);
 EXTERNL int NC_s3sdkinfo(void* client0, const char* bucket, const char* pathkey, unsigned long long* lenp, char** errmsgp);
 EXTERNL int NC_s3sdkread(void* client0, const char* bucket, const char* pathkey, unsigned long long start, unsigned long long count, void* content, char** errmsgp);
+EXTERNL int NC_s3sdkinfon(void* client0, const char* bucket, size_t n, const char** pathkeys, unsigned long long* lens, int* stats, char** errmsgp);
+EXTERNL int NC_s3sdkreadn(void* client0, const char* bucket, size_t n, const char** pathkeys, unsigned long long* starts, unsigned long long* counts, void** contents, int* stats, char** errmsgp);
 EXTERNL int NC_s3sdkwriteobject(void* client0, const char* bucket, const char* pathkey, unsigned long long count, const void* content, char** errmsgp);
 EXTERNL int NC_s3sdkclose(void* s3client0, NCS3INFO* info, int deleteit, char** errmsgp);
 EXTERNL int NC_s3sdkgetkeys(void* s3client0, const char* bucket, const char* prefix, size_t* nkeysp, char*** keysp, char** errmsgp);
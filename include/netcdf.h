@@ -970,6 +970,32 @@ EXTERNL int
 nc_get_var_chunk_cache(int ncid, int varid, size_t *sizep, size_t *nelemsp,
                        float *preemptionp);
 
+/** Runtime I/O statistics of a variable, or of a whole dataset for
+    NC_GLOBAL; see nc_inq_var_stats(). Times are in seconds. */
+typedef struct NC_io_stats {
+    unsigned long long cache_hits;      /**< Chunks found in the chunk cache. */
+    unsigned long long cache_misses;    /**< Chunks that had to be read or created. */
+    unsigned long long cache_evictions; /**< Chunks removed from the chunk cache. */
+    unsigned long long map_reads;       /**< Storage read calls. */
+    unsigned long long map_writes;      /**< Storage write calls. */
+    unsigned long long map_exists;      /**< Storage existence checks. */
+    unsigned long long map_lens;        /**< Storage object length queries. */
+    unsigned long long map_searches;    /**< Storage listings. */
+    unsigned long long map_removes;     /**< Storage object removals. */
+    unsigned long long bytes_read;      /**< Bytes read from storage. */
+    unsigned long long bytes_written;   /**< Bytes written to storage. */
+    unsigned long long encodes;         /**< Chunks run through the filters for writing. */
+    unsigned long long decodes;         /**< Chunks run through the filters for reading. */
+    unsigned long long transfers;       /**< Reads and writes of the variable. */
+    double encode_time;                 /**< Time spent encoding. */
+    double decode_time;                 /**< Time spent decoding. */
+    double transfer_time;               /**< Time spent copying between chunks and memory. */
+} NC_io_stats;
+
+/* Get the I/O statistics of a variable or (NC_GLOBAL) a dataset. */
+EXTERNL int
+nc_inq_var_stats(int ncid, int varid, NC_io_stats *statsp);
+
 EXTERNL int
 nc_redef(int ncid);
 
@@ -975,4 +975,5 @@ NC_NOTNC4_inq_var_filter_info,
 
 NC_NOTNC4_def_var_quantize,
 NC_NOTNC4_inq_var_quantize,
+NC_NOSTATS_inq_var_stats,
 };
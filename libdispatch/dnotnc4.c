@@ -84,6 +84,21 @@ NC_NOTNC4_inq_var_filter_info(int ncid, int varid, unsigned int id, size_t* npar
     return NC_ENOTNC4;
 }
 
+/**
+ * @internal I/O statistics are only collected for NCZarr datasets.
+ *
+ * @param ncid Ignored.
+ * @param varid Ignored.
+ * @param statsp Ignored.
+ *
+ * @return ::NC_ENOTBUILT Not collected by this dispatch table.
+ */
+int
+NC_NOSTATS_inq_var_stats(int ncid, int varid, NC_io_stats *statsp)
+{
+    return NC_ENOTBUILT;
+}
+
 int
 NC_NOOP_inq_var_filter_ids(int ncid, int varid, size_t* nfilters, unsigned int* filterids)
 {
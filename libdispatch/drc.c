@@ -616,6 +616,7 @@ NC_rcfile_insert(const char* key, const char* value, const char* hostport, const
     if(rc == NULL) {
 	rc = nclistnew();
 	if(rc == NULL) {ret = NC_ENOMEM; goto done;}
+	globalstate->rcinfo.entries = rc;
     }
     entry = rclocate(key,hostport,path);
     if(entry == NULL) {
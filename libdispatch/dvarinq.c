@@ -767,4 +767,42 @@ nc_inq_var_szip(int ncid, int varid, int *options_maskp, int *pixels_per_blockp)
    return stat;
 }
 
+/** \ingroup variables
+Get the runtime I/O statistics of a variable.
+
+The counters cover the chunk cache, the calls made to the storage
+and the bytes moved, the time spent running the filters and the
+time spent copying data between the chunks and user memory, since
+the file was opened or created. Statistics are only collected for
+NCZarr datasets.
+
+\param ncid NetCDF or group ID, from a previous call to nc_open(),
+nc_create(), nc_def_grp(), or associated inquiry functions such as
+nc_inq_ncid().
+
+\param varid Variable ID, or ::NC_GLOBAL for the whole dataset. The
+storage counters of a variable only cover its chunks; those of the
+dataset cover all storage traffic, including metadata, while its
+other counters are the sums over all its variables.
+
+\param statsp Storage which will get the counters.
+
+\returns ::NC_NOERR No error.
+\returns ::NC_EBADID Bad ncid.
+\returns ::NC_ENOTVAR Invalid variable ID.
+\returns ::NC_EINVAL NULL statsp.
+\returns ::NC_ENOTBUILT The dataset is not an NCZarr dataset.
+*/
+int
+nc_inq_var_stats(int ncid, int varid, NC_io_stats *statsp)
+{
+   NC* ncp;
+   int stat = NC_check_id(ncid,&ncp);
+   if(stat != NC_NOERR) return stat;
+   TRACE(nc_inq_var_stats);
+   if(statsp == NULL) return NC_EINVAL;
+   if(ncp->dispatch->inq_var_stats == NULL) return NC_ENOTBUILT;
+   return ncp->dispatch->inq_var_stats(ncid,varid,statsp);
+}
+
 /*! \} */  /* End of named group ...*/
@@ -0,0 +1,255 @@
+/*
+  Copyright (c) 1998-2018 University Corporation for Atmospheric Research/Unidata
+  See LICENSE.txt for license information.
+*/
+
+/** \file \internal
+    A cache of the aligned blocks of a remote object.
+
+    This file contains functions for manipulating NCblockcache objects.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "netcdf.h"
+#include "nclist.h"
+#include "ncblockcache.h"
+
+#define DFALTBLOCKSIZE 262144
+#define DFALTMAXBLOCKS 32
+
+typedef struct NCblock {
+    size64_t index; /* offset == index*blocksize */
+    size_t len; /* bytes of the object in this block; < blocksize only for the last block */
+    char* data; /* blocksize bytes; zero past len */
+} NCblock;
+
+/* Forward */
+static NCblock* findblock(NCblockcache* cache, size64_t index, int touch);
+static int loadblocks(NCblockcache* cache, size64_t first, size64_t last, size64_t nblocks);
+static int readrange(NCblockcache* cache, size64_t offset, size64_t count, void* buf);
+static int growbuffer(void** bufp, size_t* sizep, size_t size);
+static void freeblock(NCblock* block);
+
+/**************************************************/
+
+int
+ncblockcachenew(size64_t objsize, size_t blocksize, size_t maxblocks, size_t readahead,
+                NCblockreader reader, void* state, NCblockcache** cachep)
+{
+    int stat = NC_NOERR;
+    NCblockcache* cache = NULL;
+
+    if(reader == NULL || cachep == NULL) return NC_EINVAL;
+    if((cache = calloc(1,sizeof(NCblockcache))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    cache->blocksize = (blocksize == 0 ? DFALTBLOCKSIZE : blocksize);
+    cache->maxblocks = (maxblocks == 0 ? DFALTMAXBLOCKS : maxblocks);
+    /* Readahead must leave room for the blocks being read */
+    cache->readahead = (readahead < cache->maxblocks ? readahead : cache->maxblocks - 1);
+    cache->objsize = objsize;
+    cache->reader = reader;
+    cache->state = state;
+    if((cache->blocks = nclistnew()) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    *cachep = cache; cache = NULL;
+done:
+    ncblockcachefree(cache);
+    return stat;
+}
+
+void
+ncblockcachefree(NCblockcache* cache)
+{
+    size_t i;
+    if(cache == NULL) return;
+    for(i=0;i<nclistlength(cache->blocks);i++)
+	freeblock((NCblock*)nclistget(cache->blocks,i));
+    nclistfree(cache->blocks);
+    if(cache->span != NULL) free(cache->span);
+    if(cache->scratch != NULL) free(cache->scratch);
+    free(cache);
+}
+
+int
+ncblockcacheget(NCblockcache* cache, size64_t offset, size_t extent, void** datap)
+{
+    int stat = NC_NOERR;
+    size64_t first, last, nblocks, b;
+    size_t pos;
+
+    if(cache == NULL || datap == NULL) return NC_EINVAL;
+    if(extent == 0) extent = 1; /* still return a valid pointer */
+    first = offset / cache->blocksize;
+    last = (offset + extent - 1) / cache->blocksize;
+    nblocks = (last - first) + 1;
+
+    if(nblocks > cache->maxblocks) {
+	/* Larger than the cache; read it directly */
+	if((stat = growbuffer(&cache->span,&cache->spansize,extent))) goto done;
+	if((stat = readrange(cache,offset,extent,cache->span))) goto done;
+	cache->next = last + 1;
+	*datap = cache->span;
+	goto done;
+    }
+
+    if((stat = loadblocks(cache,first,last,nblocks))) goto done;
+
+    if(nblocks == 1) {
+	/* Point into the block itself */
+	NCblock* block = findblock(cache,first,0);
+	assert(block != NULL);
+	*datap = block->data + (offset - first*cache->blocksize);
+	goto done;
+    }
+    /* Assemble the region from its blocks */
+    if((stat = growbuffer(&cache->span,&cache->spansize,extent))) goto done;
+    for(pos=0,b=first;b<=last;b++) {
+	NCblock* block = findblock(cache,b,0);
+	size64_t start = (b == first ? offset - first*cache->blocksize : 0);
+	size64_t stop = (b == last ? (offset + extent) - last*cache->blocksize : cache->blocksize);
+	assert(block != NULL);
+	memcpy((char*)cache->span + pos,block->data + start,(size_t)(stop - start));
+	pos += (size_t)(stop - start);
+    }
+    assert(pos == extent);
+    *datap = cache->span;
+done:
+    return stat;
+}
+
+/**************************************************/
+
+/* Locate a cached block; touch => make it the most recently used */
+static NCblock*
+findblock(NCblockcache* cache, size64_t index, int touch)
+{
+    size_t i, n = nclistlength(cache->blocks);
+    /* Search from the most recently used end */
+    for(i=n;i-- > 0;) {
+	NCblock* block = (NCblock*)nclistget(cache->blocks,i);
+	if(block->index != index) continue;
+	if(touch && i+1 < n) {
+	    (void)nclistremove(cache->blocks,i);
+	    nclistpush(cache->blocks,block);
+	}
+	return block;
+    }
+    return NULL;
+}
+
+/* Make blocks first..last (nblocks of them) present; each run of
+   missing blocks is read with one request, and the last run is
+   extended by the readahead when access is sequential */
+static int
+loadblocks(NCblockcache* cache, size64_t first, size64_t last, size64_t nblocks)
+{
+    int stat = NC_NOERR;
+    size64_t b, run, endblock, limit;
+    size_t i;
+    int sequential = (first == cache->next || (cache->next > 0 && first+1 == cache->next));
+    NClist* loaded = nclistnew(); /* NClist<NCblock*> */
+
+    /* No. of blocks in the object */
+    endblock = (cache->objsize + cache->blocksize - 1) / cache->blocksize;
+    /* Blocks read ahead must not evict the ones being read */
+    limit = last + 1;
+    if(sequential && cache->readahead > 0) {
+	size64_t room = cache->maxblocks - nblocks;
+	limit += (cache->readahead < room ? cache->readahead : room);
+    }
+    if(limit > endblock && endblock > last) limit = endblock;
+    if(limit < last + 1) limit = last + 1;
+
+    for(b=first;b<limit;) {
+	size64_t count, offset, nbytes;
+	if(findblock(cache,b,0) != NULL) {
+	    if(b > last) break; /* readahead stops at a cached block */
+	    cache->stats.hits++;
+	    b++;
+	    continue;
+	}
+	/* Find the run of missing blocks starting at b */
+	for(run=b+1;run<limit;run++) {
+	    if(findblock(cache,run,0) != NULL) break;
+	}
+	count = run - b;
+	offset = b * cache->blocksize;
+	nbytes = count * cache->blocksize;
+	if((stat = growbuffer(&cache->scratch,&cache->scratchsize,(size_t)nbytes))) goto done;
+	if((stat = readrange(cache,offset,nbytes,cache->scratch))) goto done;
+	for(;b<run;b++) {
+	    NCblock* block = NULL;
+	    size64_t bstart = b * cache->blocksize;
+	    if((block = calloc(1,sizeof(NCblock))) == NULL) {stat = NC_ENOMEM; goto done;}
+	    nclistpush(loaded,block); /* reclaimed on failure */
+	    block->index = b;
+	    block->len = (bstart >= cache->objsize ? 0
+			  : (cache->objsize - bstart < cache->blocksize ? (size_t)(cache->objsize - bstart) : cache->blocksize));
+	    if((block->data = malloc(cache->blocksize)) == NULL) {stat = NC_ENOMEM; goto done;}
+	    memcpy(block->data,(char*)cache->scratch + (bstart - offset),cache->blocksize);
+	    if(b <= last) cache->stats.misses++;
+	}
+    }
+    /* Readahead blocks are less recently used than the requested blocks */
+    for(i=0;i<nclistlength(loaded);i++) {
+	NCblock* block = (NCblock*)nclistget(loaded,i);
+	if(block->index > last) nclistpush(cache->blocks,block);
+    }
+    for(i=0;i<nclistlength(loaded);i++) {
+	NCblock* block = (NCblock*)nclistget(loaded,i);
+	if(block->index <= last) nclistpush(cache->blocks,block);
+    }
+    nclistclear(loaded);
+    for(b=first;b<=last;b++) (void)findblock(cache,b,1);
+    /* Evict from the least recently used end */
+    while(nclistlength(cache->blocks) > cache->maxblocks)
+	freeblock((NCblock*)nclistremove(cache->blocks,0));
+    cache->next = last + 1;
+done:
+    for(i=0;i<nclistlength(loaded);i++)
+	freeblock((NCblock*)nclistget(loaded,i));
+    nclistfree(loaded);
+    return stat;
+}
+
+/* Read a range with one request; the part past the end of the object is zeroed */
+static int
+readrange(NCblockcache* cache, size64_t offset, size64_t count, void* buf)
+{
+    int stat = NC_NOERR;
+    size64_t avail = (offset >= cache->objsize ? 0 : cache->objsize - offset);
+    size64_t n = (count < avail ? count : avail);
+
+    if(n > 0) {
+	if((stat = cache->reader(cache->state,offset,n,buf))) goto done;
+	cache->stats.requests++;
+	cache->stats.bytes += n;
+    }
+    if(n < count) memset((char*)buf + n,0,(size_t)(count - n));
+done:
+    return stat;
+}
+
+static int
+growbuffer(void** bufp, size_t* sizep, size_t size)
+{
+    void* p;
+    if(*sizep >= size) return NC_NOERR;
+    if((p = realloc(*bufp,size)) == NULL) return NC_ENOMEM;
+    *bufp = p;
+    *sizep = size;
+    return NC_NOERR;
+}
+
+static void
+freeblock(NCblock* block)
+{
+    if(block == NULL) return;
+    if(block->data != NULL) free(block->data);
+    free(block);
+}
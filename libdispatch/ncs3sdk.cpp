@@ -13,6 +13,8 @@
 #include <string.h>
 #include <iostream>
 #include <streambuf>
+#include <future>
+#include <vector>
 #include "netcdf.h"
 #include "ncrc.h"
 
@@ -339,6 +341,127 @@ NC_s3sdkread(void* s3client0, const char* bucket, const char* pathkey, size64_t
     return NCUNTRACE(stat);
 }
 
+/* Map a failed request to an error code; not-found => NC_EEMPTY */
+static int
+s3errorcode(const Aws::Client::AWSError<Aws::S3::S3Errors>& err)
+{
+    switch (err.GetErrorType()) {
+    case Aws::S3::S3Errors::RESOURCE_NOT_FOUND:
+    case Aws::S3::S3Errors::NO_SUCH_KEY:
+	return NC_EEMPTY;
+    case Aws::S3::S3Errors::ACCESS_DENIED:
+	return NC_EACCESS;
+    default: break;
+    }
+    return NC_ES3;
+}
+
+/*
+Batch form of NC_s3sdkinfo: all the HEAD requests are issued
+before any of them is waited on.
+stats[i] is set to NC_NOERR, NC_EEMPTY, or some other error.
+@return NC_NOERR unless the batch could not be issued.
+*/
+EXTERNL int
+NC_s3sdkinfon(void* s3client0, const char* bucket, size_t n, const char** pathkeys, size64_t* lens, int* stats, char** errmsgp)
+{
+    size_t i;
+    const char* key = NULL;
+
+    NCTRACE(11,"bucket=%s n=%llu",bucket,(size64_t)n);
+
+    Aws::S3::S3Client* s3client = (Aws::S3::S3Client*)s3client0;
+    std::vector<Aws::S3::Model::HeadObjectOutcomeCallable> outcomes;
+
+    if(errmsgp) *errmsgp = NULL;
+    for(i=0;i<n;i++) {
+	Aws::S3::Model::HeadObjectRequest head_request;
+	if(*pathkeys[i] != '/') return NCUNTRACE(NC_EINTERNAL);
+	(void)makes3key(pathkeys[i],&key);
+	head_request.SetBucket(bucket);
+	head_request.SetKey(key);
+	outcomes.push_back(s3client->HeadObjectCallable(head_request));
+    }
+    for(i=0;i<n;i++) {
+	auto head_outcome = outcomes[i].get();
+	if(lens) lens[i] = 0;
+	if(head_outcome.IsSuccess()) {
+	    stats[i] = NC_NOERR;
+	    if(lens) lens[i] = (size64_t)head_outcome.GetResult().GetContentLength();
+	} else {
+	    stats[i] = s3errorcode(head_outcome.GetError());
+	    if(stats[i] != NC_EEMPTY && errmsgp && *errmsgp == NULL)
+	        *errmsgp = makeerrmsg(head_outcome.GetError(),pathkeys[i]+1);
+	}
+    }
+    return NCUNTRACE(NC_NOERR);
+}
+
+/*
+Batch form of NC_s3sdkread: all the GET requests are issued
+before any of them is waited on. If contents[i] is NULL, then
+the whole object is read (with no preceding HEAD) into malloc'd
+memory and counts[i] is set to its size.
+stats[i] is set to NC_NOERR, NC_EEMPTY, or some other error.
+@return NC_NOERR unless the batch could not be issued.
+*/
+EXTERNL int
+NC_s3sdkreadn(void* s3client0, const char* bucket, size_t n, const char** pathkeys, size64_t* starts, size64_t* counts, void** contents, int* stats, char** errmsgp)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    char range[1024];
+    const char* key = NULL;
+
+    NCTRACE(11,"bucket=%s n=%llu",bucket,(size64_t)n);
+
+    Aws::S3::S3Client* s3client = (Aws::S3::S3Client*)s3client0;
+    std::vector<Aws::S3::Model::GetObjectOutcomeCallable> outcomes;
+
+    if(errmsgp) *errmsgp = NULL;
+    for(i=0;i<n;i++) {
+	Aws::S3::Model::GetObjectRequest object_request;
+	if(*pathkeys[i] != '/') return NCUNTRACE(NC_EINTERNAL);
+	(void)makes3key(pathkeys[i],&key);
+	object_request.SetBucket(bucket);
+	object_request.SetKey(key);
+	if(contents[i] != NULL) {
+	    if(counts[i] == 0) continue; /* nothing to read */
+	    snprintf(range,sizeof(range),"bytes=%llu-%llu",starts[i],(starts[i]+counts[i])-1);
+	    object_request.SetRange(range);
+	}
+	outcomes.push_back(s3client->GetObjectCallable(object_request));
+    }
+    /* Collect in the same order; skipped requests have no outcome */
+    size_t j = 0;
+    for(i=0;i<n;i++) {
+	stats[i] = NC_NOERR;
+	if(contents[i] != NULL && counts[i] == 0) continue;
+	auto get_object_result = outcomes[j++].get();
+	if(!get_object_result.IsSuccess()) {
+	    stats[i] = s3errorcode(get_object_result.GetError());
+	    if(stats[i] != NC_EEMPTY && errmsgp && *errmsgp == NULL)
+	        *errmsgp = makeerrmsg(get_object_result.GetError(),pathkeys[i]+1);
+	    if(contents[i] == NULL) counts[i] = 0;
+	    continue;
+	}
+	Aws::IOStream &result = get_object_result.GetResultWithOwnership().GetBody();
+	std::string str((std::istreambuf_iterator<char>(result)),std::istreambuf_iterator<char>());
+	size_t slen = str.size();
+	if(contents[i] == NULL) {
+	    if((contents[i] = malloc(slen == 0 ? 1 : slen)) == NULL)
+		{stat = NC_ENOMEM; continue;}
+	    starts[i] = 0;
+	    counts[i] = slen;
+	} else if(slen != counts[i]) {
+	    stats[i] = NC_ES3;
+	    continue;
+	}
+	memcpy(contents[i],str.c_str(),slen);
+    }
+    return NCUNTRACE(stat);
+}
+
 /*
 For S3, I can see no way to do a byterange write;
 so we are effectively writing the whole object
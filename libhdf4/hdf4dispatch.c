@@ -106,6 +106,11 @@ static const NC_Dispatch HDF4_dispatcher = {
 
     NC_NOOP_inq_var_filter_ids,
     NC_NOOP_inq_var_filter_info,
+
+    NC_NOTNC4_def_var_quantize,
+    NC_NOTNC4_inq_var_quantize,
+
+    NC_NOSTATS_inq_var_stats,
 };
 
 const NC_Dispatch *HDF4_dispatch_table = NULL;
@@ -108,6 +108,7 @@ static const NC_Dispatch HDF5_dispatcher = {
 
     NC4_def_var_quantize,
     NC4_inq_var_quantize,
+    NC_NOSTATS_inq_var_stats,
     
 };
 
@@ -4,6 +4,7 @@
  *********************************************************************/
 
 #include "zincludes.h"
+#include "zthread.h"
 
 /**************************************************/
 /* Forwards */
@@ -73,7 +74,11 @@ ncz_create_dataset(NC_FILE_INFO_T* file, NC_GRP_INFO_T* root, const char** contr
     }
 
     /* initialize map handle*/
-    if((stat = nczmap_create(zinfo->controls.mapimpl,nc->path,nc->mode,zinfo->controls.flags,NULL,&zinfo->map)))
+    if(zinfo->controls.flags & FLAG_INMEMORY)
+        stat = nczmap_create(NCZM_MEM,nc->path,nc->mode,zinfo->controls.flags,&zinfo->controls.mapimpl,&zinfo->map);
+    else
+        stat = nczmap_create(zinfo->controls.mapimpl,nc->path,nc->mode,zinfo->controls.flags,NULL,&zinfo->map);
+    if(stat)
 	goto done;
 
 done:
@@ -136,7 +141,11 @@ ncz_open_dataset(NC_FILE_INFO_T* file, const char** controls)
     if((stat = applycontrols(zinfo))) goto done;
 
     /* initialize map handle*/
-    if((stat = nczmap_open(zinfo->controls.mapimpl,nc->path,mode,zinfo->controls.flags,NULL,&zinfo->map)))
+    if(zinfo->controls.flags & FLAG_INMEMORY)
+        stat = nczmap_open(NCZM_MEM,nc->path,mode,zinfo->controls.flags,&zinfo->controls.mapimpl,&zinfo->map);
+    else
+        stat = nczmap_open(zinfo->controls.mapimpl,nc->path,mode,zinfo->controls.flags,NULL,&zinfo->map);
+    if(stat)
 	goto done;
 
     if((stat = ncz_read_superblock(file,&nczarr_version,&zarr_format))) goto done;
@@ -392,9 +401,11 @@ applycontrols(NCZ_FILE_INFO_T* zinfo)
 	    noflags |= FLAG_XARRAYDIMS;
 	    zinfo->controls.flags |= FLAG_PUREZARR; /*noxarray=>zarr*/
 	}
+	else if(strcasecmp(p,CONSOLIDATEDCONTROL)==0) zinfo->controls.flags |= FLAG_CONSOLIDATED;
 	else if(strcasecmp(p,"zip")==0) zinfo->controls.mapimpl = NCZM_ZIP;
 	else if(strcasecmp(p,"file")==0) zinfo->controls.mapimpl = NCZM_FILE;
 	else if(strcasecmp(p,"s3")==0) zinfo->controls.mapimpl = NCZM_S3;
+	else if(strcasecmp(p,"mem")==0) zinfo->controls.flags |= FLAG_INMEMORY;
     }
     /* Apply negative controls by turning off negative flags */
     /* This is necessary to avoid order dependence of mode flags when both positive and negative flags are defined */
@@ -409,6 +420,45 @@ applycontrols(NCZ_FILE_INFO_T* zinfo)
 	if(strcasecmp(value,"fetch")==0)
 	    zinfo->controls.flags |= FLAG_SHOWFETCH;
     }
+    {
+	NCRCglobalstate* ngs = ncrc_getglobalstate();
+	zinfo->controls.nthreads = (ngs == NULL ? 0 : ngs->zarr.threads);
+    }
+    if((value = controllookup((const char**)zinfo->envv_controls,"threads")) != NULL) {
+	unsigned long n;
+	if(sscanf(value,"%lu",&n) == 1)
+	    zinfo->controls.nthreads = (size_t)n;
+    }
+#ifndef ENABLE_NCZARR_THREADS
+    zinfo->controls.nthreads = 0;
+#endif
+    if((value = controllookup((const char**)zinfo->envv_controls,"shard")) != NULL) {
+	unsigned long n;
+	if(sscanf(value,"%lu",&n) == 1)
+	    zinfo->controls.shard = (size_t)n;
+    }
+    if((value = controllookup((const char**)zinfo->envv_controls,"readahead")) != NULL) {
+	unsigned long n;
+	if(sscanf(value,"%lu",&n) == 1)
+	    zinfo->controls.readahead = (size_t)n;
+    }
+    zinfo->controls.writeempty = 1;
+    if((value = controllookup((const char**)zinfo->envv_controls,"writeemptychunks")) != NULL) {
+	if(strcasecmp(value,"false")==0 || strcmp(value,"0")==0)
+	    zinfo->controls.writeempty = 0;
+    }
+    zinfo->controls.writecombine = NCZ_WCOMBINE_CACHESIZE;
+    if((value = controllookup((const char**)zinfo->envv_controls,"writecombine")) != NULL) {
+	unsigned long n;
+	if(sscanf(value,"%lu",&n) == 1)
+	    zinfo->controls.writecombine = (size_t)n;
+    }
+    zinfo->controls.writebehind = 0;
+    if((value = controllookup((const char**)zinfo->envv_controls,"writebehind")) != NULL) {
+	unsigned long n;
+	if(sscanf(value,"%lu",&n) == 1)
+	    zinfo->controls.writebehind = (size_t)n;
+    }
 done:
     nclistfreeall(modelist);
     return stat;
@@ -45,6 +45,7 @@ EXTERNL int ncz_read_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp);
 EXTERNL int ncz_read_file(NC_FILE_INFO_T* file);
 EXTERNL int ncz_write_var(NC_VAR_INFO_T* var);
 EXTERNL int ncz_read_superblock(NC_FILE_INFO_T* zinfo, char** nczarrvp, char** zarrfp);
+EXTERNL void ncz_free_consolidated(NCZ_FILE_INFO_T* zinfo);
 
 /* zutil.c */
 EXTERNL int NCZ_grpkey(const NC_GRP_INFO_T* grp, char** pathp);
@@ -61,6 +62,7 @@ EXTERNL int NCZ_createobject(NCZMAP* zmap, const char* key, size64_t size);
 EXTERNL int NCZ_uploadjson(NCZMAP* zmap, const char* key, NCjson* json);
 EXTERNL int NCZ_downloadjson(NCZMAP* zmap, const char* key, NCjson** jsonp);
 EXTERNL int NCZ_isLittleEndian(void);
+EXTERNL int NCZ_isswapped(const NC_VAR_INFO_T* var);
 EXTERNL int NCZ_subobjects(NCZMAP* map, const char* prefix, const char* tag, char dimsep, NClist* objlist);
 EXTERNL int NCZ_grpname_full(int gid, char** pathp);
 EXTERNL int ncz_get_var_meta(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var);
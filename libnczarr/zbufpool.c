@@ -0,0 +1,131 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+/**
+ * @file
+ * @internal Pool of reusable chunk buffers.
+ *
+ * @author Dennis Heimbigner
+ */
+
+#include "zincludes.h"
+#include "zbufpool.h"
+
+#ifdef ENABLE_NCZARR_THREADS
+#include <pthread.h>
+#endif
+
+/* The tracing code is not thread safe */
+#ifdef ZTRACING
+#undef ENABLE_NCZARR_THREADS
+#endif
+
+struct NCZBufPool {
+    size_t bufsize;
+    size_t maxbufs;
+    size_t nbufs; /* no. of idle buffers in bufs */
+    void** bufs;
+    NCZBufPoolStats stats;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_t mutex;
+#endif
+};
+
+#ifdef ENABLE_NCZARR_THREADS
+#define LOCK(pool) pthread_mutex_lock(&(pool)->mutex)
+#define UNLOCK(pool) pthread_mutex_unlock(&(pool)->mutex)
+#else
+#define LOCK(pool)
+#define UNLOCK(pool)
+#endif
+
+/**
+ * Create a buffer pool.
+ *
+ * @param bufsize size of each buffer
+ * @param maxbufs max no. of idle buffers to keep; 0 => pool only counts
+ * @param poolp return the pool
+ * @return ::NC_NOERR | ::NC_ENOMEM | ::NC_EINVAL
+ */
+int
+NCZ_bufpool_new(size_t bufsize, size_t maxbufs, struct NCZBufPool** poolp)
+{
+    int stat = NC_NOERR;
+    struct NCZBufPool* pool = NULL;
+
+    if(bufsize == 0) return NC_EINVAL;
+    if(maxbufs > MAX_NCZ_BUFPOOL) maxbufs = MAX_NCZ_BUFPOOL;
+    if((pool = calloc(1,sizeof(struct NCZBufPool))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    pool->bufsize = bufsize;
+    pool->maxbufs = maxbufs;
+    if(maxbufs > 0 && (pool->bufs = calloc(maxbufs,sizeof(void*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_init(&pool->mutex,NULL);
+#endif
+    if(poolp) {*poolp = pool; pool = NULL;}
+done:
+    if(pool) {nullfree(pool->bufs); free(pool);}
+    return THROW(stat);
+}
+
+void
+NCZ_bufpool_free(struct NCZBufPool* pool)
+{
+    size_t i;
+    if(pool == NULL) return;
+    for(i=0;i<pool->nbufs;i++) nullfree(pool->bufs[i]);
+    nullfree(pool->bufs);
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_destroy(&pool->mutex);
+#endif
+    free(pool);
+}
+
+size_t
+NCZ_bufpool_bufsize(struct NCZBufPool* pool)
+{
+    return (pool == NULL ? 0 : pool->bufsize);
+}
+
+void*
+NCZ_bufpool_get(struct NCZBufPool* pool)
+{
+    void* buf = NULL;
+    LOCK(pool);
+    if(pool->nbufs > 0) {
+	buf = pool->bufs[--pool->nbufs];
+	pool->bufs[pool->nbufs] = NULL;
+	pool->stats.hits++;
+    } else
+	pool->stats.misses++;
+    UNLOCK(pool);
+    if(buf == NULL) buf = malloc(pool->bufsize);
+    return buf;
+}
+
+void
+NCZ_bufpool_put(struct NCZBufPool* pool, void* buf)
+{
+    if(buf == NULL) return;
+    LOCK(pool);
+    if(pool->nbufs < pool->maxbufs) {
+	pool->bufs[pool->nbufs++] = buf;
+	pool->stats.recycled++;
+	buf = NULL;
+    } else
+	pool->stats.dropped++;
+    UNLOCK(pool);
+    nullfree(buf);
+}
+
+void
+NCZ_bufpool_stats(struct NCZBufPool* pool, NCZBufPoolStats* stats)
+{
+    LOCK(pool);
+    *stats = pool->stats;
+    UNLOCK(pool);
+}
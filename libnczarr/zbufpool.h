@@ -0,0 +1,41 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+#ifndef ZBUFPOOL_H
+#define ZBUFPOOL_H
+
+/*
+A small pool of equally sized scratch buffers used to recycle
+the real (unfiltered) chunk buffers of a variable instead of
+returning them to the heap each time a chunk leaves the cache.
+Pooled buffers are plain malloc'd memory, so a buffer taken from
+the pool may be released with free() and any malloc'd buffer
+of the pool's size may be given to the pool.
+The pool may be used concurrently by worker threads.
+*/
+
+/* Max no. of idle buffers kept by a pool */
+#define MAX_NCZ_BUFPOOL 8
+
+/* Counters; hits are the heap allocations avoided */
+typedef struct NCZBufPoolStats {
+    size_t hits;     /* requests satisfied from the pool */
+    size_t misses;   /* requests that had to allocate */
+    size_t recycled; /* buffers given back to the pool */
+    size_t dropped;  /* buffers freed because the pool was full */
+} NCZBufPoolStats;
+
+struct NCZBufPool; /* Opaque */
+
+extern int NCZ_bufpool_new(size_t bufsize, size_t maxbufs, struct NCZBufPool** poolp);
+extern void NCZ_bufpool_free(struct NCZBufPool* pool);
+extern size_t NCZ_bufpool_bufsize(struct NCZBufPool* pool);
+/* Return a buffer of bufsize bytes (contents undefined); NULL => out of memory */
+extern void* NCZ_bufpool_get(struct NCZBufPool* pool);
+/* Give a buffer of bufsize bytes to the pool; freed if the pool is full */
+extern void NCZ_bufpool_put(struct NCZBufPool* pool, void* buf);
+extern void NCZ_bufpool_stats(struct NCZBufPool* pool, NCZBufPoolStats* stats);
+
+#endif /*ZBUFPOOL_H*/
@@ -11,6 +11,9 @@
 */
 
 struct NCxcache;
+struct NC_hashmap;
+struct NCZBufPool;
+struct NCZBufPoolStats;
 
 /* Note in the following: the term "real"
    refers to the unfiltered/uncompressed data
@@ -22,18 +25,27 @@ struct NCxcache;
    be real or filtered.
 */
 
+/* The map key of a chunk is varkey/chunkkey */
+struct ChunkKey {
+    char* varkey; /* key to the containing variable */
+    char* chunkkey; /* name of the chunk */
+};
+
+/* Entries are identified by their chunk indices; the textual
+   map key is only built when the chunk is read or written */
 typedef struct NCZCacheEntry {
-    struct List {void* next; void* prev; void* unused;} list;
+    struct List {void* next; void* prev; void* unused;} list; /* LRU links; owned by the xcache and must be first */
     int modified;
     size64_t indices[NC_MAX_VAR_DIMS];
-    struct ChunkKey {
-	char* varkey; /* key to the containing variable */
-        char* chunkkey; /* name of the chunk */
-    } key;
-    size64_t hashkey;
+    size64_t hashkey; /* hash of the indices */
     int isfiltered; /* 1=>data contains filtered data else real data */
+    int stored; /* 1=>chunk exists in the map */
+    int isfill; /* 1=>modified chunk holds only fill and is not to be stored */
     size64_t size; /* |data| */
     void* data; /* contains either filtered or real data */
+    unsigned char* written; /* partial entry: bitmap of the elements written into a
+                               fill chunk in place of reading it; NULL => complete */
+    size64_t nwritten; /* no. of bits set in written */
 } NCZCacheEntry;
 
 typedef struct NCZChunkCache {
@@ -44,21 +56,62 @@ typedef struct NCZChunkCache {
     size_t maxentries; /* Max number of entries allowed; maxsize can override */
     size_t maxsize; /* Maximum space used by cache; 0 => nolimit */
     size_t used; /* How much total space is being used */
-    NClist* mru; /* NClist<NCZCacheEntry> all cache entries in mru order */
-    struct NCxcache* xcache;
+    struct NCxcache* xcache; /* indices => entry; also links the entries in LRU order */
+    size64_t keymask; /* applied to the hash keys; all ones except in tests */
     char dimension_separator;
+    NClist* pending; /* NClist<NCZPending*> chunks being loaded by worker threads */
+    struct NC_hashmap* shards; /* shard path => NCZShard*; indices of shards seen so far */
+    struct NCZBufPool* bufpool; /* recycled real chunk buffers */
+    int writeempty; /* 0 => chunks holding only fill are removed rather than stored */
+    struct NCZStats* stats; /* I/O counters of the variable */
+    double waittime; /* time the current transfer spent getting chunks */
+    struct NCZProjMemo* projmemo; /* projections of the last transfer */
+    struct WriteCombine {
+	size_t limit; /* max bytes of held partial entries; NCZ_WCOMBINE_CACHESIZE => maxsize */
+	size_t used; /* bytes of held partial entries */
+	struct NCxcache* held; /* partial entries evicted before they were completed */
+    } wcombine;
+    struct WriteBehind {
+	size_t limit; /* max bytes of chunk writes in progress; 0 => write synchronously */
+	size_t used; /* bytes of chunk writes in progress */
+	NClist* jobs; /* NClist<NCZPending*> chunk writes in the order they were started */
+	int stat; /* first error of a completed write; reported by the next flush */
+    } writebehind;
+    struct Readahead {
+	size_t nchunks; /* chunks to load ahead once access is sequential; 0 => off */
+	size64_t last[NC_MAX_VAR_DIMS]; /* indices of the previously read chunk */
+	int valid; /* 1 => last is defined */
+	int dim; /* dimension along which access is sequential; -1 => C order */
+	size_t run; /* no. of consecutive sequential steps */
+    } readahead;
 } NCZChunkCache;
 
 /**************************************************/
 
+/* Hold as many partial chunks as the chunk cache holds chunks */
+#define NCZ_WCOMBINE_CACHESIZE ((size_t)-1)
+
+#define SHARDED(cache) (((NCZ_VAR_INFO_T*)(cache)->var->format_var_info)->shards != NULL)
 #define FILTERED(cache) (nclistlength((NClist*)(cache)->var->filters) || (cache)->var->shuffle || (cache)->var->fletcher32);
 
 extern int NCZ_set_var_chunk_cache(int ncid, int varid, size_t size, size_t nelems, float preemption);
+extern int NCZ_set_var_chunk_readahead(int ncid, int varid, size_t nchunks);
+extern int NCZ_inq_var_chunk_bufpool(int ncid, int varid, struct NCZBufPoolStats* stats);
+extern int NCZ_inq_var_chunk_cache_used(int ncid, int varid, size_t* usedp, size_t* sizep);
+extern int NCZ_set_var_write_empty_chunks(int ncid, int varid, int writeempty);
+extern int NCZ_set_var_write_combine(int ncid, int varid, size_t limit);
+extern int NCZ_set_var_write_behind(int ncid, int varid, size_t limit);
+extern int NCZ_set_var_cache_keymask(int ncid, int varid, unsigned long long mask);
 extern int NCZ_adjust_var_cache(NC_VAR_INFO_T *var);
 extern int NCZ_create_chunk_cache(NC_VAR_INFO_T* var, size64_t, char dimsep, NCZChunkCache** cachep);
 extern void NCZ_free_chunk_cache(NCZChunkCache* cache);
 extern int NCZ_read_cache_chunk(NCZChunkCache* cache, const size64_t* indices, void** datap);
+extern int NCZ_cache_combining(NCZChunkCache* cache);
+extern int NCZ_modify_cache_chunk(NCZChunkCache* cache, const size64_t* indices, const struct NCZSlice* slices, void** datap);
+extern int NCZ_read_cache_wholechunk(NCZChunkCache* cache, const size64_t* indices, size_t nchunks, void* buffer, void** datap);
+extern int NCZ_prefetch_cache_chunks(NCZChunkCache* cache, size_t n, const size64_t* indices);
 extern int NCZ_flush_chunk_cache(NCZChunkCache* cache);
+extern int NCZ_chunk_cache_modified(NCZChunkCache* cache, const size64_t* indices);
 extern size64_t NCZ_cache_entrysize(NCZChunkCache* cache);
 extern NCZCacheEntry* NCZ_cache_entry(NCZChunkCache* cache, const size64_t* indices);
 extern size64_t NCZ_cache_size(NCZChunkCache* cache);
@@ -11,7 +11,14 @@
 /* Callback functions so we can use with unit tests */
 
 typedef int (*NCZ_reader)(void* source, size64_t* chunkindices, void** chunkdata);
-struct Reader {void* source; NCZ_reader read;};
+/* Optional: announce the chunks that are about to be read, in order */
+typedef int (*NCZ_prefetcher)(void* source, size_t n, const size64_t* chunkindices);
+/* Optional: read a chunk that the transfer (of nchunks chunks) covers whole;
+   *chunkdata is either buffer or data owned by the source */
+typedef int (*NCZ_wholereader)(void* source, size64_t* chunkindices, size_t nchunks, void* buffer, void** chunkdata);
+/* Optional: get a chunk of which only the part slices (NULL => all) is written */
+typedef int (*NCZ_modifier)(void* source, size64_t* chunkindices, const struct NCZSlice* slices, void** chunkdata);
+struct Reader {void* source; NCZ_reader read; NCZ_prefetcher prefetch; NCZ_wholereader readwhole; NCZ_modifier modify;};
 
 /* Define the intersecting set of chunks for a slice
    in terms of chunk indices (not absolute positions)
@@ -54,7 +61,34 @@ typedef struct NCZSliceProjections {
 				   the chunk */
 } NCZSliceProjections;
 
+/* The projections of a slice depend on its position only through
+   the chunk it starts in, so a slice that differs from an earlier
+   one by whole chunks can reuse its projections, shifted */
+typedef struct NCZProjKey {
+    int valid;
+    size64_t phase; /* slice start modulo the chunk length */
+    size64_t extent; /* slice stop - start */
+    size64_t stride;
+    size64_t chunklen;
+    size64_t memlen; /* memory shape in this dimension */
+} NCZProjKey;
+
+/* Per-variable memo of the last projections and the odometers
+   that walk them; owned by the chunk cache */
+typedef struct NCZProjMemo {
+    int rank;
+    NCZProjKey* keys; /* rank keys */
+    NCZSliceProjections* allprojections; /* rank entries */
+    struct NCZOdometer* chunkodom;
+    struct NCZOdometer* slpodom;
+    struct NCZOdometer* memodom;
+} NCZProjMemo;
+
 /* Combine some values to simplify internal argument lists */
+/* Copy count elements between strided (in elements) buffers,
+   byte swapping them if the kernel was selected for that */
+typedef void (*NCZCopy)(size_t typesize, unsigned char* dst, size64_t dststride, const unsigned char* src, size64_t srcstride, size64_t count);
+
 struct Common {
     NC_FILE_INFO_T* file;
     NC_VAR_INFO_T* var;
@@ -68,9 +102,11 @@ struct Common {
     void* memory;
     size_t typesize;
     size64_t chunkcount; /* computed product of chunklens; warning indices, not bytes */
-    int swap; /* var->format_info_file->native_endianness == var->endianness */
+    int swap; /* 1 => stored data is not in native byte order; see NCZ_isswapped */
+    NCZCopy copy; /* kernel chosen for typesize and swap */
     size64_t shape[NC_MAX_VAR_DIMS]; /* shape of the output hyperslab */
     NCZSliceProjections* allprojections;
+    NCZProjMemo* memo; /* if set, owns allprojections and the odometers */
     /* Parametric chunk reader so we can do unittests */
     struct Reader reader;
 };
@@ -101,6 +137,7 @@ EXTERNL int NCZ_projectslices(size64_t* dimlens,
 EXTERNL int NCZ_chunkindexodom(int rank, const NCZChunkRange* ranges, size64_t*, struct NCZOdometer** odom);
 EXTERNL void NCZ_clearsliceprojections(int count, NCZSliceProjections* slpv);
 EXTERNL void NCZ_clearcommon(struct Common* common);
+EXTERNL void NCZ_free_projmemo(NCZProjMemo* memo);
 
 #define floordiv(x,y) ((x) / (y))
 
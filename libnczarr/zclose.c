@@ -5,6 +5,7 @@
 
 #include "zincludes.h"
 #include "zfilter.h"
+#include "zthread.h"
 
 /* Forward */
 static int zclose_group(NC_GRP_INFO_T*);
@@ -47,7 +48,14 @@ ncz_close_file(NC_FILE_INFO_T* file, int abort)
 
     zinfo = file->format_file_info;
 
-    if((stat = nczmap_close(zinfo->map,(abort && zinfo->created)?1:0)))
+    /* All outstanding chunk loads were drained when the caches were freed */
+    NCZ_workers_free(zinfo->workers);
+    zinfo->workers = NULL;
+
+    ncz_free_consolidated(zinfo);
+
+    /* Aborting an in-memory dataset discards it without persisting */
+    if((stat = nczmap_close(zinfo->map,(abort && (zinfo->created || (zinfo->controls.flags & FLAG_INMEMORY)))?1:0)))
 	goto done;
     NCZ_freestringvec(0,zinfo->envv_controls);
     NC_authfree(zinfo->auth);
@@ -176,6 +184,7 @@ zclose_vars(NC_GRP_INFO_T* grp)
         NCZ_free_chunk_cache(zvar->cache);
 	/* reclaim xarray */
 	nclistfreeall(zvar->xarray);
+	nullfree(zvar->shards);
 	nullfree(zvar);
 	var->format_var_info = NULL; /* avoid memory errors */
     }
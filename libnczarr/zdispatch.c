@@ -106,6 +106,7 @@ static const NC_Dispatch NCZ_dispatcher = {
     NCZ_inq_var_filter_info,
     NC_NOTNC4_def_var_quantize,
     NC_NOTNC4_inq_var_quantize,
+    NCZ_inq_var_stats,
 };
 
 const NC_Dispatch* NCZ_dispatch_table = NULL; /* moved here from ddispatch.c */
@@ -68,8 +68,40 @@ typedef struct NCZ_Plugin {
 	const NCZ_codec_t* codec;
 	NCPSharedLib* codeclib; /* of the source codec; null if same as hdf5 */
     } codec;
+    int initialized; /* NCZ_codec_initialize has been called */
 } NCZ_Plugin;
 
+/* What a plugin library provides */
+typedef struct NCZ_PluginId {
+    unsigned hdf5id;
+    char* codecid; /* NULL if the library has no codec for hdf5id */
+} NCZ_PluginId;
+
+/* A candidate plugin library on the plugin path. The libraries are
+   only indexed by NCZ_filter_initialize; each one is loaded the
+   first time one of the filters it (may) provide is needed. */
+typedef struct NCZ_PluginFile {
+    char* name;            /**< Name within its directory */
+    char* path;            /**< Full path of the library */
+    size_t dir;            /**< Index of its directory in plugin_dirs */
+    long long mtime;
+    long long size;
+    int kind;
+#	define PLUGIN_UNKNOWN 0 /* Not yet examined */
+#	define PLUGIN_NONE 1 /* Not a usable plugin library */
+#	define PLUGIN_FILTER 2 /* Provides HDF5 filters and/or codecs */
+#	define PLUGIN_DEFAULTS 3 /* Provides default codecs */
+    int loaded;            /**< NCZ_load_plugin has been applied */
+    NClist* ids;           /**< NClist<NCZ_PluginId*> */
+    NCZ_codec_t** defaults; /**< PLUGIN_DEFAULTS only; NULL terminated */
+    NCPSharedLib* defaultlib; /**< source of the defaults */
+} NCZ_PluginFile;
+
+typedef struct NCZ_PluginDir {
+    char* path;
+    int dirty; /* the manifest is out of date */
+} NCZ_PluginDir;
+
 /* The NC_VAR_INFO_T->filters field is an NClist of this struct */
 /*
 Each filter can have two parts: HDF5 and Codec.
@@ -139,8 +171,13 @@ typedef struct NCZ_Filter {
 NCZ_Plugin* loaded_plugins[H5Z_FILTER_MAX];
 int loaded_plugins_max = -1;
 
-static NCZ_codec_t** codec_defaults; /* NULL terminated */
-static NCPSharedLib* default_lib; /* source of the defaults */
+/* The plugin registry; files are kept in search order */
+static NClist* plugin_dirs = NULL; /* NClist<NCZ_PluginDir*> */
+static NClist* plugin_files = NULL; /* NClist<NCZ_PluginFile*> */
+static int plugin_manifest_mode = 0;
+#define MANIFEST_OFF 0
+#define MANIFEST_READ 1
+#define MANIFEST_UPDATE 2
 
 static int NCZ_filter_initialized = 0;
 
@@ -236,9 +273,14 @@ printfilter(const NCZ_Filter* f)
 
 
 /* Forward */
-static int NCZ_load_all_plugins(void);
-static int NCZ_load_plugin_dir(const char* path);
-static int NCZ_load_plugin(const char* path, NCZ_Plugin** plugp);
+static int NCZ_index_all_plugins(void);
+static int NCZ_index_plugin_dir(size_t dirindex);
+static void NCZ_free_plugin_files(void);
+static int NCZ_load_plugin(NCZ_PluginFile* file);
+static int NCZ_plugin_lookup(unsigned int id, NCZ_Plugin** pp);
+static int NCZ_plugin_lookup_codec(const char* codecid, NCZ_Plugin** pp);
+static int NCZ_read_manifest(size_t dirindex);
+static int NCZ_write_manifest(size_t dirindex);
 static int NCZ_unload_plugin(NCZ_Plugin* plugin);
 static int NCZ_plugin_loaded(int filterid, NCZ_Plugin** pp);
 static int NCZ_plugin_save(int filterid, NCZ_Plugin* p);
@@ -335,9 +377,9 @@ NCZ_addfilter(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, unsigned int id, size_t
     
     if(var->filters == NULL) var->filters = (void*)nclistnew();
 
-    /* Before anything else, find the matching plugin */
-    if((stat = NCZ_plugin_loaded(id,&plugin))) goto done;
-    if(plugin == NULL || plugin->codec.codec == NULL) { /* fail */
+    /* Before anything else, find the matching plugin; this may load it */
+    if((stat = NCZ_plugin_lookup(id,&plugin))) goto done;
+    if(plugin == NULL) { /* fail */
 	ZLOG(NCLOGWARN,"no such plugin: %u",(unsigned)id);
 	stat = NC_ENOFILTER;
 	goto done;
@@ -693,7 +735,7 @@ NCZ_filter_initialize(void)
         NCZ_filter_initialized = 1;
         memset(loaded_plugins,0,sizeof(loaded_plugins));
 #ifdef ENABLE_NCZARR_FILTERS
-        if((stat = NCZ_load_all_plugins())) goto done;
+        if((stat = NCZ_index_all_plugins())) goto done;
 #endif
     }
 done:
@@ -708,13 +750,20 @@ NCZ_filter_finalize(void)
     ZTRACE(6,"");
     if(!NCZ_filter_initialized) goto done;
 #ifdef ENABLE_NCZARR_FILTERS
+    /* Record what was learned about the plugin libraries */
+    if(plugin_manifest_mode == MANIFEST_UPDATE) {
+	size_t d;
+	for(d=0;d<nclistlength(plugin_dirs);d++)
+	    (void)NCZ_write_manifest(d); /* best effort */
+    }
     /* Reclaim all loaded filters */
     for(i=0;i<=loaded_plugins_max;i++) {
         NCZ_unload_plugin(loaded_plugins[i]);
 	loaded_plugins[i] = NULL;
     }
-    /* Reclaim the defaults library; Must occur as last act */
-    if(default_lib != NULL) {(void)ncpsharedlibfree(default_lib); default_lib = NULL; codec_defaults = NULL;}
+    loaded_plugins_max = -1;
+    /* Reclaim the registry, including the defaults libraries; Must occur as last act */
+    NCZ_free_plugin_files();
 #else
     memset(loaded_plugins,0,sizeof(loaded_plugins));
 #endif
@@ -751,15 +800,19 @@ done:
     return ZUNTRACEX(stat,"plugin=%p",*pp);
 }
 
+/**
+ * Make sure the working parameters for all the filters of a
+ * variable are available. This may call back into the netcdf API,
+ * so it must be invoked before the filter chain is applied
+ * from a worker thread.
+ */
 int
-NCZ_applyfilterchain(const NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, NClist* chain, size_t inlen, void* indata, size_t* outlenp, void** outdatap, int encode)
+NCZ_filter_prepare(const NC_FILE_INFO_T* file, NC_VAR_INFO_T* var)
 {
     int i, stat = NC_NOERR;
-    void* lastbuffer = NULL; /* if not null, then last allocated buffer */
+    NClist* chain = (NClist*)var->filters;
 
-    ZTRACE(6,"|chain|=%u inlen=%u indata=%p encode=%d", (unsigned)nclistlength(chain), (unsigned)inlen, indata, encode);
-
-    /* Make sure all the filters are loaded && setup */
+    NC_UNUSED(file);
     for(i=0;i<nclistlength(chain);i++) {
 	struct NCZ_Filter* f = (struct NCZ_Filter*)nclistget(chain,i);
 	assert(f != NULL && f->hdf5.id > 0 && f->plugin != NULL);
@@ -767,6 +820,20 @@ NCZ_applyfilterchain(const NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, NClist* cha
 	    if((stat = ensure_working(var,f))) goto done;
 	}
     }
+done:
+    return THROW(stat);
+}
+
+int
+NCZ_applyfilterchain(const NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, NClist* chain, size_t inlen, void* indata, size_t* outlenp, void** outdatap, int encode)
+{
+    int i, stat = NC_NOERR;
+    void* lastbuffer = NULL; /* if not null, then last allocated buffer */
+
+    ZTRACE(6,"|chain|=%u inlen=%u indata=%p encode=%d", (unsigned)nclistlength(chain), (unsigned)inlen, indata, encode);
+
+    /* Make sure all the filters are loaded && setup */
+    if((stat = NCZ_filter_prepare(file,var))) goto done;
 
     {
 	struct NCZ_Filter* f = NULL;
@@ -882,7 +949,7 @@ done:
 int
 NCZ_filter_build(const NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, const NCjson* jfilter)
 {
-    int i,stat = NC_NOERR;
+    int stat = NC_NOERR;
     NCZ_Filter* filter = NULL;
     NCjson* jvalue = NULL;
     NCZ_Plugin* plugin = NULL;
@@ -905,12 +972,8 @@ NCZ_filter_build(const NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, const NCjson* j
         {stat = NC_ENOMEM; goto done;}
     if(NCJunparse(jfilter,0,&codec.codec)<0) {stat = NC_EFILTER; goto done;}
 
-    /* Find the plugin for this filter */
-    for(i=0;i<=loaded_plugins_max;i++) {
-        if (!loaded_plugins[i]) continue;
-        if(strcmp(NCJstring(jvalue), loaded_plugins[i]->codec.codec->codecid) == 0)
-	    {plugin = loaded_plugins[i]; break;}
-    }
+    /* Find the plugin for this filter; this may load it */
+    if((stat = NCZ_plugin_lookup_codec(NCJstring(jvalue),&plugin))) goto done;
 
     if(plugin != NULL) {
 	/* Save the hdf5 id */
@@ -1048,10 +1111,12 @@ done:
 #endif /*_WIN32*/
 
 static int
-NCZ_load_all_plugins(void)
+NCZ_index_all_plugins(void)
 {
-    int i,ret = NC_NOERR;
+    int ret = NC_NOERR;
+    size_t i;
     const char* pluginroot = NULL;
+    const char* mode = NULL;
     struct stat buf;
     NClist* dirs = nclistnew();
 #ifdef _WIN32
@@ -1061,9 +1126,18 @@ NCZ_load_all_plugins(void)
    ZTRACE(6,"");
 
 #ifdef DEBUGL
-   fprintf(stderr,"DEBUGL: NCZ_load_all_plugins\n");
+   fprintf(stderr,"DEBUGL: NCZ_index_all_plugins\n");
 #endif
 
+    /* Decide how the manifests are used */
+    mode = getenv(plugin_manifest_env);
+    if(mode == NULL || strlen(mode) == 0 || strcasecmp(mode,"read")==0)
+        plugin_manifest_mode = MANIFEST_READ;
+    else if(strcasecmp(mode,"update")==0)
+        plugin_manifest_mode = MANIFEST_UPDATE; /* only on request */
+    else
+        plugin_manifest_mode = MANIFEST_OFF;
+
    /* Find the plugin directory root(s) */
     pluginroot = getenv(plugin_env);
     if(pluginroot == NULL || strlen(pluginroot) == 0) {
@@ -1088,7 +1162,10 @@ NCZ_load_all_plugins(void)
 
     if((ret = NCZ_split_plugin_path(pluginroot,dirs))) goto done;
 
+    plugin_dirs = nclistnew();
+    plugin_files = nclistnew();
     for(i=0;i<nclistlength(dirs);i++) {
+	NCZ_PluginDir* pdir = NULL;
 	const char* dir = (const char*)nclistget(dirs,i);
         /* Make sure the root is actually a directory */
         errno = 0;
@@ -1102,61 +1179,14 @@ NCZ_load_all_plugins(void)
             ret = NC_EINVAL;
         if(ret) goto done;
 
-        /* Try to load plugins from this directory */
-        if((ret = NCZ_load_plugin_dir(dir))) goto done;
-    }
+	if((pdir = (NCZ_PluginDir*)calloc(1,sizeof(NCZ_PluginDir)))==NULL) {ret = NC_ENOMEM; goto done;}
+	nclistpush(plugin_dirs,pdir);
+	if((pdir->path = strdup(dir))==NULL) {ret = NC_ENOMEM; goto done;}
 
-    if(codec_defaults != NULL) { /* Try to provide default for any HDF5 filters without matching Codec. */
-        NCZ_codec_t** dfalts = NULL;
-        /* Search the defaults */
-        for(dfalts = codec_defaults;*dfalts;dfalts++) {
-	    NCZ_codec_t* codec = *dfalts;
-	    int hdf5id = codec->hdf5id;
-	    NCZ_Plugin* p = loaded_plugins[hdf5id]; /* get candidate */
-	    if(p != NULL && p->hdf5.filter != NULL && p->codec.codec == NULL) {
-#ifdef DEBUGL
-	        fprintf(stderr,"DEBUGL: plugin defaulted: id=%u, codec=%s\n",hdf5id,codec->codecid);
-#endif
-		p->codec.codec = codec; codec = NULL;
-		p->codec.codeclib = NULL;
-	    }
-	}
+        /* Index the libraries in this directory */
+        if((ret = NCZ_index_plugin_dir(nclistlength(plugin_dirs)-1))) goto done;
     }
 
-    /* Expunge all plugins for which we do not have both HDF5 and codec */
-    {
-        int i;
-	NCZ_Plugin* p;
-	for(i=0;i<loaded_plugins_max;i++) {
-	    if((p = loaded_plugins[i]) != NULL) {
-		if(p->hdf5.filter == NULL || p->codec.codec == NULL) {
-#ifdef DEBUGL
-		    fprintf(stderr,"DEBUGL: plugin expunged: id=%u\n",p->hdf5.filter->id);
-#endif
-		    /* expunge this entry */
-		    (void)NCZ_unload_plugin(p);
-		    loaded_plugins[i] = NULL;
-		}
-	    }
-	}
-    }
-    /* Iniitalize all remaining plugins */
-    {
-        int i;
-	NCZ_Plugin* p;
-	for(i=0;i<loaded_plugins_max;i++) {
-	    if((p = loaded_plugins[i]) != NULL) {
-		if(p->hdf5.filter != NULL && p->codec.codec != NULL) {
-		    if(p->codec.codec && p->codec.codec->NCZ_codec_initialize)
-			p->codec.codec->NCZ_codec_initialize();
-#ifdef DEBUGL
-		    fprintf(stderr,"DEBUGL: plugin initialized: id=%u\n",p->hdf5.filter->id);
-#endif
-		}
-	    }
-	}
-    }
-    
 done:
     nclistfreeall(dirs);
     errno = 0;
@@ -1199,72 +1229,440 @@ done:
 }
 
 
-/* Load all the filters within a specified directory */
+#define MANIFEST_HEADER "# NCZarr plugin manifest 1"
+
+static const char* plugin_kind_names[] = {"unknown","none","filter","defaults"};
+
+static void
+NCZ_clear_plugin_ids(NCZ_PluginFile* pf)
+{
+    size_t i;
+    for(i=0;i<nclistlength(pf->ids);i++) {
+	NCZ_PluginId* pid = (NCZ_PluginId*)nclistget(pf->ids,i);
+	nullfree(pid->codecid);
+	free(pid);
+    }
+    nclistclear(pf->ids);
+}
+
+static int
+NCZ_add_plugin_id(NCZ_PluginFile* pf, unsigned int hdf5id, const char* codecid)
+{
+    NCZ_PluginId* pid = NULL;
+    if((pid = (NCZ_PluginId*)calloc(1,sizeof(NCZ_PluginId)))==NULL) return NC_ENOMEM;
+    pid->hdf5id = hdf5id;
+    if(codecid != NULL && (pid->codecid = strdup(codecid))==NULL)
+	{free(pid); return NC_ENOMEM;}
+    nclistpush(pf->ids,pid);
+    return NC_NOERR;
+}
+
+/* Does a library provide something for the given HDF5 filter id? */
 static int
-NCZ_load_plugin_dir(const char* path)
+NCZ_plugin_provides(const NCZ_PluginFile* pf, unsigned int id)
 {
-    int i,stat = NC_NOERR;
-    size_t pathlen;
+    size_t i;
+    for(i=0;i<nclistlength(pf->ids);i++) {
+	const NCZ_PluginId* pid = (const NCZ_PluginId*)nclistget(pf->ids,i);
+	if(pid->hdf5id == id) return 1;
+    }
+    return 0;
+}
+
+static void
+NCZ_free_plugin_file(NCZ_PluginFile* pf)
+{
+    if(pf == NULL) return;
+    NCZ_clear_plugin_ids(pf);
+    nclistfree(pf->ids);
+    if(pf->defaultlib != NULL) (void)ncpsharedlibfree(pf->defaultlib);
+    nullfree(pf->name);
+    nullfree(pf->path);
+    free(pf);
+}
+
+static void
+NCZ_free_plugin_files(void)
+{
+    size_t i;
+    for(i=0;i<nclistlength(plugin_files);i++)
+	NCZ_free_plugin_file((NCZ_PluginFile*)nclistget(plugin_files,i));
+    nclistfree(plugin_files);
+    plugin_files = NULL;
+    for(i=0;i<nclistlength(plugin_dirs);i++) {
+	NCZ_PluginDir* pdir = (NCZ_PluginDir*)nclistget(plugin_dirs,i);
+	nullfree(pdir->path);
+	free(pdir);
+    }
+    nclistfree(plugin_dirs);
+    plugin_dirs = NULL;
+}
+
+static char*
+NCZ_manifest_path(const char* dir)
+{
+    size_t len = strlen(dir)+1+strlen(plugin_manifest)+1;
+    char* path = (char*)malloc(len);
+    if(path != NULL) {
+	path[0] = '\0';
+	strlcat(path,dir,len);
+	strlcat(path,"/",len);
+	strlcat(path,plugin_manifest,len);
+    }
+    return path;
+}
+
+/* Return the current tab separated field and advance past it */
+static char*
+nextfield(char** linep)
+{
+    char* field = *linep;
+    char* p;
+    if(field == NULL) return NULL;
+    p = strchr(field,'\t');
+    if(p != NULL) *p++ = '\0';
+    *linep = p;
+    return field;
+}
+
+/* Index the libraries within a specified directory without loading them */
+static int
+NCZ_index_plugin_dir(size_t dirindex)
+{
+    int ret = NC_NOERR;
+    size_t i, pathlen;
+    NCZ_PluginDir* pdir = (NCZ_PluginDir*)nclistget(plugin_dirs,dirindex);
     NClist* contents = nclistnew();
-    char* file = NULL;
+    NCZ_PluginFile* pf = NULL;
+    struct stat buf;
 
-    ZTRACE(7,"path=%s",path);
+    ZTRACE(7,"path=%s",pdir->path);
 
 #ifdef DEBUGL
-   fprintf(stderr,"DEBUGL: NCZ_load_plugin_dir: path=%s\n",path);
+   fprintf(stderr,"DEBUGL: NCZ_index_plugin_dir: path=%s\n",pdir->path);
 #endif
 
-    if(path == NULL) {stat = NC_EINVAL; goto done;}
-    pathlen = strlen(path);
-    if(pathlen == 0) {stat = NC_EINVAL; goto done;}
+    pathlen = strlen(pdir->path);
+    if(pathlen == 0) {ret = NC_EINVAL; goto done;}
 
-    if((stat = getentries(path,contents))) goto done;
+    if((ret = getentries(pdir->path,contents))) goto done;
     for(i=0;i<nclistlength(contents);i++) {
         const char* name = (const char*)nclistget(contents,i);
-	size_t nmlen = strlen(name);
-	size_t flen = pathlen+1+nmlen+1;
-	int id;
-	NCZ_Plugin* plugin = NULL;
-
-	assert(nmlen > 0);
-	nullfree(file); file = NULL;
-	if((file = (char*)malloc(flen))==NULL) {stat = NC_ENOMEM; goto done;}
-	file[0] = '\0';
-	strlcat(file,path,flen);
-	strlcat(file,"/",flen);
-	strlcat(file,name,flen);
-	/* See if can load the file */
-	switch ((stat = NCZ_load_plugin(file,&plugin))) {
-	case NC_NOERR: break;
-	case NC_ENOFILTER: case NC_ENOTFOUND: stat = NC_NOERR; break; /* will cause it to be ignored */
-	default: goto done;
+	size_t flen = pathlen+1+strlen(name)+1;
+
+	/* Skip the manifest and any temporary left while writing it */
+	if(strncmp(name,plugin_manifest,strlen(plugin_manifest))==0) continue;
+	if((pf = (NCZ_PluginFile*)calloc(1,sizeof(NCZ_PluginFile)))==NULL) {ret = NC_ENOMEM; goto done;}
+	pf->ids = nclistnew();
+	if((pf->name = strdup(name))==NULL) {ret = NC_ENOMEM; goto done;}
+	if((pf->path = (char*)malloc(flen))==NULL) {ret = NC_ENOMEM; goto done;}
+	pf->path[0] = '\0';
+	strlcat(pf->path,pdir->path,flen);
+	strlcat(pf->path,"/",flen);
+	strlcat(pf->path,name,flen);
+	/* Only regular files can be plugin libraries */
+	if(NCstat(pf->path,&buf) < 0 || !S_ISREG(buf.st_mode)) {
+	    NCZ_free_plugin_file(pf); pf = NULL;
+	    continue;
+	}
+	pf->dir = dirindex;
+	pf->mtime = (long long)buf.st_mtime;
+	pf->size = (long long)buf.st_size;
+	pf->kind = PLUGIN_UNKNOWN;
+	nclistpush(plugin_files,pf);
+	pf = NULL;
+    }
+
+    /* Fill in what is already known about the libraries */
+    if(plugin_manifest_mode != MANIFEST_OFF) {
+	if((ret = NCZ_read_manifest(dirindex))) goto done;
+    }
+    for(i=0;i<nclistlength(plugin_files);i++) {
+	NCZ_PluginFile* f = (NCZ_PluginFile*)nclistget(plugin_files,i);
+	if(f->dir == dirindex && f->kind == PLUGIN_UNKNOWN) pdir->dirty = 1;
+    }
+
+done:
+    errno = 0;
+    NCZ_free_plugin_file(pf);
+    nclistfreeall(contents);
+    return ZUNTRACE(ret);
+}
+
+/**
+ * Fill in the registry from the manifest of a plugin directory.
+ * An entry is only trusted if the size and modification time of
+ * its library are unchanged; a missing or malformed manifest is
+ * not an error.
+ */
+static int
+NCZ_read_manifest(size_t dirindex)
+{
+    int stat = NC_NOERR;
+    size_t i, mlen;
+    NCZ_PluginDir* pdir = (NCZ_PluginDir*)nclistget(plugin_dirs,dirindex);
+    NCbytes* buf = ncbytesnew();
+    char* mpath = NULL;
+    char* line = NULL;
+    char* next = NULL;
+
+    if((mpath = NCZ_manifest_path(pdir->path))==NULL) {stat = NC_ENOMEM; goto done;}
+    if(NC_readfile(mpath,buf) != NC_NOERR) goto done; /* no manifest */
+    line = ncbytescontents(buf);
+    mlen = strlen(MANIFEST_HEADER);
+    if(strncmp(line,MANIFEST_HEADER,mlen) != 0 || (line[mlen] != '\n' && line[mlen] != '\0'))
+	{pdir->dirty = 1; goto done;}
+    for(;line != NULL && *line != '\0';line = next) {
+	NCZ_PluginFile* pf = NULL;
+	char* p = NULL;
+	char *name, *smtime, *ssize, *skind, *sid;
+	int kind;
+
+	next = strchr(line,'\n');
+	if(next != NULL) *next++ = '\0';
+	if(*line == '#') continue;
+	p = line;
+	name = nextfield(&p);
+	smtime = nextfield(&p);
+	ssize = nextfield(&p);
+	skind = nextfield(&p);
+	if(skind == NULL) {pdir->dirty = 1; continue;} /* malformed */
+	for(i=0;i<nclistlength(plugin_files);i++) {
+	    NCZ_PluginFile* f = (NCZ_PluginFile*)nclistget(plugin_files,i);
+	    if(f->dir == dirindex && strcmp(f->name,name)==0) {pf = f; break;}
+	}
+	for(kind=PLUGIN_NONE;kind<=PLUGIN_DEFAULTS;kind++)
+	    if(strcmp(skind,plugin_kind_names[kind])==0) break;
+	if(pf == NULL || pf->kind != PLUGIN_UNKNOWN || kind > PLUGIN_DEFAULTS
+	   || pf->mtime != strtoll(smtime,NULL,10) || pf->size != strtoll(ssize,NULL,10))
+	    {pdir->dirty = 1; continue;} /* stale */
+	while((sid = nextfield(&p)) != NULL) {
+	    char* codecid = strchr(sid,':');
+	    unsigned long id;
+	    if(codecid != NULL) *codecid++ = '\0';
+	    id = strtoul(sid,NULL,10);
+	    if(id == 0 || id >= H5Z_FILTER_MAX) {kind = PLUGIN_UNKNOWN; break;}
+	    if((stat = NCZ_add_plugin_id(pf,(unsigned)id,codecid))) goto done;
+	}
+	if(kind == PLUGIN_UNKNOWN) { /* malformed */
+	    NCZ_clear_plugin_ids(pf);
+	    pdir->dirty = 1;
+	    continue;
+	}
+	pf->kind = kind;
+    }
+
+done:
+    nullfree(mpath);
+    ncbytesfree(buf);
+    return stat;
+}
+
+/**
+ * Rewrite the manifest of a plugin directory if it is out of date.
+ * This is best effort: a directory that cannot be written is left alone,
+ * and the new manifest is renamed into place so that concurrent readers
+ * never see it partially written.
+ */
+static int
+NCZ_write_manifest(size_t dirindex)
+{
+    int stat = NC_NOERR;
+    size_t i,j;
+    NCZ_PluginDir* pdir = (NCZ_PluginDir*)nclistget(plugin_dirs,dirindex);
+    NCbytes* buf = NULL;
+    char* mpath = NULL;
+    char* tmppath = NULL;
+    char num[64];
+
+    if(!pdir->dirty) goto done;
+    if(NCaccess(pdir->path,ACCESS_MODE_W) != 0) goto done;
+
+    buf = ncbytesnew();
+    ncbytescat(buf,MANIFEST_HEADER);
+    ncbytescat(buf,"\n");
+    for(i=0;i<nclistlength(plugin_files);i++) {
+	NCZ_PluginFile* pf = (NCZ_PluginFile*)nclistget(plugin_files,i);
+	int ok = 1;
+	if(pf->dir != dirindex || pf->kind == PLUGIN_UNKNOWN) continue;
+	/* Omit anything that the format cannot represent */
+	if(strpbrk(pf->name,"\t\n") != NULL) ok = 0;
+	for(j=0;ok && j<nclistlength(pf->ids);j++) {
+	    NCZ_PluginId* pid = (NCZ_PluginId*)nclistget(pf->ids,j);
+	    if(pid->codecid != NULL && strpbrk(pid->codecid,"\t\n") != NULL) ok = 0;
+	}
+	if(!ok) continue;
+	ncbytescat(buf,pf->name);
+	snprintf(num,sizeof(num),"\t%lld\t%lld\t",pf->mtime,pf->size);
+	ncbytescat(buf,num);
+	ncbytescat(buf,plugin_kind_names[pf->kind]);
+	for(j=0;j<nclistlength(pf->ids);j++) {
+	    NCZ_PluginId* pid = (NCZ_PluginId*)nclistget(pf->ids,j);
+	    snprintf(num,sizeof(num),"\t%u",pid->hdf5id);
+	    ncbytescat(buf,num);
+	    if(pid->codecid != NULL) {
+		ncbytescat(buf,":");
+		ncbytescat(buf,pid->codecid);
+	    }
+	}
+	ncbytescat(buf,"\n");
+    }
+
+    if((mpath = NCZ_manifest_path(pdir->path))==NULL) {stat = NC_ENOMEM; goto done;}
+    if((tmppath = NC_mktmp(mpath))==NULL) {stat = NC_ENOMEM; goto done;}
+    if((stat = NC_writefile(tmppath,ncbyteslength(buf),ncbytescontents(buf)))) goto done;
+#ifdef _WIN32
+    (void)NCremove(mpath); /* rename will not replace an existing file */
+#endif
+    if(rename(tmppath,mpath) != 0) {stat = errno; goto done;}
+    nullfree(tmppath); tmppath = NULL;
+    pdir->dirty = 0;
+
+done:
+    if(tmppath != NULL) {(void)NCremove(tmppath); free(tmppath);}
+    nullfree(mpath);
+    ncbytesfree(buf);
+    errno = 0;
+    return stat;
+}
+
+/**
+ * Find the plugin implementing an HDF5 filter id, loading libraries
+ * from the registry as needed. Libraries are tried in search order,
+ * so the first library providing the filter or codec wins, just as if
+ * all of them had been loaded; default codecs are only used when no
+ * remaining library can supply one. Only a plugin with both an HDF5
+ * filter and a codec is returned.
+ */
+static int
+NCZ_plugin_lookup(unsigned int id, NCZ_Plugin** pp)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    NCZ_Plugin* plugin = NULL;
+
+    ZTRACE(6,"id=%u",id);
+
+    if(id == 0 || id >= H5Z_FILTER_MAX) {stat = NC_EINVAL; goto done;}
+
+    for(;;) {
+	NCZ_PluginFile* next = NULL;
+	plugin = loaded_plugins[id];
+	if(plugin != NULL && plugin->hdf5.filter != NULL && plugin->codec.codec != NULL) break;
+	/* Find the next library that may contribute */
+	for(i=0;i<nclistlength(plugin_files);i++) {
+	    NCZ_PluginFile* pf = (NCZ_PluginFile*)nclistget(plugin_files,i);
+	    if(pf->loaded) continue;
+	    if(pf->kind == PLUGIN_UNKNOWN || (pf->kind == PLUGIN_FILTER && NCZ_plugin_provides(pf,id)))
+		{next = pf; break;}
 	}
-	if(plugin != NULL) {
-	    id = plugin->hdf5.filter->id;
-	    if(loaded_plugins[id] == NULL) {
-	        loaded_plugins[id] = plugin;
-		if(id > loaded_plugins_max) loaded_plugins_max = id;
+	if(next == NULL) break;
+	if((stat = NCZ_load_plugin(next))) goto done;
+    }
+
+    /* Try to provide a default for an HDF5 filter without matching codec */
+    if(plugin != NULL && plugin->hdf5.filter != NULL && plugin->codec.codec == NULL) {
+	for(i=0;i<nclistlength(plugin_files) && plugin->codec.codec == NULL;i++) {
+	    NCZ_PluginFile* pf = (NCZ_PluginFile*)nclistget(plugin_files,i);
+	    NCZ_codec_t** dfalts = NULL;
+	    if(pf->kind != PLUGIN_DEFAULTS || !NCZ_plugin_provides(pf,id)) continue;
+	    if((stat = NCZ_load_plugin(pf))) goto done;
+	    for(dfalts=pf->defaults;dfalts != NULL && *dfalts != NULL;dfalts++) {
+		if((*dfalts)->hdf5id != id) continue;
 #ifdef DEBUGL
-		fprintf(stderr,"DEBUGL: plugin loaded: %s\n",printplugin(plugin));
+	        fprintf(stderr,"DEBUGL: plugin defaulted: id=%u, codec=%s\n",id,(*dfalts)->codecid);
 #endif
-	    } else {
+		plugin->codec.codec = *dfalts;
+		plugin->codec.codeclib = NULL;
+		break;
+	    }
+	}
+    }
+
+    /* Plugins for which we do not have both HDF5 and codec are unusable */
+    if(plugin != NULL && (plugin->hdf5.filter == NULL || plugin->codec.codec == NULL))
+	plugin = NULL;
+
+    if(plugin != NULL && !plugin->initialized) {
+	if(plugin->codec.codec->NCZ_codec_initialize)
+	    plugin->codec.codec->NCZ_codec_initialize();
+	plugin->initialized = 1;
 #ifdef DEBUGL
-		fprintf(stderr,"DEBUGL: plugin duplicate: %s\n",printplugin(plugin));
+	fprintf(stderr,"DEBUGL: plugin initialized: id=%u\n",id);
 #endif
-	        NCZ_unload_plugin(plugin); /* its a duplicate */
+    }
+
+done:
+    if(pp) *pp = plugin;
+    return ZUNTRACEX(stat,"plugin=%p",plugin);
+}
+
+/**
+ * Find the plugin implementing a codec. The codec is mapped to its
+ * HDF5 filter id using what the registry knows, examining libraries
+ * in search order only until the first one providing the codec.
+ */
+static int
+NCZ_plugin_lookup_codec(const char* codecid, NCZ_Plugin** pp)
+{
+    int stat = NC_NOERR;
+    size_t i,j;
+    NCZ_Plugin* plugin = NULL;
+
+    ZTRACE(6,"codecid=%s",codecid);
+
+    for(;;) {
+	NCZ_PluginFile* next = NULL;
+	int found = 0;
+	unsigned int id = 0;
+	for(i=0;!found && next == NULL && i<nclistlength(plugin_files);i++) {
+	    NCZ_PluginFile* pf = (NCZ_PluginFile*)nclistget(plugin_files,i);
+	    if(pf->kind == PLUGIN_UNKNOWN) {next = pf; break;}
+	    for(j=0;j<nclistlength(pf->ids);j++) {
+		NCZ_PluginId* pid = (NCZ_PluginId*)nclistget(pf->ids,j);
+		if(pid->codecid != NULL && strcmp(pid->codecid,codecid)==0)
+		    {id = pid->hdf5id; found = 1; break;}
 	    }
-	} else
-	    stat = NC_NOERR; /*ignore failure */
-    }	
+	}
+	if(found) {
+	    if((stat = NCZ_plugin_lookup(id,&plugin))) goto done;
+	    if(plugin != NULL && strcmp(plugin->codec.codec->codecid,codecid) != 0)
+		plugin = NULL; /* The filter is implemented with a different codec */
+	    break;
+	}
+	if(next == NULL) break;
+	if((stat = NCZ_load_plugin(next))) goto done;
+    }
 
 done:
-    nullfree(file);
-    nclistfreeall(contents);
-    return ZUNTRACE(stat);
+    if(pp) *pp = plugin;
+    return ZUNTRACEX(stat,"plugin=%p",plugin);
 }
 
+/* Report how many plugin libraries are registered, how many of those
+   are described (by loading or by a manifest) and how many were loaded */
+int
+NCZ_plugin_stats(size_t* nfilesp, size_t* nknownp, size_t* nloadedp)
+{
+    int stat = NC_NOERR;
+    size_t i, nknown = 0, nloaded = 0;
+
+    if((stat = NCZ_filter_initialize())) goto done;
+    for(i=0;i<nclistlength(plugin_files);i++) {
+	NCZ_PluginFile* pf = (NCZ_PluginFile*)nclistget(plugin_files,i);
+	if(pf->kind != PLUGIN_UNKNOWN) nknown++;
+	if(pf->loaded) nloaded++;
+    }
+    if(nfilesp) *nfilesp = nclistlength(plugin_files);
+    if(nknownp) *nknownp = nknown;
+    if(nloadedp) *nloadedp = nloaded;
+done:
+    return stat;
+}
+
+/* Load a library from the registry and record what it provides */
 static int
-NCZ_load_plugin(const char* path, struct NCZ_Plugin** plugp)
+NCZ_load_plugin(NCZ_PluginFile* pf)
 {
     int stat = NC_NOERR;
     NCZ_Plugin* plugin = NULL;
@@ -1273,20 +1671,25 @@ NCZ_load_plugin(const char* path, struct NCZ_Plugin** plugp)
     NCPSharedLib* lib = NULL;
     int flags = NCP_GLOBAL;
     int h5id = -1;
+    int oldkind = pf->kind;
+    const char* path = pf->path;
     
-    assert(path != NULL && strlen(path) > 0 && plugp != NULL);
+    assert(path != NULL && strlen(path) > 0);
 
     ZTRACE(8,"path=%s",path);
 
+    if(pf->loaded) goto done;
+    pf->loaded = 1;
+    pf->kind = PLUGIN_UNKNOWN;
+    NCZ_clear_plugin_ids(pf);
+
 #ifdef DEBUGL
    fprintf(stderr,"DEBUGL: NCZ_load_plugin: path=%s\n",path);
 #endif
 
-    if(plugp) *plugp = NULL;
-
 #ifdef _WIN32
     /*triage because visual studio does a popup if the file will not load*/
-    if(memcmp(path+(strlen(path)-4),".dll",4) != 0) {
+    if(strlen(path) < 4 || memcmp(path+(strlen(path)-4),".dll",4) != 0) {
 	stat = NC_ENOFILTER; goto done;
     }
 #endif
@@ -1304,10 +1707,13 @@ NCZ_load_plugin(const char* path, struct NCZ_Plugin** plugp)
 
 	/* Deal with defaults first */
 	if(cpd != NULL) {
-	    if(codec_defaults == NULL) {
-		codec_defaults = (NCZ_codec_t**)cpd();
-		default_lib = lib; lib = NULL;
+	    NCZ_codec_t** dfalts = NULL;
+	    pf->defaults = (NCZ_codec_t**)cpd();
+	    pf->defaultlib = lib; lib = NULL;
+	    for(dfalts=pf->defaults;dfalts != NULL && *dfalts != NULL;dfalts++) {
+		if((stat = NCZ_add_plugin_id(pf,(*dfalts)->hdf5id,(*dfalts)->codecid))) goto done;
 	    }
+	    pf->kind = PLUGIN_DEFAULTS;
 	    goto done;
 	}	
 
@@ -1358,6 +1764,10 @@ fprintf(stderr,"\n");
 	h5id = codec->hdf5id;
 	if((stat = NCZ_plugin_loaded(codec->hdf5id,&plugin))) goto done;
     }
+    /* Record what this library provides */
+    if((stat = NCZ_add_plugin_id(pf,(unsigned)h5id,(codec?codec->codecid:NULL)))) goto done;
+    pf->kind = PLUGIN_FILTER;
+
     if(plugin == NULL) {
 	/* create new entry */
 	if((plugin = (NCZ_Plugin*)calloc(1,sizeof(NCZ_Plugin)))==NULL) {stat = NC_ENOMEM; goto done;}
@@ -1380,7 +1790,6 @@ fprintf(stderr,"\n");
        fprintf(stderr,"DEBUGL: load_plugin: %s\n",printplugin(plugin));
 #endif
 
-
     /* Cleanup */
     if(plugin->hdf5.hdf5lib == plugin->codec.codeclib)
 	    plugin->codec.codeclib = NULL;
@@ -1392,7 +1801,15 @@ done:
         (void)ncpsharedlibfree(lib);
     }
     if(plugin) NCZ_unload_plugin(plugin);
-    return ZUNTRACEX(stat,"plug=%p",*plugp);
+    /* A library that cannot be used is ignored from now on */
+    if(stat != NC_ENOMEM && (stat != NC_NOERR || pf->kind == PLUGIN_UNKNOWN)) {
+	NCZ_clear_plugin_ids(pf);
+	pf->kind = PLUGIN_NONE;
+	stat = NC_NOERR;
+    }
+    if(pf->kind != oldkind)
+	((NCZ_PluginDir*)nclistget(plugin_dirs,pf->dir))->dirty = 1;
+    return ZUNTRACE(stat);
 }
 
 static int
@@ -1404,7 +1821,7 @@ NCZ_unload_plugin(NCZ_Plugin* plugin)
 #ifdef DEBUGL
         fprintf(stderr,"DEBUGL: unload: %s\n",printplugin(plugin));
 #endif
-	if(plugin->codec.codec && plugin->codec.codec->NCZ_codec_finalize)
+	if(plugin->initialized && plugin->codec.codec && plugin->codec.codec->NCZ_codec_finalize)
 		plugin->codec.codec->NCZ_codec_finalize();
         if(plugin->hdf5.filter != NULL) loaded_plugins[plugin->hdf5.filter->id] = NULL;
 	if(plugin->hdf5.hdf5lib != NULL) (void)ncpsharedlibfree(plugin->hdf5.hdf5lib);
@@ -25,6 +25,11 @@
 #define plugin_dir_win "%s/hdf5/lib/plugin"
 #define win32_root_env "ALLUSERSPROFILE"
 
+/* Per-directory record of what each plugin library provides */
+#define plugin_manifest ".nczplugins"
+/* One of off, read (the default), or update */
+#define plugin_manifest_env "NCZ_PLUGIN_MANIFEST"
+
 /*
 Return a NULL terminated vector of pointers to instances of ''NCZ_codec_t''.
 The value returned is actually of type ''NCZ_codec_t**'',
@@ -44,9 +49,11 @@ int NCZ_addfilter(NC_FILE_INFO_T*, NC_VAR_INFO_T* var, unsigned int id, size_t n
 int NCZ_filter_setup(NC_VAR_INFO_T* var);
 int NCZ_filter_freelist(NC_VAR_INFO_T* var);
 int NCZ_codec_freelist(NCZ_VAR_INFO_T* zvar);
+int NCZ_filter_prepare(const NC_FILE_INFO_T*, NC_VAR_INFO_T* var);
 int NCZ_applyfilterchain(const NC_FILE_INFO_T*, NC_VAR_INFO_T*, NClist* chain, size_t insize, void* indata, size_t* outlen, void** outdata, int encode);
 int NCZ_filter_jsonize(const NC_FILE_INFO_T*, const NC_VAR_INFO_T*, struct NCZ_Filter* filter, struct NCjson**);
 int NCZ_filter_build(const NC_FILE_INFO_T*, NC_VAR_INFO_T* var, const NCjson* jfilter);
 int NCZ_codec_attr(const NC_VAR_INFO_T* var, size_t* lenp, void* data);
+int NCZ_plugin_stats(size_t* nfilesp, size_t* nknownp, size_t* nloadedp);
 	    
 #endif /*ZFILTER_H*/
@@ -56,6 +56,7 @@ extern "C" {
 #include "zcache.h"
 #include "zarr.h"
 #include "zdebug.h"
+#include "zstats.h"
 
 #ifdef __cplusplus
 }
@@ -17,6 +17,7 @@
 
 #include "zincludes.h"
 #include "zfilter.h"
+#include "zthread.h"
 
 /* These are the default chunk cache sizes for ZARR files created or
  * opened with netCDF-4. */
@@ -61,6 +62,7 @@ NCZ_initialize_internal(void)
 {
     int stat = NC_NOERR;
     char* dimsep = NULL;
+    char* threads = NULL;
     NCRCglobalstate* ngs = NULL;
 
     ncz_initialized = 1;
@@ -74,6 +76,13 @@ NCZ_initialize_internal(void)
 	    if(dimsep != NULL && strlen(dimsep) == 1 && islegaldimsep(dimsep[0]))
 		ngs->zarr.dimension_separator = dimsep[0];
         }    
+	ngs->zarr.threads = DFALT_NCZ_THREADS;
+        threads = NC_rclookup("ZARR.THREADS",NULL,NULL);
+        if(threads != NULL) {
+	    unsigned long n;
+	    if(sscanf(threads,"%lu",&n) == 1)
+		ngs->zarr.threads = (size_t)n;
+        }
     }
 
     return stat;
@@ -56,6 +56,10 @@
 #define ZATTRS ".zattrs"
 #define ZARRAY ".zarray"
 
+/* Consolidated metadata object (see zarr-python consolidate_metadata) */
+#define ZMETADATA "/.zmetadata"
+#define ZCONSOLIDATED_FORMAT "1"
+
 /* Pure Zarr pseudo names */
 #define ZDIMANON "_zdim"
 
@@ -73,6 +77,7 @@ Inserted into any .zarray
 "_NCZARR_ARRAY": "{
 \"dimensions\": [\"/g1/g2/d1\", \"/d2\",...]
 \"storage\": \"scalar\"|\"contiguous\"|\"compact\"|\"chunked\"
+\"shards\": [2, 2, ...]
 }"
 Inserted into any .zattrs ? or should it go into the container?
 "_NCZARR_ATTRS": "{
@@ -85,9 +90,17 @@ Inserted into any .zattrs ? or should it go into the container?
 #define NCZ_V2_ARRAY   "_NCZARR_ARRAY"
 #define NCZ_V2_ATTR    NC_NCZARR_ATTR
 
+/* Sharded variables: shard objects are keyed apart from chunks
+   (s.0.1 rather than 0.1), and the .zarray filters list a codec
+   that no other reader resolves, so readers that do not know about
+   sharding refuse the variable instead of decoding a shard as a chunk. */
+#define NCZ_SHARD_PREFIX "s"
+#define NCZ_SHARD_CODEC "nczarr_shard"
+
 #define PUREZARRCONTROL "zarr"
 #define XARRAYCONTROL "xarray"
 #define NOXARRAYCONTROL "noxarray"
+#define CONSOLIDATEDCONTROL "consolidated"
 
 #define LEGAL_DIM_SEPARATORS "./"
 #define DFALT_DIM_SEPARATOR '.'
@@ -112,6 +125,8 @@ struct NCjson;
 struct NCauth;
 struct NCZMAP;
 struct NCZChunkCache;
+struct NCZWorkers;
+struct NC_hashmap;
 
 /**************************************************/
 /* Define annotation data for NCZ objects */
@@ -144,8 +159,23 @@ typedef struct NCZ_FILE_INFO {
 #		define FLAG_LOGGING     4
 #		define FLAG_XARRAYDIMS  8
 #		define FLAG_NCZARR_V1   16
+#		define FLAG_CONSOLIDATED 32
+#		define FLAG_INMEMORY    64 /* keep the dataset in memory; mapimpl is the backing store */
 	NCZM_IMPL mapimpl;
+	size_t nthreads; /* size of the chunk I/O worker pool; 0|1 => none */
+	size_t shard; /* chunks per shard along each dim for new vars; 0|1 => unsharded */
+	size_t readahead; /* default chunks to read ahead on sequential access; 0 => off */
+	int writeempty; /* default for new caches; 0 => chunks holding only fill are not stored */
+	size_t writecombine; /* default bytes of partially written chunks held per variable */
+	size_t writebehind; /* default bytes of chunk writes in progress per variable; 0 => off */
     } controls;
+    struct NCZWorkers* workers; /* created on first use */
+    struct Consolidated {
+	struct NCjson* json; /* root of the .zmetadata object; NULL => none */
+	struct NCjson* metadata; /* the "metadata" dict inside json */
+	struct NC_hashmap* index; /* metadata key => position of its value */
+	int loaded; /* read from the dataset, so authoritative for reads */
+    } consolidated;
 } NCZ_FILE_INFO_T;
 
 /* This is a struct to handle the dim metadata. */
@@ -185,6 +215,8 @@ typedef struct NCZ_VAR_INFO {
     struct NCZChunkCache* cache;
     struct NClist* xarray; /* names from _ARRAY_DIMENSIONS */
     char dimension_separator; /* '.' | '/' */
+    size64_t* shards; /* chunks per shard along each dim; NULL => one chunk per object */
+    int nativeorder; /* 1 => chunks are in native byte order whatever the dtype; see NCZ_isswapped */
 } NCZ_VAR_INFO_T;
 
 /* Struct to hold ZARR-specific info for a field. */
@@ -18,6 +18,7 @@ nczmap_features(NCZM_IMPL impl)
 {
     switch (impl) {
     case NCZM_FILE: return zmap_file.features;
+    case NCZM_MEM: return zmap_mem.features;
 #ifdef ENABLE_NCZARR_ZIP
     case NCZM_ZIP: return zmap_zip.features;
 #endif
@@ -46,6 +47,10 @@ nczmap_create(NCZM_IMPL impl, const char *path, int mode, size64_t flags, void*
         stat = zmap_file.create(path, mode, flags, parameters, &map);
 	if(stat) goto done;
 	break;
+    case NCZM_MEM:
+        stat = zmap_mem.create(path, mode, flags, parameters, &map);
+	if(stat) goto done;
+	break;
 #ifdef ENABLE_NCZARR_ZIP
     case NCZM_ZIP:
         stat = zmap_zip.create(path, mode, flags, parameters, &map);
@@ -61,6 +66,7 @@ nczmap_create(NCZM_IMPL impl, const char *path, int mode, size64_t flags, void*
     default:
 	{stat = REPORT(NC_ENOTBUILT,"nczmap_create"); goto done;}
     }
+    if((stat = NCZ_stats_new(&map->stats))) {(void)map->api->close(map,0); goto done;}
     if(mapp) *mapp = map;
 done:
     ncurifree(uri);
@@ -84,6 +90,10 @@ nczmap_open(NCZM_IMPL impl, const char *path, int mode, size64_t flags, void* pa
         stat = zmap_file.open(path, mode, flags, parameters, &map);
 	if(stat) goto done;
 	break;
+    case NCZM_MEM:
+        stat = zmap_mem.open(path, mode, flags, parameters, &map);
+	if(stat) goto done;
+	break;
 #ifdef ENABLE_NCZARR_ZIP
     case NCZM_ZIP:
         stat = zmap_zip.open(path, mode, flags, parameters, &map);
@@ -99,6 +109,7 @@ nczmap_open(NCZM_IMPL impl, const char *path, int mode, size64_t flags, void* pa
     default:
 	{stat = REPORT(NC_ENOTBUILT,"nczmap_open"); goto done;}
     }
+    if((stat = NCZ_stats_new(&map->stats))) {(void)map->api->close(map,0); goto done;}
 
 done:
     ncurifree(uri);
@@ -115,32 +126,41 @@ int
 nczmap_close(NCZMAP* map, int delete)
 {
     int stat = NC_NOERR;
-    if(map && map->api)
+    struct NCZStats* stats = NULL;
+    if(map && map->api) {
+	stats = map->stats; /* the map is reclaimed by close */
         stat = map->api->close(map,delete);
+    }
+    NCZ_stats_free(stats);
     return THROW(stat);
 }
 
 int
 nczmap_exists(NCZMAP* map, const char* key)
 {
+    NCZ_stats_count(map->stats,NCZ_STAT_EXISTS,1,0);
     return map->api->exists(map, key);
 }
 
 int
 nczmap_len(NCZMAP* map, const char* key, size64_t* lenp)
 {
+    NCZ_stats_count(map->stats,NCZ_STAT_LEN,1,0);
     return map->api->len(map, key, lenp);
 }
 
 int
 nczmap_read(NCZMAP* map, const char* key, size64_t start, size64_t count, void* content)
 {
-    return map->api->read(map, key, start, count, content);
+    int stat = map->api->read(map, key, start, count, content);
+    NCZ_stats_count(map->stats,NCZ_STAT_READ,1,(stat == NC_NOERR ? count : 0));
+    return stat;
 }
 
 int
 nczmap_write(NCZMAP* map, const char* key, size64_t start, size64_t count, const void* content)
 {
+    NCZ_stats_count(map->stats,NCZ_STAT_WRITE,1,count);
     return map->api->write(map, key, start, count, content);
 }
 
@@ -157,6 +177,7 @@ int
 nczmap_search(NCZMAP* map, const char* prefix, NClist* matches)
 {
     int stat = NC_NOERR;
+    NCZ_stats_count(map->stats,NCZ_STAT_SEARCH,1,0);
     if((stat = map->api->search(map, prefix, matches)) == NC_NOERR) {
         /* sort the list */
         if(nclistlength(matches) > 1) {
@@ -167,6 +188,78 @@ nczmap_search(NCZMAP* map, const char* prefix, NClist* matches)
     return stat;
 }
 
+/* Summarize a batch: the first failure other than NC_EEMPTY */
+static int
+batchstatus(size_t n, NCZM_REQUEST* requests)
+{
+    size_t i;
+    for(i=0;i<n;i++) {
+	if(requests[i].stat != NC_NOERR && requests[i].stat != NC_EEMPTY)
+	    return requests[i].stat;
+    }
+    return NC_NOERR;
+}
+
+/* Total size of the requests of a batch that succeeded */
+size64_t
+nczm_batchbytes(size_t n, const NCZM_REQUEST* requests)
+{
+    size_t i;
+    size64_t total = 0;
+    for(i=0;i<n;i++)
+	if(requests[i].stat == NC_NOERR) total += requests[i].count;
+    return total;
+}
+
+int
+nczmap_existsn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = NC_NOERR;
+    NCZ_stats_count(map->stats,NCZ_STAT_EXISTS,n,0);
+    if(map->api->existsn != NULL)
+        stat = map->api->existsn(map, n, requests);
+    else
+        stat = nczm_existsn(map, n, requests);
+    if(stat == NC_NOERR) stat = batchstatus(n,requests);
+    return THROW(stat);
+}
+
+int
+nczmap_readn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = NC_NOERR;
+    if(map->api->readn != NULL)
+        stat = map->api->readn(map, n, requests);
+    else
+        stat = nczm_readn(map, n, requests);
+    NCZ_stats_count(map->stats,NCZ_STAT_READ,n,nczm_batchbytes(n,requests));
+    if(stat == NC_NOERR) stat = batchstatus(n,requests);
+    return THROW(stat);
+}
+
+int
+nczmap_writen(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    if(map->api->writen != NULL)
+        stat = map->api->writen(map, n, requests);
+    else
+        stat = nczm_writen(map, n, requests);
+    NCZ_stats_count(map->stats,NCZ_STAT_WRITE,n,nczm_batchbytes(n,requests));
+    /* Writes have no excuse for being empty */
+    for(i=0;stat == NC_NOERR && i<n;i++) stat = requests[i].stat;
+    return THROW(stat);
+}
+
+int
+nczmap_remove(NCZMAP* map, const char* key)
+{
+    if(map->api->remove == NULL) return NC_ENOTBUILT;
+    NCZ_stats_count(map->stats,NCZ_STAT_REMOVE,1,0);
+    return map->api->remove(map, key);
+}
+
 /**************************************************/
 /* Utilities */
 
@@ -305,6 +398,51 @@ done:
     return stat;
 }
 
+int
+nczm_existsn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    size_t i;
+    for(i=0;i<n;i++)
+	requests[i].stat = map->api->exists(map,requests[i].key);
+    return NC_NOERR;
+}
+
+int
+nczm_readn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    size_t i;
+    for(i=0;i<n;i++) {
+	NCZM_REQUEST* req = &requests[i];
+	if(req->content == NULL) { /* whole object */
+	    size64_t len = 0;
+	    req->start = 0;
+	    req->count = 0;
+	    if((req->stat = map->api->len(map,req->key,&len))) continue;
+	    if((req->content = malloc(len == 0 ? 1 : len)) == NULL)
+		return NC_ENOMEM;
+	    req->count = len;
+	    if(len == 0) continue;
+	    if((req->stat = map->api->read(map,req->key,0,len,req->content))) {
+		nullfree(req->content); req->content = NULL;
+		req->count = 0;
+	    }
+	} else
+	    req->stat = map->api->read(map,req->key,req->start,req->count,req->content);
+    }
+    return NC_NOERR;
+}
+
+int
+nczm_writen(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    size_t i;
+    for(i=0;i<n;i++) {
+	NCZM_REQUEST* req = &requests[i];
+	req->stat = map->api->write(map,req->key,req->start,req->count,req->content);
+    }
+    return NC_NOERR;
+}
+
 int
 nczm_clear(NCZMAP* map)
 {
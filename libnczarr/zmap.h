@@ -127,6 +127,17 @@ caller asked for non-content-bearing key.
 The current set of operations defined for zmaps are define with the
 generic nczm_xxx functions below.
 
+Batch Operations:
+The exists, read, and write operations also have batch forms
+(nczmap_existsn, nczmap_readn, nczmap_writen) that take a vector
+of requests. Each request carries its own key, byte range, and
+content, and receives its own status, so one missing object
+does not fail the whole batch. An implementation may leave the
+batch entries of its API NULL, in which case the wrappers loop
+over the single-key operations. Implementations that can overlap
+or coalesce the underlying I/O (e.g. S3 with concurrent GETs)
+should supply their own versions.
+
 Each zmap implementation has retrievable flags defining limitations
 of the implementation.
 
@@ -149,10 +160,11 @@ typedef struct NCZMAP_API NCZMAP_API;
 
 /* Define the space of implemented (eventually) map implementations */
 typedef enum NCZM_IMPL {
-NCZM_UNDEF=0, /* In-memory implementation */
+NCZM_UNDEF=0, /* Undefined implementation */
 NCZM_FILE=1,	/* File system directory-based implementation */
 NCZM_ZIP=2,	/* Zip-file based implementation */
 NCZM_S3=3,	/* Amazon S3 implementation */
+NCZM_MEM=4,	/* In-memory implementation; see zmap_mem.c */
 } NCZM_IMPL;
 
 /* Define the default map implementation */
@@ -164,6 +176,7 @@ typedef size64_t NCZM_FEATURES;
 #define NCZM_UNIMPLEMENTED 1 /* Unknown/ unimplemented */
 #define NCZM_WRITEONCE 2     /* Objects can only be written once */
 #define NCZM_ZEROSTART 4     /* Objects can only be written using a start count of zero */
+#define NCZM_THREADSAFE 8    /* Object operations may be invoked concurrently from multiple threads */
 
 /*
 For each dataset, we create what amounts to a class
@@ -183,6 +196,7 @@ typedef struct NCZMAP {
     int mode;
     size64_t flags; /* Passed in by caller */
     struct NCZMAP_API* api;
+    struct NCZStats* stats; /* counters of all calls made through the nczmap_ wrappers */
 } NCZMAP;
 
 /* zmap_s3sdk related-types and constants */
@@ -190,6 +204,15 @@ typedef struct NCZMAP {
 /* Forward */
 struct NClist;
 
+/* One element of a batch operation */
+typedef struct NCZM_REQUEST {
+    const char* key;
+    size64_t start;
+    size64_t count;
+    void* content; /* readn: NULL => read the whole object into malloc'd memory */
+    int stat; /* per-request result */
+} NCZM_REQUEST;
+
 /* Define the object-level API */
 
 struct NCZMAP_API {
@@ -202,6 +225,12 @@ struct NCZMAP_API {
 	int (*read)(NCZMAP* map, const char* key, size64_t start, size64_t count, void* content);
 	int (*write)(NCZMAP* map, const char* key, size64_t start, size64_t count, const void* content);
         int (*search)(NCZMAP* map, const char* prefix, struct NClist* matches);
+    /* Batch Operations; NULL => loop over the single-key operations */
+	int (*existsn)(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+	int (*readn)(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+	int (*writen)(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+    /* Optional; NULL => objects cannot be removed */
+	int (*remove)(NCZMAP* map, const char* key);
 };
 
 /* Define the Dataset level API */
@@ -213,6 +242,7 @@ typedef struct NCZMAP_DS_API {
 } NCZMAP_DS_API;
 
 extern NCZMAP_DS_API zmap_file;
+extern NCZMAP_DS_API zmap_mem;
 #ifdef USE_HDF5
 extern NCZMAP_DS_API zmap_nz4;
 #endif
@@ -298,6 +328,54 @@ next segment of legal objects that are immediately contained by the prefix key.
 */
 EXTERNL int nczmap_search(NCZMAP* map, const char* prefix, struct NClist* matches);
 
+/**
+Check the existence of a vector of content-bearing objects.
+@param map -- the containing map
+@param n -- number of requests
+@param requests -- requests[i].key specifies the object; requests[i].stat
+                   is set to NC_NOERR, NC_EEMPTY, or some other error.
+@return NC_NOERR if every object was checked, even if some are empty.
+@return NC_EXXX the first failure other than NC_EEMPTY
+*/
+EXTERNL int nczmap_existsn(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+
+/**
+Read the content of a vector of content-bearing objects.
+@param map -- the containing map
+@param n -- number of requests
+@param requests -- requests[i].key, .start, .count, and .content are as
+                   for nczmap_read. If .content is NULL, then the whole
+                   object is read into memory allocated by the map and
+                   .count is set to its length; the caller must free it.
+                   requests[i].stat is set to the result of the read.
+@return NC_NOERR if every object was read or is empty (NC_EEMPTY).
+@return NC_EXXX the first failure other than NC_EEMPTY
+*/
+EXTERNL int nczmap_readn(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+
+/**
+Write the content of a vector of content-bearing objects.
+@param map -- the containing map
+@param n -- number of requests
+@param requests -- requests[i].key, .start, .count, and .content are as
+                   for nczmap_write; requests[i].stat is set to the
+                   result of the write.
+@return NC_NOERR if every object was written
+@return NC_EXXX the first failure
+*/
+EXTERNL int nczmap_writen(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+
+/**
+Remove a content-bearing object.
+@param map -- the containing map
+@param key -- the key specifying the content-bearing object
+@return NC_NOERR if the object was removed
+@return NC_EEMPTY if the object did not exist
+@return NC_ENOTBUILT if the map cannot remove objects
+@return NC_EXXX if the operation failed for one of several possible reasons
+*/
+EXTERNL int nczmap_remove(NCZMAP* map, const char* key);
+
 /**
 Close a map
 @param map -- the map to close
@@ -315,6 +393,9 @@ EXTERNL int nczmap_open(NCZM_IMPL impl, const char *path, int mode, size64_t con
 EXTERNL void NCZ_s3finalize(void);
 #endif
 
+/* Return the open file cache counters of a zmap_file map */
+EXTERNL int nczmap_file_fdstats(NCZMAP* map, size_t* hitsp, size_t* missesp);
+
 /* Utility functions */
 
 /** Split a path into pieces along '/' character; elide any leading '/' */
@@ -342,6 +423,12 @@ EXTERNL int nczm_appendn(char** resultp, int n, ...);
 */
 EXTERNL int nczm_divide_at(const char* key, int nsegs, char** prefixp, char** suffixp);
 
+/* Default batch operations: loop over the single-key operations */
+EXTERNL int nczm_existsn(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+EXTERNL int nczm_readn(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+EXTERNL int nczm_writen(NCZMAP* map, size_t n, NCZM_REQUEST* requests);
+EXTERNL size64_t nczm_batchbytes(size_t n, const NCZM_REQUEST* requests);
+
 /* Reclaim the content of a map but not the map itself */
 EXTERNL int nczm_clear(NCZMAP* map);
 
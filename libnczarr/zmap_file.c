@@ -45,6 +45,11 @@
 
 #include "fbits.h"
 #include "ncpathmgr.h"
+#include "nchashmap.h"
+
+#ifdef ENABLE_NCZARR_THREADS
+#include <pthread.h>
+#endif
 
 #define VERIFY
 
@@ -105,18 +110,54 @@ For the object API, the mapping is as follows:
 /* define the var name containing an objects content */
 #define ZCONTENT "data"
 
+/*
+Open files are kept in a bounded LRU cache keyed by the canonical path
+so that repeated access to the same object (e.g. writing a chunk
+in several slabs, or re-reading metadata) does not open and close
+the file each time. A cached file may be in use by several threads
+at once, so all I/O on it is positional (pread/pwrite); on platforms
+without those, the cache is disabled.
+*/
+
+/* Default max no. of files held open by the cache */
+#define ZF_MAXOPEN 32
+
+typedef struct ZFOPEN {
+    struct ZFOPEN* next; /* toward least recently used */
+    struct ZFOPEN* prev;
+    char* path; /* canonical path; the cache key */
+    int fd;
+    int refs;  /* no. of FDs currently using fd */
+    int stale; /* no longer in the cache; close when refs drops to 0 */
+} ZFOPEN;
+
 typedef struct FD {
   int fd;
+  ZFOPEN* cached; /* non-NULL => fd belongs to the cache */
 } FD;
 
-static FD FDNUL = {-1};
+static FD FDNUL = {-1,NULL};
 
 /* Define the "subclass" of NCZMAP */
 typedef struct ZFMAP {
     NCZMAP map;
     char* root;
+    struct ZFCache {
+        size_t maxopen; /* 0 => no caching */
+        size_t nopen;
+        NC_hashmap* index; /* path => ZFOPEN* */
+        ZFOPEN* head; /* most recently used */
+        ZFOPEN* tail;
+        size_t hits;
+        size_t misses;
+#ifdef ENABLE_NCZARR_THREADS
+        pthread_mutex_t mutex;
+#endif
+    } fdcache;
 } ZFMAP;
 
+static size_t zf_maxopen = ZF_MAXOPEN;
+
 /* Forward */
 static NCZMAP_API zapi;
 static int zfileclose(NCZMAP* map, int delete);
@@ -126,6 +167,12 @@ static int zfparseurl(const char* path0, NCURI** urip);
 static int zffullpath(ZFMAP* zfmap, const char* key, char**);
 static void zfrelease(ZFMAP* zfmap, FD* fd);
 static void zfunlink(const char* canonpath);
+static void zfcacheinit(ZFMAP* zfmap);
+static int zfcacheacquire(ZFMAP* zfmap, const char* path, FD* fd);
+static void zfcacheinsert(ZFMAP* zfmap, const char* path, FD* fd);
+static void zfcacheforget(ZFMAP* zfmap, const char* path);
+static void zfcacheclear(ZFMAP* zfmap);
+static void zfcachefree(ZFMAP* zfmap);
 
 static int platformerr(int err);
 static int platformcreatefile(ZFMAP* map, const char* truepath,FD*);
@@ -135,8 +182,15 @@ static int platformopendir(ZFMAP* map, const char* truepath);
 static int platformdircontent(ZFMAP* map, const char* path, NClist* contents);
 static int platformdelete(ZFMAP* map, const char* path, int delroot);
 static int platformseek(ZFMAP* map, FD* fd, int pos, size64_t* offset);
+#ifndef HAVE_PREAD
 static int platformread(ZFMAP* map, FD* fd, size64_t count, void* content);
+#endif
+#ifndef HAVE_PWRITE
 static int platformwrite(ZFMAP* map, FD* fd, size64_t count, const void* content);
+#endif
+static int platformpwrite(ZFMAP* map, FD* fd, size64_t start, size64_t count, const void* content);
+static int platformpread(ZFMAP* map, FD* fd, size64_t start, size64_t count, void* content);
+static void platformadvise(ZFMAP* map, FD* fd, size64_t start, size64_t count);
 static void platformrelease(ZFMAP* zfmap, FD* fd);
 static int platformtestcontentbearing(ZFMAP* zfmap, const char* truepath);
 
@@ -161,6 +215,10 @@ zfileinitialize(void)
 	if(env != NULL && strlen(env) > 0) {
 	    if(sscanf(env,"%d",&perms) == 1) NC_DEFAULT_DIR_PERMS = perms;
 	}
+	env = getenv("NC_ZFILE_MAXOPEN");
+	if(env != NULL && strlen(env) > 0) {
+	    if(sscanf(env,"%d",&perms) == 1 && perms >= 0) zf_maxopen = (size_t)perms;
+	}
         zfinitialized = 1;
 	(void)ZUNTRACE(NC_NOERR);
     }
@@ -223,6 +281,7 @@ zfilecreate(const char *path, int mode, size64_t flags, void* parameters, NCZMAP
     zfmap->map.api = &zapi;
     zfmap->root = abspath;
         abspath = NULL;
+    zfcacheinit(zfmap);
 
     /* If NC_CLOBBER, then delete below file tree */
     if(!fIsSet(mode,NC_NOCLOBBER))
@@ -296,6 +355,7 @@ zfileopen(const char *path, int mode, size64_t flags, void* parameters, NCZMAP**
     zfmap->map.api = (NCZMAP_API*)&zapi;
     zfmap->root = abspath;
 	abspath = NULL;
+    zfcacheinit(zfmap);
     
     /* Verify root dir exists */
     if((stat = platformopendir(zfmap,zfmap->root)))
@@ -376,8 +436,7 @@ zfileread(NCZMAP* map, const char* key, size64_t start, size64_t count, void* co
 
     switch (stat = zflookupobj(zfmap,key,&fd)) {
     case NC_NOERR:
-        if((stat = platformseek(zfmap, &fd, SEEK_SET, &start))) goto done;
-        if((stat = platformread(zfmap, &fd, count, content))) goto done;
+        if((stat = platformpread(zfmap, &fd, start, count, content))) goto done;
 	break;
     case NC_ENOOBJECT: stat = NC_EEMPTY;
     case NC_EEMPTY: break;
@@ -414,10 +473,11 @@ zfilewrite(NCZMAP* map, const char* key, size64_t start, size64_t count, const v
         if((stat = zffullpath(zfmap,key,&truepath))) goto done;
 	/* Create file */
 	if((stat = platformcreatefile(zfmap,truepath,&fd))) goto done;
+	/* Keep it open for any further writes */
+	zfcacheinsert(zfmap,truepath,&fd);
 	/* Fall thru to write the object */
     case NC_NOERR:
-        if((stat = platformseek(zfmap, &fd, SEEK_SET, &start))) goto done;
-        if((stat = platformwrite(zfmap, &fd, count, content))) goto done;
+        if((stat = platformpwrite(zfmap, &fd, start, count, content))) goto done;
 	break;
     default: break;
     }
@@ -428,6 +488,112 @@ done:
     return ZUNTRACE(stat);
 }
 
+/* The file is unlinked; a cached open file for it is dropped first
+   so that a later write cannot land in the unlinked inode */
+static int
+zfileremove(NCZMAP* map, const char* key)
+{
+    int stat = NC_NOERR;
+    ZFMAP* zfmap = (ZFMAP*)map; /* cast to true type */
+    char* truepath = NULL;
+    char* local = NULL;
+
+    ZTRACE(5,"map=%s key=%s",map->url,key);
+
+    if((stat = zffullpath(zfmap,key,&truepath))) goto done;
+    zfcacheforget(zfmap,truepath);
+    if((local = NCpathcvt(truepath))==NULL) {stat = NC_ENOMEM; goto done;}
+    errno = 0;
+    if(NCunlink(local) < 0) {
+	stat = platformerr(errno);
+	if(stat == NC_ENOOBJECT) stat = NC_EEMPTY;
+    }
+
+done:
+    errno = 0;
+    nullfree(local);
+    nullfree(truepath);
+    return ZUNTRACE(stat);
+}
+
+/* Max no. of files a batch operation holds open at once */
+#define ZF_BATCH 64
+
+static int
+zfileexistsn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    ZFMAP* zfmap = (ZFMAP*)map;
+    size_t i;
+    char* path = NULL;
+
+    ZTRACE(5,"map=%s n=%llu",map->url,(unsigned long long)n);
+    /* A stat is sufficient; unlike zfileexists, do not open the file */
+    for(i=0;i<n;i++) {
+	NCZM_REQUEST* req = &requests[i];
+	if((req->stat = zffullpath(zfmap,req->key,&path)) == NC_NOERR)
+	    req->stat = platformtestcontentbearing(zfmap,path);
+	if(req->stat == NC_ENOOBJECT) req->stat = NC_EEMPTY;
+	nullfree(path); path = NULL;
+    }
+    return ZUNTRACE(NC_NOERR);
+}
+
+/*
+Open up to ZF_BATCH files at a time and advise the kernel of all the
+byte ranges before reading any of them, so that the reads of the
+group overlap in the I/O layer instead of being issued serially.
+Each file is opened once, rather than once for len and once for read.
+*/
+static int
+zfilereadn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = NC_NOERR;
+    ZFMAP* zfmap = (ZFMAP*)map;
+    FD fds[ZF_BATCH];
+    size_t i, base, m;
+
+    ZTRACE(5,"map=%s n=%llu",map->url,(unsigned long long)n);
+
+    for(i=0;i<ZF_BATCH;i++) fds[i] = FDNUL;
+    for(base=0;base<n;base+=m) {
+	m = n - base;
+	if(m > ZF_BATCH) m = ZF_BATCH;
+	/* Open and advise */
+	for(i=0;i<m;i++) {
+	    NCZM_REQUEST* req = &requests[base+i];
+	    switch (req->stat = zflookupobj(zfmap,req->key,&fds[i])) {
+	    case NC_NOERR: break;
+	    case NC_ENOOBJECT: req->stat = NC_EEMPTY; /* fall thru */
+	    default: continue;
+	    }
+	    if(req->content == NULL) { /* whole object */
+		size64_t len = 0;
+		if((req->stat = platformseek(zfmap,&fds[i],SEEK_END,&len))) continue;
+		req->start = 0;
+		req->count = len;
+	    }
+	    platformadvise(zfmap,&fds[i],req->start,req->count);
+	}
+	/* Read and release */
+	for(i=0;i<m;i++) {
+	    NCZM_REQUEST* req = &requests[base+i];
+	    if(req->stat == NC_NOERR) {
+		int alloc = (req->content == NULL);
+		if(alloc && (req->content = malloc(req->count == 0 ? 1 : req->count)) == NULL)
+		    {stat = NC_ENOMEM; goto done;}
+		req->stat = platformpread(zfmap,&fds[i],req->start,req->count,req->content);
+		if(req->stat && alloc)
+		    {nullfree(req->content); req->content = NULL; req->count = 0;}
+	    }
+	    zfrelease(zfmap,&fds[i]);
+	}
+    }
+
+done:
+    for(i=0;i<ZF_BATCH;i++) zfrelease(zfmap,&fds[i]);
+    return ZUNTRACE(stat);
+}
+
 static int
 zfileclose(NCZMAP* map, int delete)
 {
@@ -437,6 +603,8 @@ zfileclose(NCZMAP* map, int delete)
     ZTRACE(5,"map=%s delete=%d",map->url,delete);
     if(zfmap == NULL) return NC_NOERR;
     
+    /* Close any cached files before possibly deleting them */
+    zfcachefree(zfmap);
     /* Delete the subtree below the root and the root */
     if(delete) {
 	stat = platformdelete(zfmap,zfmap->root,1);
@@ -555,6 +723,10 @@ zflookupobj(ZFMAP* zfmap, const char* key, FD* fd)
     if((stat = zffullpath(zfmap,key,&path)))
 	{goto done;}    
 
+    /* A cached open file is known to be content-bearing */
+    if(zfcacheacquire(zfmap,path,fd))
+	goto done;
+
     /* See if this is content-bearing */
     if((stat = platformtestcontentbearing(zfmap,path)))
 	goto done;        
@@ -562,6 +734,7 @@ zflookupobj(ZFMAP* zfmap, const char* key, FD* fd)
     /* Open the file */
     if((stat = platformopenfile(zfmap,path,fd)))
         goto done;
+    zfcacheinsert(zfmap,path,fd);
 
 done:
     errno = 0;
@@ -574,16 +747,220 @@ static void
 zfrelease(ZFMAP* zfmap, FD* fd)
 {
     ZTRACE(5,"map=%s fd=%d",zfmap->map.url,(fd?fd->fd:-1));
-    platformrelease(zfmap,fd);
+    if(fd->cached != NULL) {
+	ZFOPEN* zo = fd->cached;
+	int doclose;
+#ifdef ENABLE_NCZARR_THREADS
+	pthread_mutex_lock(&zfmap->fdcache.mutex);
+#endif
+	zo->refs--;
+	doclose = (zo->stale && zo->refs == 0);
+#ifdef ENABLE_NCZARR_THREADS
+	pthread_mutex_unlock(&zfmap->fdcache.mutex);
+#endif
+	if(doclose) {
+	    platformrelease(zfmap,fd);
+	    nullfree(zo->path);
+	    free(zo);
+	}
+	fd->fd = -1;
+	fd->cached = NULL;
+    } else
+        platformrelease(zfmap,fd);
     (void)ZUNTRACE(NC_NOERR);
 }
 
+/**************************************************/
+/* Open file cache */
+
+static void
+zfcacheinit(ZFMAP* zfmap)
+{
+    struct ZFCache* cache = &zfmap->fdcache;
+#if defined(HAVE_PREAD) && defined(HAVE_PWRITE)
+    cache->maxopen = zf_maxopen;
+#else
+    cache->maxopen = 0; /* shared fds would need a shared file offset */
+#endif
+    cache->index = NC_hashmapnew(0);
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_init(&cache->mutex,NULL);
+#endif
+}
+
+/* Caller must hold the mutex */
+static void
+zfunlinkopen(struct ZFCache* cache, ZFOPEN* zo)
+{
+    if(zo->prev) zo->prev->next = zo->next; else cache->head = zo->next;
+    if(zo->next) zo->next->prev = zo->prev; else cache->tail = zo->prev;
+    zo->next = zo->prev = NULL;
+}
+
+/* Caller must hold the mutex */
+static void
+zfpushopen(struct ZFCache* cache, ZFOPEN* zo)
+{
+    zo->prev = NULL;
+    zo->next = cache->head;
+    if(cache->head) cache->head->prev = zo;
+    cache->head = zo;
+    if(cache->tail == NULL) cache->tail = zo;
+}
+
+/* Remove from the cache; close now if unused. Caller must hold the mutex. */
+static void
+zfevictopen(ZFMAP* zfmap, ZFOPEN* zo)
+{
+    struct ZFCache* cache = &zfmap->fdcache;
+    uintptr_t data = 0;
+    zfunlinkopen(cache,zo);
+    (void)NC_hashmapremove(cache->index,zo->path,strlen(zo->path),&data);
+    cache->nopen--;
+    if(zo->refs > 0)
+	zo->stale = 1;
+    else {
+	FD fd = FDNUL;
+	fd.fd = zo->fd;
+	platformrelease(zfmap,&fd);
+	nullfree(zo->path);
+	free(zo);
+    }
+}
+
+/* @return 1 and fill in fd if path is open in the cache */
+static int
+zfcacheacquire(ZFMAP* zfmap, const char* path, FD* fd)
+{
+    struct ZFCache* cache = &zfmap->fdcache;
+    uintptr_t data = 0;
+    int found = 0;
+
+    if(cache->maxopen == 0) return 0;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_lock(&cache->mutex);
+#endif
+    if(NC_hashmapget(cache->index,path,strlen(path),&data)) {
+	ZFOPEN* zo = (ZFOPEN*)data;
+	zo->refs++;
+	zfunlinkopen(cache,zo);
+	zfpushopen(cache,zo);
+	fd->fd = zo->fd;
+	fd->cached = zo;
+	cache->hits++;
+	found = 1;
+    } else
+	cache->misses++;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_unlock(&cache->mutex);
+#endif
+    return found;
+}
+
+/* Hand a newly opened fd to the cache; fd remains usable by the caller.
+   If the cache is full of files in use or another thread cached the
+   same path first, the fd is simply left uncached. */
+static void
+zfcacheinsert(ZFMAP* zfmap, const char* path, FD* fd)
+{
+    struct ZFCache* cache = &zfmap->fdcache;
+    ZFOPEN* zo = NULL;
+    uintptr_t data = 0;
+
+    if(cache->maxopen == 0 || fd->cached != NULL) return;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_lock(&cache->mutex);
+#endif
+    if(NC_hashmapget(cache->index,path,strlen(path),&data)) goto done;
+    /* Make room, least recently used first */
+    while(cache->nopen >= cache->maxopen && cache->tail != NULL)
+	zfevictopen(zfmap,cache->tail);
+    if((zo = (ZFOPEN*)calloc(1,sizeof(ZFOPEN))) == NULL) goto done;
+    if((zo->path = strdup(path)) == NULL) {free(zo); goto done;}
+    zo->fd = fd->fd;
+    zo->refs = 1;
+    if(!NC_hashmapadd(cache->index,(uintptr_t)zo,zo->path,strlen(zo->path)))
+	{nullfree(zo->path); free(zo); goto done;}
+    zfpushopen(cache,zo);
+    cache->nopen++;
+    fd->cached = zo;
+done:
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_unlock(&cache->mutex);
+#endif
+    return;
+}
+
+/* Drop the cached file for path, if any */
+static void
+zfcacheforget(ZFMAP* zfmap, const char* path)
+{
+    struct ZFCache* cache = &zfmap->fdcache;
+    uintptr_t data = 0;
+    if(cache->index == NULL) return;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_lock(&cache->mutex);
+#endif
+    if(NC_hashmapget(cache->index,path,strlen(path),&data))
+	zfevictopen(zfmap,(ZFOPEN*)data);
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_unlock(&cache->mutex);
+#endif
+}
+
+/* Drop all cached files; files in use are closed when released */
+static void
+zfcacheclear(ZFMAP* zfmap)
+{
+    struct ZFCache* cache = &zfmap->fdcache;
+    if(cache->index == NULL) return;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_lock(&cache->mutex);
+#endif
+    while(cache->head != NULL)
+	zfevictopen(zfmap,cache->head);
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_unlock(&cache->mutex);
+#endif
+}
+
+static void
+zfcachefree(ZFMAP* zfmap)
+{
+    struct ZFCache* cache = &zfmap->fdcache;
+    if(cache->index == NULL) return;
+    ZTRACEMORE(5,"\tfdcache: hits=%llu misses=%llu",(unsigned long long)cache->hits,(unsigned long long)cache->misses);
+    zfcacheclear(zfmap);
+    NC_hashmapfree(cache->index);
+    cache->index = NULL;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_destroy(&cache->mutex);
+#endif
+}
+
+/**
+Return the open file cache counters of a file map.
+@param map -- a map created with zmap_file
+@param hitsp -- return no. of lookups satisfied by an open file
+@param missesp -- return no. of lookups that had to open the file
+@return NC_NOERR | NC_EINVAL if map is not a file map
+*/
+int
+nczmap_file_fdstats(NCZMAP* map, size_t* hitsp, size_t* missesp)
+{
+    ZFMAP* zfmap = (ZFMAP*)map;
+    if(map == NULL || map->format != NCZM_FILE) return NC_EINVAL;
+    if(hitsp) *hitsp = zfmap->fdcache.hits;
+    if(missesp) *missesp = zfmap->fdcache.misses;
+    return NC_NOERR;
+}
+
 /**************************************************/
 /* External API objects */
 
 NCZMAP_DS_API zmap_file = {
     NCZM_FILE_V1,
-    0,
+    NCZM_THREADSAFE,
     zfilecreate,
     zfileopen,
 };
@@ -596,6 +973,10 @@ static NCZMAP_API zapi = {
     zfileread,
     zfilewrite,
     zfilesearch,
+    zfileexistsn,
+    zfilereadn,
+    NULL, /* writen: file creation dominates, so looping over zfilewrite is as good */
+    zfileremove,
 };
 
 static int
@@ -1074,6 +1455,8 @@ platformdelete(ZFMAP* zfmap, const char* rootpath, int delroot)
     ZTRACE(6,"map=%s rootpath=%s delroot=%d",zfmap->map.url,rootpath,delroot);
     
     if(rootpath == NULL || strlen(rootpath) == 0) goto done;
+    /* Cached files may be about to disappear */
+    zfcacheclear(zfmap);
     ncbytescat(canonpath,rootpath);
     if(rootpath[strlen(rootpath)-1] == '/') /* elide trailing '/' */
 	ncbytessetlength(canonpath,ncbyteslength(canonpath)-1);
@@ -1107,6 +1490,7 @@ done:
     return ZUNTRACEX(ret,"sizep=%llu",*sizep);
 }
 
+#ifndef HAVE_PREAD
 static int
 platformread(ZFMAP* zfmap, FD* fd, size64_t count, void* content)
 {
@@ -1129,7 +1513,83 @@ done:
     errno = 0;
     return ZUNTRACE(stat);
 }
+#endif
+
+/* Positional read; does not use or move the file offset */
+static int
+platformpread(ZFMAP* zfmap, FD* fd, size64_t start, size64_t count, void* content)
+{
+    int stat = NC_NOERR;
+#ifdef HAVE_PREAD
+    size_t need = count;
+    off_t offset = (off_t)start;
+    unsigned char* readpoint = content;
+
+    assert(fd && fd->fd >= 0);
+
+    ZTRACE(6,"map=%s fd=%d start=%llu count=%llu",zfmap->map.url,(fd?fd->fd:-1),start,count);
+
+    while(need > 0) {
+        ssize_t red;
+        if((red = pread(fd->fd,readpoint,need,offset)) <= 0)
+	    {stat = (red < 0 ? platformerr(errno) : NC_EINTERNAL); goto done;}
+        need -= (size_t)red;
+	offset += red;
+	readpoint += red;
+    }
+done:
+    errno = 0;
+    return ZUNTRACE(stat);
+#else
+    if((stat = platformseek(zfmap,fd,SEEK_SET,&start))) return stat;
+    return platformread(zfmap,fd,count,content);
+#endif
+}
+
+/* Positional write; does not use or move the file offset */
+static int
+platformpwrite(ZFMAP* zfmap, FD* fd, size64_t start, size64_t count, const void* content)
+{
+    int ret = NC_NOERR;
+#ifdef HAVE_PWRITE
+    size_t need = count;
+    off_t offset = (off_t)start;
+    const unsigned char* writepoint = (const unsigned char*)content;
+
+    assert(fd && fd->fd >= 0);
+
+    ZTRACE(6,"map=%s fd=%d start=%llu count=%llu",zfmap->map.url,(fd?fd->fd:-1),start,count);
+
+    while(need > 0) {
+        ssize_t red = 0;
+        if((red = pwrite(fd->fd,(const void*)writepoint,need,offset)) <= 0)
+	    {ret = NC_EACCESS; goto done;}
+        need -= (size_t)red;
+	offset += red;
+	writepoint += red;
+    }
+done:
+    return ZUNTRACE(ret);
+#else
+    if((ret = platformseek(zfmap,fd,SEEK_SET,&start))) return ret;
+    return platformwrite(zfmap,fd,count,content);
+#endif
+}
 
+/* Tell the kernel that a range of a file will be read soon */
+static void
+platformadvise(ZFMAP* zfmap, FD* fd, size64_t start, size64_t count)
+{
+    NC_UNUSED(zfmap);
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+    if(count > 0)
+        (void)posix_fadvise(fd->fd,(off_t)start,(off_t)count,POSIX_FADV_WILLNEED);
+#else
+    NC_UNUSED(fd); NC_UNUSED(start); NC_UNUSED(count);
+#endif
+}
+
+#ifndef HAVE_PWRITE
 static int
 platformwrite(ZFMAP* zfmap, FD* fd, size64_t count, const void* content)
 {
@@ -1151,6 +1611,7 @@ platformwrite(ZFMAP* zfmap, FD* fd, size64_t count, const void* content)
 done:
     return ZUNTRACE(ret);
 }
+#endif
 
 #if 0
 static int
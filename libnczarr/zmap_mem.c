@@ -0,0 +1,463 @@
+/*
+ *	Copyright 2018, University Corporation for Atmospheric Research
+ *      See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ */
+
+#include "zincludes.h"
+#include "fbits.h"
+#include "nchashmap.h"
+
+#ifdef ENABLE_NCZARR_THREADS
+#include <pthread.h>
+#endif
+
+/*
+In-memory zmap implementation.
+
+Every content-bearing object is kept in a hash table keyed by its
+full key (e.g. /v/0.0) and holding a malloc'd copy of its content.
+Nothing touches storage while the dataset is open, so this can be
+used to build a dataset entirely in RAM, or to measure the cost of
+the codecs and the chunk walker without any I/O.
+
+The storage that the dataset is associated with (the "backing" map)
+is given by the parameters argument of create and open: a pointer
+to an NCZM_IMPL; NULL means NCZM_DEFAULT. As with NC_INMEMORY for
+classic files:
+1. open extracts the whole dataset from the backing map into memory;
+2. if the mode includes NC_PERSIST and NC_WRITE, then close writes the
+   whole dataset back to the backing map, replacing whatever was there;
+3. otherwise, the content is discarded on close.
+*/
+
+#define NCZM_MEM_V1 1
+
+/* One content-bearing object */
+typedef struct ZMOBJ {
+    size64_t size;
+    size64_t alloc;
+    unsigned char* content;
+} ZMOBJ;
+
+/* Define the "subclass" of NCZMAP */
+typedef struct ZMMAP {
+    NCZMAP map;
+    NCZM_IMPL backing; /* where open extracts from and close persists to */
+    NC_hashmap* objects; /* key => ZMOBJ* */
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_t mutex;
+#endif
+} ZMMAP;
+
+/* Forward */
+static NCZMAP_API zapi;
+static int zmemclose(NCZMAP* map, int delete);
+static int zmembuild(const char* path, int mode, size64_t flags, void* parameters, ZMMAP** zmmapp);
+static int zmemextract(ZMMAP* zmmap, NCZMAP* src, const char* prefix);
+static int zmempersist(ZMMAP* zmmap);
+static ZMOBJ* zmemlookup(ZMMAP* zmmap, const char* key);
+static void zmemlock(ZMMAP* zmmap);
+static void zmemunlock(ZMMAP* zmmap);
+
+/**************************************************/
+/* Define the Dataset level API */
+
+/*
+@param path the dataset url; it names the backing storage
+@param mode the netcdf-c mode flags
+@param flags extra flags
+@param parameters NCZM_IMPL* of the backing map or NULL
+@param mapp return the map object in this
+*/
+
+static int
+zmemcreate(const char *path, int mode, size64_t flags, void* parameters, NCZMAP** mapp)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = NULL;
+
+    ZTRACE(5,"path=%s mode=%d flag=%llu",path,mode,flags);
+
+    /* create => NC_WRITE */
+    if((stat = zmembuild(path,mode|NC_NETCDF4|NC_WRITE,flags,parameters,&zmmap)))
+	goto done;
+    /* Nothing exists yet; clobbering the backing storage is deferred to a persisting close */
+    if(mapp) *mapp = (NCZMAP*)zmmap;
+
+done:
+    return ZUNTRACE(stat);
+}
+
+static int
+zmemopen(const char *path, int mode, size64_t flags, void* parameters, NCZMAP** mapp)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = NULL;
+    NCZMAP* src = NULL;
+
+    ZTRACE(5,"path=%s mode=%d flags=%llu",path,mode,flags);
+
+    if((stat = zmembuild(path,mode|NC_NETCDF4,flags,parameters,&zmmap)))
+	goto done;
+    /* Pull the whole dataset into memory */
+    if((stat = nczmap_open(zmmap->backing,path,(mode & ~NC_WRITE),flags,NULL,&src)))
+	goto done;
+    if((stat = zmemextract(zmmap,src,"/"))) goto done;
+    if(mapp) *mapp = (NCZMAP*)zmmap;
+
+done:
+    if(src) (void)nczmap_close(src,0);
+    if(stat) zmemclose((NCZMAP*)zmmap,1);
+    return ZUNTRACE(stat);
+}
+
+/**************************************************/
+/* Object API */
+
+static int
+zmemexists(NCZMAP* map, const char* key)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = (ZMMAP*)map;
+
+    zmemlock(zmmap);
+    if(zmemlookup(zmmap,key) == NULL) stat = NC_EEMPTY;
+    zmemunlock(zmmap);
+    return stat;
+}
+
+static int
+zmemlen(NCZMAP* map, const char* key, size64_t* lenp)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = (ZMMAP*)map;
+    ZMOBJ* obj = NULL;
+    size64_t len = 0;
+
+    zmemlock(zmmap);
+    if((obj = zmemlookup(zmmap,key)) == NULL)
+	stat = NC_EEMPTY;
+    else
+	len = obj->size;
+    zmemunlock(zmmap);
+    if(lenp) *lenp = len;
+    return stat;
+}
+
+static int
+zmemread(NCZMAP* map, const char* key, size64_t start, size64_t count, void* content)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = (ZMMAP*)map;
+    ZMOBJ* obj = NULL;
+
+    ZTRACE(6,"map=%s key=%s start=%llu count=%llu",map->url,key,start,count);
+
+    zmemlock(zmmap);
+    if((obj = zmemlookup(zmmap,key)) == NULL)
+	stat = NC_EEMPTY;
+    else if(start + count > obj->size) /* a short read, as with the other maps */
+	stat = NC_EINTERNAL;
+    else if(count > 0)
+	memcpy(content,obj->content+start,(size_t)count);
+    zmemunlock(zmmap);
+    return ZUNTRACE(stat);
+}
+
+static int
+zmemwrite(NCZMAP* map, const char* key, size64_t start, size64_t count, const void* content)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = (ZMMAP*)map;
+    ZMOBJ* obj = NULL;
+    size64_t end = start + count;
+
+    ZTRACE(6,"map=%s key=%s start=%llu count=%llu",map->url,key,start,count);
+
+    if(!fIsSet(map->mode,NC_WRITE)) return ZUNTRACE(NC_EPERM);
+
+    zmemlock(zmmap);
+    if((obj = zmemlookup(zmmap,key)) == NULL) {
+	if((obj = calloc(1,sizeof(ZMOBJ))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	if(!NC_hashmapadd(zmmap->objects,(uintptr_t)obj,key,strlen(key)))
+	    {free(obj); stat = NC_ENOMEM; goto done;}
+    }
+    if(end > obj->alloc) {
+	/* Grow geometrically so that objects written in pieces are not copied on every piece */
+	size64_t newalloc = (obj->alloc * 2 > end ? obj->alloc * 2 : end);
+	unsigned char* newcontent = realloc(obj->content,(size_t)(newalloc == 0 ? 1 : newalloc));
+	if(newcontent == NULL) {stat = NC_ENOMEM; goto done;}
+	obj->content = newcontent;
+	obj->alloc = newalloc;
+    }
+    if(start > obj->size) /* a hole reads as zeros */
+	memset(obj->content+obj->size,0,(size_t)(start - obj->size));
+    if(count > 0)
+	memcpy(obj->content+start,content,(size_t)count);
+    if(end > obj->size) obj->size = end;
+
+done:
+    zmemunlock(zmmap);
+    return ZUNTRACE(stat);
+}
+
+static int
+zmemremove(NCZMAP* map, const char* key)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = (ZMMAP*)map;
+    uintptr_t data = 0;
+
+    zmemlock(zmmap);
+    if(!NC_hashmapremove(zmmap->objects,key,strlen(key),&data))
+	stat = NC_EEMPTY;
+    zmemunlock(zmmap);
+    if(data) {
+	ZMOBJ* obj = (ZMOBJ*)data;
+	nullfree(obj->content);
+	free(obj);
+    }
+    return stat;
+}
+
+/*
+Return the distinct next segments of all the keys below the prefix.
+The table is scanned in full, as is the zip map's tree; a missing
+prefix yields no matches.
+*/
+static int
+zmemsearch(NCZMAP* map, const char* prefixkey, NClist* matches)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = (ZMMAP*)map;
+    char* prefix = NULL;
+    size_t plen, i;
+    NC_hashmap* seen = NC_hashmapnew(0);
+
+    ZTRACE(5,"map=%s prefixkey=%s",map->url,prefixkey);
+
+    /* Normalize the prefix to end with '/' */
+    if(prefixkey == NULL || strlen(prefixkey)==0 || strcmp(prefixkey,"/")==0)
+	prefix = strdup("/");
+    else if((stat = nczm_appendn(&prefix,2,prefixkey,
+				 (prefixkey[strlen(prefixkey)-1] == NCZM_SEP[0]?"":NCZM_SEP))))
+	goto done;
+    if(prefix == NULL) {stat = NC_ENOMEM; goto done;}
+    plen = strlen(prefix);
+
+    zmemlock(zmmap);
+    for(i=0;;i++) {
+	const char* key = NULL;
+	const char* name;
+	const char* q;
+	size_t nlen;
+	if(NC_hashmapith(zmmap->objects,i,NULL,&key) != NC_NOERR) break;
+	if(key == NULL || strncmp(key,prefix,plen) != 0) continue;
+	name = key + plen;
+	q = strchr(name,NCZM_SEP[0]);
+	nlen = (q == NULL ? strlen(name) : (size_t)(q - name));
+	if(nlen == 0) continue;
+	if(!NC_hashmapget(seen,name,nlen,NULL)) {
+	    char* segment = malloc(nlen+1);
+	    if(segment == NULL) {stat = NC_ENOMEM; break;}
+	    memcpy(segment,name,nlen);
+	    segment[nlen] = '\0';
+	    nclistpush(matches,segment);
+	    NC_hashmapadd(seen,0,segment,nlen);
+	}
+    }
+    zmemunlock(zmmap);
+
+done:
+    NC_hashmapfree(seen);
+    nullfree(prefix);
+    return ZUNTRACEX(stat,"|matches|=%d",(int)nclistlength(matches));
+}
+
+static int
+zmemclose(NCZMAP* map, int delete)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = (ZMMAP*)map;
+    size_t i;
+
+    ZTRACE(5,"map=%s delete=%d",(map?map->url:"null"),delete);
+    if(zmmap == NULL) return ZUNTRACE(NC_NOERR);
+
+    if(!delete && fIsSet(map->mode,NC_PERSIST) && fIsSet(map->mode,NC_WRITE))
+	stat = zmempersist(zmmap);
+
+    if(zmmap->objects != NULL) {
+	for(i=0;;i++) {
+	    uintptr_t data = 0;
+	    if(NC_hashmapith(zmmap->objects,i,&data,NULL) != NC_NOERR) break;
+	    if(data) {
+		ZMOBJ* obj = (ZMOBJ*)data;
+		nullfree(obj->content);
+		free(obj);
+	    }
+	}
+	NC_hashmapfree(zmmap->objects);
+    }
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_destroy(&zmmap->mutex);
+#endif
+    nczm_clear(map);
+    free(zmmap);
+    return ZUNTRACE(stat);
+}
+
+/**************************************************/
+/* Utilities */
+
+static int
+zmembuild(const char* path, int mode, size64_t flags, void* parameters, ZMMAP** zmmapp)
+{
+    int stat = NC_NOERR;
+    ZMMAP* zmmap = NULL;
+
+    if((zmmap = calloc(1,sizeof(ZMMAP))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    zmmap->map.format = NCZM_MEM;
+    zmmap->map.url = strdup(path);
+    zmmap->map.flags = flags;
+    zmmap->map.mode = mode;
+    zmmap->map.api = &zapi;
+    zmmap->backing = (parameters == NULL ? NCZM_DEFAULT : *((NCZM_IMPL*)parameters));
+    if(zmmap->backing == NCZM_MEM || zmmap->backing == NCZM_UNDEF)
+	zmmap->backing = NCZM_DEFAULT;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_init(&zmmap->mutex,NULL);
+#endif
+    if(zmmap->map.url == NULL || (zmmap->objects = NC_hashmapnew(0)) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if(zmmapp) {*zmmapp = zmmap; zmmap = NULL;}
+
+done:
+    if(zmmap) zmemclose((NCZMAP*)zmmap,1);
+    return stat;
+}
+
+/* Copy every object below prefix in src into memory; a name is an
+   object if it has content, and otherwise is searched in turn */
+static int
+zmemextract(ZMMAP* zmmap, NCZMAP* src, const char* prefix)
+{
+    int stat = NC_NOERR;
+    NClist* names = nclistnew();
+    char* key = NULL;
+    void* content = NULL;
+    size_t i;
+    int mode = zmmap->map.mode;
+
+    if((stat = nczmap_search(src,prefix,names))) goto done;
+    zmmap->map.mode |= NC_WRITE; /* so that zmemwrite accepts the content */
+    for(i=0;i<nclistlength(names);i++) {
+	size64_t len = 0;
+	nullfree(key); key = NULL;
+	if((stat = nczm_concat(prefix,nclistget(names,i),&key))) goto done;
+	switch (stat = nczmap_len(src,key,&len)) {
+	case NC_NOERR:
+	    if((content = malloc((size_t)(len == 0 ? 1 : len))) == NULL)
+		{stat = NC_ENOMEM; goto done;}
+	    if(len > 0 && (stat = nczmap_read(src,key,0,len,content))) goto done;
+	    if((stat = zmemwrite((NCZMAP*)zmmap,key,0,len,content))) goto done;
+	    nullfree(content); content = NULL;
+	    break;
+	case NC_EEMPTY: /* not content-bearing; look below it */
+	    if((stat = zmemextract(zmmap,src,key))) goto done;
+	    break;
+	default: goto done;
+	}
+    }
+
+done:
+    zmmap->map.mode = mode;
+    nullfree(content);
+    nullfree(key);
+    nclistfreeall(names);
+    return stat;
+}
+
+/* Replace the backing dataset with the content of memory */
+static int
+zmempersist(ZMMAP* zmmap)
+{
+    int stat = NC_NOERR;
+    NCZMAP* dst = NULL;
+    size_t i;
+    int mode = (zmmap->map.mode & ~(NC_NOCLOBBER|NC_PERSIST)) | NC_WRITE;
+
+    if((stat = nczmap_create(zmmap->backing,zmmap->map.url,mode,zmmap->map.flags,NULL,&dst)))
+	goto done;
+    for(i=0;;i++) {
+	uintptr_t data = 0;
+	const char* key = NULL;
+	ZMOBJ* obj;
+	if(NC_hashmapith(zmmap->objects,i,&data,&key) != NC_NOERR) break;
+	if((obj = (ZMOBJ*)data) == NULL) continue;
+	if((stat = nczmap_write(dst,key,0,obj->size,obj->content))) goto done;
+    }
+
+done:
+    if(dst) {
+	int stat2 = nczmap_close(dst,0);
+	if(!stat) stat = stat2;
+    }
+    return stat;
+}
+
+/* Caller must hold the lock */
+static ZMOBJ*
+zmemlookup(ZMMAP* zmmap, const char* key)
+{
+    uintptr_t data = 0;
+    if(!NC_hashmapget(zmmap->objects,key,strlen(key),&data))
+	return NULL;
+    return (ZMOBJ*)data;
+}
+
+static void
+zmemlock(ZMMAP* zmmap)
+{
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_lock(&zmmap->mutex);
+#else
+    NC_UNUSED(zmmap);
+#endif
+}
+
+static void
+zmemunlock(ZMMAP* zmmap)
+{
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_unlock(&zmmap->mutex);
+#else
+    NC_UNUSED(zmmap);
+#endif
+}
+
+/**************************************************/
+/* External API objects */
+
+NCZMAP_DS_API zmap_mem = {
+    NCZM_MEM_V1,
+    NCZM_THREADSAFE,
+    zmemcreate,
+    zmemopen,
+};
+
+static NCZMAP_API zapi = {
+    NCZM_MEM_V1,
+    zmemclose,
+    zmemexists,
+    zmemlen,
+    zmemread,
+    zmemwrite,
+    zmemsearch,
+    NULL, /* existsn: the single-key operations are already cheap */
+    NULL,
+    NULL,
+    zmemremove,
+};
@@ -51,6 +51,7 @@ typedef struct ZS3MAP {
 /* Forward */
 static NCZMAP_API nczs3sdkapi; // c++ will not allow static forward variables
 static int zs3len(NCZMAP* map, const char* key, size64_t* lenp);
+static int zs3remove(NCZMAP* map, const char* key);
 
 static void freevector(size_t nkeys, char** list);
 
@@ -387,6 +388,123 @@ done:
     return ZUNTRACE(stat);
 }
 
+/* Convert the keys of a batch to true keys; caller frees the vector */
+static int
+maketruekeys(ZS3MAP* z3map, size_t n, NCZM_REQUEST* requests, char*** truekeysp)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    char** truekeys = NULL;
+
+    if((truekeys = (char**)calloc(n+1,sizeof(char*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<n;i++) {
+	if((stat = maketruekey(z3map->s3.rootkey,requests[i].key,&truekeys[i]))) goto done;
+    }
+    *truekeysp = truekeys; truekeys = NULL;
+done:
+    if(truekeys) freevector(n,truekeys);
+    return stat;
+}
+
+/*
+Issue all the HEAD requests of the batch concurrently.
+*/
+static int
+zs3existsn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = NC_NOERR;
+    ZS3MAP* z3map = (ZS3MAP*)map;
+    char** truekeys = NULL;
+    int* stats = NULL;
+    size_t i;
+
+    ZTRACE(6,"map=%s n=%llu",map->url,(unsigned long long)n);
+
+    if(n == 0) goto done;
+    if((stat = maketruekeys(z3map,n,requests,&truekeys))) goto done;
+    if((stats = (int*)calloc(n,sizeof(int))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((stat = NC_s3sdkinfon(z3map->s3client,z3map->s3.bucket,n,(const char**)truekeys,NULL,stats,&z3map->errmsg)))
+	goto done;
+    for(i=0;i<n;i++) requests[i].stat = stats[i];
+
+done:
+    if(truekeys) freevector(n,truekeys);
+    nullfree(stats);
+    reporterr(z3map);
+    return ZUNTRACE(stat);
+}
+
+/*
+Issue all the GET requests of the batch concurrently.
+Unlike zs3read, whole-object requests need no preceding HEAD
+because the object size is the size of the response.
+*/
+static int
+zs3readn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = NC_NOERR;
+    ZS3MAP* z3map = (ZS3MAP*)map;
+    char** truekeys = NULL;
+    int* stats = NULL;
+    size64_t* starts = NULL;
+    size64_t* counts = NULL;
+    void** contents = NULL;
+    size_t i;
+
+    ZTRACE(6,"map=%s n=%llu",map->url,(unsigned long long)n);
+
+    if(n == 0) goto done;
+    if((stat = maketruekeys(z3map,n,requests,&truekeys))) goto done;
+    stats = (int*)calloc(n,sizeof(int));
+    starts = (size64_t*)calloc(n,sizeof(size64_t));
+    counts = (size64_t*)calloc(n,sizeof(size64_t));
+    contents = (void**)calloc(n,sizeof(void*));
+    if(stats == NULL || starts == NULL || counts == NULL || contents == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<n;i++) {
+	starts[i] = requests[i].start;
+	counts[i] = requests[i].count;
+	contents[i] = requests[i].content;
+    }
+    stat = NC_s3sdkreadn(z3map->s3client,z3map->s3.bucket,n,(const char**)truekeys,starts,counts,contents,stats,&z3map->errmsg);
+    /* Always hand back the results so that allocated content is not lost */
+    for(i=0;i<n;i++) {
+	requests[i].start = starts[i];
+	requests[i].count = counts[i];
+	requests[i].content = contents[i];
+	requests[i].stat = stats[i];
+    }
+
+done:
+    if(truekeys) freevector(n,truekeys);
+    nullfree(stats);
+    nullfree(starts);
+    nullfree(counts);
+    nullfree(contents);
+    reporterr(z3map);
+    return ZUNTRACE(stat);
+}
+
+/* S3 reports success when deleting a missing key */
+static int
+zs3remove(NCZMAP* map, const char* key)
+{
+    int stat = NC_NOERR;
+    ZS3MAP* z3map = (ZS3MAP*)map;
+    char* truekey = NULL;
+
+    ZTRACE(6,"map=%s key=%s",map->url,key);
+
+    if((stat = maketruekey(z3map->s3.rootkey,key,&truekey))) goto done;
+    stat = NC_s3sdkdeletekey(z3map->s3client,z3map->s3.bucket,truekey,&z3map->errmsg);
+done:
+    nullfree(truekey);
+    reporterr(z3map);
+    return ZUNTRACE(stat);
+}
+
 static int
 zs3close(NCZMAP* map, int deleteit)
 {
@@ -579,4 +697,8 @@ nczs3sdkapi = {
     zs3read,
     zs3write,
     zs3search,
+    zs3existsn,
+    zs3readn,
+    NULL, /* writen: zs3write must read-modify-write, so loop over it */
+    zs3remove,
 };
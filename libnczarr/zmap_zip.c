@@ -14,6 +14,19 @@
 #include <errno.h>
 #include <zip.h>
 
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
 #include "fbits.h"
 #include "ncpathmgr.h"
 
@@ -52,6 +65,32 @@ For the object API, the mapping is as follows:
 /* define the var name containing an objects content */
 #define ZCONTENT "data"
 
+/*
+An archive opened read-only also gets its own index of the central
+directory, parsed once at open and sorted by name. Lookups and
+searches then use binary search instead of libzip name lookups and
+scans, and an entry stored uncompressed (the usual case for chunks,
+which are already filtered) is read with a single pread at its data
+offset instead of being opened and read from its start by libzip.
+Compressed or encrypted entries, archives that cannot be parsed, and
+archives open for writing (whose pending changes exist only inside
+libzip) all use libzip as before.
+*/
+
+typedef struct ZZENTRY {
+    char* name; /* full name in the archive, e.g. dataset/v/0.0 */
+    int direct; /* 1 => stored uncompressed and unencrypted */
+    size64_t size; /* uncompressed size */
+    size64_t header; /* offset of the local header */
+    size64_t data; /* offset of the content; 0 => not yet computed */
+} ZZENTRY;
+
+typedef struct ZZINDEX {
+    int fd;
+    size_t nentries;
+    ZZENTRY* entries; /* sorted by name */
+} ZZINDEX;
+
 /* Define the "subclass" of NCZMAP */
 typedef struct ZZMAP {
     NCZMAP map;
@@ -59,6 +98,7 @@ typedef struct ZZMAP {
     char* dataset; /* prefix for all keys in zip file */
     zip_t* archive;
     char** searchcache;
+    ZZINDEX* index; /* NULL => use libzip for everything */
 } ZZMAP;
 
 typedef zip_int64_t ZINDEX;;    
@@ -73,6 +113,11 @@ static int zipmaperr(ZZMAP* zzmap);
 static int ziperr(zip_error_t* zerror);
 static int ziperrno(int zerror);
 static void freesearchcache(char** cache);
+static int zzindexbuild(ZZMAP* zzmap);
+static void zzindexfree(ZZINDEX* index);
+static int zzindexlookup(ZZMAP* zzmap, const char* key, ZZENTRY** entryp);
+static int zzindexread(ZZMAP* zzmap, ZZENTRY* entry, size64_t start, size64_t count, void* content);
+static int zzindexsearch(ZZMAP* zzmap, const char* trueprefix, NClist* matches);
 
 static int zzinitialized = 0;
 
@@ -257,6 +302,9 @@ zipopen(const char *path, int mode, size64_t flags, void* parameters, NCZMAP** m
 	if((nczm_segment1(name,&zzmap->dataset))) goto done;
     }
 
+    /* The on-disk central directory is current only if nothing will be written */
+    if(!fIsSet(mode,NC_WRITE) && (stat = zzindexbuild(zzmap))) goto done;
+
     /* Dataset superblock will be read by higher layer */
     
     if(mapp) {*mapp = (NCZMAP*)zzmap; zzmap = NULL;}
@@ -280,6 +328,12 @@ zipexists(NCZMAP* map, const char* key)
     ZINDEX zindex = -1;
 
     ZTRACE(6,"map=%s key=%s",map->url,key);
+    if(zzmap->index != NULL) {
+	ZZENTRY* entry = NULL;
+	stat = zzindexlookup(zzmap,key,&entry);
+	if(stat == NC_ENOOBJECT) stat = NC_EEMPTY;
+	return ZUNTRACE(stat);
+    }
     switch(stat=zzlookupobj(zzmap,key,&zindex)) {
     case NC_NOERR: break;
     case NC_ENOOBJECT: stat = NC_EEMPTY; break;
@@ -299,6 +353,18 @@ ziplen(NCZMAP* map, const char* key, size64_t* lenp)
 
     ZTRACE(6,"map=%s key=%s",map->url,key);
 
+    if(zzmap->index != NULL) {
+	ZZENTRY* entry = NULL;
+	switch(stat = zzindexlookup(zzmap,key,&entry)) {
+	case NC_NOERR: len = entry->size; break;
+	case NC_ENOOBJECT: stat = NC_EEMPTY; break;
+	case NC_EEMPTY: break;
+	default: goto done;
+	}
+	if(lenp) *lenp = len;
+	goto done;
+    }
+
     switch(stat = zzlookupobj(zzmap,key,&zindex)) {
     case NC_NOERR:
 	if((stat = zzlen(zzmap,zindex,&len))) goto done;
@@ -330,6 +396,19 @@ zipread(NCZMAP* map, const char* key, size64_t start, size64_t count, void* cont
 
     ZTRACE(6,"map=%s key=%s start=%llu count=%llu",map->url,key,start,count);
 
+    if(zzmap->index != NULL) {
+	ZZENTRY* entry = NULL;
+	switch(stat = zzindexlookup(zzmap,key,&entry)) {
+	case NC_NOERR: break;
+	case NC_ENOOBJECT: stat = NC_EEMPTY; /* fall thru */
+	default: goto done;
+	}
+	/* NC_ENOTBUILT => compressed; let libzip decode it */
+	if((stat = zzindexread(zzmap,entry,start,count,content)) != NC_ENOTBUILT)
+	    goto done;
+	stat = NC_NOERR;
+    }
+
     switch(stat = zzlookupobj(zzmap,key,&zindex)) {
     case NC_NOERR: break;
     case NC_ENOOBJECT: stat = NC_EEMPTY; /* fall thru */
@@ -445,6 +524,123 @@ done:
     return ZUNTRACE(stat);
 }
 
+/* Pair a batch request with its archive index for sorting */
+typedef struct ZZREQ {
+    ZINDEX zindex;
+    NCZM_REQUEST* req;
+} ZZREQ;
+
+static int
+zzreqcompare(const void* a, const void* b)
+{
+    const ZZREQ* ra = (const ZZREQ*)a;
+    const ZZREQ* rb = (const ZZREQ*)b;
+    return (ra->zindex < rb->zindex ? -1 : (ra->zindex > rb->zindex ? 1 : 0));
+}
+
+/*
+Locate every key first, then read the entries in archive index order
+so the archive is traversed roughly sequentially. Entries are opened
+by index, which avoids the second name lookup done by zipread.
+*/
+static int
+zipreadn(NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = NC_NOERR;
+    ZZMAP* zzmap = (ZZMAP*)map; /* cast to true type */
+    ZZREQ* order = NULL;
+    zip_file_t* zfile = NULL;
+    char* buffer = NULL;
+    size_t i, nfound;
+    int zerrno;
+
+    ZTRACE(6,"map=%s n=%llu",map->url,(unsigned long long)n);
+
+    if(n == 0) goto done;
+    if((order = (ZZREQ*)calloc(n,sizeof(ZZREQ))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(nfound=0,i=0;i<n;i++) {
+	NCZM_REQUEST* req = &requests[i];
+	ZINDEX zindex = -1;
+	if(zzmap->index != NULL) { /* serve stored entries directly */
+	    ZZENTRY* entry = NULL;
+	    int alloc = (req->content == NULL);
+	    switch(req->stat = zzindexlookup(zzmap,req->key,&entry)) {
+	    case NC_NOERR: break;
+	    case NC_ENOOBJECT: req->stat = NC_EEMPTY; /* fall thru */
+	    default: continue;
+	    }
+	    if(entry->direct) {
+		if(alloc) {
+		    req->start = 0;
+		    req->count = entry->size;
+		    if((req->content = malloc(entry->size == 0 ? 1 : entry->size)) == NULL)
+			{stat = NC_ENOMEM; goto done;}
+		}
+		req->stat = zzindexread(zzmap,entry,req->start,req->count,req->content);
+		if(req->stat && alloc)
+		    {nullfree(req->content); req->content = NULL; req->count = 0;}
+		continue;
+	    }
+	}
+	switch(req->stat = zzlookupobj(zzmap,req->key,&zindex)) {
+	case NC_NOERR: break;
+	case NC_ENOOBJECT: req->stat = NC_EEMPTY; /* fall thru */
+	default: continue;
+	}
+	order[nfound].zindex = zindex;
+	order[nfound].req = req;
+	nfound++;
+    }
+    qsort(order,nfound,sizeof(ZZREQ),zzreqcompare);
+
+    for(i=0;i<nfound;i++) {
+	NCZM_REQUEST* req = order[i].req;
+	size64_t endpoint;
+	zip_int64_t red = 0;
+	int alloc = (req->content == NULL);
+	if(alloc) { /* whole object */
+	    size64_t len = 0;
+	    if((req->stat = zzlen(zzmap,order[i].zindex,&len))) continue;
+	    req->start = 0;
+	    req->count = len;
+	    if((req->content = malloc(len == 0 ? 1 : len)) == NULL)
+		{stat = NC_ENOMEM; goto done;}
+	}
+	if(req->count == 0) continue;
+	if((zfile = zip_fopen_index(zzmap->archive,(zip_uint64_t)order[i].zindex,0)) == NULL)
+	    {req->stat = zipmaperr(zzmap); goto next;}
+	/* As with zipread, compressed entries cannot seek, so read from zero */
+	endpoint = req->start + req->count;
+	if(req->start == 0) {
+	    if((red = zip_fread(zfile,req->content,(zip_uint64_t)req->count)) < 0)
+		{req->stat = zipmaperr(zzmap); goto next;}
+	} else {
+	    if((buffer = malloc(endpoint)) == NULL)
+		{stat = NC_ENOMEM; goto done;}
+	    if((red = zip_fread(zfile,buffer,(zip_uint64_t)endpoint)) < 0)
+		{req->stat = zipmaperr(zzmap); goto next;}
+	    if(red == endpoint)
+		memcpy(req->content,buffer+req->start,req->count);
+	    red -= (zip_int64_t)req->start;
+	}
+	if(red < (zip_int64_t)req->count) req->stat = NC_EINTERNAL;
+next:
+	nullfree(buffer); buffer = NULL;
+	if(zfile != NULL && (zerrno=zip_fclose(zfile)) != 0 && req->stat == NC_NOERR)
+	    req->stat = ziperrno(zerrno);
+	zfile = NULL;
+	if(req->stat && alloc)
+	    {nullfree(req->content); req->content = NULL; req->count = 0;}
+    }
+
+done:
+    nullfree(buffer);
+    if(zfile != NULL) (void)zip_fclose(zfile);
+    nullfree(order);
+    return ZUNTRACE(stat);
+}
+
 static int
 zipclose(NCZMAP* map, int delete)
 {
@@ -467,6 +663,8 @@ zipclose(NCZMAP* map, int delete)
         NCremove(zzmap->root);
 
     zzmap->archive = NULL;
+    zzindexfree(zzmap->index);
+    zzmap->index = NULL;
     nczm_clear(map);
     nullfree(zzmap->root);
     nullfree(zzmap->dataset);
@@ -523,6 +721,11 @@ zipsearch(NCZMAP* map, const char* prefix0, NClist* matches)
 	strlcat(trueprefix,"/",truelen+1);
     truelen = strlen(trueprefix);
 
+    if(zzmap->index != NULL) {
+	stat = zzindexsearch(zzmap,trueprefix,matches);
+	goto done;
+    }
+
     /* Get number of entries */
     num_entries = zip_get_num_entries(zzmap->archive, (zip_flags_t)0);
 #ifdef CACHESEARCH
@@ -700,6 +903,289 @@ done:
     return ZUNTRACEX(stat,"len=%llu",(lenp?*lenp:777777777777));
 }
 
+/**************************************************/
+/* Central directory index */
+
+/* Zip record signatures and fixed sizes */
+#define ZZ_LOCAL_SIG 0x04034b50
+#define ZZ_CENTRAL_SIG 0x02014b50
+#define ZZ_EOCD_SIG 0x06054b50
+#define ZZ_EOCD64_SIG 0x06064b50
+#define ZZ_LOCATOR64_SIG 0x07064b50
+#define ZZ_LOCAL_SIZE 30
+#define ZZ_CENTRAL_SIZE 46
+#define ZZ_EOCD_SIZE 22
+#define ZZ_EOCD64_SIZE 56
+#define ZZ_LOCATOR64_SIZE 20
+#define ZZ_MAXCOMMENT 65535
+#define ZZ_ZIP64_EXTRA 0x0001
+
+/* Zip integers are little-endian */
+static unsigned
+zzget16(const unsigned char* p)
+{
+    return (unsigned)p[0] | ((unsigned)p[1] << 8);
+}
+
+static size64_t
+zzget32(const unsigned char* p)
+{
+    return (size64_t)zzget16(p) | ((size64_t)zzget16(p+2) << 16);
+}
+
+static size64_t
+zzget64(const unsigned char* p)
+{
+    return zzget32(p) | (zzget32(p+4) << 32);
+}
+
+static int
+zzpread(int fd, size64_t offset, size64_t count, void* content)
+{
+#ifdef HAVE_PREAD
+    unsigned char* readpoint = content;
+    while(count > 0) {
+	ssize_t red = pread(fd,readpoint,(size_t)count,(off_t)offset);
+	if(red <= 0) return (red < 0 ? NC_EIO : NC_EINTERNAL);
+	count -= (size64_t)red;
+	offset += (size64_t)red;
+	readpoint += red;
+    }
+    return NC_NOERR;
+#else
+    if(lseek(fd,(off_t)offset,SEEK_SET) < 0) return NC_EIO;
+    while(count > 0) {
+	ssize_t red = read(fd,content,(size_t)count);
+	if(red <= 0) return (red < 0 ? NC_EIO : NC_EINTERNAL);
+	count -= (size64_t)red;
+	content = ((unsigned char*)content) + red;
+    }
+    return NC_NOERR;
+#endif
+}
+
+static int
+zzentrycompare(const void* a, const void* b)
+{
+    return strcmp(((const ZZENTRY*)a)->name,((const ZZENTRY*)b)->name);
+}
+
+/* Parse the central directory into zzmap->index. An archive that
+   cannot be parsed is left without an index; only NC_ENOMEM is fatal. */
+static int
+zzindexbuild(ZZMAP* zzmap)
+{
+    int stat = NC_NOERR;
+    ZZINDEX* index = NULL;
+    unsigned char* tail = NULL;
+    unsigned char* cd = NULL;
+    unsigned char* p;
+    struct stat statbuf;
+    size64_t filesize, taillen, eocd, nentries, cdsize, cdoffset, i;
+    int fd = -1;
+
+    ZTRACE(7,"map=%s",zzmap->map.url);
+
+    if((fd = NCopen2(zzmap->root,O_RDONLY
+#ifdef O_BINARY
+				     |O_BINARY
+#endif
+		    )) < 0) goto done;
+    if(fstat(fd,&statbuf) < 0) goto done;
+    filesize = (size64_t)statbuf.st_size;
+    if(filesize < ZZ_EOCD_SIZE) goto done;
+
+    /* The end of central directory record is followed only by the archive comment */
+    taillen = ZZ_EOCD_SIZE + ZZ_MAXCOMMENT;
+    if(taillen > filesize) taillen = filesize;
+    if((tail = malloc((size_t)taillen)) == NULL) {stat = NC_ENOMEM; goto done;}
+    if(zzpread(fd,filesize-taillen,taillen,tail)) goto done;
+    for(p=tail+(taillen-ZZ_EOCD_SIZE);;p--) {
+	if(zzget32(p) == ZZ_EOCD_SIG) break;
+	if(p == tail) goto done; /* not found */
+    }
+    eocd = (filesize - taillen) + (size64_t)(p - tail);
+    if(zzget16(p+4) != 0) goto done; /* multi-disk archive */
+    nentries = zzget16(p+10);
+    cdsize = zzget32(p+12);
+    cdoffset = zzget32(p+16);
+    if(nentries == 0xFFFF || cdsize == 0xFFFFFFFF || cdoffset == 0xFFFFFFFF) {
+	/* Zip64: the locator precedes the record and gives the zip64 record */
+	unsigned char rec[ZZ_EOCD64_SIZE];
+	size64_t eocd64;
+	if(eocd < ZZ_LOCATOR64_SIZE) goto done;
+	if(zzpread(fd,eocd-ZZ_LOCATOR64_SIZE,ZZ_LOCATOR64_SIZE,rec)) goto done;
+	if(zzget32(rec) != ZZ_LOCATOR64_SIG) goto done;
+	eocd64 = zzget64(rec+8);
+	if(eocd64 + ZZ_EOCD64_SIZE > filesize) goto done;
+	if(zzpread(fd,eocd64,ZZ_EOCD64_SIZE,rec)) goto done;
+	if(zzget32(rec) != ZZ_EOCD64_SIG) goto done;
+	nentries = zzget64(rec+32);
+	cdsize = zzget64(rec+40);
+	cdoffset = zzget64(rec+48);
+    }
+    if(cdoffset + cdsize > filesize || nentries > cdsize / ZZ_CENTRAL_SIZE) goto done;
+
+    if((cd = malloc((size_t)(cdsize == 0 ? 1 : cdsize))) == NULL) {stat = NC_ENOMEM; goto done;}
+    if(zzpread(fd,cdoffset,cdsize,cd)) goto done;
+    if((index = calloc(1,sizeof(ZZINDEX))) == NULL) {stat = NC_ENOMEM; goto done;}
+    index->fd = -1;
+    if((index->entries = calloc((size_t)(nentries == 0 ? 1 : nentries),sizeof(ZZENTRY))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(p=cd,i=0;i<nentries;i++) {
+	ZZENTRY* entry = &index->entries[i];
+	unsigned method, gpflags, namelen, extralen, commentlen;
+	size64_t csize;
+	const unsigned char* x;
+	const unsigned char* xend;
+	if((size64_t)(p - cd) + ZZ_CENTRAL_SIZE > cdsize || zzget32(p) != ZZ_CENTRAL_SIG) goto done;
+	gpflags = zzget16(p+8);
+	method = zzget16(p+10);
+	csize = zzget32(p+20);
+	entry->size = zzget32(p+24);
+	namelen = zzget16(p+28);
+	extralen = zzget16(p+30);
+	commentlen = zzget16(p+32);
+	entry->header = zzget32(p+42);
+	if((size64_t)(p - cd) + ZZ_CENTRAL_SIZE + namelen + extralen + commentlen > cdsize) goto done;
+	if((entry->name = malloc(namelen+1)) == NULL) {stat = NC_ENOMEM; goto done;}
+	memcpy(entry->name,p+ZZ_CENTRAL_SIZE,namelen);
+	entry->name[namelen] = '\0';
+	index->nentries++;
+	/* The zip64 extra field holds, in order, just the fields that overflowed */
+	x = p + ZZ_CENTRAL_SIZE + namelen;
+	xend = x + extralen;
+	while(x + 4 <= xend) {
+	    unsigned id = zzget16(x);
+	    unsigned len = zzget16(x+2);
+	    const unsigned char* v = x + 4;
+	    if(v + len > xend) break;
+	    if(id == ZZ_ZIP64_EXTRA) {
+		const unsigned char* vend = v + len;
+		if(entry->size == 0xFFFFFFFF && v + 8 <= vend) {entry->size = zzget64(v); v += 8;}
+		if(csize == 0xFFFFFFFF && v + 8 <= vend) {csize = zzget64(v); v += 8;}
+		if(entry->header == 0xFFFFFFFF && v + 8 <= vend) {entry->header = zzget64(v); v += 8;}
+	    }
+	    x += 4 + len;
+	}
+	entry->direct = (method == ZIP_CM_STORE && (gpflags & 1) == 0 && csize == entry->size);
+	p += ZZ_CENTRAL_SIZE + namelen + extralen + commentlen;
+    }
+    qsort(index->entries,(size_t)index->nentries,sizeof(ZZENTRY),zzentrycompare);
+    index->fd = fd; fd = -1;
+    zzmap->index = index; index = NULL;
+
+done:
+    if(fd >= 0) NCclose(fd);
+    zzindexfree(index);
+    nullfree(cd);
+    nullfree(tail);
+    return ZUNTRACE(stat);
+}
+
+static void
+zzindexfree(ZZINDEX* index)
+{
+    size_t i;
+    if(index == NULL) return;
+    for(i=0;i<index->nentries;i++)
+	nullfree(index->entries[i].name);
+    nullfree(index->entries);
+    if(index->fd >= 0) NCclose(index->fd);
+    free(index);
+}
+
+/* Return the position of the first entry whose name is >= name */
+static size_t
+zzindexlowerbound(ZZINDEX* index, const char* name)
+{
+    size_t lo = 0, hi = index->nentries;
+    while(lo < hi) {
+	size_t mid = lo + (hi - lo) / 2;
+	if(strcmp(index->entries[mid].name,name) < 0) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/* Same results as zzlookupobj; a directory need not have its own entry */
+static int
+zzindexlookup(ZZMAP* zzmap, const char* key, ZZENTRY** entryp)
+{
+    int stat = NC_NOERR;
+    ZZINDEX* index = zzmap->index;
+    char* name = NULL;
+    size_t pos, len;
+
+    if(key == NULL) {stat = NC_EINVAL; goto done;}
+    /* Note, assume key[0] == '/' */
+    if((stat = nczm_appendn(&name,3,zzmap->dataset,key,"/"))) goto done;
+    len = strlen(name);
+    name[len-1] = '\0'; /* first look for the object itself */
+    pos = zzindexlowerbound(index,name);
+    if(pos < index->nentries && strcmp(index->entries[pos].name,name) == 0) {
+	if(entryp) *entryp = &index->entries[pos];
+	goto done;
+    }
+    name[len-1] = '/'; /* then for anything below it */
+    pos = zzindexlowerbound(index,name);
+    if(pos < index->nentries && strncmp(index->entries[pos].name,name,len) == 0)
+	stat = NC_EEMPTY;
+    else
+	stat = NC_ENOOBJECT;
+
+done:
+    nullfree(name);
+    return stat;
+}
+
+/* Read a stored entry directly; NC_ENOTBUILT => the entry must be decoded by libzip */
+static int
+zzindexread(ZZMAP* zzmap, ZZENTRY* entry, size64_t start, size64_t count, void* content)
+{
+    int stat = NC_NOERR;
+    int fd = zzmap->index->fd;
+
+    if(!entry->direct) return NC_ENOTBUILT;
+    if(start + count > entry->size) return NC_EINTERNAL; /* short read */
+    if(count == 0) return NC_NOERR;
+    if(entry->data == 0) {
+	/* The local header may carry a different extra field than the central one */
+	unsigned char header[ZZ_LOCAL_SIZE];
+	if((stat = zzpread(fd,entry->header,ZZ_LOCAL_SIZE,header))) return stat;
+	if(zzget32(header) != ZZ_LOCAL_SIG) return NC_ENOTBUILT;
+	entry->data = entry->header + ZZ_LOCAL_SIZE + zzget16(header+26) + zzget16(header+28);
+    }
+    return zzpread(fd,entry->data+start,count,content);
+}
+
+/* The entries below trueprefix are contiguous in the sorted index,
+   and so are the entries below each of its next segments */
+static int
+zzindexsearch(ZZMAP* zzmap, const char* trueprefix, NClist* matches)
+{
+    int stat = NC_NOERR;
+    ZZINDEX* index = zzmap->index;
+    size_t truelen = strlen(trueprefix);
+    size_t pos;
+    char* match = NULL;
+    const char* last = NULL;
+
+    for(pos=zzindexlowerbound(index,trueprefix);pos<index->nentries;pos++) {
+	const char* name = index->entries[pos].name;
+	if(strncmp(name,trueprefix,truelen) != 0) break;
+	if(name[truelen] == '\0') continue; /* the prefix's own entry */
+	if((stat = nczm_segment1(name+truelen,&match))) goto done;
+	if(last != NULL && strcmp(last,match) == 0)
+	    {nullfree(match); match = NULL; continue;}
+	nclistpush(matches,match);
+	last = match; match = NULL;
+    }
+
+done:
+    nullfree(match);
+    return stat;
+}
+
 static void
 freesearchcache(char** cache)
 {
@@ -729,6 +1215,10 @@ static NCZMAP_API zapi = {
     zipread,
     zipwrite,
     zipsearch,
+    NULL, /* existsn: zipexists only does a name lookup */
+    zipreadn,
+    NULL, /* writen: libzip serializes writes at close */
+    NULL, /* remove: zip files are write once */
 };
 
 static int
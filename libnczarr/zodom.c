@@ -18,12 +18,30 @@ nczodom_reset(NCZOdometer* odom)
 NCZOdometer*
 nczodom_new(int rank, const size64_t* start, const size64_t* stop, const size64_t* stride, const size64_t* len)
 {
-    int i;
     NCZOdometer* odom = NULL;
     if(buildodom(rank,&odom)) return NULL;
+    nczodom_set(odom,start,stop,stride,len);
+    return odom;
+}
+
+NCZOdometer*
+nczodom_fromslices(int rank, const NCZSlice* slices)
+{
+    NCZOdometer* odom = NULL;
+
+    if(buildodom(rank,&odom)) return NULL;
+    nczodom_setslices(odom,slices);
+    return odom;
+}
+
+/* Reinitialize an existing odometer of the same rank */
+void
+nczodom_set(NCZOdometer* odom, const size64_t* start, const size64_t* stop, const size64_t* stride, const size64_t* len)
+{
+    int i;
     odom->properties.stride1 = 1; /* assume */
     odom->properties.start0 = 1; /* assume */
-    for(i=0;i<rank;i++) { 
+    for(i=0;i<odom->rank;i++) { 
 	odom->start[i] = (size64_t)start[i];
 	odom->stop[i] = (size64_t)stop[i];
 	odom->stride[i] = (size64_t)stride[i];
@@ -32,21 +50,17 @@ nczodom_new(int rank, const size64_t* start, const size64_t* stop, const size64_
 	if(odom->stride[i] != 1) odom->properties.stride1 = 0;
     }
     nczodom_reset(odom);
-    for(i=0;i<rank;i++)
+    for(i=0;i<odom->rank;i++)
         assert(stop[i] >= start[i] && stride[i] > 0 && (len[i]+1) >= stop[i]);
-    return odom;
 }
 
-NCZOdometer*
-nczodom_fromslices(int rank, const NCZSlice* slices)
+void
+nczodom_setslices(NCZOdometer* odom, const NCZSlice* slices)
 {
-    size_t i;
-    NCZOdometer* odom = NULL;
-
-    if(buildodom(rank,&odom)) return NULL;
+    int i;
     odom->properties.stride1 = 1; /* assume */
     odom->properties.start0 = 1; /* assume */
-    for(i=0;i<rank;i++) {    
+    for(i=0;i<odom->rank;i++) {    
 	odom->start[i] = slices[i].start;
 	odom->stop[i] = slices[i].stop;
 	odom->stride[i] = slices[i].stride;
@@ -55,11 +69,10 @@ nczodom_fromslices(int rank, const NCZSlice* slices)
 	if(odom->stride[i] != 1) odom->properties.stride1 = 0;
     }
     nczodom_reset(odom);
-    for(i=0;i<rank;i++) {
+    for(i=0;i<odom->rank;i++) {
         assert(slices[i].stop >= slices[i].start && slices[i].stride > 0);
         assert((slices[i].stop - slices[i].start) <= slices[i].len);
     }
-    return odom;
 }
   
 void
@@ -151,8 +164,10 @@ size64_t
 nczodom_avail(const NCZOdometer* odom)
 {
     size64_t avail;
+    int r = odom->rank-1;
     /* The best we can do is compute the count for the rightmost index */
-    avail = (odom->stop[odom->rank-1] - odom->start[odom->rank-1]);
+    if(odom->stop[r] <= odom->start[r]) return 0;
+    avail = (odom->stop[r] - odom->start[r] + odom->stride[r] - 1) / odom->stride[r];
     return avail;
 }
 
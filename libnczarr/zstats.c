@@ -0,0 +1,216 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+/**
+ * @file
+ * @internal Runtime I/O statistics of variables and datasets.
+ *
+ * @author Dennis Heimbigner
+ */
+
+#include "zincludes.h"
+#include "zstats.h"
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef ENABLE_NCZARR_THREADS
+#include <pthread.h>
+#endif
+
+/* The tracing code is not thread safe */
+#ifdef ZTRACING
+#undef ENABLE_NCZARR_THREADS
+#endif
+
+struct NCZStats {
+    NC_io_stats counts;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_t mutex;
+#endif
+};
+
+#ifdef ENABLE_NCZARR_THREADS
+#define LOCK(s) pthread_mutex_lock(&(s)->mutex)
+#define UNLOCK(s) pthread_mutex_unlock(&(s)->mutex)
+#else
+#define LOCK(s)
+#define UNLOCK(s)
+#endif
+
+int
+NCZ_stats_new(struct NCZStats** statsp)
+{
+    struct NCZStats* stats = NULL;
+    if((stats = calloc(1,sizeof(struct NCZStats))) == NULL)
+	return THROW(NC_ENOMEM);
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_init(&stats->mutex,NULL);
+#endif
+    *statsp = stats;
+    return NC_NOERR;
+}
+
+void
+NCZ_stats_free(struct NCZStats* stats)
+{
+    if(stats == NULL) return;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_mutex_destroy(&stats->mutex);
+#endif
+    free(stats);
+}
+
+void
+NCZ_stats_count(struct NCZStats* stats, NCZStatOp op, size64_t n, size64_t nbytes)
+{
+    NC_io_stats* c;
+    if(stats == NULL) return;
+    c = &stats->counts;
+    LOCK(stats);
+    switch (op) {
+    case NCZ_STAT_HIT: c->cache_hits += n; break;
+    case NCZ_STAT_MISS: c->cache_misses += n; break;
+    case NCZ_STAT_EVICT: c->cache_evictions += n; break;
+    case NCZ_STAT_READ: c->map_reads += n; c->bytes_read += nbytes; break;
+    case NCZ_STAT_WRITE: c->map_writes += n; c->bytes_written += nbytes; break;
+    case NCZ_STAT_EXISTS: c->map_exists += n; break;
+    case NCZ_STAT_LEN: c->map_lens += n; break;
+    case NCZ_STAT_SEARCH: c->map_searches += n; break;
+    case NCZ_STAT_REMOVE: c->map_removes += n; break;
+    default: break;
+    }
+    UNLOCK(stats);
+}
+
+void
+NCZ_stats_time(struct NCZStats* stats, NCZStatOp op, double seconds)
+{
+    NC_io_stats* c;
+    if(stats == NULL) return;
+    c = &stats->counts;
+    LOCK(stats);
+    switch (op) {
+    case NCZ_STAT_ENCODE: c->encodes++; c->encode_time += seconds; break;
+    case NCZ_STAT_DECODE: c->decodes++; c->decode_time += seconds; break;
+    case NCZ_STAT_TRANSFER: c->transfers++; c->transfer_time += seconds; break;
+    default: break;
+    }
+    UNLOCK(stats);
+}
+
+void
+NCZ_stats_get(struct NCZStats* stats, NC_io_stats* iostats)
+{
+    if(stats == NULL) {memset(iostats,0,sizeof(NC_io_stats)); return;}
+    LOCK(stats);
+    *iostats = stats->counts;
+    UNLOCK(stats);
+}
+
+double
+NCZ_stats_clock(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if(clock_gettime(CLOCK_MONOTONIC,&ts) == 0)
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+    return 0.0;
+#elif defined(_WIN32)
+    LARGE_INTEGER count, freq;
+    if(QueryPerformanceCounter(&count) && QueryPerformanceFrequency(&freq) && freq.QuadPart > 0)
+	return (double)count.QuadPart / (double)freq.QuadPart;
+    return 0.0;
+#elif defined(HAVE_GETTIMEOFDAY)
+    struct timeval tv;
+    if(gettimeofday(&tv,NULL) == 0)
+	return (double)tv.tv_sec + (double)tv.tv_usec * 1.0e-6;
+    return 0.0;
+#else
+    return 0.0;
+#endif
+}
+
+/* Add the counters of a variable's cache into a dataset total */
+static void
+addcache(NC_io_stats* total, const NC_io_stats* s)
+{
+    total->cache_hits += s->cache_hits;
+    total->cache_misses += s->cache_misses;
+    total->cache_evictions += s->cache_evictions;
+    total->encodes += s->encodes;
+    total->decodes += s->decodes;
+    total->transfers += s->transfers;
+    total->encode_time += s->encode_time;
+    total->decode_time += s->decode_time;
+    total->transfer_time += s->transfer_time;
+}
+
+static void
+sumgroup(NC_GRP_INFO_T* grp, NC_io_stats* total)
+{
+    size_t i;
+    for(i=0;i<ncindexsize(grp->vars);i++) {
+	NC_VAR_INFO_T* var = (NC_VAR_INFO_T*)ncindexith(grp->vars,i);
+	NCZ_VAR_INFO_T* zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+	NC_io_stats s;
+	if(zvar == NULL || zvar->cache == NULL) continue;
+	NCZ_stats_get(zvar->cache->stats,&s);
+	addcache(total,&s);
+    }
+    for(i=0;i<ncindexsize(grp->children);i++)
+	sumgroup((NC_GRP_INFO_T*)ncindexith(grp->children,i),total);
+}
+
+/**
+ * @internal Return the I/O statistics of a variable or, for
+ * NC_GLOBAL, of the whole dataset. The map counters of a variable
+ * only cover its chunks; those of the dataset cover all storage
+ * traffic, including metadata, while its cache, filter and transfer
+ * counters are the sums over all variables.
+ *
+ * @param ncid File or group ID.
+ * @param varid Variable ID or NC_GLOBAL.
+ * @param iostats return the counters
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NCZ_inq_var_stats(int ncid, int varid, NC_io_stats* iostats)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    int retval = NC_NOERR;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        goto done;
+    assert(grp && h5);
+    memset(iostats,0,sizeof(NC_io_stats));
+    if(varid == NC_GLOBAL) {
+	NCZ_FILE_INFO_T* zfile = (NCZ_FILE_INFO_T*)h5->format_file_info;
+	if(zfile != NULL && zfile->map != NULL)
+	    NCZ_stats_get(zfile->map->stats,iostats);
+	sumgroup(h5->root_grp,iostats);
+    } else {
+	if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+	    {retval = NC_ENOTVAR; goto done;}
+	zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+	if(zvar != NULL && zvar->cache != NULL)
+	    NCZ_stats_get(zvar->cache->stats,iostats);
+    }
+done:
+    return retval;
+}
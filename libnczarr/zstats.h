@@ -0,0 +1,46 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+#ifndef ZSTATS_H
+#define ZSTATS_H
+
+/*
+Runtime I/O counters, as returned by nc_inq_var_stats.
+Each map keeps the counters for all of its traffic and each
+variable's chunk cache keeps the counters for that variable.
+The counters may be updated concurrently by worker threads.
+A NULL counter set is ignored, so callers need not check.
+*/
+
+typedef enum NCZStatOp {
+    NCZ_STAT_HIT,       /* chunk found in the cache */
+    NCZ_STAT_MISS,      /* chunk read (or synthesized) for the cache */
+    NCZ_STAT_EVICT,     /* chunk removed from the cache */
+    NCZ_STAT_READ,      /* map read; counts bytes */
+    NCZ_STAT_WRITE,     /* map write; counts bytes */
+    NCZ_STAT_EXISTS,
+    NCZ_STAT_LEN,
+    NCZ_STAT_SEARCH,
+    NCZ_STAT_REMOVE,
+    NCZ_STAT_ENCODE,    /* filter chain applied for writing; timed */
+    NCZ_STAT_DECODE,    /* filter chain applied for reading; timed */
+    NCZ_STAT_TRANSFER   /* copy between chunks and user memory; timed */
+} NCZStatOp;
+
+struct NCZStats; /* Opaque */
+
+extern int NCZ_stats_new(struct NCZStats** statsp);
+extern void NCZ_stats_free(struct NCZStats* stats);
+/* Count n occurrences of op; nbytes only matters for reads and writes */
+extern void NCZ_stats_count(struct NCZStats* stats, NCZStatOp op, size64_t n, size64_t nbytes);
+/* Count one occurrence of a timed op */
+extern void NCZ_stats_time(struct NCZStats* stats, NCZStatOp op, double seconds);
+extern void NCZ_stats_get(struct NCZStats* stats, NC_io_stats* iostats);
+/* Monotonic wall clock in seconds */
+extern double NCZ_stats_clock(void);
+
+extern int NCZ_inq_var_stats(int ncid, int varid, NC_io_stats* iostats);
+
+#endif /*ZSTATS_H*/
@@ -13,7 +13,7 @@ static int ncz_collect_dims(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NCjson** j
 static int ncz_sync_var(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, int isclose);
 
 static int ncz_jsonize_atts(NCindex* attlist, NCjson** jattrsp);
-static int load_jatts(NCZMAP* map, NC_OBJ* container, int nczarrv1, NCjson** jattrsp, NClist** atypes);
+static int load_jatts(NCZ_FILE_INFO_T* zinfo, NC_OBJ* container, int nczarrv1, NCjson** jattrsp, NClist** atypes);
 static int zconvert(nc_type typeid, size_t typelen, void* dst, NCjson* src);
 static int computeattrinfo(const char* name, NClist* atypes, NCjson* values,
 		nc_type* typeidp, size_t* typelenp, size_t* lenp, void** datap);
@@ -25,14 +25,23 @@ static int define_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* varname
 static int define_subgrps(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* subgrpnames);
 static int searchvars(NCZ_FILE_INFO_T*, NC_GRP_INFO_T*, NClist*);
 static int searchsubgrps(NCZ_FILE_INFO_T*, NC_GRP_INFO_T*, NClist*);
+static int searchobjs(NCZ_FILE_INFO_T*, const char*, const char*, NClist*);
 static int locategroup(NC_FILE_INFO_T* file, size_t nsegs, NClist* segments, NC_GRP_INFO_T** grpp);
 static int createdim(NC_FILE_INFO_T* file, const char* name, size64_t dimlen, NC_DIM_INFO_T** dimp);
 static int parsedimrefs(NC_FILE_INFO_T*, NClist* dimnames,  size64_t* shape, NC_DIM_INFO_T** dims, int create);
 static int decodeints(NCjson* jshape, size64_t* shapes);
+static int jsonize_shardcodec(NC_VAR_INFO_T* var, NCjson** jcodecp);
+static int isshardcodec(const NCjson* jcodec);
 static int computeattrdata(nc_type* typeidp, NCjson* values, size_t* typelenp, size_t* lenp, void** datap);
 static int inferattrtype(NCjson* values, nc_type* typeidp);
 static int mininttype(unsigned long long u64, int negative);
 static int computedimrefs(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, int purezarr, int xarray, int ndims, NClist* dimnames, size64_t* shapes, NC_DIM_INFO_T** dims);
+static int download_meta(NCZ_FILE_INFO_T* zinfo, const char* key, NCjson** jsonp);
+static int download_metadict(NCZ_FILE_INFO_T* zinfo, const char* key, NCjson** jsonp);
+static int upload_meta(NCZ_FILE_INFO_T* zinfo, const char* key, NCjson* json);
+static int load_consolidated(NCZ_FILE_INFO_T* zinfo);
+static int write_consolidated(NCZ_FILE_INFO_T* zinfo);
+static int search_consolidated(NCZ_FILE_INFO_T* zinfo, const char* grpkey, const char* tag, NClist* names);
 
 /**************************************************/
 /**************************************************/
@@ -67,6 +76,10 @@ ncz_sync_file(NC_FILE_INFO_T* file, int isclose)
     if((stat = ncz_sync_grp(file, file->root_grp, isclose)))
         goto done;
 
+    /* Write out .zmetadata if requested */
+    if((stat = write_consolidated((NCZ_FILE_INFO_T*)file->format_file_info)))
+        goto done;
+
 done:
     NCJreclaim(json);
     return ZUNTRACE(stat);
@@ -118,7 +131,6 @@ ncz_sync_grp(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, int isclose)
     NCZ_FILE_INFO_T* zinfo = NULL;
     char version[1024];
     int purezarr = 0;
-    NCZMAP* map = NULL;
     char* fullpath = NULL;
     char* key = NULL;
     NCjson* json = NULL;
@@ -132,7 +144,6 @@ ncz_sync_grp(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, int isclose)
     LOG((3, "%s: dims: %s", __func__, key));
 
     zinfo = file->format_file_info;
-    map = zinfo->map;
 
     purezarr = (zinfo->controls.flags & FLAG_PUREZARR)?1:0;
 
@@ -200,7 +211,7 @@ ncz_sync_grp(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, int isclose)
     if((stat = nczm_concat(fullpath,ZGROUP,&key)))
 	goto done;
     /* Write to map */
-    if((stat=NCZ_uploadjson(map,key,jgroup)))
+    if((stat=upload_meta(zinfo,key,jgroup)))
 	goto done;
     nullfree(key); key = NULL;
 
@@ -250,7 +261,6 @@ ncz_sync_var_meta(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, int isclose)
     int i,stat = NC_NOERR;
     NCZ_FILE_INFO_T* zinfo = NULL;
     char number[1024];
-    NCZMAP* map = NULL;
     char* fullpath = NULL;
     char* key = NULL;
     char* dimpath = NULL;
@@ -268,7 +278,6 @@ ncz_sync_var_meta(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, int isclose)
 #endif
 	    
     zinfo = file->format_file_info;
-    map = zinfo->map;
 
     /* Construct var path */
     if((stat = NCZ_varkey(var,&fullpath)))
@@ -386,20 +395,28 @@ ncz_sync_var_meta(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, int isclose)
     /* A list of JSON objects providing codec configurations, or ``null``
        if no filters are to be applied. */
     if((stat = NCJaddstring(jvar,NCJ_STRING,"filters"))) goto done;
+    /* A sharded variable lists the shard codec first, so that readers
+       which do not know about sharding refuse the variable */
+    if(zvar->shards != NULL) {
+	NCjson* jshard = NULL;
+	if((stat = NCJnew(NCJ_ARRAY,&jtmp))) goto done;
+	if((stat = jsonize_shardcodec(var,&jshard))) goto done;
+	if((stat = NCJappend(jtmp,jshard))) goto done;
+    }
 #ifdef ENABLE_NCZARR_FILTERS
     if(nclistlength(filterchain) > 1) {
 	int k;
 	/* jtmp holds the array of filters */
-	if((stat = NCJnew(NCJ_ARRAY,&jtmp))) goto done;
+	if(jtmp == NULL && (stat = NCJnew(NCJ_ARRAY,&jtmp))) goto done;
 	for(k=0;k<nclistlength(filterchain)-1;k++) {
  	    struct NCZ_Filter* filter = (struct NCZ_Filter*)nclistget(filterchain,k);
 	    /* encode up the filter as a string */
 	    if((stat = NCZ_filter_jsonize(file,var,filter,&jfilter))) goto done;
 	    if((stat = NCJappend(jtmp,jfilter))) goto done;
 	}
-    } else
+    }
 #endif
-    { /* no filters at all */
+    if(jtmp == NULL) { /* no filters at all */
         if((stat = NCJnew(NCJ_NULL,&jtmp))) goto done;
     }
     if((stat = NCJappend(jvar,jtmp))) goto done;
@@ -458,6 +475,25 @@ ncz_sync_var_meta(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, int isclose)
 	if((stat = NCJinsert(jncvar,"storage",jtmp))) goto done;
 	jtmp = NULL;
 
+	/* Record that the chunks hold the byte order of the dtype;
+	   without it they are taken to be in native byte order */
+	if(!zvar->nativeorder) {
+	    if((stat = NCJnewstring(NCJ_STRING,"dtype",&jtmp)))goto done;
+	    if((stat = NCJinsert(jncvar,"byteorder",jtmp))) goto done;
+	    jtmp = NULL;
+	}
+
+	/* Insert the shard shape, if sharded */
+	if(zvar->shards != NULL) {
+	    if((stat = NCJnew(NCJ_ARRAY,&jtmp))) goto done;
+	    for(i=0;i<var->ndims;i++) {
+		snprintf(number,sizeof(number),"%llu",zvar->shards[i]);
+		NCJaddstring(jtmp,NCJ_INT,number);
+	    }
+	    if((stat = NCJinsert(jncvar,"shards",jtmp))) goto done;
+	    jtmp = NULL;
+	}
+
 	if(!(zinfo->controls.flags & FLAG_PUREZARR)) {
 	    if((stat = NCJinsert(jvar,NCZ_V2_ARRAY,jncvar))) goto done;
 	    jncvar = NULL;
@@ -469,7 +505,7 @@ ncz_sync_var_meta(NC_FILE_INFO_T* file, NC_VAR_INFO_T* var, int isclose)
 	goto done;
 
     /* Write to map */
-    if((stat=NCZ_uploadjson(map,key,jvar)))
+    if((stat=upload_meta(zinfo,key,jvar)))
 	goto done;
     nullfree(key); key = NULL;
 
@@ -537,8 +573,9 @@ ncz_write_var(NC_VAR_INFO_T* var)
     }
     
 #ifdef FILLONCLOSE
-    /* If fill is enabled, then create missing chunks */
-    if(!var->no_fill) {
+    /* If fill is enabled, then create missing chunks, unless
+       fill-only chunks are not to be stored */
+    if(!var->no_fill && zvar->cache->writeempty) {
         int i;
     NCZOdometer* chunkodom =  NULL;
     NC_FILE_INFO_T* file = var->container->nc4_info;
@@ -609,7 +646,6 @@ ncz_sync_atts(NC_FILE_INFO_T* file, NC_OBJ* container, NCindex* attlist, int isc
     NCjson* jtype = NULL;
     NCjson* jdimrefs = NULL;
     NCjson* jdict = NULL;
-    NCZMAP* map = NULL;
     char* fullpath = NULL;
     char* key = NULL;
     char* content = NULL;
@@ -620,7 +656,6 @@ ncz_sync_atts(NC_FILE_INFO_T* file, NC_OBJ* container, NCindex* attlist, int isc
     LOG((3, "%s", __func__));
 
     zinfo = file->format_file_info;
-    map = zinfo->map;
 
     if(zinfo->controls.flags & FLAG_XARRAYDIMS) isxarray = 1;
 
@@ -700,7 +735,7 @@ ncz_sync_atts(NC_FILE_INFO_T* file, NC_OBJ* container, NCindex* attlist, int isc
     if((stat = nczm_concat(fullpath,ZATTRS,&key)))
 	goto done;
     /* Write to map */
-    if((stat=NCZ_uploadjson(map,key,jatts)))
+    if((stat=upload_meta(zinfo,key,jatts)))
 	goto done;
     nullfree(key); key = NULL;
 
@@ -764,7 +799,7 @@ done:
 /**
 @internal Extract attributes from a group or var and return
 the corresponding NCjson dict.
-@param map - [in] the map object for storage
+@param zinfo - [in] the file annotation
 @param container - [in] the containing object
 @param jattrsp - [out] the json for .zattrs
 @param jtypesp - [out] the json for .ztypes
@@ -772,7 +807,7 @@ the corresponding NCjson dict.
 @author Dennis Heimbigner
 */
 static int
-load_jatts(NCZMAP* map, NC_OBJ* container, int nczarrv1, NCjson** jattrsp, NClist** atypesp)
+load_jatts(NCZ_FILE_INFO_T* zinfo, NC_OBJ* container, int nczarrv1, NCjson** jattrsp, NClist** atypesp)
 {
     int i,stat = NC_NOERR;
     char* fullpath = NULL;
@@ -802,7 +837,7 @@ load_jatts(NCZMAP* map, NC_OBJ* container, int nczarrv1, NCjson** jattrsp, NClis
 	goto done;
 
     /* Download the .zattrs object: may not exist */
-    switch ((stat=NCZ_downloadjson(map,key,&jattrs))) {
+    switch ((stat=download_meta(zinfo,key,&jattrs))) {
     case NC_NOERR: break;
     case NC_EEMPTY: stat = NC_NOERR; break; /* did not exist */
     default: goto done; /* failure */
@@ -814,12 +849,12 @@ load_jatts(NCZMAP* map, NC_OBJ* container, int nczarrv1, NCjson** jattrsp, NClis
 	    /* Construct the path to the NCZATTRS object */
 	    if((stat = nczm_concat(fullpath,NCZATTRS,&key))) goto done;
 	    /* Download the NCZATTRS object: may not exist if pure zarr or using deprecated name */
-	    stat=NCZ_downloadjson(map,key,&jncattr);
+	    stat=NCZ_downloadjson(zinfo->map,key,&jncattr);
 	    if(stat == NC_EEMPTY) {
 	        /* try deprecated name */
 	        nullfree(key); key = NULL;
 	        if((stat = nczm_concat(fullpath,NCZATTRDEP,&key))) goto done;
-	        stat=NCZ_downloadjson(map,key,&jncattr);
+	        stat=NCZ_downloadjson(zinfo->map,key,&jncattr);
 	    }
 	} else {/* Get _NCZARR_ATTRS from .zattrs */
 	    stat = NCJdictget(jattrs,NCZ_V2_ATTR,&jncattr);
@@ -1163,7 +1198,7 @@ define_grp(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp)
 	    if((stat = nczm_concat(fullpath,ZGROUP,&key)))
 	        goto done;
 	    /* Read */
-	    switch (stat=NCZ_downloadjson(map,key,&jgroup)) {
+	    switch (stat=download_meta(zinfo,key,&jgroup)) {
 	    case NC_NOERR: /* we read it */
 	        /* Extract the NCZ_V2_GROUP dict */
 	        if((stat = NCJdictget(jgroup,NCZ_V2_GROUP,&jdict))) goto done;
@@ -1225,7 +1260,6 @@ ncz_read_atts(NC_FILE_INFO_T* file, NC_OBJ* container)
     char* fullpath = NULL;
     char* key = NULL;
     NCZ_FILE_INFO_T* zinfo = NULL;
-    NCZMAP* map = NULL;
     NC_ATT_INFO_T* att = NULL;
     NCindex* attlist = NULL;
     NCjson* jattrs = NULL;
@@ -1236,14 +1270,13 @@ ncz_read_atts(NC_FILE_INFO_T* file, NC_OBJ* container)
     NC_ATT_INFO_T* fillvalueatt = NULL;
 
     zinfo = file->format_file_info;
-    map = zinfo->map;
 
     if(container->sort == NCGRP)
 	attlist = ((NC_GRP_INFO_T*)container)->att;
     else
 	attlist = ((NC_VAR_INFO_T*)container)->att;
 
-    switch ((stat = load_jatts(map, container, (zinfo->controls.flags & FLAG_NCZARR_V1), &jattrs, &atypes))) {
+    switch ((stat = load_jatts(zinfo, container, (zinfo->controls.flags & FLAG_NCZARR_V1), &jattrs, &atypes))) {
     case NC_NOERR: break;
     case NC_EEMPTY:  /* container has no attributes */
         stat = NC_NOERR;
@@ -1389,6 +1422,7 @@ define_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* varnames)
     int purezarr = 0;
     int xarray = 0;
     int formatv1 = 0;
+    int shardcodec = 0;
     nc_type typeid;
     size64_t* shapes = NULL;
     int rank = 0;
@@ -1431,7 +1465,7 @@ define_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* varnames)
 	if((stat = nczm_concat(varpath,ZARRAY,&key)))
 	    goto done;
 	/* Download the zarray object */
-	if((stat=NCZ_readdict(map,key,&jvar)))
+	if((stat=download_metadict(zinfo,key,&jvar)))
 	    goto done;
 	nullfree(key); key = NULL;
 	assert(NCJsort(jvar) == NCJ_DICT);
@@ -1556,6 +1590,13 @@ define_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* varnames)
            object MUST contain a "id" key identifying the codec to be used. */
 	/* Do filters key before compressor key so final filter chain is in correct order */
 	{
+	    /* Look for the shard codec, which is not a real filter */
+	    shardcodec = 0;
+	    if((stat = NCJdictget(jvar,"filters",&jvalue))) goto done;
+	    if(jvalue != NULL && NCJsort(jvalue) == NCJ_ARRAY) {
+		for(j=0;j<NCJlength(jvalue);j++)
+		    if(isshardcodec(NCJith(jvalue,j))) shardcodec = 1;
+	    }
 	    if(var->filters == NULL) var->filters = (void*)nclistnew();
 #ifdef ENABLE_NCZARR_FILTERS
 	    { int k;
@@ -1568,6 +1609,7 @@ define_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* varnames)
 		    jfilter = NCJith(jvalue,k);
 		    if(jfilter == NULL) break; /* done */
 		    if(NCJsort(jfilter) != NCJ_DICT) {stat = NC_EFILTER; goto done;} 
+		    if(isshardcodec(jfilter)) continue;
 		    if((stat = NCZ_filter_build(file,var,jfilter))) goto done;
 		}
 	    }
@@ -1620,6 +1662,26 @@ define_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* varnames)
 		    var->storage = NC_CONTIGUOUS;
 		}
 	    }
+	    /* Older versions stored the chunks in native byte order
+	       whatever the dtype said, and did not record "byteorder" */
+	    if((stat = NCJdictget(jncvar,"byteorder",&jvalue))) goto done;
+	    if(jvalue == NULL) {
+		zvar->nativeorder = 1;
+		/* Rebuild the fill chunk in that byte order */
+		if(zvar->cache != NULL && (stat = NCZ_adjust_var_cache(var))) goto done;
+	    } else if(strcmp(NCJstring(jvalue),"dtype") != 0)
+		{stat = NC_ENCZARR; goto done;}
+	    /* Extract the shard shape, if any */
+	    if((stat = NCJdictget(jncvar,"shards",&jvalue))) goto done;
+	    if(jvalue != NULL && rank > 0) {
+		if(NCJsort(jvalue) != NCJ_ARRAY || NCJlength(jvalue) != rank)
+		    {stat = NC_ENCZARR; goto done;}
+		if((zvar->shards = calloc((size_t)rank,sizeof(size64_t))) == NULL)
+		    {stat = NC_ENOMEM; goto done;}
+		if((stat = decodeints(jvalue,zvar->shards))) goto done;
+		for(j=0;j<rank;j++)
+		    if(zvar->shards[j] == 0) {stat = NC_ENCZARR; goto done;}
+	    }
 	    /* Extract dimnames list  */
 	    switch ((stat = NCJdictget(jncvar,"dimrefs",&jdimrefs))) {
 	    case NC_NOERR: /* Extract the dimref names */
@@ -1639,6 +1701,9 @@ define_vars(NC_FILE_INFO_T* file, NC_GRP_INFO_T* grp, NClist* varnames)
 	    }
 	    jdimrefs = NULL;
 	}
+	/* The shards are only readable given the shard shape, which pure
+	   Zarr does not see; never read them as chunks */
+	if(shardcodec != (zvar->shards != NULL)) {stat = NC_ENCZARR; goto done;}
 
 	if((stat = computedimrefs(file, var, purezarr, xarray, rank, dimnames, shapes, var->dim)))
 	    goto done;
@@ -1721,9 +1786,16 @@ ncz_read_superblock(NC_FILE_INFO_T* file, char** nczarrvp, char** zarrfp)
     char* nczarr_version = NULL;
     char* zarr_format = NULL;
     NCZ_FILE_INFO_T* zinfo = (NCZ_FILE_INFO_T*)file->format_file_info;
-    
-    /* See if the V1 META-Root is being used */
-    switch(stat = NCZ_downloadjson(zinfo->map, NCZMETAROOT, &jnczgroup)) {
+
+    /* Try for consolidated metadata first */
+    if((stat = load_consolidated(zinfo))) goto done;
+
+    /* See if the V1 META-Root is being used; V1 predates .zmetadata */
+    if(zinfo->consolidated.json != NULL)
+	stat = NC_EEMPTY;
+    else
+        stat = NCZ_downloadjson(zinfo->map, NCZMETAROOT, &jnczgroup);
+    switch(stat) {
     case NC_EEMPTY: /* not there */
 	stat = NC_NOERR;
 	break;
@@ -1734,7 +1806,7 @@ ncz_read_superblock(NC_FILE_INFO_T* file, char** nczarrvp, char** zarrfp)
     default: goto done;
     }
     /* Also gett Zarr Root Group */
-    switch(stat = NCZ_downloadjson(zinfo->map, ZMETAROOT, &jzgroup)) {
+    switch(stat = download_meta(zinfo, ZMETAROOT, &jzgroup)) {
     case NC_NOERR:
 	break;
     case NC_EEMPTY: /* not there */
@@ -1777,6 +1849,259 @@ done:
     return THROW(stat);
 }
 
+/**************************************************/
+/* Consolidated metadata */
+
+/*
+A .zmetadata object (as written by zarr.consolidate_metadata)
+holds the content of every .zgroup, .zarray, and .zattrs object
+in the dataset, keyed by path relative to the root. If one is
+present at open, then all metadata reads are served from it,
+including the pure zarr searches for variables and subgroups, so
+opening costs a single map read. It is rewritten at sync/close
+whenever FLAG_CONSOLIDATED is set: either because the "consolidated"
+mode was specified or because the dataset already had one.
+*/
+
+/* Return the consolidated name for a key or NULL if the key
+   does not refer to a .zgroup, .zarray, or .zattrs object */
+static const char*
+consolidatedname(const char* key)
+{
+    const char* base = strrchr(key,NCZM_SEP[0]);
+    base = (base == NULL ? key : base+1);
+    if(strcmp(base,ZGROUP) != 0 && strcmp(base,ZARRAY) != 0 && strcmp(base,ZATTRS) != 0)
+        return NULL;
+    while(*key == NCZM_SEP[0]) key++; /* relative to root */
+    return key;
+}
+
+/* Index the "metadata" dict by key */
+static int
+index_consolidated(NCZ_FILE_INFO_T* zinfo)
+{
+    int i,stat = NC_NOERR;
+    NCjson* jmeta = zinfo->consolidated.metadata;
+
+    if((zinfo->consolidated.index = NC_hashmapnew((size_t)NCJlength(jmeta))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<NCJlength(jmeta);i+=2) {
+	const NCjson* jkey = NCJith(jmeta,i);
+	if(NCJsort(jkey) != NCJ_STRING) {stat = THROW(NC_ENCZARR); goto done;}
+	NC_hashmapadd(zinfo->consolidated.index,(uintptr_t)(i+1),NCJstring(jkey),strlen(NCJstring(jkey)));
+    }
+done:
+    return THROW(stat);
+}
+
+/* Read and index .zmetadata if it exists */
+static int
+load_consolidated(NCZ_FILE_INFO_T* zinfo)
+{
+    int stat = NC_NOERR;
+    NCjson* json = NULL;
+    NCjson* jformat = NULL;
+    NCjson* jmeta = NULL;
+
+    switch (stat = NCZ_downloadjson(zinfo->map,ZMETADATA,&json)) {
+    case NC_NOERR: break;
+    case NC_EEMPTY: stat = NC_NOERR; goto done; /* not consolidated */
+    default: goto done;
+    }
+    /* Ignore anything unrecognized; the individual objects are still available */
+    if(NCJsort(json) != NCJ_DICT) goto done;
+    if((stat = NCJdictget(json,"zarr_consolidated_format",&jformat))) goto done;
+    if(jformat == NULL || strcmp(NCJstring(jformat),ZCONSOLIDATED_FORMAT) != 0) goto done;
+    if((stat = NCJdictget(json,"metadata",&jmeta))) goto done;
+    if(jmeta == NULL || NCJsort(jmeta) != NCJ_DICT) goto done;
+
+    zinfo->consolidated.json = json; json = NULL;
+    zinfo->consolidated.metadata = jmeta;
+    zinfo->consolidated.loaded = 1;
+    if((stat = index_consolidated(zinfo))) goto done;
+    /* Keep it current if the dataset is modified */
+    zinfo->controls.flags |= FLAG_CONSOLIDATED;
+
+done:
+    if(stat) ncz_free_consolidated(zinfo);
+    NCJreclaim(json);
+    return THROW(stat);
+}
+
+/* Create an empty .zmetadata tree to be filled in by upload_meta */
+static int
+new_consolidated(NCZ_FILE_INFO_T* zinfo)
+{
+    int stat = NC_NOERR;
+    NCjson* json = NULL;
+    NCjson* jmeta = NULL;
+
+    if((stat = NCJnew(NCJ_DICT,&json))) goto done;
+    if((stat = NCJaddstring(json,NCJ_STRING,"zarr_consolidated_format"))) goto done;
+    if((stat = NCJaddstring(json,NCJ_INT,ZCONSOLIDATED_FORMAT))) goto done;
+    if((stat = NCJnew(NCJ_DICT,&jmeta))) goto done;
+    if((stat = NCJinsert(json,"metadata",jmeta))) goto done;
+    zinfo->consolidated.metadata = jmeta; jmeta = NULL;
+    zinfo->consolidated.json = json; json = NULL;
+    if((stat = index_consolidated(zinfo))) goto done;
+
+done:
+    if(stat) ncz_free_consolidated(zinfo);
+    NCJreclaim(jmeta);
+    NCJreclaim(json);
+    return THROW(stat);
+}
+
+/* Insert or replace an entry; takes ownership of value */
+static int
+put_consolidated(NCZ_FILE_INFO_T* zinfo, const char* name, NCjson* value)
+{
+    int stat = NC_NOERR;
+    uintptr_t pos;
+    NCjson* jmeta = zinfo->consolidated.metadata;
+
+    if(NC_hashmapget(zinfo->consolidated.index,name,strlen(name),&pos)) {
+	NCJreclaim(NCJith(jmeta,pos));
+	NCJith(jmeta,pos) = value;
+    } else {
+	if((stat = NCJinsert(jmeta,(char*)name,value)))
+	    {NCJreclaim(value); stat = NC_ENOMEM; goto done;}
+	pos = (uintptr_t)(NCJlength(jmeta)-1);
+	NC_hashmapadd(zinfo->consolidated.index,pos,name,strlen(name));
+    }
+done:
+    return THROW(stat);
+}
+
+/* Write out .zmetadata */
+static int
+write_consolidated(NCZ_FILE_INFO_T* zinfo)
+{
+    int stat = NC_NOERR;
+    if(!(zinfo->controls.flags & FLAG_CONSOLIDATED) || zinfo->consolidated.json == NULL)
+	goto done;
+    if((stat = NCZ_uploadjson(zinfo->map,ZMETADATA,zinfo->consolidated.json)))
+	goto done;
+done:
+    return THROW(stat);
+}
+
+/**
+@internal Read a metadata object, serving it from
+the consolidated metadata when possible.
+@param zinfo - [in] the file annotation
+@param key - [in] key of the object
+@param jsonp - [out] return parsed json
+@return NC_NOERR
+@return NC_EEMPTY [object did not exist]
+*/
+static int
+download_meta(NCZ_FILE_INFO_T* zinfo, const char* key, NCjson** jsonp)
+{
+    int stat = NC_NOERR;
+    const char* name = NULL;
+    uintptr_t pos;
+
+    if(!zinfo->consolidated.loaded || (name = consolidatedname(key)) == NULL)
+	return NCZ_downloadjson(zinfo->map,key,jsonp);
+    /* Not in .zmetadata => does not exist */
+    if(!NC_hashmapget(zinfo->consolidated.index,name,strlen(name),&pos))
+	{stat = NC_EEMPTY; goto done;}
+    if(jsonp && NCJclone(NCJith(zinfo->consolidated.metadata,pos),jsonp))
+	{stat = NC_ENOMEM; goto done;}
+done:
+    return stat;
+}
+
+/* As download_meta, but fail if the object is not a dict */
+static int
+download_metadict(NCZ_FILE_INFO_T* zinfo, const char* key, NCjson** jsonp)
+{
+    int stat = NC_NOERR;
+    NCjson* json = NULL;
+
+    if((stat = download_meta(zinfo,key,&json)))
+	goto done;
+    if(NCJsort(json) != NCJ_DICT) {stat = NC_ENCZARR; goto done;}
+    if(jsonp) {*jsonp = json; json = NULL;}
+done:
+    NCJreclaim(json);
+    return stat;
+}
+
+/**
+@internal Write a metadata object and, if consolidating,
+record it for the .zmetadata object.
+@param zinfo - [in] the file annotation
+@param key - [in] key of the object
+@param json - [in] the content; not reclaimed
+@return NC_NOERR
+*/
+static int
+upload_meta(NCZ_FILE_INFO_T* zinfo, const char* key, NCjson* json)
+{
+    int stat = NC_NOERR;
+    const char* name = NULL;
+    NCjson* clone = NULL;
+
+    if((stat = NCZ_uploadjson(zinfo->map,key,json)))
+	goto done;
+    if(!(zinfo->controls.flags & FLAG_CONSOLIDATED) || (name = consolidatedname(key)) == NULL)
+	goto done;
+    if(zinfo->consolidated.json == NULL && (stat = new_consolidated(zinfo)))
+	goto done;
+    if(NCJclone(json,&clone))
+	{stat = NC_ENOMEM; goto done;}
+    stat = put_consolidated(zinfo,name,clone);
+done:
+    return THROW(stat);
+}
+
+/* Collect the names of the children of grpkey that have a tag object */
+static int
+search_consolidated(NCZ_FILE_INFO_T* zinfo, const char* grpkey, const char* tag, NClist* names)
+{
+    int i,stat = NC_NOERR;
+    size_t plen;
+    NCjson* jmeta = zinfo->consolidated.metadata;
+
+    while(*grpkey == NCZM_SEP[0]) grpkey++;
+    plen = strlen(grpkey);
+    while(plen > 0 && grpkey[plen-1] == NCZM_SEP[0]) plen--;
+    for(i=0;i<NCJlength(jmeta);i+=2) {
+	const char* name = NCJstring(NCJith(jmeta,i));
+	const char* sep = NULL;
+	char* child = NULL;
+	if(plen > 0) {
+	    if(strncmp(name,grpkey,plen) != 0 || name[plen] != NCZM_SEP[0]) continue;
+	    name += (plen+1);
+	}
+	/* Look for <child>/<tag> */
+	if((sep = strchr(name,NCZM_SEP[0])) == NULL || sep == name) continue;
+	if(strcmp(sep+1,tag) != 0) continue;
+	if((child = malloc((size_t)(sep-name)+1)) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	memcpy(child,name,(size_t)(sep-name));
+	child[sep-name] = '\0';
+	nclistpush(names,child);
+    }
+done:
+    return THROW(stat);
+}
+
+/**
+@internal Reclaim the consolidated metadata.
+@param zinfo - [in] the file annotation
+*/
+void
+ncz_free_consolidated(NCZ_FILE_INFO_T* zinfo)
+{
+    NCJreclaim(zinfo->consolidated.json);
+    if(zinfo->consolidated.index != NULL)
+        NC_hashmapfree(zinfo->consolidated.index);
+    memset(&zinfo->consolidated,0,sizeof(zinfo->consolidated));
+}
+
 /**************************************************/
 /* Utilities */
 
@@ -1885,71 +2210,84 @@ done:
 }
 #endif
 
+/* Return the names below grpkey for which name/objname exists,
+   checking all the candidates with one batch exists */
 static int
-searchvars(NCZ_FILE_INFO_T* zfile, NC_GRP_INFO_T* grp, NClist* varnames)
+searchobjs(NCZ_FILE_INFO_T* zfile, const char* grpkey, const char* objname, NClist* names)
 {
     int i,stat = NC_NOERR;
-    char* grpkey = NULL;
-    char* varkey = NULL;
-    char* zarray = NULL;
+    char* subkey = NULL;
     NClist* matches = nclistnew();
-    
-    /* Compute the key for the grp */
-    if((stat = NCZ_grpkey(grp,&grpkey))) goto done;
+    NClist* candidates = nclistnew();
+    NCZM_REQUEST* requests = NULL;
+    size_t n = 0;
+
     /* Get the map and search group */
     if((stat = nczmap_search(zfile->map,grpkey,matches))) goto done;
     for(i=0;i<nclistlength(matches);i++) {
 	const char* name = nclistget(matches,i);
 	if(name[0] == NCZM_DOT) continue; /* zarr/nczarr specific */
-	/* See if name/.zarray exists */
-	if((stat = nczm_concat(grpkey,name,&varkey))) goto done;
-	if((stat = nczm_concat(varkey,ZARRAY,&zarray))) goto done;
-	if((stat = nczmap_exists(zfile->map,zarray)) == NC_NOERR)
-	    nclistpush(varnames,strdup(name));
-	stat = NC_NOERR;
-	nullfree(varkey); varkey = NULL;
-	nullfree(zarray); zarray = NULL;
+	nclistpush(candidates,(void*)name);
+    }
+    if((n = nclistlength(candidates)) == 0) goto done;
+    if((requests = (NCZM_REQUEST*)calloc(n,sizeof(NCZM_REQUEST))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<n;i++) {
+	char* key = NULL;
+	/* See if name/objname exists */
+	if((stat = nczm_concat(grpkey,nclistget(candidates,i),&subkey))) goto done;
+	if((stat = nczm_concat(subkey,objname,&key))) goto done;
+	requests[i].key = key;
+	nullfree(subkey); subkey = NULL;
+    }
+    (void)nczmap_existsn(zfile->map,n,requests);
+    for(i=0;i<n;i++) {
+	if(requests[i].stat == NC_NOERR)
+	    nclistpush(names,strdup(nclistget(candidates,i)));
     }
 
 done:
-    nullfree(grpkey);
-    nullfree(varkey);
-    nullfree(zarray);
+    if(requests != NULL) {
+	for(i=0;i<n;i++) nullfree((char*)requests[i].key);
+	free(requests);
+    }
+    nullfree(subkey);
+    nclistfree(candidates);
     nclistfreeall(matches);
     return stat;
 }
 
 static int
-searchsubgrps(NCZ_FILE_INFO_T* zfile, NC_GRP_INFO_T* grp, NClist* subgrpnames)
+searchvars(NCZ_FILE_INFO_T* zfile, NC_GRP_INFO_T* grp, NClist* varnames)
 {
-    int i,stat = NC_NOERR;
+    int stat = NC_NOERR;
     char* grpkey = NULL;
-    char* subkey = NULL;
-    char* zgroup = NULL;
-    NClist* matches = nclistnew();
     
     /* Compute the key for the grp */
     if((stat = NCZ_grpkey(grp,&grpkey))) goto done;
-    /* Get the map and search group */
-    if((stat = nczmap_search(zfile->map,grpkey,matches))) goto done;
-    for(i=0;i<nclistlength(matches);i++) {
-	const char* name = nclistget(matches,i);
-	if(name[0] == NCZM_DOT) continue; /* zarr/nczarr specific */
-	/* See if name/.zgroup exists */
-	if((stat = nczm_concat(grpkey,name,&subkey))) goto done;
-	if((stat = nczm_concat(subkey,ZGROUP,&zgroup))) goto done;
-	if((stat = nczmap_exists(zfile->map,zgroup)) == NC_NOERR)
-	    nclistpush(subgrpnames,strdup(name));
-	stat = NC_NOERR;
-	nullfree(subkey); subkey = NULL;
-	nullfree(zgroup); zgroup = NULL;
-    }
+    if(zfile->consolidated.json != NULL)
+	stat = search_consolidated(zfile,grpkey,ZARRAY,varnames);
+    else
+	stat = searchobjs(zfile,grpkey,ZARRAY,varnames);
+done:
+    nullfree(grpkey);
+    return stat;
+}
 
+static int
+searchsubgrps(NCZ_FILE_INFO_T* zfile, NC_GRP_INFO_T* grp, NClist* subgrpnames)
+{
+    int stat = NC_NOERR;
+    char* grpkey = NULL;
+    
+    /* Compute the key for the grp */
+    if((stat = NCZ_grpkey(grp,&grpkey))) goto done;
+    if(zfile->consolidated.json != NULL)
+	stat = search_consolidated(zfile,grpkey,ZGROUP,subgrpnames);
+    else
+	stat = searchobjs(zfile,grpkey,ZGROUP,subgrpnames);
 done:
     nullfree(grpkey);
-    nullfree(subkey);
-    nullfree(zgroup);
-    nclistfreeall(matches);
     return stat;
 }
 
@@ -1971,6 +2309,45 @@ done:
     return THROW(stat);
 }
 
+/* Build the codec entry that marks a sharded variable in its .zarray:
+   {"id": "nczarr_shard", "shards": [2, 2, ...]} */
+static int
+jsonize_shardcodec(NC_VAR_INFO_T* var, NCjson** jcodecp)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    char number[64];
+    NCjson* jcodec = NULL;
+    NCjson* jshards = NULL;
+    NCZ_VAR_INFO_T* zvar = var->format_var_info;
+
+    if((stat = NCJnew(NCJ_DICT,&jcodec))) goto done;
+    if((stat = NCJaddstring(jcodec,NCJ_STRING,"id"))) goto done;
+    if((stat = NCJaddstring(jcodec,NCJ_STRING,NCZ_SHARD_CODEC))) goto done;
+    if((stat = NCJnew(NCJ_ARRAY,&jshards))) goto done;
+    for(i=0;i<var->ndims;i++) {
+	snprintf(number,sizeof(number),"%llu",zvar->shards[i]);
+	if((stat = NCJaddstring(jshards,NCJ_INT,number))) goto done;
+    }
+    if((stat = NCJinsert(jcodec,"shards",jshards))) goto done;
+    jshards = NULL;
+    *jcodecp = jcodec; jcodec = NULL;
+done:
+    NCJreclaim(jshards);
+    NCJreclaim(jcodec);
+    return THROW(stat);
+}
+
+/* Is this filter entry the one written by jsonize_shardcodec? */
+static int
+isshardcodec(const NCjson* jcodec)
+{
+    NCjson* jid = NULL;
+    if(jcodec == NULL || NCJsort(jcodec) != NCJ_DICT) return 0;
+    if(NCJdictget(jcodec,"id",&jid) || jid == NULL) return 0;
+    return (NCJsort(jid) == NCJ_STRING && strcmp(NCJstring(jid),NCZ_SHARD_CODEC) == 0);
+}
+
 /* This code is a subset of NCZ_def_dim */
 static int
 createdim(NC_FILE_INFO_T* file, const char* name, size64_t dimlen, NC_DIM_INFO_T** dimp)
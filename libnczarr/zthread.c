@@ -0,0 +1,239 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+/**
+ * @file
+ * @internal Worker thread pool for overlapping chunk I/O.
+ *
+ * @author Dennis Heimbigner
+ */
+
+#include "zincludes.h"
+#include "zthread.h"
+
+#ifdef ENABLE_NCZARR_THREADS
+#include <pthread.h>
+#endif
+
+/* The tracing code is not thread safe */
+#ifdef ZTRACING
+#undef ENABLE_NCZARR_THREADS
+#endif
+
+struct NCZWorkers {
+    size_t nthreads;
+#ifdef ENABLE_NCZARR_THREADS
+    pthread_t* threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t ready; /* signalled when work is queued or on shutdown */
+    pthread_cond_t done;  /* signalled when any work completes */
+    NCZWork* head; /* FIFO of queued work */
+    NCZWork* tail;
+    int shutdown;
+#endif
+};
+
+/* Forward */
+static void runwork(NCZWork* work);
+
+/**************************************************/
+
+#ifdef ENABLE_NCZARR_THREADS
+
+/* Remove work from the queue; caller holds the mutex */
+static int
+dequeue(struct NCZWorkers* workers, NCZWork* work)
+{
+    NCZWork* prev = NULL;
+    NCZWork* p;
+    for(p=workers->head;p != NULL;prev=p,p=p->next) {
+	if(p != work) continue;
+	if(prev == NULL) workers->head = p->next; else prev->next = p->next;
+	if(workers->tail == p) workers->tail = prev;
+	p->next = NULL;
+	return 1;
+    }
+    return 0;
+}
+
+static void*
+worker(void* arg)
+{
+    struct NCZWorkers* workers = (struct NCZWorkers*)arg;
+
+    pthread_mutex_lock(&workers->mutex);
+    for(;;) {
+	NCZWork* work;
+	while(workers->head == NULL && !workers->shutdown)
+	    pthread_cond_wait(&workers->ready,&workers->mutex);
+	if(workers->head == NULL) break; /* shutdown and queue drained */
+	work = workers->head;
+	(void)dequeue(workers,work);
+	work->state = WORK_RUNNING;
+	pthread_mutex_unlock(&workers->mutex);
+	runwork(work);
+	pthread_mutex_lock(&workers->mutex);
+	work->state = WORK_DONE;
+	pthread_cond_broadcast(&workers->done);
+    }
+    pthread_mutex_unlock(&workers->mutex);
+    return NULL;
+}
+#endif /*ENABLE_NCZARR_THREADS*/
+
+static void
+runwork(NCZWork* work)
+{
+    work->stat = work->fcn(work->arg);
+}
+
+/**************************************************/
+
+/**
+ * Create a pool of worker threads.
+ *
+ * @param nthreads number of threads; 0 or 1 => execute synchronously
+ * @param workersp return the pool
+ * @return ::NC_NOERR | ::NC_ENOMEM
+ */
+int
+NCZ_workers_new(size_t nthreads, struct NCZWorkers** workersp)
+{
+    int stat = NC_NOERR;
+    struct NCZWorkers* workers = NULL;
+
+    if((workers = calloc(1,sizeof(struct NCZWorkers))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if(nthreads > MAX_NCZ_THREADS) nthreads = MAX_NCZ_THREADS;
+#ifdef ENABLE_NCZARR_THREADS
+    /* A single thread buys no overlap since the caller always waits */
+    if(nthreads > 1) {
+	size_t i;
+	pthread_mutex_init(&workers->mutex,NULL);
+	pthread_cond_init(&workers->ready,NULL);
+	pthread_cond_init(&workers->done,NULL);
+	if((workers->threads = calloc(nthreads,sizeof(pthread_t))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	for(i=0;i<nthreads;i++) {
+	    if(pthread_create(&workers->threads[i],NULL,worker,workers) != 0)
+		break;
+	    workers->nthreads++;
+	}
+    }
+#endif
+    if(workersp) {*workersp = workers; workers = NULL;}
+done:
+    NCZ_workers_free(workers);
+    return THROW(stat);
+}
+
+void
+NCZ_workers_free(struct NCZWorkers* workers)
+{
+    if(workers == NULL) return;
+#ifdef ENABLE_NCZARR_THREADS
+    if(workers->threads != NULL) {
+	size_t i;
+	pthread_mutex_lock(&workers->mutex);
+	workers->shutdown = 1;
+	pthread_cond_broadcast(&workers->ready);
+	pthread_mutex_unlock(&workers->mutex);
+	for(i=0;i<workers->nthreads;i++)
+	    pthread_join(workers->threads[i],NULL);
+	nullfree(workers->threads);
+	pthread_cond_destroy(&workers->done);
+	pthread_cond_destroy(&workers->ready);
+	pthread_mutex_destroy(&workers->mutex);
+    }
+#endif
+    free(workers);
+}
+
+size_t
+NCZ_workers_count(struct NCZWorkers* workers)
+{
+    return (workers == NULL ? 0 : workers->nthreads);
+}
+
+/**
+ * Queue work for execution; if there are no worker threads,
+ * then the work is executed before returning.
+ */
+int
+NCZ_workers_submit(struct NCZWorkers* workers, NCZWork* work)
+{
+    work->next = NULL;
+    work->stat = NC_NOERR;
+#ifdef ENABLE_NCZARR_THREADS
+    if(workers != NULL && workers->nthreads > 0) {
+	pthread_mutex_lock(&workers->mutex);
+	work->state = WORK_QUEUED;
+	if(workers->tail == NULL)
+	    workers->head = work;
+	else
+	    workers->tail->next = work;
+	workers->tail = work;
+	pthread_cond_signal(&workers->ready);
+	pthread_mutex_unlock(&workers->mutex);
+	return NC_NOERR;
+    }
+#endif
+    work->state = WORK_RUNNING;
+    runwork(work);
+    work->state = WORK_DONE;
+    return NC_NOERR;
+}
+
+/**
+ * Wait for work to complete. If the work has not yet been
+ * started by a worker, then the caller runs it itself rather than
+ * sitting idle.
+ * @return the status returned by the work function.
+ */
+int
+NCZ_workers_wait(struct NCZWorkers* workers, NCZWork* work)
+{
+    if(work->state == WORK_NEW) return NC_NOERR; /* never submitted */
+#ifdef ENABLE_NCZARR_THREADS
+    if(workers != NULL && workers->nthreads > 0) {
+	int steal = 0;
+	pthread_mutex_lock(&workers->mutex);
+	if(work->state == WORK_QUEUED && dequeue(workers,work)) {
+	    work->state = WORK_RUNNING;
+	    steal = 1;
+	}
+	pthread_mutex_unlock(&workers->mutex);
+	if(steal) {
+	    runwork(work);
+	    pthread_mutex_lock(&workers->mutex);
+	    work->state = WORK_DONE;
+	    pthread_mutex_unlock(&workers->mutex);
+	} else {
+	    pthread_mutex_lock(&workers->mutex);
+	    while(work->state != WORK_DONE)
+		pthread_cond_wait(&workers->done,&workers->mutex);
+	    pthread_mutex_unlock(&workers->mutex);
+	}
+    }
+#endif
+    assert(work->state == WORK_DONE);
+    return work->stat;
+}
+
+int
+NCZ_workers_isdone(struct NCZWorkers* workers, NCZWork* work)
+{
+    int isdone = 1;
+#ifdef ENABLE_NCZARR_THREADS
+    if(workers != NULL && workers->nthreads > 0) {
+	pthread_mutex_lock(&workers->mutex);
+	isdone = (work->state == WORK_DONE);
+	pthread_mutex_unlock(&workers->mutex);
+	return isdone;
+    }
+#endif
+    isdone = (work->state == WORK_DONE || work->state == WORK_NEW);
+    return isdone;
+}
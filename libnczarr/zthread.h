@@ -0,0 +1,53 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+#ifndef ZTHREAD_H
+#define ZTHREAD_H
+
+/*
+A minimal pool of worker threads used to overlap chunk
+fetch and decode. When threads are not available (or the pool
+size is zero), submitted work is executed immediately by the
+caller, so the code using the pool need not special case it.
+
+Work items are owned by the submitter; they must not be
+reclaimed until NCZ_workers_wait has been called on them.
+The work function must not touch any shared netcdf state
+except read-only metadata.
+*/
+
+/* Default number of worker threads per file; override with
+   the .rc key ZARR.THREADS or the "threads" URL fragment key */
+#define DFALT_NCZ_THREADS 4
+/* Upper limit on pool size */
+#define MAX_NCZ_THREADS 64
+
+typedef int (*NCZ_work_fcn)(void* arg);
+
+typedef struct NCZWork {
+    NCZ_work_fcn fcn;
+    void* arg;
+    int stat; /* return value of fcn */
+    int state;
+#		define WORK_NEW     0
+#		define WORK_QUEUED  1
+#		define WORK_RUNNING 2
+#		define WORK_DONE    3
+    struct NCZWork* next; /* queue link */
+} NCZWork;
+
+struct NCZWorkers; /* Opaque */
+
+extern int NCZ_workers_new(size_t nthreads, struct NCZWorkers** workersp);
+extern void NCZ_workers_free(struct NCZWorkers* workers);
+/* Return number of worker threads; 0 => work is executed synchronously */
+extern size_t NCZ_workers_count(struct NCZWorkers* workers);
+extern int NCZ_workers_submit(struct NCZWorkers* workers, NCZWork* work);
+/* Wait for work to complete and return its status */
+extern int NCZ_workers_wait(struct NCZWorkers* workers, NCZWork* work);
+/* Return 1 if work has completed; never blocks */
+extern int NCZ_workers_isdone(struct NCZWorkers* workers, NCZWork* work);
+
+#endif /*ZTHREAD_H*/
@@ -568,5 +568,6 @@ static const NC_Dispatch NCZ_dispatcher_trace = {
     NCZTR_inq_var_filter_info,
     NC_NOTNC4_def_var_quantize,
     NC_NOTNC4_inq_var_quantize,
+    NCZ_inq_var_stats,
 };
 
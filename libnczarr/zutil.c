@@ -440,6 +440,25 @@ NCZ_isLittleEndian(void)
     return (u.bytes[0] == 1 ? 1 : 0);
 }
 
+/* Return 1 if the stored data of a var must be byte swapped.
+   NCZarr files whose arrays do not record "byteorder" were written
+   by versions that never swapped, so their chunks are read (and
+   extended) in native byte order; see ncz_sync_var_meta. */
+int
+NCZ_isswapped(const NC_VAR_INFO_T* var)
+{
+    const NCZ_VAR_INFO_T* zvar = (const NCZ_VAR_INFO_T*)var->format_var_info;
+    int native = (NCZ_isLittleEndian() ? NC_ENDIAN_LITTLE : NC_ENDIAN_BIG);
+    if(zvar != NULL && zvar->nativeorder) return 0;
+    if(var->type_info->size <= 1) return 0;
+    switch (var->type_info->hdr.id) {
+    case NC_SHORT: case NC_USHORT: case NC_INT: case NC_UINT:
+    case NC_FLOAT: case NC_DOUBLE: case NC_INT64: case NC_UINT64:
+	break;
+    default: return 0; /* e.g. NC_STRING */
+    }
+    return (var->endianness != NC_ENDIAN_NATIVE && var->endianness != native);
+}
 
 /*
 Given a path to a group, return the list of objects
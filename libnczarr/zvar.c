@@ -384,6 +384,16 @@ NCZ_def_var(int ncid, const char *name, nc_type xtype, int ndims,
     zvar->dimension_separator = ncrc_getglobalstate()->zarr.dimension_separator;
     assert(zvar->dimension_separator != 0);
 
+    /* Pure zarr has no way to describe shards */
+    {
+	NCZ_FILE_INFO_T* zinfo = (NCZ_FILE_INFO_T*)h5->format_file_info;
+	if(ndims > 0 && zinfo->controls.shard > 1 && !(zinfo->controls.flags & FLAG_PUREZARR)) {
+	    if((zvar->shards = calloc((size_t)ndims,sizeof(size64_t))) == NULL)
+		BAIL(NC_ENOMEM);
+	    for(d=0;d<ndims;d++) zvar->shards[d] = zinfo->controls.shard;
+	}
+    }
+
     /* Set these state flags for the var. */
     var->is_new_var = NC_TRUE;
     var->meta_read = NC_TRUE;
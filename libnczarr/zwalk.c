@@ -25,8 +25,19 @@ static unsigned int wdebug = 0;
 static int NCZ_walk(NCZProjection** projv, NCZOdometer* chunkodom, NCZOdometer* slpodom, NCZOdometer* memodom, const struct Common* common, void* chunkdata);
 static int rangecount(NCZChunkRange range);
 static int readfromcache(void* source, size64_t* chunkindices, void** chunkdata);
+static int prefetchcache(void* source, size_t n, const size64_t* chunkindices);
+static int readwholefromcache(void* source, size64_t* chunkindices, size_t nchunks, void* buffer, void** chunkdata);
+static int modifyincache(void* source, size64_t* chunkindices, void** chunkdata);
+static int modifyregionincache(void* source, size64_t* chunkindices, const NCZSlice* slices, void** chunkdata);
+static int collectchunks(struct Common* common, NCZOdometer* chunkodom, size_t* nchunksp, size64_t** chunklistp);
 static int iswholechunk(struct Common* common,NCZSlice*);
+static int chunkcovered(const struct Common* common, NCZProjection** proj);
+static int memcontiguous(const struct Common* common);
+static size_t touchedchunks(const struct Common* common);
 static int wholechunk_indices(struct Common* common, NCZSlice* slices, size64_t* chunkindices);
+static NCZCopy selectcopy(size_t typesize, int swap);
+static int getprojmemo(NCZChunkCache* cache, int rank, NCZProjMemo** memop);
+static int memoprojections(struct Common* common, NCZProjMemo* memo, int r, const NCZSlice* slice, const NCZChunkRange* range);
 
 const char*
 astype(int typesize, void* ptr)
@@ -42,6 +53,100 @@ astype(int typesize, void* ptr)
     return "?";
 }
 
+/**************************************************/
+/* Copy kernels (see NCZCopy).
+   Fixed size kernels move each element with a single load and
+   store, with the byte swap fused in; the loops are simple enough
+   for the compiler to vectorize them. */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define bswap16(x) __builtin_bswap16(x)
+#define bswap32(x) __builtin_bswap32(x)
+#define bswap64(x) __builtin_bswap64(x)
+#else
+#define bswap16(x) ((unsigned short)(((x) >> 8) | ((x) << 8)))
+#define bswap32(x) ((((x) & 0xff000000u) >> 24) | (((x) & 0x00ff0000u) >> 8) \
+		   | (((x) & 0x0000ff00u) << 8) | (((x) & 0x000000ffu) << 24))
+#define bswap64(x) (((unsigned long long)bswap32((unsigned int)(x)) << 32) \
+		   | (unsigned long long)bswap32((unsigned int)((x) >> 32)))
+#endif
+
+/* Any typesize, no swapping */
+static void
+copyn(size_t typesize, unsigned char* dst, size64_t dststride, const unsigned char* src, size64_t srcstride, size64_t count)
+{
+    size64_t i;
+    if(dststride == 1 && srcstride == 1) {
+        memcpy(dst,src,count*typesize);
+	return;
+    }
+    dststride *= typesize;
+    srcstride *= typesize;
+    for(i=0;i<count;i++,dst+=dststride,src+=srcstride)
+        memcpy(dst,src,typesize);
+}
+
+#define COPYKERNEL(name,T) \
+static void \
+name(size_t typesize, unsigned char* dst, size64_t dststride, const unsigned char* src, size64_t srcstride, size64_t count) \
+{ \
+    size64_t i; \
+    T v; \
+    (void)typesize; \
+    if(dststride == 1 && srcstride == 1) { \
+        memcpy(dst,src,count*sizeof(T)); \
+	return; \
+    } \
+    for(i=0;i<count;i++) { \
+        memcpy(&v,src+(i*srcstride*sizeof(T)),sizeof(T)); \
+        memcpy(dst+(i*dststride*sizeof(T)),&v,sizeof(T)); \
+    } \
+}
+
+#define SWAPKERNEL(name,T,SWAP) \
+static void \
+name(size_t typesize, unsigned char* dst, size64_t dststride, const unsigned char* src, size64_t srcstride, size64_t count) \
+{ \
+    size64_t i; \
+    T v; \
+    (void)typesize; \
+    if(dststride == 1 && srcstride == 1) { \
+        for(i=0;i<count;i++) { \
+            memcpy(&v,src+(i*sizeof(T)),sizeof(T)); \
+	    v = SWAP(v); \
+            memcpy(dst+(i*sizeof(T)),&v,sizeof(T)); \
+	} \
+	return; \
+    } \
+    for(i=0;i<count;i++) { \
+        memcpy(&v,src+(i*srcstride*sizeof(T)),sizeof(T)); \
+	v = SWAP(v); \
+        memcpy(dst+(i*dststride*sizeof(T)),&v,sizeof(T)); \
+    } \
+}
+
+COPYKERNEL(copy1,unsigned char)
+COPYKERNEL(copy2,unsigned short)
+COPYKERNEL(copy4,unsigned int)
+COPYKERNEL(copy8,unsigned long long)
+SWAPKERNEL(swap2,unsigned short,bswap16)
+SWAPKERNEL(swap4,unsigned int,bswap32)
+SWAPKERNEL(swap8,unsigned long long,bswap64)
+
+/* Choose the kernel once per transfer */
+static NCZCopy
+selectcopy(size_t typesize, int swap)
+{
+    switch (typesize) {
+    case 1: return copy1;
+    case 2: return (swap ? swap2 : copy2);
+    case 4: return (swap ? swap4 : copy4);
+    case 8: return (swap ? swap8 : copy8);
+    default: break;
+    }
+    return copyn; /* swapping only applies to the sizes above */
+}
+
 /**************************************************/
 int
 ncz_chunking_init(void)
@@ -92,9 +197,9 @@ NCZ_transferslice(NC_VAR_INFO_T* var, int reading,
     size64_t memshape[NC_MAX_VAR_DIMS];
     NCZSlice slices[NC_MAX_VAR_DIMS];
     struct Common common;
-    NCZ_FILE_INFO_T* zfile = NULL;
     NCZ_VAR_INFO_T* zvar = NULL;
     size_t typesize;
+    double starttime;
 
     if(!initialized) ncz_chunking_init();
 
@@ -114,7 +219,6 @@ NCZ_transferslice(NC_VAR_INFO_T* var, int reading,
     memset(&common,0,sizeof(common));
     common.var = var;
     common.file = (var->container)->nc4_info;
-    zfile = common.file->format_file_info;
     zvar = common.var->format_var_info;
 
     common.reading = reading;
@@ -125,7 +229,7 @@ NCZ_transferslice(NC_VAR_INFO_T* var, int reading,
     /* We need to talk scalar into account */
     common.rank = var->ndims + zvar->scalar;
     common.scalar = zvar->scalar;
-    common.swap = (zfile->native_endianness == var->endianness ? 0 : 1);
+    common.swap = NCZ_isswapped(var);
 
     common.chunkcount = 1;
     for(r=0;r<common.rank+common.scalar;r++) {
@@ -155,17 +259,33 @@ NCZ_transferslice(NC_VAR_INFO_T* var, int reading,
     common.chunklens = chunklens; /* ditto */
     common.memshape = memshape; /* ditto */
     common.reader.source = ((NCZ_VAR_INFO_T*)(var->format_var_info))->cache;
-    common.reader.read = readfromcache;
+    common.reader.read = (reading ? readfromcache : modifyincache);
+    /* Read chunks ahead in batches; also overlap chunk fetch and
+       decode if worker threads are available */
+    common.reader.prefetch = prefetchcache;
+    /* Chunks covered whole by a read may bypass the cache */
+    common.reader.readwhole = readwholefromcache;
+    /* Writes need not read the part of a chunk they overwrite */
+    if(!reading && NCZ_cache_combining(zvar->cache))
+	common.reader.modify = modifyregionincache;
 
     /* verify */
     assert(var->no_fill || var->fill_value != NULL);
 
+    /* Reuse the projections of earlier transfers of the same shape */
+    if(!common.scalar && (stat = getprojmemo(zvar->cache,common.rank,&common.memo))) goto done;
+
+    /* Time spent waiting on the cache is not part of the transfer */
+    zvar->cache->waittime = 0;
+    starttime = NCZ_stats_clock();
     if(common.scalar) {
         if((stat = NCZ_transferscalar(&common))) goto done;
     }
     else {
         if((stat = NCZ_transfer(&common, slices))) goto done;
     }
+    NCZ_stats_count(zvar->cache->stats,NCZ_STAT_TRANSFER,1,0);
+    NCZ_stats_time(zvar->cache->stats,NCZ_STAT_TRANSFER,(NCZ_stats_clock() - starttime) - zvar->cache->waittime);
 done:
     NCZ_clearcommon(&common);
     return stat;
@@ -186,6 +306,14 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
     NCZOdometer* memodom = NULL;
     void* chunkdata = NULL;
     int wholechunk = 0;
+    size64_t* chunklist = NULL; /* chunks to prefetch */
+    size_t nchunks = 0;
+    size_t ichunk = 0;
+    int readwhole = 0;
+    int inplace = 0;
+    size_t ntouched = 0;
+    void* scratch = NULL; /* for whole chunks that are not contiguous in memory */
+    NCZProjMemo* memo = common->memo;
 
     /*
      We will need three sets of odometers.
@@ -202,6 +330,9 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
 	fprintf(stderr,"slices=%s\n",nczprint_slices(common->rank,slices));
     }
 
+    if(common->copy == NULL)
+        common->copy = selectcopy(common->typesize,common->swap);
+
     if((stat = NCZ_projectslices(common->dimlens, common->chunklens, slices,
 		  common, &chunkodom)))
 	goto done;
@@ -224,8 +355,12 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
 	if((stat=wholechunk_indices(common,slices,chunkindices))) goto done;
 	if(wdebug >= 1)
 	    fprintf(stderr,"case: wholechunk: chunkindices: %s\n",nczprint_vector(common->rank,chunkindices));
-	/* Read the chunk */
-        switch ((stat = common->reader.read(common->reader.source, chunkindices, &chunkdata))) {
+	/* Read the chunk; one that is written whole need not be read */
+	if(!common->reading && common->reader.modify != NULL)
+	    stat = common->reader.modify(common->reader.source, chunkindices, NULL, &chunkdata);
+	else
+	    stat = common->reader.read(common->reader.source, chunkindices, &chunkdata);
+        switch (stat) {
         case NC_EEMPTY: /* cache created the chunk */
 	    break;
         case NC_NOERR: break;
@@ -235,16 +370,37 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
 	memptr = ((unsigned char*)common->memory);
 	slpptr = ((unsigned char*)chunkdata);
 	if(common->reading) {
-	    memcpy(memptr,slpptr,common->chunkcount*common->typesize);
+	    common->copy(common->typesize,memptr,1,slpptr,1,common->chunkcount);
 	} else {
-	    memcpy(slpptr,memptr,common->chunkcount*common->typesize);
+	    common->copy(common->typesize,slpptr,1,memptr,1,common->chunkcount);
 	}
-//        transfern(common,slpptr,memptr,common->chunkcount,1,chunkdata);
         if(zutest && zutest->tests & UTEST_WHOLECHUNK)
 	    zutest->print(UTEST_WHOLECHUNK, common, chunkindices);
 	goto done;
     }
 
+    /* The per-chunk odometers are reinitialized rather than rebuilt */
+    if(memo != NULL) {
+	slpodom = memo->slpodom; memo->slpodom = NULL;
+	memodom = memo->memodom; memo->memodom = NULL;
+    }
+
+    /* Chunks covered whole by a read may be decoded directly into memory */
+    if(common->reading && common->reader.readwhole != NULL) {
+	readwhole = 1;
+	inplace = memcontiguous(common);
+	ntouched = touchedchunks(common);
+    }
+
+    /* Chunks that are only written into are not read ahead */
+    if(common->reader.prefetch != NULL && (common->reading || common->reader.modify == NULL)) {
+	/* Get the ordered list of chunks actually touched so they can be
+	   fetched and decoded in parallel ahead of the walk */
+	if((stat = collectchunks(common,chunkodom,&nchunks,&chunklist))) goto done;
+	if(nchunks <= 1) {nullfree(chunklist); chunklist = NULL;}
+	nczodom_reset(chunkodom);
+    }
+
     /* iterate over the odometer: all combination of chunk
        indices in the projections */
     for(;nczodom_more(chunkodom);) {
@@ -294,17 +450,62 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
 	if(zutest && zutest->tests & UTEST_TRANSFER)
 	    zutest->print(UTEST_TRANSFER, common, chunkodom, slpslices, memslices);
 
-        /* Read from cache */
-        stat = common->reader.read(common->reader.source, chunkindices, &chunkdata);
-	switch (stat) {
-        case NC_EEMPTY: /* cache created the chunk */
-	    break;
-        case NC_NOERR: break;
-        default: goto done;
-        }
+	/* Keep a window of the following chunks in flight */
+	if(chunklist != NULL) {
+	    assert(ichunk < nchunks);
+	    if((stat = common->reader.prefetch(common->reader.source, nchunks - ichunk, chunklist + (ichunk * common->rank))))
+	        goto done;
+	    ichunk++;
+	}
+
+	if(readwhole && chunkcovered(common,proj)) {
+	    unsigned char* memptr = (unsigned char*)common->memory;
+	    void* buffer = NULL;
+	    size64_t memstart[NC_MAX_VAR_DIMS];
+	    for(r=0;r<common->rank;r++) memstart[r] = memslices[r].start;
+	    memptr += NCZ_computelinearoffset(common->rank,memstart,common->memshape) * common->typesize;
+	    if(inplace)
+	        buffer = memptr;
+	    else {
+	        if(scratch == NULL && (scratch = malloc(common->chunkcount*common->typesize)) == NULL)
+		    {stat = NC_ENOMEM; goto done;}
+		buffer = scratch;
+	    }
+	    if((stat = common->reader.readwhole(common->reader.source, chunkindices, ntouched, buffer, &chunkdata)))
+	        goto done;
+	    if(inplace) {
+		if(chunkdata != memptr)
+		    common->copy(common->typesize,memptr,1,chunkdata,1,common->chunkcount);
+		else if(common->swap) /* swap in place */
+		    common->copy(common->typesize,memptr,1,memptr,1,common->chunkcount);
+		goto next;
+	    }
+	    /* else walk the chunk data as usual */
+	} else if(!common->reading && common->reader.modify != NULL) {
+	    NCZSlice* region = (chunkcovered(common,proj) ? NULL : slpslices);
+	    if((stat = common->reader.modify(common->reader.source, chunkindices, region, &chunkdata)))
+		goto done;
+	} else {
+            /* Read from cache */
+            stat = common->reader.read(common->reader.source, chunkindices, &chunkdata);
+	    switch (stat) {
+            case NC_EEMPTY: /* cache created the chunk */
+	        break;
+            case NC_NOERR: break;
+            default: goto done;
+            }
+	}
 
-	slpodom = nczodom_fromslices(common->rank,slpslices);
-	memodom = nczodom_fromslices(common->rank,memslices);
+	if(slpodom == NULL) {
+	    if((slpodom = nczodom_fromslices(common->rank,slpslices)) == NULL)
+		{stat = NC_ENOMEM; goto done;}
+	} else
+	    nczodom_setslices(slpodom,slpslices);
+	if(memodom == NULL) {
+	    if((memodom = nczodom_fromslices(common->rank,memslices)) == NULL)
+		{stat = NC_ENOMEM; goto done;}
+	} else
+	    nczodom_setslices(memodom,memslices);
 
 	{ /* walk with odometer */
 	    if(wdebug >= 1)
@@ -313,17 +514,58 @@ NCZ_transfer(struct Common* common, NCZSlice* slices)
   	    if((stat = NCZ_walk(proj,chunkodom,slpodom,memodom,common,chunkdata))) goto done;
 	}
 next:
-        nczodom_free(slpodom); slpodom = NULL;
-        nczodom_free(memodom); memodom = NULL;
         nczodom_next(chunkodom);
     }
 done:
+    nullfree(chunklist);
+    nullfree(scratch);
+    if(memo != NULL) {
+	/* Give the odometers back to the memo */
+	memo->slpodom = slpodom; slpodom = NULL;
+	memo->memodom = memodom; memodom = NULL;
+	if(chunkodom == memo->chunkodom) chunkodom = NULL;
+    }
     nczodom_free(slpodom);
     nczodom_free(memodom);
     nczodom_free(chunkodom);
     return stat;
 }
 
+/* Collect the indices of all the chunks that will be
+   touched by the transfer, in walk order */
+static int
+collectchunks(struct Common* common, NCZOdometer* chunkodom, size_t* nchunksp, size64_t** chunklistp)
+{
+    int stat = NC_NOERR;
+    size_t n = 0;
+    size_t alloc = 0;
+    size64_t* chunklist = NULL;
+
+    for(;nczodom_more(chunkodom);nczodom_next(chunkodom)) {
+	int r, skip = 0;
+	size64_t* chunkindices = nczodom_indices(chunkodom);
+	for(r=0;r<common->rank;r++) {
+	    NCZSliceProjections* slp = &common->allprojections[r];
+	    if(slp->projections[chunkindices[r] - slp->range.start].skip) {skip = 1; break;}
+	}
+	if(skip) continue;
+	if(n >= alloc) {
+	    size64_t* newlist;
+	    alloc = (alloc == 0 ? 16 : 2*alloc);
+	    if((newlist = realloc(chunklist,alloc*common->rank*sizeof(size64_t))) == NULL)
+	        {stat = NC_ENOMEM; goto done;}
+	    chunklist = newlist;
+	}
+	memcpy(chunklist+(n*common->rank),chunkindices,common->rank*sizeof(size64_t));
+	n++;
+    }
+    *nchunksp = n;
+    *chunklistp = chunklist; chunklist = NULL;
+done:
+    nullfree(chunklist);
+    return stat;
+}
+
 
 #ifdef WDEBUG
 static void
@@ -398,27 +640,21 @@ NCZ_walk(NCZProjection** projv, NCZOdometer* chunkodom, NCZOdometer* slpodom, NC
 	    LOG((1,"%s: slpptr0=%p memptr0=%p slpoffset=%llu memoffset=%lld",__func__,slpptr0,memptr0,slpoffset,memoffset));
 	    if(zutest && zutest->tests & UTEST_WALK)
 		zutest->print(UTEST_WALK, common, chunkodom, slpodom, memodom);
-	    /* See if we can transfer multiple values at one shot */
+	    /* Transfer the whole (possibly strided) last dimension at one shot */
 	    laststride = slpodom->stride[common->rank-1];
-	    if(laststride == 1) {
-	        slpavail = nczodom_avail(slpodom); /* How much can we read? */
-	        memavail = nczodom_avail(memodom);
-		assert(memavail == slpavail);
-		nczodom_skipavail(slpodom);
-	        nczodom_skipavail(memodom);
-	    } else {
-	        slpavail = 1;
-		memavail = 1;
-	    }
+	    slpavail = nczodom_avail(slpodom); /* How much can we read? */
+	    memavail = nczodom_avail(memodom);
+	    assert(memavail == slpavail);
+	    nczodom_skipavail(slpodom);
+	    nczodom_skipavail(memodom);
    	    if(slpavail > 0) {
 if(wdebug > 0) wdebug2(common,slpptr0,memptr0,slpavail,laststride,chunkdata);
 	  	if(common->reading) {
-		    memcpy(memptr0,slpptr0,slpavail*common->typesize);
+		    common->copy(common->typesize,memptr0,1,slpptr0,laststride,slpavail);
 		} else {
-		    memcpy(slpptr0,memptr0,slpavail*common->typesize);
+		    common->copy(common->typesize,slpptr0,laststride,memptr0,1,slpavail);
 		}
 	    }
-//	    if((stat = transfern(common,slpptr0,memptr0,avail,nczodom_laststride(slpodom),chunkdata)))goto done;
             nczodom_next(memodom);
             nczodom_next(slpodom);
     }
@@ -536,14 +772,13 @@ NCZ_projectslices(size64_t* dimlens,
     int r;
     NCZOdometer* odom = NULL;
     NCZSliceProjections* allprojections = NULL;
+    NCZProjMemo* memo = common->memo;
     NCZChunkRange ranges[NC_MAX_VAR_DIMS];
     size64_t start[NC_MAX_VAR_DIMS];
     size64_t stop[NC_MAX_VAR_DIMS];
     size64_t stride[NC_MAX_VAR_DIMS];
     size64_t len[NC_MAX_VAR_DIMS];
 
-    if((allprojections = calloc(common->rank,sizeof(NCZSliceProjections))) == NULL)
-        {stat = NC_ENOMEM; goto done;}
     memset(ranges,0,sizeof(ranges));
 
     /* Package common arguments */
@@ -554,27 +789,36 @@ NCZ_projectslices(size64_t* dimlens,
         goto done;
 
     /* Compute the slice index vector */
-    if((stat=NCZ_compute_all_slice_projections(common,slices,ranges,allprojections)))
-        goto done;
+    if(memo != NULL) {
+	/* The memo keeps ownership; see NCZ_clearcommon */
+	for(r=0;r<common->rank;r++)
+	    if((stat = memoprojections(common,memo,r,&slices[r],&ranges[r]))) goto done;
+	common->allprojections = memo->allprojections;
+    } else {
+	if((allprojections = calloc(common->rank,sizeof(NCZSliceProjections))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	if((stat=NCZ_compute_all_slice_projections(common,slices,ranges,allprojections)))
+	    goto done;
+	common->allprojections = allprojections;
+	allprojections = NULL;
+    }
 
     /* Verify */
     for(r=0;r<common->rank;r++) {
-        assert(rangecount(ranges[r]) == allprojections[r].count);
+        assert(rangecount(ranges[r]) == common->allprojections[r].count);
     }
 
     /* Compute the shape vector */
     for(r=0;r<common->rank;r++) {
         int j;
         size64_t iocount = 0;
-        NCZProjection* projections = allprojections[r].projections;
-        for(j=0;j<allprojections[r].count;j++) {
+        NCZProjection* projections = common->allprojections[r].projections;
+        for(j=0;j<common->allprojections[r].count;j++) {
             NCZProjection* proj = &projections[j];
             iocount += proj->iocount;
         }
         common->shape[r] = iocount;
     }
-    common->allprojections = allprojections;
-    allprojections = NULL;
 
     /* Create an odometer to walk all the range combinations */
     for(r=0;r<common->rank;r++) {
@@ -584,8 +828,14 @@ NCZ_projectslices(size64_t* dimlens,
         len[r] = ceildiv(common->dimlens[r],common->chunklens[r]);
     }   
 
-    if((odom = nczodom_new(common->rank,start,stop,stride,len)) == NULL)
-        {stat = NC_ENOMEM; goto done;}
+    if(memo != NULL && memo->chunkodom != NULL)
+	nczodom_set(memo->chunkodom,start,stop,stride,len);
+    else {
+	if((odom = nczodom_new(common->rank,start,stop,stride,len)) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	if(memo != NULL) memo->chunkodom = odom;
+    }
+    if(memo != NULL) odom = memo->chunkodom;
     if(odomp) *odomp = odom;
 
 done:
@@ -670,17 +920,157 @@ done:
     return stat;
 }
 
+/* Charge the time since start to the cache rather than the transfer */
+static void
+cachewait(void* source, double start)
+{
+    ((struct NCZChunkCache*)source)->waittime += (NCZ_stats_clock() - start);
+}
+
 static int
 readfromcache(void* source, size64_t* chunkindices, void** chunkdatap)
 {
-    return NCZ_read_cache_chunk((struct NCZChunkCache*)source, chunkindices, chunkdatap);
+    double start = NCZ_stats_clock();
+    int stat = NCZ_read_cache_chunk((struct NCZChunkCache*)source, chunkindices, chunkdatap);
+    cachewait(source,start);
+    return stat;
+}
+
+/* Get a chunk that is about to be written into */
+static int
+modifyincache(void* source, size64_t* chunkindices, void** chunkdatap)
+{
+    int stat = NC_NOERR;
+    int stat1;
+    double start = NCZ_stats_clock();
+    switch (stat = NCZ_read_cache_chunk((struct NCZChunkCache*)source, chunkindices, chunkdatap)) {
+    case NC_NOERR: case NC_EEMPTY: break;
+    default: cachewait(source,start); return stat;
+    }
+    stat1 = NCZ_chunk_cache_modified((struct NCZChunkCache*)source, chunkindices);
+    cachewait(source,start);
+    if(stat1) return stat1;
+    return stat;
+}
+
+/* Get the part of a chunk that is about to be written into */
+static int
+modifyregionincache(void* source, size64_t* chunkindices, const NCZSlice* slices, void** chunkdatap)
+{
+    double start = NCZ_stats_clock();
+    int stat = NCZ_modify_cache_chunk((struct NCZChunkCache*)source, chunkindices, slices, chunkdatap);
+    cachewait(source,start);
+    return stat;
+}
+
+static int
+prefetchcache(void* source, size_t n, const size64_t* chunkindices)
+{
+    double start = NCZ_stats_clock();
+    int stat = NCZ_prefetch_cache_chunks((struct NCZChunkCache*)source, n, chunkindices);
+    cachewait(source,start);
+    return stat;
+}
+
+static int
+readwholefromcache(void* source, size64_t* chunkindices, size_t nchunks, void* buffer, void** chunkdatap)
+{
+    double start = NCZ_stats_clock();
+    int stat = NCZ_read_cache_wholechunk((struct NCZChunkCache*)source, chunkindices, nchunks, buffer, chunkdatap);
+    cachewait(source,start);
+    return stat;
 }
 
 void
 NCZ_clearcommon(struct Common* common)
 {
-    NCZ_clearsliceprojections(common->rank,common->allprojections);
-    nullfree(common->allprojections);
+    if(common->memo == NULL) {
+	NCZ_clearsliceprojections(common->rank,common->allprojections);
+	nullfree(common->allprojections);
+    }
+    common->allprojections = NULL;
+}
+
+/* Get (creating if necessary) the projection memo of a cache */
+static int
+getprojmemo(NCZChunkCache* cache, int rank, NCZProjMemo** memop)
+{
+    int stat = NC_NOERR;
+    NCZProjMemo* memo = cache->projmemo;
+
+    if(memo != NULL && memo->rank != rank) {
+	NCZ_free_projmemo(memo);
+	memo = cache->projmemo = NULL;
+    }
+    if(memo == NULL) {
+	if((memo = calloc(1,sizeof(NCZProjMemo))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	memo->rank = rank;
+	if((memo->keys = calloc((size_t)rank,sizeof(NCZProjKey))) == NULL
+	   || (memo->allprojections = calloc((size_t)rank,sizeof(NCZSliceProjections))) == NULL)
+	    {NCZ_free_projmemo(memo); memo = NULL; stat = NC_ENOMEM; goto done;}
+	cache->projmemo = memo;
+    }
+    *memop = memo;
+done:
+    return stat;
+}
+
+void
+NCZ_free_projmemo(NCZProjMemo* memo)
+{
+    if(memo == NULL) return;
+    if(memo->allprojections != NULL)
+	NCZ_clearsliceprojections(memo->rank,memo->allprojections);
+    nullfree(memo->allprojections);
+    nullfree(memo->keys);
+    nczodom_free(memo->chunkodom);
+    nczodom_free(memo->slpodom);
+    nczodom_free(memo->memodom);
+    free(memo);
+}
+
+/* Get the projections of slice r from the memo, recomputing them
+   unless the memo holds those of a slice that differs only by a
+   whole number of chunks */
+static int
+memoprojections(struct Common* common, NCZProjMemo* memo, int r, const NCZSlice* slice, const NCZChunkRange* range)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    NCZProjKey key;
+    NCZSliceProjections* slp = &memo->allprojections[r];
+    size64_t chunklen = common->chunklens[r];
+
+    memset(&key,0,sizeof(key)); /* keys are compared with memcmp */
+    key.valid = 1;
+    key.phase = slice->start % chunklen;
+    key.extent = slice->stop - slice->start;
+    key.stride = slice->stride;
+    key.chunklen = chunklen;
+    key.memlen = common->memshape[r];
+    /* The projections are clipped by the dimension length */
+    if(slice->stop > common->dimlens[r]) key.valid = 0;
+
+    if(key.valid && memcmp(&key,&memo->keys[r],sizeof(NCZProjKey)) == 0) {
+	/* Same shape; only the chunk indices move (unsigned wraparound is fine) */
+	size64_t delta = range->start - slp->range.start;
+	if(delta != 0) {
+	    for(i=0;i<slp->count;i++) {
+		slp->projections[i].chunkindex += delta;
+		slp->projections[i].offset += delta * chunklen;
+	    }
+	    slp->range = *range;
+	}
+	goto done;
+    }
+    NCZ_clearsliceprojections(1,slp);
+    memset(slp,0,sizeof(NCZSliceProjections));
+    memset(&memo->keys[r],0,sizeof(NCZProjKey));
+    if((stat = NCZ_compute_per_slice_projections(common,r,slice,range,slp))) goto done;
+    memo->keys[r] = key;
+done:
+    return stat;
 }
 
 /* Does the User want all of one and only chunk? */
@@ -710,6 +1100,50 @@ wholechunk_indices(struct Common* common, NCZSlice* slices, size64_t* chunkindic
     return NC_NOERR;
 }
 
+/* Does the transfer cover all of the chunk selected by these projections? */
+static int
+chunkcovered(const struct Common* common, NCZProjection** proj)
+{
+    int r;
+    for(r=0;r<common->rank;r++) {
+	const NCZSlice* slice = &proj[r]->chunkslice;
+	if(slice->stride != 1 || slice->start != 0 || slice->stop != common->chunklens[r])
+	    return 0;
+    }
+    return 1;
+}
+
+/* Does a chunk covered whole occupy contiguous memory in the same layout?
+   Past the first dimension where the chunk is longer than one,
+   the chunk must span the memory shape. */
+static int
+memcontiguous(const struct Common* common)
+{
+    int r;
+    for(r=0;r<common->rank && common->chunklens[r] == 1;r++);
+    for(r++;r<common->rank;r++) {
+	if(common->chunklens[r] != common->memshape[r]) return 0;
+    }
+    return 1;
+}
+
+/* No. of chunks actually touched by the transfer */
+static size_t
+touchedchunks(const struct Common* common)
+{
+    int r;
+    size_t i, n = 1;
+    for(r=0;r<common->rank;r++) {
+	const NCZSliceProjections* slp = &common->allprojections[r];
+	size_t count = 0;
+	for(i=0;i<slp->count;i++) {
+	    if(!slp->projections[i].skip) count++;
+	}
+	n *= count;
+    }
+    return n;
+}
+
 /**************************************************/
 /* Scalar variable support */
 
@@ -734,13 +1168,16 @@ NCZ_transferscalar(struct Common* common)
     default: goto done;
     }
 
+    if(common->copy == NULL)
+        common->copy = selectcopy(common->typesize,common->swap);
+
     /* Figure out memory address */
     memptr = ((unsigned char*)common->memory);
     slpptr = ((unsigned char*)chunkdata);
     if(common->reading)
-	memcpy(memptr,slpptr,common->chunkcount*common->typesize);
+	common->copy(common->typesize,memptr,1,slpptr,1,common->chunkcount);
     else
-	memcpy(slpptr,memptr,common->chunkcount*common->typesize);
+	common->copy(common->typesize,slpptr,1,memptr,1,common->chunkcount);
 
 done:
     return stat;
@@ -14,6 +14,8 @@
 #include "zcache.h"
 #include "ncxcache.h"
 #include "zfilter.h"
+#include "zthread.h"
+#include "zbufpool.h"
 
 #undef DEBUG
 
@@ -21,12 +23,76 @@
 
 #define LEAFLEN 32
 
+/* Max no. of chunks read by one batch read when there are no worker threads */
+#define BATCHWINDOW 8
+
+/* No. of consecutive sequential steps before readahead starts */
+#define READAHEADRUN 2
+
+/* A chunk being loaded (or encoded) by a worker thread; a chunk
+   being loaded is not visible in the cache until it is claimed
+   by NCZ_read_cache_chunk */
+typedef struct NCZPending {
+    NCZWork work;
+    NCZChunkCache* cache;
+    NCZCacheEntry* entry;
+    int fetched; /* 1 => raw data was already read by the submitting thread */
+    int empty;   /* 1 => chunk does not exist in the map */
+    char* path;  /* map key, built by the submitting thread if !fetched */
+    int borrowed; /* write of data that still belongs to a cached entry */
+} NCZPending;
+
+/* The index of a shard object; see the Sharding section below */
+typedef struct NCZShard {
+    size64_t size; /* size of the shard object; 0 => does not exist */
+    size64_t* index; /* (offset,nbytes) for each chunk in the shard */
+} NCZShard;
+
 /* Forward */
 static int get_chunk(NCZChunkCache* cache, NCZCacheEntry* entry);
+static int fetch_chunk(NCZChunkCache* cache, NCZCacheEntry* entry, int* emptyp);
+static int finish_chunk(NCZChunkCache* cache, NCZCacheEntry* entry, int empty);
+static NCZPending* findpending(NCZChunkCache* cache, const size64_t* indices);
+static int claimpending(NCZChunkCache* cache, NCZPending* pending, NCZCacheEntry** entryp);
+static void drainpending(NCZChunkCache* cache);
+static void free_cache_entry(NCZChunkCache* cache, NCZCacheEntry* entry);
+static void* alloc_chunk_buffer(NCZChunkCache* cache);
 static int put_chunk(NCZChunkCache* cache, NCZCacheEntry*);
+static int put_chunks(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries, int release);
+static int fetch_chunks(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries, char** paths, int* empties);
+static int chunkpaths(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries, char** paths);
 static int makeroom(NCZChunkCache* cache);
 static int flushcache(NCZChunkCache* cache);
 static int constraincache(NCZChunkCache* cache);
+static int evict_collision(NCZChunkCache* cache, NCZCacheEntry* entry);
+static int encode_chunk(NCZChunkCache* cache, NCZCacheEntry* entry);
+static int encode_chunks(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries, NCZPending** jobsp);
+static int encode_modified(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries);
+static void markfill(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries);
+static int drop_chunk(NCZChunkCache* cache, const char* path, NCZCacheEntry* entry);
+static int fetch_shard_chunk(NCZChunkCache* cache, NCZCacheEntry* entry, int* emptyp);
+static int put_shard(NCZChunkCache* cache, const char* path, size_t n, NCZCacheEntry** entries);
+static int flush_shards(NCZChunkCache* cache);
+static void free_shards(NCZChunkCache* cache);
+static int readahead(NCZChunkCache* cache, const size64_t* indices);
+static int partial_entry(NCZChunkCache* cache, const size64_t* indices, ncexhashkey_t hkey, NCZCacheEntry** entryp);
+static void mark_written(NCZChunkCache* cache, NCZCacheEntry* entry, const NCZSlice* slices);
+static size_t wclimit(NCZChunkCache* cache);
+static ncexhashkey_t cachekey(NCZChunkCache* cache, const size64_t* indices);
+static int materialize(NCZChunkCache* cache, NCZCacheEntry* entry);
+static NCZCacheEntry* take_held(NCZChunkCache* cache, const size64_t* indices, ncexhashkey_t hkey);
+static int hold_partial(NCZChunkCache* cache, NCZCacheEntry* entry);
+static int flush_held(NCZChunkCache* cache);
+static void free_held(NCZChunkCache* cache);
+static int writingbehind(NCZChunkCache* cache);
+static int queuewrite(NCZChunkCache* cache, NCZCacheEntry* entry, char* path, int release);
+static void syncwrite(NCZChunkCache* cache, const size64_t* indices);
+static void reapwrites(NCZChunkCache* cache, size_t need, int all);
+static int drainwrites(NCZChunkCache* cache);
+static int decode_cached(NCZChunkCache* cache, NCZCacheEntry* entry);
+static int lruentries(NCZChunkCache* cache, size_t* np, NCZCacheEntry*** entriesp);
+static size_t cachecapacity(NCZChunkCache* cache);
+static size_t bufpoolsize(NCZChunkCache* cache);
 
 /**************************************************/
 /* Dispatch table per-var cache functions */
@@ -87,6 +153,287 @@ done:
     return retval;
 }
 
+/**
+ * @internal Set the number of chunks to load ahead of a sequential
+ * reader of a variable. Once consecutive reads step through the
+ * chunks in order, the next nchunks chunks are loaded into the
+ * cache (asynchronously if there are worker threads), subject to
+ * the cache limits.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param nchunks # of chunks to read ahead; 0 => no readahead
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NCZ_set_var_chunk_readahead(int ncid, int varid, size_t nchunks)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    int retval = NC_NOERR;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        goto done;
+    assert(grp && h5);
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        {retval = NC_ENOTVAR; goto done;}
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    assert(zvar != NULL && zvar->cache != NULL);
+    zvar->cache->readahead.nchunks = nchunks;
+    zvar->cache->readahead.valid = 0;
+    zvar->cache->readahead.run = 0;
+done:
+    return retval;
+}
+
+/**
+ * @internal Set whether modified chunks of a variable that hold
+ * nothing but the fill value are stored. If not, such chunks are
+ * not written, and are removed from storage if they exist there;
+ * reads of missing chunks return the fill value, so the data is
+ * unchanged. The default comes from the "writeemptychunks" mode
+ * fragment key.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param writeempty 0 => do not store fill-only chunks
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NCZ_set_var_write_empty_chunks(int ncid, int varid, int writeempty)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    int retval = NC_NOERR;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        goto done;
+    assert(grp && h5);
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        {retval = NC_ENOTVAR; goto done;}
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    assert(zvar != NULL && zvar->cache != NULL);
+    zvar->cache->writeempty = (writeempty ? 1 : 0);
+done:
+    return retval;
+}
+
+/**
+ * @internal Set the number of bytes of partially written chunks
+ * that a variable may hold outside its chunk cache. A chunk that is
+ * written without first being read starts out as the fill value;
+ * the elements written are tracked, and the stored chunk is only
+ * read and merged in when the chunk is read, flushed or must be
+ * dropped, and never if it is completely written first. The
+ * default comes from the "writecombine" mode fragment key.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param limit bytes to hold; 0 => always read a chunk before writing into it
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NCZ_set_var_write_combine(int ncid, int varid, size_t limit)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    int retval = NC_NOERR;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        goto done;
+    assert(grp && h5);
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        {retval = NC_ENOTVAR; goto done;}
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    assert(zvar != NULL && zvar->cache != NULL);
+    zvar->cache->wcombine.limit = limit;
+    /* Write out whatever no longer fits */
+    if(zvar->cache->wcombine.used > limit)
+	retval = flush_held(zvar->cache);
+done:
+    return retval;
+}
+
+/**
+ * @internal Set the number of bytes of chunk writes that a variable
+ * may have in progress. Chunks written out of the chunk cache are
+ * then handed to the worker threads rather than written by the
+ * caller, which only waits once the limit is reached. Any error of
+ * such a write is returned by the next nc_sync or nc_close. The
+ * default comes from the "writebehind" mode fragment key.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param limit bytes in progress; 0 => write synchronously
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NCZ_set_var_write_behind(int ncid, int varid, size_t limit)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    int retval = NC_NOERR;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        goto done;
+    assert(grp && h5);
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        {retval = NC_ENOTVAR; goto done;}
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    assert(zvar != NULL && zvar->cache != NULL);
+    zvar->cache->writebehind.limit = limit;
+    if(zvar->cache->writebehind.used > limit)
+	reapwrites(zvar->cache,0,1);
+done:
+    return retval;
+}
+
+/**
+ * @internal Mask the hash keys of the chunks of a variable, so that
+ * tests can make different chunks share a key. Only allowed while
+ * the chunk cache of the variable is empty.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param mask applied to the hash keys; all ones => unmasked
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ * @returns ::NC_EINVAL The chunk cache is in use.
+ */
+int
+NCZ_set_var_cache_keymask(int ncid, int varid, unsigned long long mask)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    int retval = NC_NOERR;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        goto done;
+    assert(grp && h5);
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        {retval = NC_ENOTVAR; goto done;}
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    assert(zvar != NULL && zvar->cache != NULL);
+    if(ncxcachecount(zvar->cache->xcache) > 0 || zvar->cache->wcombine.used > 0
+       || nclistlength(zvar->cache->pending) > 0)
+        {retval = NC_EINVAL; goto done;}
+    zvar->cache->keymask = (size64_t)mask;
+done:
+    return retval;
+}
+
+/**
+ * @internal Return the counters of the chunk buffer pool of a
+ * variable. The counters restart whenever the cache is adjusted,
+ * e.g. by nc_set_var_chunk_cache.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param stats return the counters
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NCZ_inq_var_chunk_bufpool(int ncid, int varid, struct NCZBufPoolStats* stats)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    int retval = NC_NOERR;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        goto done;
+    assert(grp && h5);
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        {retval = NC_ENOTVAR; goto done;}
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    assert(zvar != NULL && zvar->cache != NULL);
+    memset(stats,0,sizeof(NCZBufPoolStats));
+    if(zvar->cache->bufpool != NULL)
+	NCZ_bufpool_stats(zvar->cache->bufpool,stats);
+done:
+    return retval;
+}
+
+/**
+ * @internal Return the space the chunk cache of a variable counts
+ * as used, and the sum of the sizes of its entries; the two are the
+ * same unless the accounting is wrong.
+ *
+ * @param ncid File ID.
+ * @param varid Variable ID.
+ * @param usedp return the space counted as used
+ * @param sizep return the sum of the entry sizes
+ *
+ * @returns ::NC_NOERR No error.
+ * @returns ::NC_EBADID Bad ncid.
+ * @returns ::NC_ENOTVAR Invalid variable ID.
+ */
+int
+NCZ_inq_var_chunk_cache_used(int ncid, int varid, size_t* usedp, size_t* sizep)
+{
+    NC_GRP_INFO_T *grp;
+    NC_FILE_INFO_T *h5;
+    NC_VAR_INFO_T *var;
+    NCZ_VAR_INFO_T *zvar;
+    NCZCacheEntry** entries = NULL;
+    size_t i, nentries = 0, size = 0;
+    int retval = NC_NOERR;
+
+    if ((retval = nc4_find_nc_grp_h5(ncid, NULL, &grp, &h5)))
+        goto done;
+    assert(grp && h5);
+    if (!(var = (NC_VAR_INFO_T *)ncindexith(grp->vars, varid)))
+        {retval = NC_ENOTVAR; goto done;}
+    zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
+    assert(zvar != NULL && zvar->cache != NULL);
+    if((retval = lruentries(zvar->cache,&nentries,&entries))) goto done;
+    for(i=0;i<nentries;i++) size += entries[i]->size;
+    if(usedp) *usedp = zvar->cache->used;
+    if(sizep) *sizep = size;
+done:
+    nullfree(entries);
+    return retval;
+}
+
+/* Keep about half a cache's worth of idle buffers, which covers
+   the chunks evicted while the next ones are being loaded */
+static size_t
+bufpoolsize(NCZChunkCache* cache)
+{
+    size_t n = cachecapacity(cache) / 2;
+    if(n == 0) n = 1;
+    if(n > MAX_NCZ_BUFPOOL) n = MAX_NCZ_BUFPOOL;
+    return n;
+}
+
 /**
  * @internal Adjust the chunk cache of a var for better
  * performance.
@@ -106,7 +453,9 @@ NCZ_adjust_var_cache(NC_VAR_INFO_T *var)
     int stat = NC_NOERR;
     NCZ_VAR_INFO_T* zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
     /* completely empty the cache */
+    drainpending(zvar->cache);
     flushcache(zvar->cache);
+    if((stat = flush_held(zvar->cache))) return stat;
 
 #ifdef DEBUG
 fprintf(stderr,"xxx: adjusting cache for: %s\n",var->hdr.name);
@@ -129,12 +478,67 @@ fprintf(stderr,"xxx: adjusting cache for: %s\n",var->hdr.name);
     else {
 	assert(var->fill_value != NULL);
         stat = NCZ_create_fill_chunk(zvar->cache->chunksize,var->type_info->size,var->fill_value,&zvar->cache->fillchunk);
+	/* Cached chunks hold the data in storage byte order */
+	if(stat == NC_NOERR && NCZ_isswapped(var))
+	    stat = NCZ_swapatomicdata(zvar->cache->chunksize,zvar->cache->fillchunk,(int)var->type_info->size);
     }
+    /* and the buffer pool; the cache is empty, so no buffer is outstanding */
+    NCZ_bufpool_free(zvar->cache->bufpool);
+    zvar->cache->bufpool = NULL;
+    if(stat == NC_NOERR)
+	stat = NCZ_bufpool_new(zvar->cache->chunksize,bufpoolsize(zvar->cache),&zvar->cache->bufpool);
     return stat;
 }
 
 /**************************************************/
 
+/* Map operations on behalf of a cache are also counted in the
+   statistics of its variable */
+static int
+cacheread(NCZChunkCache* cache, NCZMAP* map, const char* key, size64_t start, size64_t count, void* content)
+{
+    int stat = nczmap_read(map,key,start,count,content);
+    NCZ_stats_count(cache->stats,NCZ_STAT_READ,1,(stat == NC_NOERR ? count : 0));
+    return stat;
+}
+
+static int
+cachewrite(NCZChunkCache* cache, NCZMAP* map, const char* key, size64_t start, size64_t count, const void* content)
+{
+    NCZ_stats_count(cache->stats,NCZ_STAT_WRITE,1,count);
+    return nczmap_write(map,key,start,count,content);
+}
+
+static int
+cachelen(NCZChunkCache* cache, NCZMAP* map, const char* key, size64_t* lenp)
+{
+    NCZ_stats_count(cache->stats,NCZ_STAT_LEN,1,0);
+    return nczmap_len(map,key,lenp);
+}
+
+static int
+cacheremove(NCZChunkCache* cache, NCZMAP* map, const char* key)
+{
+    NCZ_stats_count(cache->stats,NCZ_STAT_REMOVE,1,0);
+    return nczmap_remove(map,key);
+}
+
+static int
+cachereadn(NCZChunkCache* cache, NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = nczmap_readn(map,n,requests);
+    NCZ_stats_count(cache->stats,NCZ_STAT_READ,n,nczm_batchbytes(n,requests));
+    return stat;
+}
+
+static int
+cachewriten(NCZChunkCache* cache, NCZMAP* map, size_t n, NCZM_REQUEST* requests)
+{
+    int stat = nczmap_writen(map,n,requests);
+    NCZ_stats_count(cache->stats,NCZ_STAT_WRITE,n,nczm_batchbytes(n,requests));
+    return stat;
+}
+
 /**
  * Create a chunk cache object
  *
@@ -166,6 +570,17 @@ NCZ_create_chunk_cache(NC_VAR_INFO_T* var, size64_t chunksize, char dimsep, NCZC
     cache->fillchunk = NULL;
     cache->chunksize = chunksize;
     cache->dimension_separator = dimsep;
+    cache->writeempty = 1;
+    cache->wcombine.limit = NCZ_WCOMBINE_CACHESIZE;
+    cache->keymask = ~((size64_t)0);
+    if(var->container != NULL && var->container->nc4_info != NULL
+       && var->container->nc4_info->format_file_info != NULL) {
+	NCZ_FILE_INFO_T* zfile = var->container->nc4_info->format_file_info;
+	cache->readahead.nchunks = zfile->controls.readahead;
+	cache->writeempty = zfile->controls.writeempty;
+	cache->wcombine.limit = zfile->controls.writecombine;
+	cache->writebehind.limit = zfile->controls.writebehind;
+    }
     zvar->cache = cache;
 
 #ifdef FLUSH
@@ -177,9 +592,11 @@ NCZ_create_chunk_cache(NC_VAR_INFO_T* var, size64_t chunksize, char dimsep, NCZC
         var->hdr.name,(unsigned long)cache->maxentries,(unsigned long)cache->maxsize);
 #endif
     if((stat = ncxcachenew(LEAFLEN,&cache->xcache))) goto done;
-    if((cache->mru = nclistnew()) == NULL)
+    if((cache->pending = nclistnew()) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((cache->writebehind.jobs = nclistnew()) == NULL)
 	{stat = NC_ENOMEM; goto done;}
-    nclistsetalloc(cache->mru,cache->maxentries);
+    if((stat = NCZ_stats_new(&cache->stats))) goto done;
     if(cachep) {*cachep = cache; cache = NULL;}
 done:
     nullfree(fill);
@@ -187,13 +604,24 @@ done:
     return THROW(stat);
 }
 
+/* Real chunk buffers are recycled through the pool of the cache */
+static void*
+alloc_chunk_buffer(NCZChunkCache* cache)
+{
+    if(cache->bufpool == NULL) return malloc(cache->chunksize);
+    return NCZ_bufpool_get(cache->bufpool);
+}
+
 static void
-free_cache_entry(NCZCacheEntry* entry)
+free_cache_entry(NCZChunkCache* cache, NCZCacheEntry* entry)
 {
     if(entry) {
-	nullfree(entry->data);
-	nullfree(entry->key.varkey);
-	nullfree(entry->key.chunkkey);
+	if(entry->data != NULL && !entry->isfiltered && cache->bufpool != NULL
+	   && entry->size == NCZ_bufpool_bufsize(cache->bufpool))
+	    NCZ_bufpool_put(cache->bufpool,entry->data);
+	else
+	    nullfree(entry->data);
+	nullfree(entry->written);
 	nullfree(entry);
     }
 }
@@ -205,20 +633,29 @@ NCZ_free_chunk_cache(NCZChunkCache* cache)
 
     ZTRACE(4,"cache.var=%s",cache->var->hdr.name);
 
+    /* Wait for any outstanding loads and writes */
+    drainpending(cache);
+    nclistfree(cache->pending);
+    if(cache->writebehind.jobs != NULL) (void)drainwrites(cache);
+    nclistfree(cache->writebehind.jobs);
+
     /* Iterate over the entries */
-    while(nclistlength(cache->mru) > 0) {
-	void* ptr;
-        NCZCacheEntry* entry = nclistremove(cache->mru,0);
-	(void)ncxcacheremove(cache->xcache,entry->hashkey,&ptr);
-	assert(ptr == entry);
-	free_cache_entry(entry);
+    if(cache->xcache != NULL) {
+	NCZCacheEntry* entry;
+	while((entry = ncxcachelast(cache->xcache)) != NULL) {
+	    void* ptr;
+	    (void)ncxcacheremove(cache->xcache,entry->hashkey,&ptr);
+	    assert(ptr == entry);
+	    free_cache_entry(cache,entry);
+	}
     }
-#ifdef DEBUG
-fprintf(stderr,"|cache.free|=%ld\n",nclistlength(cache->mru));
-#endif
     ncxcachefree(cache->xcache);
-    nclistfree(cache->mru);
-    cache->mru = NULL;
+    cache->xcache = NULL;
+    free_held(cache);
+    free_shards(cache);
+    NCZ_bufpool_free(cache->bufpool);
+    NCZ_stats_free(cache->stats);
+    NCZ_free_projmemo(cache->projmemo);
     nullfree(cache->fillchunk);
     nullfree(cache);
     (void)ZUNTRACE(NC_NOERR);
@@ -236,7 +673,7 @@ size64_t
 NCZ_cache_size(NCZChunkCache* cache)
 {
     assert(cache);
-    return nclistlength(cache->mru);
+    return ncxcachecount(cache->xcache);
 }
 
 int
@@ -249,52 +686,440 @@ NCZ_read_cache_chunk(NCZChunkCache* cache, const size64_t* indices, void** datap
     int created = 0;
 
     /* the hash key */
-    hkey = ncxcachekey(indices,sizeof(size64_t)*cache->ndims);
+    hkey = cachekey(cache,indices);
     /* See if already in cache */
     stat = ncxcachelookup(cache->xcache,hkey,(void**)&entry);
     switch(stat) {
     case NC_NOERR:
+	/* The xcache is keyed by the hash of the indices alone */
+	if(memcmp(entry->indices,indices,sizeof(size64_t)*cache->ndims) != 0) {
+	    stat = evict_collision(cache,entry);
+	    entry = NULL;
+	    if(stat) goto done;
+	    NCZ_stats_count(cache->stats,NCZ_STAT_MISS,1,0);
+	    break;
+	}
+	NCZ_stats_count(cache->stats,NCZ_STAT_HIT,1,0);
         /* Move to front of the lru */
         (void)ncxcachetouch(cache->xcache,hkey);
+	/* A chunk that was only written to must now be completed */
+	if(entry->written != NULL && (stat = materialize(cache,entry)))
+	    {entry = NULL; goto done;}
+	if((stat = decode_cached(cache,entry))) {entry = NULL; goto done;}
         break;
     case NC_ENOOBJECT:
+	NCZ_stats_count(cache->stats,NCZ_STAT_MISS,1,0);
         entry = NULL; /* not found; */
 	break;
     default: goto done;
     }
 
     if(entry == NULL) { /*!found*/
-	/* Create a new entry */
-	if((entry = calloc(1,sizeof(NCZCacheEntry)))==NULL)
-	    {stat = NC_ENOMEM; goto done;}
-	memcpy(entry->indices,indices,rank*sizeof(size64_t));
-        /* Create the key for this cache */
-        if((stat = NCZ_buildchunkpath(cache,indices,&entry->key))) goto done;
-        entry->hashkey = hkey;
-	/* Try to read the object from "disk" */
-	if((stat=get_chunk(cache,entry))) goto done;
-        nclistpush(cache->mru,entry);
-	cache->used += entry->size;
+	NCZPending* pending = findpending(cache,indices);
+	if((entry = take_held(cache,indices,hkey)) != NULL) {
+	    if((stat = materialize(cache,entry))) goto done;
+	} else if(pending != NULL) {
+	    /* A worker is (or was) loading this chunk */
+	    if((stat = claimpending(cache,pending,&entry))) goto done;
+	} else {
+	    /* Create a new entry */
+	    if((entry = calloc(1,sizeof(NCZCacheEntry)))==NULL)
+	        {stat = NC_ENOMEM; goto done;}
+	    memcpy(entry->indices,indices,rank*sizeof(size64_t));
+            entry->hashkey = hkey;
+	    /* Try to read the object from "disk" */
+	    if((stat=get_chunk(cache,entry))) goto done;
+	}
+	/* Insertion also makes it the most recently used entry */
 	if((stat = ncxcacheinsert(cache->xcache,entry->hashkey,entry))) goto done;
+	cache->used += entry->size;
 	/* Ensure cache constraints not violated */
 	if((stat=makeroom(cache))) goto done;
     }
 
 #ifdef DEBUG
-fprintf(stderr,"|cache.read.lru|=%ld\n",nclistlength(cache->mru));
+fprintf(stderr,"|cache.read.lru|=%ld\n",(long)ncxcachecount(cache->xcache));
 #endif
     if(datap) *datap = entry->data;
     entry = NULL;
+    /* Readahead is advisory, so its failures are not reported here;
+       a chunk that cannot be loaded will fail when it is read */
+    (void)readahead(cache,indices);
     
 done:
     if(created && stat == NC_NOERR)  stat = NC_EEMPTY; /* tell upper layers */
-    if(entry) free_cache_entry(entry);
+    if(entry) free_cache_entry(cache,entry);
     return THROW(stat);
 }
 
-#if 0
+/* No. of chunks the cache can hold; makeroom always allows one */
+static size_t
+cachecapacity(NCZChunkCache* cache)
+{
+    size_t n = cache->maxentries;
+    if(cache->chunksize > 0 && n > cache->maxsize / cache->chunksize)
+	n = (size_t)(cache->maxsize / cache->chunksize);
+    return (n == 0 ? 1 : n);
+}
+
+/**
+ * Read a chunk that a transfer of nchunks chunks covers whole.
+ * If the chunk is cached, or the cache can hold all the chunks of
+ * the transfer, this is NCZ_read_cache_chunk. Otherwise the chunk
+ * would only be evicted again by the rest of the transfer, so it
+ * is loaded into buffer without entering the cache; an unfiltered
+ * chunk is read straight from the map into buffer.
+ *
+ * @param cache the chunk cache
+ * @param indices chunk indices
+ * @param nchunks number of chunks touched by the transfer
+ * @param buffer cache->chunksize bytes of caller memory
+ * @param datap return the chunk data: buffer or the cached data
+ * @return ::NC_NOERR | ::NC_EXXX
+ */
 int
-NCZ_write_cache_chunk(NCZChunkCache* cache, const size64_t* indices, void* content)
+NCZ_read_cache_wholechunk(NCZChunkCache* cache, const size64_t* indices, size_t nchunks, void* buffer, void** datap)
+{
+    int stat = NC_NOERR;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+    NCZCacheEntry* entry = NULL;
+    NCZPending* pending = NULL;
+    ncexhashkey_t hkey = 0;
+    char* path = NULL;
+    int filtered;
+    void* ptr = NULL;
+
+    hkey = cachekey(cache,indices);
+    if(nchunks <= cachecapacity(cache) || ncxcachelookup(cache->xcache,hkey,&ptr) == NC_NOERR
+       || ncxcachelookup(cache->wcombine.held,hkey,&ptr) == NC_NOERR)
+	return NCZ_read_cache_chunk(cache,indices,datap);
+
+    NCZ_stats_count(cache->stats,NCZ_STAT_MISS,1,0);
+    filtered = FILTERED(cache);
+    if((pending = findpending(cache,indices)) != NULL) {
+	/* Already being loaded; take it without caching it */
+	if((stat = claimpending(cache,pending,&entry))) goto done;
+    } else {
+	if((entry = calloc(1,sizeof(NCZCacheEntry)))==NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	memcpy(entry->indices,indices,cache->ndims*sizeof(size64_t));
+	entry->hashkey = hkey;
+	if(SHARDED(cache) || filtered) {
+	    if((stat = get_chunk(cache,entry))) goto done;
+	} else {
+	    if((stat = chunkpaths(cache,1,&entry,&path))) goto done;
+	    syncwrite(cache,indices);
+	    switch (stat = cacheread(cache,zfile->map,path,0,cache->chunksize,buffer)) {
+	    case NC_NOERR: break;
+	    case NC_EEMPTY:
+		memcpy(buffer,cache->fillchunk,cache->chunksize);
+		stat = NC_NOERR;
+		break;
+	    default: goto done;
+	    }
+	    free_cache_entry(cache,entry);
+	    entry = NULL;
+	}
+    }
+    if(entry != NULL) {
+	if(entry->size != cache->chunksize) {stat = NC_EINTERNAL; goto done;}
+	memcpy(buffer,entry->data,cache->chunksize);
+    }
+    if(datap) *datap = buffer;
+done:
+    nullfree(path);
+    if(entry) free_cache_entry(cache,entry);
+    return THROW(stat);
+}
+
+/**************************************************/
+/* Parallel chunk loading */
+
+/* Get the worker pool for the file containing this cache; create on demand */
+static struct NCZWorkers*
+getworkers(NCZChunkCache* cache)
+{
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+    if(zfile->workers == NULL && zfile->controls.nthreads > 1)
+	(void)NCZ_workers_new(zfile->controls.nthreads,&zfile->workers);
+    return zfile->workers;
+}
+
+/* Max no. of chunks allowed in flight; they are bounded by the cache limits */
+static size_t
+prefetchwindow(NCZChunkCache* cache, size_t nthreads)
+{
+    size_t window = (nthreads > 0 ? 2*nthreads : BATCHWINDOW);
+    if(cache->maxentries > 0 && window > cache->maxentries)
+	window = cache->maxentries;
+    if(cache->maxsize > 0 && cache->chunksize > 0 && window > (cache->maxsize / cache->chunksize))
+	window = (cache->maxsize / cache->chunksize);
+    return window;
+}
+
+/* Work function: executed by a worker thread */
+static int
+loadchunk(void* arg)
+{
+    int stat = NC_NOERR;
+    NCZPending* pending = (NCZPending*)arg;
+    if(!pending->fetched) {
+	/* Only unsharded chunks are read by workers; see NCZ_prefetch_cache_chunks */
+	if((stat = fetch_chunks(pending->cache,1,&pending->entry,&pending->path,&pending->empty))) goto done;
+    }
+    stat = finish_chunk(pending->cache,pending->entry,pending->empty);
+done:
+    return stat;
+}
+
+static NCZPending*
+findpending(NCZChunkCache* cache, const size64_t* indices)
+{
+    size_t i;
+    for(i=0;i<nclistlength(cache->pending);i++) {
+	NCZPending* p = (NCZPending*)nclistget(cache->pending,i);
+	if(memcmp(p->entry->indices,indices,sizeof(size64_t)*cache->ndims)==0)
+	    return p;
+    }
+    return NULL;
+}
+
+/* Wait for a pending load to complete and take ownership of its entry */
+static int
+claimpending(NCZChunkCache* cache, NCZPending* pending, NCZCacheEntry** entryp)
+{
+    int stat = NC_NOERR;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+
+    stat = NCZ_workers_wait(zfile->workers,&pending->work);
+    nclistelemremove(cache->pending,pending);
+    if(stat == NC_NOERR)
+	*entryp = pending->entry;
+    else
+	free_cache_entry(cache,pending->entry);
+    nullfree(pending->path);
+    free(pending);
+    return THROW(stat);
+}
+
+/* Wait for and discard all pending loads */
+static void
+drainpending(NCZChunkCache* cache)
+{
+    if(cache == NULL || cache->pending == NULL) return;
+    while(nclistlength(cache->pending) > 0) {
+	NCZCacheEntry* entry = NULL;
+	NCZPending* pending = (NCZPending*)nclistget(cache->pending,0);
+	if(claimpending(cache,pending,&entry) == NC_NOERR)
+	    free_cache_entry(cache,entry);
+    }
+}
+
+/**
+ * Start loading a sequence of chunks ahead of their use. Chunks
+ * already in the cache or already being loaded are ignored; loading
+ * stops when the number of chunks in flight reaches a limit derived
+ * from the number of threads and the cache constraints. Whenever
+ * this thread must do the reading itself (no worker threads, or a
+ * map that is not thread safe), the raw chunks are read with one
+ * batch read. The loaded chunks are inserted into the cache when
+ * NCZ_read_cache_chunk asks for them.
+ *
+ * @param cache the chunk cache
+ * @param n number of chunks in indices
+ * @param indices n*cache->ndims chunk indices in the order they will be read
+ * @return ::NC_NOERR | ::NC_ENOMEM
+ */
+int
+NCZ_prefetch_cache_chunks(NCZChunkCache* cache, size_t n, const size64_t* indices)
+{
+    int stat = NC_NOERR;
+    size_t i, window, nthreads;
+    int threadsafe;
+    struct NCZWorkers* workers = NULL;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+    NCZPending* pending = NULL;
+    NClist* todo = nclistnew(); /* NClist<NCZPending*> */
+    NCZCacheEntry** entries = NULL;
+    int* empties = NULL;
+
+    workers = getworkers(cache);
+    nthreads = NCZ_workers_count(workers);
+    window = prefetchwindow(cache,nthreads);
+    /* Without workers, there is no overlap to maintain, so only
+       start another batch once the previous one has been consumed */
+    if(nthreads == 0 && nclistlength(cache->pending) > 0) goto done;
+    /* Non-threadsafe maps are read by this thread; only the decode is parallel.
+       The same holds for shards since their indices are shared. */
+    threadsafe = ((nczmap_features(zfile->controls.mapimpl) & NCZM_THREADSAFE) ? 1 : 0);
+    if(SHARDED(cache)) threadsafe = 0;
+#ifdef ENABLE_NCZARR_FILTERS
+    /* Workers must not modify the filter state */
+    if(nthreads > 0 && (stat = NCZ_filter_prepare(file,cache->var))) goto done;
+#endif
+
+    /* Examine at most window chunks so that repeated calls are cheap */
+    for(i=0;i<n && i<window && nclistlength(cache->pending)+nclistlength(todo) < window;i++) {
+	const size64_t* chunkindices = indices + (i*cache->ndims);
+	ncexhashkey_t hkey = cachekey(cache,chunkindices);
+	void* ptr = NULL;
+	if(ncxcachelookup(cache->xcache,hkey,&ptr) == NC_NOERR) continue;
+	if(ncxcachelookup(cache->wcombine.held,hkey,&ptr) == NC_NOERR) continue;
+	if(findpending(cache,chunkindices) != NULL) continue;
+	/* The chunk must be read after any write of it */
+	syncwrite(cache,chunkindices);
+	if((pending = calloc(1,sizeof(NCZPending))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	if((pending->entry = calloc(1,sizeof(NCZCacheEntry))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	pending->cache = cache;
+	memcpy(pending->entry->indices,chunkindices,sizeof(size64_t)*cache->ndims);
+	pending->entry->hashkey = hkey;
+	nclistpush(todo,pending);
+	pending = NULL;
+    }
+    if(nclistlength(todo) == 0) goto done;
+
+    if(!threadsafe || nthreads == 0) {
+	size_t ntodo = nclistlength(todo);
+	if(SHARDED(cache)) {
+	    for(i=0;i<ntodo;i++) {
+		NCZPending* p = (NCZPending*)nclistget(todo,i);
+		stat = fetch_chunk(cache,p->entry,&p->empty);
+		if(stat != NC_NOERR && stat != NC_EEMPTY) goto done;
+		stat = NC_NOERR;
+	    }
+	} else {
+	    entries = (NCZCacheEntry**)calloc(ntodo,sizeof(NCZCacheEntry*));
+	    empties = (int*)calloc(ntodo,sizeof(int));
+	    if(entries == NULL || empties == NULL) {stat = NC_ENOMEM; goto done;}
+	    for(i=0;i<ntodo;i++) entries[i] = ((NCZPending*)nclistget(todo,i))->entry;
+	    if((stat = fetch_chunks(cache,ntodo,entries,NULL,empties))) goto done;
+	    for(i=0;i<ntodo;i++) ((NCZPending*)nclistget(todo,i))->empty = empties[i];
+	}
+	for(i=0;i<ntodo;i++) ((NCZPending*)nclistget(todo,i))->fetched = 1;
+    } else {
+	/* The workers will do the reading; build their keys here
+	   so that they need not touch the metadata */
+	for(i=0;i<nclistlength(todo);i++) {
+	    NCZPending* p = (NCZPending*)nclistget(todo,i);
+	    if((stat = chunkpaths(cache,1,&p->entry,&p->path))) goto done;
+	}
+    }
+
+    /* Hand off for decoding; without workers this decodes immediately */
+    while(nclistlength(todo) > 0) {
+	pending = (NCZPending*)nclistremove(todo,0);
+	pending->work.fcn = loadchunk;
+	pending->work.arg = pending;
+	nclistpush(cache->pending,pending);
+	if((stat = NCZ_workers_submit(workers,&pending->work))) {
+	    nclistpop(cache->pending);
+	    goto done;
+	}
+	pending = NULL;
+    }
+
+done:
+    if(pending) nclistpush(todo,pending);
+    for(i=0;i<nclistlength(todo);i++) {
+	pending = (NCZPending*)nclistget(todo,i);
+	free_cache_entry(cache,pending->entry);
+	nullfree(pending->path);
+	free(pending);
+    }
+    nclistfree(todo);
+    nullfree(entries);
+    nullfree(empties);
+    return THROW(stat);
+}
+
+/* Step indices to the next chunk in C order; return 0 when past the end of the grid */
+static int
+nextchunk(size_t rank, const size64_t* grid, size64_t* indices)
+{
+    size_t r;
+    for(r=rank;r-- > 0;) {
+	if(++indices[r] < grid[r]) return 1;
+	indices[r] = 0;
+    }
+    return 0;
+}
+
+/**
+ * Track the chunks read from a cache and, once the reads step
+ * through consecutive chunks, prefetch the next readahead.nchunks
+ * chunks. Consecutive means either the next chunk in C order
+ * (e.g. reading row by row) or the next chunk along a single
+ * dimension (e.g. reading a column of chunks).
+ * Re-reading the same chunk neither extends nor breaks a run.
+ */
+static int
+readahead(NCZChunkCache* cache, const size64_t* indices)
+{
+    int stat = NC_NOERR;
+    struct Readahead* ra = &cache->readahead;
+    NC_VAR_INFO_T* var = cache->var;
+    size_t r, n, nchanged, rank = var->ndims;
+    int dim = 0;
+    size64_t grid[NC_MAX_VAR_DIMS];
+    size64_t next[NC_MAX_VAR_DIMS];
+    size64_t* ahead = NULL;
+
+    if(ra->nchunks == 0 || rank == 0) goto done;
+    for(r=0;r<rank;r++)
+	grid[r] = ceildiv(var->dim[r]->len,var->chunksizes[r]);
+    if(ra->valid) {
+	if(memcmp(indices,ra->last,sizeof(size64_t)*rank)==0) goto done; /* same chunk */
+	memcpy(next,ra->last,sizeof(size64_t)*rank);
+	if(nextchunk(rank,grid,next) && memcmp(indices,next,sizeof(size64_t)*rank)==0)
+	    dim = -1;
+	else {
+	    for(nchanged=0,r=0;r<rank;r++) {
+		if(indices[r] == ra->last[r]) continue;
+		nchanged++;
+		dim = (int)r;
+	    }
+	    if(nchanged != 1 || indices[dim] != ra->last[dim]+1)
+		dim = -2; /* not sequential */
+	}
+	if(dim == -2 || (ra->run > 0 && dim != ra->dim))
+	    ra->run = 0;
+	if(dim != -2) {
+	    ra->dim = dim;
+	    ra->run++;
+	}
+    }
+    memcpy(ra->last,indices,sizeof(size64_t)*rank);
+    ra->valid = 1;
+    if(ra->run < READAHEADRUN) goto done;
+
+    if((ahead = (size64_t*)malloc(ra->nchunks*cache->ndims*sizeof(size64_t))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    memcpy(next,indices,sizeof(size64_t)*rank);
+    for(n=0;n<ra->nchunks;n++) {
+	if(ra->dim < 0) {
+	    if(!nextchunk(rank,grid,next)) break;
+	} else {
+	    if(next[ra->dim]+1 >= grid[ra->dim]) break;
+	    next[ra->dim]++;
+	}
+	memcpy(ahead+(n*cache->ndims),next,sizeof(size64_t)*cache->ndims);
+    }
+    if(n > 0)
+	stat = NCZ_prefetch_cache_chunks(cache,n,ahead);
+done:
+    nullfree(ahead);
+    return stat;
+}
+
+#if 0
+int
+NCZ_write_cache_chunk(NCZChunkCache* cache, const size64_t* indices, void* content)
 {
     int stat = NC_NOERR;
     int rank = cache->ndims;
@@ -302,14 +1127,13 @@ NCZ_write_cache_chunk(NCZChunkCache* cache, const size64_t* indices, void* conte
     ncexhashkey_t hkey;
     
     /* create the hash key */
-    hkey = ncxcachekey(indices,sizeof(size64_t)*cache->ndims);
+    hkey = cachekey(cache,indices);
 
     if(entry == NULL) { /*!found*/
 	/* Create a new entry */
 	if((entry = calloc(1,sizeof(NCZCacheEntry)))==NULL)
 	    {stat = NC_ENOMEM; goto done;}
 	memcpy(entry->indices,indices,rank*sizeof(size64_t));
-        if((stat = NCZ_buildchunkpath(cache,indices,&entry->key))) goto done;
         entry->hashkey = hkey;
 	/* Create the local copy space */
 	entry->size = cache->chunksize;
@@ -318,9 +1142,9 @@ NCZ_write_cache_chunk(NCZChunkCache* cache, const size64_t* indices, void* conte
 	memcpy(entry->data,content,cache->chunksize);
     }
     entry->modified = 1;
-    nclistpush(cache->mru,entry); /* MRU order */
+    if((stat = ncxcacheinsert(cache->xcache,entry->hashkey,entry))) goto done; /* MRU order */
 #ifdef DEBUG
-fprintf(stderr,"|cache.write|=%ld\n",nclistlength(cache->mru));
+fprintf(stderr,"|cache.write|=%ld\n",(long)ncxcachecount(cache->xcache));
 #endif
     entry = NULL;
 
@@ -328,7 +1152,7 @@ fprintf(stderr,"|cache.write|=%ld\n",nclistlength(cache->mru));
     if((stat=makeroom(cache))) goto done;
 
 done:
-    if(entry) free_cache_entry(entry);
+    if(entry) free_cache_entry(cache,entry);
     return THROW(stat);
 }
 #endif
@@ -340,7 +1164,7 @@ makeroom(NCZChunkCache* cache)
     int stat = NC_NOERR;
 
     /* Sanity check; make sure at least one entry is always allowed */
-    if(nclistlength(cache->mru) == 1)
+    if(ncxcachecount(cache->xcache) == 1)
 	goto done;
     stat = constraincache(cache);
 done:
@@ -366,256 +1190,1153 @@ static int
 constraincache(NCZChunkCache* cache)
 {
     int stat = NC_NOERR;
+    size_t i, nevicted = 0;
+    NClist* victims = nclistnew(); /* NClist<NCZCacheEntry*> */
+    NClist* dirty = nclistnew(); /* NClist<NCZCacheEntry*> */
 
-    /* Flush from LRU end if we are at capacity */
-    while(nclistlength(cache->mru) > cache->maxentries || cache->used > cache->maxsize) {
-	int i;
+    /* Remove entries from the LRU end until we are within capacity */
+    while(ncxcachecount(cache->xcache) > cache->maxentries || cache->used > cache->maxsize) {
 	void* ptr;
 	NCZCacheEntry* e = ncxcachelast(cache->xcache); /* last entry is the least recently used */
+	if(e == NULL) break;
         if((stat = ncxcacheremove(cache->xcache,e->hashkey,&ptr))) goto done;
 	assert(e == ptr);
-        for(i=0;i<nclistlength(cache->mru);i++) {
-	    e = nclistget(cache->mru,i);
-	    if(ptr == e) break;
-	}
-	assert(e != NULL);
-	assert(i >= 0 && i < nclistlength(cache->mru));
-	nclistremove(cache->mru,i);
-	if(e->modified) /* flush to file */
-	    stat=put_chunk(cache,e);
 	/* Decrement space used */
 	assert(cache->used >= e->size);
 	cache->used -= e->size;
-	/* reclaim */
-        nullfree(e->data); nullfree(e->key.varkey); nullfree(e->key.chunkkey); nullfree(e);
+	nevicted++;
+	/* Keep partly written chunks until they are completed, if possible */
+	if(e->written != NULL) {
+	    int held = 0;
+	    if((stat = hold_partial(cache,e)) == NC_NOERR) held = 1;
+	    else if(stat == NC_ENOMEM) stat = NC_NOERR; /* not held: write it out */
+	    else goto done;
+	    if(held) continue;
+	}
+	nclistpush(victims,e);
+	if(e->modified) nclistpush(dirty,e);
+    }
+    /* Flush the modified ones to file; unsharded chunks are encoded
+       in parallel and written as one batch */
+    if(nclistlength(dirty) > 0) {
+	if(SHARDED(cache)) {
+	    for(i=0;i<nclistlength(dirty);i++) {
+		int stat1 = put_chunk(cache,(NCZCacheEntry*)nclistget(dirty,i));
+		if(stat == NC_NOERR) stat = stat1;
+	    }
+	} else
+	    stat = put_chunks(cache,nclistlength(dirty),(NCZCacheEntry**)nclistcontents(dirty),1);
     }
 #ifdef DEBUG
-fprintf(stderr,"|cache.makeroom|=%ld\n",nclistlength(cache->mru));
+fprintf(stderr,"|cache.makeroom|=%ld\n",(long)ncxcachecount(cache->xcache));
 #endif
 done:
+    NCZ_stats_count(cache->stats,NCZ_STAT_EVICT,nevicted,0);
+    /* reclaim */
+    for(i=0;i<nclistlength(victims);i++)
+        free_cache_entry(cache,(NCZCacheEntry*)nclistget(victims,i));
+    nclistfree(victims);
+    nclistfree(dirty);
     return stat;
 }
 
+/* The xcache holds one entry per hash key, so a chunk whose indices
+   hash to the same key as a cached chunk evicts it; the new chunk is
+   then an ordinary miss. Such collisions are rare enough that the
+   two chunks thrashing does not matter. */
+static int
+evict_collision(NCZChunkCache* cache, NCZCacheEntry* entry)
+{
+    int stat = NC_NOERR;
+    void* ptr;
+
+    if((stat = ncxcacheremove(cache->xcache,entry->hashkey,&ptr))) goto done;
+    assert(entry == ptr);
+    assert(cache->used >= entry->size);
+    cache->used -= entry->size;
+    NCZ_stats_count(cache->stats,NCZ_STAT_EVICT,1,0);
+    /* Keep a partly written chunk until it is completed, if possible */
+    if(entry->written != NULL) {
+	if((stat = hold_partial(cache,entry)) == NC_NOERR) goto done;
+	if(stat != NC_ENOMEM) goto done;
+	stat = NC_NOERR; /* not held: write it out */
+    }
+    if(entry->modified) {
+	if(SHARDED(cache))
+	    stat = put_chunk(cache,entry);
+	else
+	    stat = put_chunks(cache,1,&entry,1);
+    }
+    free_cache_entry(cache,entry);
+done:
+    return THROW(stat);
+}
+
 int
 NCZ_flush_chunk_cache(NCZChunkCache* cache)
 {
     int stat = NC_NOERR;
-    size_t i;
+    size_t i, nentries = 0;
+    NCZCacheEntry** entries = NULL;
+    NClist* dirty = nclistnew();
 
-    ZTRACE(4,"cache.var=%s |cache|=%d",cache->var->hdr.name,(int)nclistlength(cache->mru));
+    ZTRACE(4,"cache.var=%s |cache|=%d",cache->var->hdr.name,(int)ncxcachecount(cache->xcache));
 
+    if((stat = flush_held(cache))) goto done;
     if(NCZ_cache_size(cache) == 0) goto done;
+
+    /* Write each modified shard once */
+    if(SHARDED(cache)) {
+	stat = flush_shards(cache);
+	goto done;
+    }
     
-    /* Iterate over the entries in hashmap */
-    for(i=0;i<nclistlength(cache->mru);i++) {
-        NCZCacheEntry* entry = nclistget(cache->mru,i);
-        if(entry->modified) {
-	    /* Write out this chunk in toto*/
-  	    if((stat=put_chunk(cache,entry)))
-	        goto done;
+    /* Collect the modified entries and write them as one batch */
+    if((stat = lruentries(cache,&nentries,&entries))) goto done;
+    for(i=0;i<nentries;i++) {
+        if(entries[i]->modified) nclistpush(dirty,entries[i]);
+    }
+    if(nclistlength(dirty) > 0) {
+	size64_t before = 0, after = 0;
+	for(i=0;i<nclistlength(dirty);i++)
+	    before += ((NCZCacheEntry*)nclistget(dirty,i))->size;
+	if((stat = put_chunks(cache,nclistlength(dirty),(NCZCacheEntry**)nclistcontents(dirty),0)))
+	    goto done;
+	for(i=0;i<nclistlength(dirty);i++) {
+	    NCZCacheEntry* e = (NCZCacheEntry*)nclistget(dirty,i);
+	    e->modified = 0;
+	    after += e->size;
 	}
-        entry->modified = 0;
+	/* The written chunks stay cached in their encoded form */
+	cache->used = (cache->used - before) + after;
     }
 
 done:
+    /* Writes started earlier must be complete, and their errors reported */
+    {int stat1 = drainwrites(cache); if(stat == NC_NOERR) stat = stat1;}
+    nullfree(entries);
+    nclistfree(dirty);
     return ZUNTRACE(stat);
 }
 
-#if 0
+/* A chunk that was flushed is left encoded until it is used again */
+static int
+decode_cached(NCZChunkCache* cache, NCZCacheEntry* entry)
+{
+    int stat = NC_NOERR;
+    size64_t size = entry->size;
+
+    if(!entry->isfiltered) goto done;
+    if((stat = finish_chunk(cache,entry,0))) goto done;
+    cache->used = (cache->used - size) + entry->size;
+done:
+    return THROW(stat);
+}
+
+/* Return the entries of a cache from least to most recently used;
+   this is the order in which they were last touched. */
+static int
+lruentries(NCZChunkCache* cache, size_t* np, NCZCacheEntry*** entriesp)
+{
+    size_t i, n = ncxcachecount(cache->xcache);
+    NCxnode* lru = &cache->xcache->lru;
+    NCxnode* p;
+    NCZCacheEntry** entries = NULL;
+
+    if((entries = (NCZCacheEntry**)calloc(n+1,sizeof(NCZCacheEntry*))) == NULL)
+	return NC_ENOMEM;
+    for(i=0,p=lru->prev;p != lru;p=p->prev,i++) {
+	assert(i < n);
+	entries[i] = (NCZCacheEntry*)p->content;
+    }
+    *np = n;
+    *entriesp = entries;
+    return NC_NOERR;
+}
+
+/* Mark a cached chunk as changed, so it is written when it is
+   flushed or evicted; a chunk read from the map is otherwise clean */
 int
 NCZ_chunk_cache_modified(NCZChunkCache* cache, const size64_t* indices)
 {
     int stat = NC_NOERR;
-    char* key = NULL;
     NCZCacheEntry* entry = NULL;
-    int rank = cache->ndims;
-
-    /* Create the key for this cache */
-    if((stat=NCZ_buildchunkkey(rank, indices, &key))) goto done;
+    ncexhashkey_t hkey;
 
-    /* See if already in cache */
-    if(NC_hashmapget(cache->mru, key, strlen(key), (uintptr_t*)entry)) { /* found */
-	entry->modified = 1;
+    hkey = cachekey(cache,indices);
+    switch (stat = ncxcachelookup(cache->xcache,hkey,(void**)&entry)) {
+    case NC_NOERR:
+	/* Another chunk with the same hash key is not this one */
+	if(memcmp(entry->indices,indices,sizeof(size64_t)*cache->ndims) == 0)
+	    entry->modified = 1;
+	break;
+    case NC_ENOOBJECT: stat = NC_NOERR; break; /* already written out */
+    default: break;
     }
-
-done:
-    nullfree(key);
     return THROW(stat);
 }
-#endif
 
 /**************************************************/
+/* Write combining */
+
 /*
-From Zarr V2 Specification:
-"The compressed sequence of bytes for each chunk is stored under
-a key formed from the index of the chunk within the grid of
-chunks representing the array.  To form a string key for a
-chunk, the indices are converted to strings and concatenated
-with the dimension_separator character ('.' or '/') separating
-each index. For example, given an array with shape (10000,
-10000) and chunk shape (1000, 1000) there will be 100 chunks
-laid out in a 10 by 10 grid. The chunk with indices (0, 0)
-provides data for rows 0-1000 and columns 0-1000 and is stored
-under the key "0.0"; the chunk with indices (2, 4) provides data
-for rows 2000-3000 and columns 4000-5000 and is stored under the
-key "2.4"; etc."
+A write into part of a chunk that is not cached would normally
+read (and decode) the stored chunk, only for the rest of the chunk
+to be overwritten soon after. Instead, the chunk is created from
+the fill chunk, and the elements written into it are recorded in
+a bitmap, entry->written. Once every element has been written the
+stored chunk is irrelevant and is never read. Otherwise the stored
+chunk is read and merged in (materialized) when the chunk is read,
+or just before it is written out. A partial entry evicted from the
+LRU is held aside, up to wcombine.limit bytes, so later writes can
+still complete it.
 */
 
-/**
- * @param R Rank
- * @param chunkindices The chunk indices
- * @param dimsep the dimension separator
- * @param keyp Return the chunk key string
- */
-int
-NCZ_buildchunkkey(size_t R, const size64_t* chunkindices, char dimsep, char** keyp)
-{
-    int stat = NC_NOERR;
-    int r;
-    NCbytes* key = ncbytesnew();
+/* Test bit i of a written bitmap */
+#define WCBIT(written,i) ((written)[(i)>>3] & (1<<((i)&7)))
 
-    if(keyp) *keyp = NULL;
+/* Set bit i; return 1 if it was not yet set */
+static size64_t
+setwritten(NCZCacheEntry* entry, size64_t i)
+{
+    if(WCBIT(entry->written,i)) return 0;
+    entry->written[i>>3] |= (unsigned char)(1<<(i&7));
+    return 1;
+}
 
-    assert(islegaldimsep(dimsep));
-    
-    for(r=0;r<R;r++) {
-	char sindex[64];
-        if(r > 0) ncbytesappend(key,dimsep);
-	/* Print as decimal with no leading zeros */
-	snprintf(sindex,sizeof(sindex),"%lu",(unsigned long)chunkindices[r]);	
-	ncbytescat(key,sindex);
-    }
-    ncbytesnull(key);
-    if(keyp) *keyp = ncbytesextract(key);
+static size_t
+wclimit(NCZChunkCache* cache)
+{
+    return (cache->wcombine.limit == NCZ_WCOMBINE_CACHESIZE ? cache->maxsize : cache->wcombine.limit);
+}
 
-    ncbytesfree(key);
-    return THROW(stat);
+/* The key of a chunk in the xcache and in the held entries */
+static ncexhashkey_t
+cachekey(NCZChunkCache* cache, const size64_t* indices)
+{
+    return ncxcachekey(indices,sizeof(size64_t)*cache->ndims) & cache->keymask;
 }
 
-/**
- * @internal Push data to chunk of a file.
- * If chunk does not exist, create it
- *
- * @param file Pointer to file info struct.
- * @param proj Chunk projection
- * @param datalen size of data
- * @param data Buffer containing the chunk data to write
- *
- * @return ::NC_NOERR No error.
- * @author Dennis Heimbigner
- */
-static int
-put_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
+/* Partial entries are only used where a chunk is a plain array of
+   fixed size elements in its own map object */
+int
+NCZ_cache_combining(NCZChunkCache* cache)
 {
-    int stat = NC_NOERR;
-    NC_FILE_INFO_T* file = NULL;
-    NCZ_FILE_INFO_T* zfile = NULL;
-    NCZMAP* map = NULL;
-    char* path = NULL;
+    NC_VAR_INFO_T* var = cache->var;
+    NC_FILE_INFO_T* file = (var->container)->nc4_info;
+    NCZ_VAR_INFO_T* zvar = (NCZ_VAR_INFO_T*)var->format_var_info;
 
-    ZTRACE(5,"cache.var=%s entry.key=%s",cache->var->hdr.name,entry->key);
-    LOG((3, "%s: var: %p", __func__, cache->var));
+    return (wclimit(cache) > 0 && !file->no_write && !zvar->scalar && !SHARDED(cache)
+	    && cache->fillchunk != NULL && var->type_info->hdr.id != NC_STRING);
+}
 
-    file = (cache->var->container)->nc4_info;
-    zfile = file->format_file_info;
-    map = zfile->map;
+/* Elements past the current end of a dimension have never been
+   written, so the stored chunk holds fill there as well */
+static void
+markoutside(NCZChunkCache* cache, NCZCacheEntry* entry, size_t r, size64_t offset, int outside)
+{
+    size64_t i;
+    size64_t chunklen = cache->var->chunksizes[r];
+    size64_t dimlen = cache->var->dim[r]->len;
+    size64_t first = entry->indices[r] * chunklen;
+    size64_t extent = (dimlen <= first ? 0 : dimlen - first);
+
+    for(i=0;i<chunklen;i++) {
+	size64_t pos = offset*chunklen + i;
+	int out = (outside || i >= extent);
+	if(r+1 < cache->ndims)
+	    markoutside(cache,entry,r+1,pos,out);
+	else if(out)
+	    entry->nwritten += setwritten(entry,pos);
+    }
+}
 
-#ifdef ENABLE_NCZARR_FILTERS
-    /* Make sure the entry is in filtered state */
-    if(!entry->isfiltered) {
-        NC_VAR_INFO_T* var = cache->var;
-        void* filtered = NULL; /* pointer to the filtered data */
-	size_t flen; /* length of filtered data */
-	/* Get the filter chain to apply */
-	NClist* filterchain = (NClist*)var->filters;
-	if(nclistlength(filterchain) > 0) {
-	    /* Apply the filter chain to get the filtered data */
-	    if((stat = NCZ_applyfilterchain(file,var,filterchain,entry->size,entry->data,&flen,&filtered,ENCODING))) goto done;
-	    /* Fix up the cache entry */
-	    /* Note that if filtered is different from entry->data, then entry->data will have been freed */
-	    entry->data = filtered;
- 	    entry->size = flen;
-            entry->isfiltered = 1;
-	}
+static void
+markslices(NCZChunkCache* cache, NCZCacheEntry* entry, const NCZSlice* slices, size_t r, size64_t offset)
+{
+    size64_t i;
+    size64_t chunklen = cache->var->chunksizes[r];
+
+    for(i=slices[r].start;i<slices[r].stop;i+=slices[r].stride) {
+	size64_t pos = offset*chunklen + i;
+	if(r+1 < cache->ndims)
+	    markslices(cache,entry,slices,r+1,pos);
+	else
+	    entry->nwritten += setwritten(entry,pos);
     }
-#endif
+}
+
+/* Record a write of slices (NULL => all) into a partial entry */
+static void
+mark_written(NCZChunkCache* cache, NCZCacheEntry* entry, const NCZSlice* slices)
+{
+    size64_t nelems = cache->chunksize / cache->var->type_info->size;
+
+    if(entry->written == NULL) return;
+    if(slices != NULL)
+	markslices(cache,entry,slices,0,0);
+    if(slices == NULL || entry->nwritten == nelems) {
+	/* Complete; whatever was stored is overwritten */
+	nullfree(entry->written);
+	entry->written = NULL;
+	entry->nwritten = 0;
+	entry->stored = 1; /* may be; only matters for dropping fill chunks */
+    }
+}
 
-    path = NCZ_chunkpath(entry->key);
-    stat = nczmap_write(map,path,0,entry->size,entry->data);
-    nullfree(path); path = NULL;
+/* Create an entry of fill for a chunk that is written but not read */
+static int
+partial_entry(NCZChunkCache* cache, const size64_t* indices, ncexhashkey_t hkey, NCZCacheEntry** entryp)
+{
+    int stat = NC_NOERR;
+    NCZCacheEntry* entry = NULL;
+    size64_t r, nelems = cache->chunksize / cache->var->type_info->size;
+    int edge = 0;
 
-    switch(stat) {
-    case NC_NOERR:
-	break;
-    case NC_EEMPTY:
-    default: goto done;
+    if((entry = calloc(1,sizeof(NCZCacheEntry)))==NULL)
+	{stat = NC_ENOMEM; goto done;}
+    memcpy(entry->indices,indices,cache->ndims*sizeof(size64_t));
+    entry->hashkey = hkey;
+    entry->size = cache->chunksize;
+    if((entry->data = alloc_chunk_buffer(cache)) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    memcpy(entry->data,cache->fillchunk,entry->size);
+    if((entry->written = calloc(1,(nelems/8)+1)) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(r=0;r<cache->ndims;r++) {
+	if((indices[r]+1) * cache->var->chunksizes[r] > cache->var->dim[r]->len) edge = 1;
     }
+    if(edge) markoutside(cache,entry,0,0,0);
+    if(entryp) {*entryp = entry; entry = NULL;}
 done:
-    nullfree(path);
-    return ZUNTRACE(stat);
+    free_cache_entry(cache,entry);
+    return THROW(stat);
 }
 
-/**
- * @internal Push data from memory to file.
- *
- * @param cache Pointer to parent cache
- * @param key chunk key
- * @param entry cache entry to read into
- *
- * @return ::NC_NOERR No error.
- * @author Dennis Heimbigner
- */
+/* Merge the stored chunk, if any, into the unwritten part of a partial entry */
 static int
-get_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
+materialize(NCZChunkCache* cache, NCZCacheEntry* entry)
 {
     int stat = NC_NOERR;
-    NCZMAP* map = NULL;
-    NC_FILE_INFO_T* file = NULL;
-    NCZ_FILE_INFO_T* zfile = NULL;
-    size64_t size;
+    NCZCacheEntry* stored = NULL;
+    size_t typesize = cache->var->type_info->size;
+    size64_t i, nelems = cache->chunksize / typesize;
     int empty = 0;
-    char* path = NULL;
-
-    ZTRACE(5,"cache.var=%s entry.key=%s sep=%d",cache->var->hdr.name,entry->key,cache->dimension_separator);
-    
-    LOG((3, "%s: file: %p", __func__, file));
 
-    file = (cache->var->container)->nc4_info;
-    zfile = file->format_file_info;
-    map = zfile->map;
-    assert(map);
-
-    /* get size of the "raw" data on "disk" */
-    path = NCZ_chunkpath(entry->key);
-    stat = nczmap_len(map,path,&size);
-    nullfree(path); path = NULL;
-    switch(stat) {
+    if(entry->written == NULL) goto done;
+    if((stored = calloc(1,sizeof(NCZCacheEntry)))==NULL)
+	{stat = NC_ENOMEM; goto done;}
+    memcpy(stored->indices,entry->indices,cache->ndims*sizeof(size64_t));
+    stored->hashkey = entry->hashkey;
+    switch (stat = fetch_chunk(cache,stored,&empty)) {
     case NC_NOERR: break;
-    case NC_EEMPTY: empty = 1; stat = NC_NOERR; break;
+    case NC_EEMPTY: stat = NC_NOERR; break;
     default: goto done;
     }
-
     if(!empty) {
-        /* Make sure we have a place to read it */
-        entry->size = size;
-        entry->isfiltered = FILTERED(cache); /* Is the data being read filtered? */
-        if((entry->data = (void*)malloc(entry->size)) == NULL)
-            {stat = NC_ENOMEM; goto done;}
-	/* Read the raw data */
-        path = NCZ_chunkpath(entry->key);
-        stat = nczmap_read(map,path,0,entry->size,(char*)entry->data);
-        nullfree(path); path = NULL;
-        switch (stat) {
-        case NC_NOERR: break;
-        case NC_EEMPTY: empty = 1; stat = NC_NOERR;break;
-	default: goto done;
+	unsigned char* dst = (unsigned char*)entry->data;
+	const unsigned char* src;
+	if((stat = finish_chunk(cache,stored,0))) goto done;
+	if(stored->size != cache->chunksize) {stat = NC_EINTERNAL; goto done;}
+	src = (const unsigned char*)stored->data;
+	for(i=0;i<nelems;i++) {
+	    if(!WCBIT(entry->written,i))
+		memcpy(dst+(i*typesize),src+(i*typesize),typesize);
+	}
+    }
+    entry->stored = !empty;
+    nullfree(entry->written);
+    entry->written = NULL;
+    entry->nwritten = 0;
+done:
+    free_cache_entry(cache,stored);
+    return THROW(stat);
+}
+
+/* Hold an evicted partial entry; NC_ENOMEM => it does not fit */
+static int
+hold_partial(NCZChunkCache* cache, NCZCacheEntry* entry)
+{
+    int stat = NC_NOERR;
+    void* ptr = NULL;
+
+    if(cache->wcombine.used + entry->size > wclimit(cache))
+	return NC_ENOMEM;
+    if(cache->wcombine.held == NULL && (stat = ncxcachenew(LEAFLEN,&cache->wcombine.held)))
+	goto done;
+    /* Another chunk with the same hash key is already held */
+    if(ncxcachelookup(cache->wcombine.held,entry->hashkey,&ptr) == NC_NOERR)
+	return NC_ENOMEM;
+    if((stat = ncxcacheinsert(cache->wcombine.held,entry->hashkey,entry))) goto done;
+    cache->wcombine.used += entry->size;
+done:
+    return stat;
+}
+
+/* Remove and return the held partial entry for a chunk, if any */
+static NCZCacheEntry*
+take_held(NCZChunkCache* cache, const size64_t* indices, ncexhashkey_t hkey)
+{
+    NCZCacheEntry* entry = NULL;
+    void* ptr = NULL;
+
+    if(cache->wcombine.held == NULL) return NULL;
+    if(ncxcachelookup(cache->wcombine.held,hkey,(void**)&entry) != NC_NOERR) return NULL;
+    if(memcmp(entry->indices,indices,sizeof(size64_t)*cache->ndims) != 0) return NULL;
+    if(ncxcacheremove(cache->wcombine.held,hkey,&ptr) != NC_NOERR) return NULL;
+    assert(ptr == entry);
+    cache->wcombine.used -= entry->size;
+    return entry;
+}
+
+/* Complete and write out all held partial entries */
+static int
+flush_held(NCZChunkCache* cache)
+{
+    int stat = NC_NOERR;
+    size_t i, n;
+    NCZCacheEntry** entries = NULL;
+
+    if(cache->wcombine.held == NULL || (n = ncxcachecount(cache->wcombine.held)) == 0)
+	goto done;
+    if((entries = (NCZCacheEntry**)calloc(n,sizeof(NCZCacheEntry*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<n;i++) {
+	void* ptr;
+	entries[i] = ncxcachelast(cache->wcombine.held);
+	if((stat = ncxcacheremove(cache->wcombine.held,entries[i]->hashkey,&ptr))) goto done;
+	assert(ptr == entries[i]);
+    }
+    cache->wcombine.used = 0;
+    stat = put_chunks(cache,n,entries,1);
+done:
+    if(entries != NULL) {
+	for(i=0;i<n;i++) free_cache_entry(cache,entries[i]);
+	free(entries);
+    }
+    return THROW(stat);
+}
+
+static void
+free_held(NCZChunkCache* cache)
+{
+    NCZCacheEntry* entry;
+
+    if(cache->wcombine.held == NULL) return;
+    while((entry = ncxcachelast(cache->wcombine.held)) != NULL) {
+	void* ptr;
+	(void)ncxcacheremove(cache->wcombine.held,entry->hashkey,&ptr);
+	assert(ptr == entry);
+	free_cache_entry(cache,entry);
+    }
+    ncxcachefree(cache->wcombine.held);
+    cache->wcombine.held = NULL;
+    cache->wcombine.used = 0;
+}
+
+/**
+ * Get a chunk that is about to be written into, and mark it modified.
+ * A chunk that is not cached is not read first; it starts out as
+ * fill, and the stored chunk is merged in later only if slices
+ * turn out not to cover it.
+ *
+ * @param cache the chunk cache
+ * @param indices chunk indices
+ * @param slices the part of the chunk to be written; NULL => all of it
+ * @param datap return the chunk data
+ * @return ::NC_NOERR | ::NC_EXXX
+ */
+int
+NCZ_modify_cache_chunk(NCZChunkCache* cache, const size64_t* indices, const NCZSlice* slices, void** datap)
+{
+    int stat = NC_NOERR;
+    NCZCacheEntry* entry = NULL;
+    ncexhashkey_t hkey = 0;
+    NCZPending* pending = NULL;
+
+    if(!NCZ_cache_combining(cache)) {
+	switch (stat = NCZ_read_cache_chunk(cache,indices,datap)) {
+	case NC_NOERR: case NC_EEMPTY: break;
+	default: return THROW(stat);
+	}
+	return THROW(NCZ_chunk_cache_modified(cache,indices));
+    }
+
+    hkey = cachekey(cache,indices);
+    switch (stat = ncxcachelookup(cache->xcache,hkey,(void**)&entry)) {
+    case NC_NOERR:
+	if(memcmp(entry->indices,indices,sizeof(size64_t)*cache->ndims) != 0) {
+	    stat = evict_collision(cache,entry);
+	    entry = NULL;
+	    if(stat) goto done;
+	    break;
+	}
+	NCZ_stats_count(cache->stats,NCZ_STAT_HIT,1,0);
+	(void)ncxcachetouch(cache->xcache,hkey);
+	if((stat = decode_cached(cache,entry))) {entry = NULL; goto done;}
+	mark_written(cache,entry,slices);
+	entry->modified = 1;
+	if(datap) *datap = entry->data;
+	entry = NULL;
+	goto done;
+    case NC_ENOOBJECT:
+	stat = NC_NOERR;
+	entry = NULL;
+	break;
+    default: goto done;
+    }
+
+    if((entry = take_held(cache,indices,hkey)) != NULL) {
+	NCZ_stats_count(cache->stats,NCZ_STAT_HIT,1,0);
+    } else if((pending = findpending(cache,indices)) != NULL) {
+	/* Already being loaded */
+	NCZ_stats_count(cache->stats,NCZ_STAT_MISS,1,0);
+	if((stat = claimpending(cache,pending,&entry))) goto done;
+    } else {
+	NCZ_stats_count(cache->stats,NCZ_STAT_MISS,1,0);
+	if((stat = partial_entry(cache,indices,hkey,&entry))) goto done;
+    }
+    mark_written(cache,entry,slices);
+    entry->modified = 1;
+    if((stat = ncxcacheinsert(cache->xcache,entry->hashkey,entry))) goto done;
+    cache->used += entry->size;
+    if(datap) *datap = entry->data;
+    entry = NULL;
+    /* The entry being returned is the most recently used, so it stays */
+    if((stat=makeroom(cache))) goto done;
+done:
+    if(entry) free_cache_entry(cache,entry);
+    return THROW(stat);
+}
+
+/**************************************************/
+/* Write behind */
+
+/*
+With a write behind limit, the chunks written out of the cache
+are encoded as usual and then written by the worker threads, so
+the caller need not wait for the storage. At most limit bytes of
+writes may be in progress; past that the caller waits for the
+oldest ones. A chunk is never read, removed or written again while
+a write of it is in progress. The first error of a write is kept
+and returned by the next flush, i.e. the next nc_sync or nc_close.
+All this happens in the calling thread; the workers only write.
+*/
+
+/* Work function: write one chunk; executed by a worker thread */
+static int
+writechunk(void* arg)
+{
+    NCZPending* job = (NCZPending*)arg;
+    NC_FILE_INFO_T* file = (job->cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+    return cachewrite(job->cache,zfile->map,job->path,0,job->entry->size,job->entry->data);
+}
+
+/* Writes are only handed off to threads that can do them concurrently */
+static int
+writingbehind(NCZChunkCache* cache)
+{
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+
+    if(cache->writebehind.limit == 0 || SHARDED(cache)) return 0;
+    if(!(nczmap_features(zfile->controls.mapimpl) & NCZM_THREADSAFE)) return 0;
+    return (NCZ_workers_count(getworkers(cache)) > 0);
+}
+
+/* Wait for the i'th write in progress and reclaim it */
+static void
+finishwrite(NCZChunkCache* cache, size_t i)
+{
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+    NCZPending* job = (NCZPending*)nclistremove(cache->writebehind.jobs,i);
+    int stat = NCZ_workers_wait(zfile->workers,&job->work);
+
+    if(stat != NC_NOERR && cache->writebehind.stat == NC_NOERR)
+	cache->writebehind.stat = stat;
+    assert(cache->writebehind.used >= job->entry->size);
+    cache->writebehind.used -= job->entry->size;
+    if(job->borrowed) job->entry->data = NULL;
+    free_cache_entry(cache,job->entry);
+    nullfree(job->path);
+    free(job);
+}
+
+/* Reclaim the completed writes at the front of the queue, and wait
+   for more until there is room for need more bytes; all => wait for all */
+static void
+reapwrites(NCZChunkCache* cache, size_t need, int all)
+{
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+
+    while(nclistlength(cache->writebehind.jobs) > 0) {
+	NCZPending* job = (NCZPending*)nclistget(cache->writebehind.jobs,0);
+	if(!all && cache->writebehind.used + need <= cache->writebehind.limit
+	   && !NCZ_workers_isdone(zfile->workers,&job->work))
+	    break;
+	finishwrite(cache,0);
+    }
+}
+
+/* Wait for any write in progress of a chunk */
+static void
+syncwrite(NCZChunkCache* cache, const size64_t* indices)
+{
+    size_t i;
+
+    for(i=0;i<nclistlength(cache->writebehind.jobs);) {
+	NCZPending* job = (NCZPending*)nclistget(cache->writebehind.jobs,i);
+	if(memcmp(job->entry->indices,indices,sizeof(size64_t)*cache->ndims) == 0)
+	    finishwrite(cache,i);
+	else
+	    i++;
+    }
+}
+
+/* Wait for all writes in progress; return the first error of any write */
+static int
+drainwrites(NCZChunkCache* cache)
+{
+    int stat;
+
+    reapwrites(cache,0,1);
+    stat = cache->writebehind.stat;
+    cache->writebehind.stat = NC_NOERR;
+    return THROW(stat);
+}
+
+/* Start writing an encoded entry to path, which the write then owns;
+   release => the data is taken from the entry, else it is borrowed */
+static int
+queuewrite(NCZChunkCache* cache, NCZCacheEntry* entry, char* path, int release)
+{
+    int stat = NC_NOERR;
+    NCZPending* job = NULL;
+
+    reapwrites(cache,(size_t)entry->size,0);
+    if((job = calloc(1,sizeof(NCZPending))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((job->entry = calloc(1,sizeof(NCZCacheEntry))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    memcpy(job->entry->indices,entry->indices,sizeof(size64_t)*cache->ndims);
+    job->entry->hashkey = entry->hashkey;
+    job->entry->size = entry->size;
+    job->entry->isfiltered = entry->isfiltered;
+    job->entry->data = entry->data;
+    if(release) entry->data = NULL; else job->borrowed = 1;
+    job->cache = cache;
+    job->path = path;
+    job->work.fcn = writechunk;
+    job->work.arg = job;
+    nclistpush(cache->writebehind.jobs,job);
+    cache->writebehind.used += job->entry->size;
+    if((stat = NCZ_workers_submit(getworkers(cache),&job->work))) {
+	/* Never started; give everything back */
+	nclistpop(cache->writebehind.jobs);
+	cache->writebehind.used -= job->entry->size;
+	if(release) entry->data = job->entry->data;
+	job->entry->data = NULL;
+	job->path = NULL;
+	goto done;
+    }
+    job = NULL;
+done:
+    if(job) {
+	free_cache_entry(cache,job->entry);
+	free(job);
+    }
+    return THROW(stat);
+}
+
+/**************************************************/
+/*
+From Zarr V2 Specification:
+"The compressed sequence of bytes for each chunk is stored under
+a key formed from the index of the chunk within the grid of
+chunks representing the array.  To form a string key for a
+chunk, the indices are converted to strings and concatenated
+with the dimension_separator character ('.' or '/') separating
+each index. For example, given an array with shape (10000,
+10000) and chunk shape (1000, 1000) there will be 100 chunks
+laid out in a 10 by 10 grid. The chunk with indices (0, 0)
+provides data for rows 0-1000 and columns 0-1000 and is stored
+under the key "0.0"; the chunk with indices (2, 4) provides data
+for rows 2000-3000 and columns 4000-5000 and is stored under the
+key "2.4"; etc."
+*/
+
+/**
+ * @param R Rank
+ * @param chunkindices The chunk indices
+ * @param dimsep the dimension separator
+ * @param keyp Return the chunk key string
+ */
+int
+NCZ_buildchunkkey(size_t R, const size64_t* chunkindices, char dimsep, char** keyp)
+{
+    int stat = NC_NOERR;
+    int r;
+    NCbytes* key = ncbytesnew();
+
+    if(keyp) *keyp = NULL;
+
+    assert(islegaldimsep(dimsep));
+    
+    for(r=0;r<R;r++) {
+	char sindex[64];
+        if(r > 0) ncbytesappend(key,dimsep);
+	/* Print as decimal with no leading zeros */
+	snprintf(sindex,sizeof(sindex),"%lu",(unsigned long)chunkindices[r]);	
+	ncbytescat(key,sindex);
+    }
+    ncbytesnull(key);
+    if(keyp) *keyp = ncbytesextract(key);
+
+    ncbytesfree(key);
+    return THROW(stat);
+}
+
+/**
+ * @internal Make sure the entry is in filtered state
+ * before it is written.
+ *
+ * @param cache Pointer to parent cache
+ * @param entry cache entry
+ *
+ * @return ::NC_NOERR No error.
+ */
+static int
+encode_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
+{
+    int stat = NC_NOERR;
+#ifdef ENABLE_NCZARR_FILTERS
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    if(!entry->isfiltered && !entry->isfill) {
+        NC_VAR_INFO_T* var = cache->var;
+        void* filtered = NULL; /* pointer to the filtered data */
+	size_t flen; /* length of filtered data */
+	/* Get the filter chain to apply */
+	NClist* filterchain = (NClist*)var->filters;
+	if(nclistlength(filterchain) > 0) {
+	    double start = NCZ_stats_clock();
+	    /* Apply the filter chain to get the filtered data */
+	    stat = NCZ_applyfilterchain(file,var,filterchain,entry->size,entry->data,&flen,&filtered,ENCODING);
+	    NCZ_stats_time(cache->stats,NCZ_STAT_ENCODE,NCZ_stats_clock() - start);
+	    if(stat) goto done;
+	    /* Fix up the cache entry */
+	    /* Note that if filtered is different from entry->data, then entry->data will have been freed */
+	    entry->data = filtered;
+ 	    entry->size = flen;
+            entry->isfiltered = 1;
+	}
+    }
+done:
+#endif
+    return THROW(stat);
+}
+
+/**
+ * @internal Push data to chunk of a file.
+ * If chunk does not exist, create it
+ *
+ * @param file Pointer to file info struct.
+ * @param proj Chunk projection
+ * @param datalen size of data
+ * @param data Buffer containing the chunk data to write
+ *
+ * @return ::NC_NOERR No error.
+ * @author Dennis Heimbigner
+ */
+static int
+put_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
+{
+    int stat = NC_NOERR;
+
+    ZTRACE(5,"cache.var=%s",cache->var->hdr.name);
+    LOG((3, "%s: var: %p", __func__, cache->var));
+
+    if(SHARDED(cache)) {
+	markfill(cache,1,&entry);
+	if((stat = encode_chunk(cache,entry))) goto done;
+	stat = put_shard(cache,NULL,1,&entry);
+    } else
+	stat = put_chunks(cache,1,&entry,0);
+done:
+    return ZUNTRACE(stat);
+}
+
+/**
+ * @internal Encode and write a set of chunks with a single batch
+ * write.
+ *
+ * @param cache Pointer to parent cache
+ * @param n number of entries
+ * @param entries cache entries to write
+ * @param release 1 => the entries are about to be freed, so their
+ * data may be handed to writes still in progress on return
+ *
+ * @return ::NC_NOERR No error.
+ * @author Dennis Heimbigner
+ */
+static int
+put_chunks(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries, int release)
+{
+    int stat = NC_NOERR;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+    NCZM_REQUEST* requests = NULL;
+    char** paths = NULL;
+    NCZPending* jobs = NULL;
+    size_t i, m, first, window;
+    int behind = writingbehind(cache);
+
+    /* Partly written chunks must be completed first */
+    for(i=0;i<n;i++)
+	if(entries[i]->written != NULL && (stat = materialize(cache,entries[i]))) goto done;
+    /* Earlier writes of the same chunks must not overtake these */
+    for(i=0;i<n;i++) syncwrite(cache,entries[i]->indices);
+    if((requests = (NCZM_REQUEST*)calloc(n,sizeof(NCZM_REQUEST))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((paths = (char**)calloc(n,sizeof(char*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((stat = chunkpaths(cache,n,entries,paths))) goto done;
+    markfill(cache,n,entries);
+    /* Start encoding all the chunks on the worker threads, if any */
+    if((stat = encode_chunks(cache,n,entries,&jobs))) goto done;
+    /* Write the chunks in order, a window at a time as their encoding
+       completes, so the writes overlap the rest of the encoding */
+    window = (jobs == NULL ? n : NCZ_workers_count(zfile->workers));
+    for(first=0,m=0,i=0;i<n;i++) {
+	if(jobs == NULL)
+	    stat = encode_chunk(cache,entries[i]);
+	else
+	    stat = NCZ_workers_wait(zfile->workers,&jobs[i].work);
+	if(stat) goto done;
+	if(entries[i]->isfill) {
+	    if((stat = drop_chunk(cache,paths[i],entries[i]))) goto done;
+	} else if(behind) {
+	    if((stat = queuewrite(cache,entries[i],paths[i],release))) goto done;
+	    paths[i] = NULL; /* now owned by the write */
+	} else {
+	    requests[m].key = paths[i];
+	    requests[m].start = 0;
+	    requests[m].count = entries[i]->size;
+	    requests[m].content = entries[i]->data;
+	    m++;
+	}
+	if(m > first && (i+1 == n || m-first == window)) {
+	    if((stat = cachewriten(cache,zfile->map,m-first,requests+first))) goto done;
+	    first = m;
 	}
     }
+    for(i=0;i<n;i++)
+	if(!entries[i]->isfill) entries[i]->stored = 1;
+
+done:
+    if(jobs != NULL) {
+	/* Wait for any encoding still in progress */
+	for(i=0;i<n;i++) (void)NCZ_workers_wait(zfile->workers,&jobs[i].work);
+	free(jobs);
+    }
+    /* Data still owned by cached entries must not be written later */
+    if(behind && !release) reapwrites(cache,0,1);
+    if(paths != NULL) {
+	for(i=0;i<n;i++) nullfree(paths[i]);
+	free(paths);
+    }
+    nullfree(requests);
+    return THROW(stat);
+}
+
+/* Decide which of the modified entries hold only fill and are
+   therefore not stored; they must still hold real data */
+static void
+markfill(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries)
+{
+    size_t i;
+    for(i=0;i<n;i++) {
+	NCZCacheEntry* entry = entries[i];
+	entry->isfill = (!cache->writeempty && entry->modified && !entry->isfiltered
+			 && entry->size == cache->chunksize && cache->fillchunk != NULL
+			 && memcmp(entry->data,cache->fillchunk,(size_t)cache->chunksize) == 0);
+    }
+}
+
+/* Make sure a fill-only chunk is not in the map; a map that
+   cannot remove objects gets the fill chunk written instead */
+static int
+drop_chunk(NCZChunkCache* cache, const char* path, NCZCacheEntry* entry)
+{
+    int stat = NC_NOERR;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+
+    if(!entry->stored) goto done;
+    switch (stat = cacheremove(cache,zfile->map,path)) {
+    case NC_NOERR: case NC_EEMPTY:
+	stat = NC_NOERR;
+	entry->stored = 0;
+	break;
+    case NC_ENOTBUILT:
+	stat = cachewrite(cache,zfile->map,path,0,entry->size,entry->data);
+	break;
+    default: break;
+    }
+done:
+    return THROW(stat);
+}
+
+/* Work function: encode one chunk; executed by a worker thread */
+static int
+encodechunk(void* arg)
+{
+    NCZPending* pending = (NCZPending*)arg;
+    return encode_chunk(pending->cache,pending->entry);
+}
+
+/**
+ * @internal Start encoding a set of chunks on the worker threads.
+ * Nothing is started, and *jobsp is NULL, unless the variable is
+ * filtered and there are workers and more than one chunk; the caller
+ * then encodes the chunks itself. Otherwise, the caller must wait
+ * for the work of every element of *jobsp before reclaiming it.
+ *
+ * @param cache Pointer to parent cache
+ * @param n number of entries
+ * @param entries cache entries to encode
+ * @param jobsp return n jobs, one per entry, or NULL
+ *
+ * @return ::NC_NOERR No error.
+ */
+static int
+encode_chunks(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries, NCZPending** jobsp)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    struct NCZWorkers* workers = NULL;
+    NCZPending* jobs = NULL;
+    int filtered;
+
+    *jobsp = NULL;
+    filtered = FILTERED(cache);
+    if(!filtered || n <= 1) goto done;
+    workers = getworkers(cache);
+    if(NCZ_workers_count(workers) == 0) goto done;
+#ifdef ENABLE_NCZARR_FILTERS
+    /* Workers must not modify the filter state */
+    if((stat = NCZ_filter_prepare((cache->var->container)->nc4_info,cache->var))) goto done;
+#endif
+    if((jobs = (NCZPending*)calloc(n,sizeof(NCZPending))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<n;i++) {
+	jobs[i].cache = cache;
+	jobs[i].entry = entries[i];
+	jobs[i].work.fcn = encodechunk;
+	jobs[i].work.arg = &jobs[i];
+	if((stat = NCZ_workers_submit(workers,&jobs[i].work))) break;
+    }
+    *jobsp = jobs;
+done:
+    return THROW(stat);
+}
+
+/* Encode the modified entries among a set, in parallel if possible */
+static int
+encode_modified(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries)
+{
+    int stat = NC_NOERR;
+    size_t i, ndirty = 0;
+    NCZCacheEntry** dirty = NULL;
+    NCZPending* jobs = NULL;
+    NCZ_FILE_INFO_T* zfile = ((cache->var->container)->nc4_info)->format_file_info;
+
+    if((dirty = (NCZCacheEntry**)calloc(n+1,sizeof(NCZCacheEntry*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<n;i++) {
+	if(entries[i]->modified) dirty[ndirty++] = entries[i];
+    }
+    stat = encode_chunks(cache,ndirty,dirty,&jobs);
+    for(i=0;i<ndirty;i++) {
+	int stat1;
+	if(jobs != NULL)
+	    stat1 = NCZ_workers_wait(zfile->workers,&jobs[i].work);
+	else if(stat == NC_NOERR)
+	    stat1 = encode_chunk(cache,dirty[i]);
+	else
+	    break;
+	if(stat == NC_NOERR) stat = stat1;
+    }
+done:
+    nullfree(jobs);
+    nullfree(dirty);
+    return THROW(stat);
+}
+
+/**
+ * @internal Read the raw data for a chunk from the map.
+ *
+ * @param cache Pointer to parent cache
+ * @param entry cache entry to read into
+ * @param emptyp return 1 if the chunk does not exist
+ *
+ * @return ::NC_NOERR No error.
+ * @return ::NC_EEMPTY Chunk does not exist.
+ * @author Dennis Heimbigner
+ */
+static int
+fetch_chunk(NCZChunkCache* cache, NCZCacheEntry* entry, int* emptyp)
+{
+    int stat = NC_NOERR;
+    int empty = 0;
+
+    ZTRACE(5,"cache.var=%s sep=%d",cache->var->hdr.name,cache->dimension_separator);
+
+    syncwrite(cache,entry->indices);
+    if(SHARDED(cache))
+	stat = fetch_shard_chunk(cache,entry,&empty);
+    else if((stat = fetch_chunks(cache,1,&entry,NULL,&empty)) == NC_NOERR && empty)
+	stat = NC_EEMPTY;
+    if(emptyp) *emptyp = empty;
+    return ZUNTRACE(stat);
+}
+
+/**
+ * @internal Read the raw data for a set of chunks from the map with
+ * a single batch read, so the map can overlap the underlying I/O.
+ * Each object is read whole, so its size need not be obtained first.
+ *
+ * @param cache Pointer to parent cache
+ * @param n number of entries
+ * @param entries cache entries to read into
+ * @param paths map keys of the entries; NULL => build them here
+ * @param empties return empties[i] = 1 if the chunk does not exist
+ *
+ * @return ::NC_NOERR No error.
+ * @author Dennis Heimbigner
+ */
+static int
+fetch_chunks(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries, char** paths, int* empties)
+{
+    int stat = NC_NOERR;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZ_FILE_INFO_T* zfile = file->format_file_info;
+    NCZM_REQUEST* requests = NULL;
+    char** mypaths = NULL;
+    size_t i;
+    int pooled;
+
+    LOG((3, "%s: var: %s n=%d", __func__, cache->var->hdr.name, (int)n));
+    assert(zfile->map);
+
+    if((requests = (NCZM_REQUEST*)calloc(n,sizeof(NCZM_REQUEST))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if(paths == NULL) {
+	if((mypaths = (char**)calloc(n,sizeof(char*))) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	if((stat = chunkpaths(cache,n,entries,mypaths))) goto done;
+	paths = mypaths;
+    }
+    pooled = !FILTERED(cache);
+    for(i=0;i<n;i++) {
+	requests[i].key = paths[i];
+	/* Real chunks have a known size, so read them into recycled buffers */
+	if(pooled) {
+	    if((requests[i].content = alloc_chunk_buffer(cache)) == NULL)
+		{stat = NC_ENOMEM; goto done;}
+	    requests[i].count = cache->chunksize;
+	}
+    }
+    stat = cachereadn(cache,zfile->map,n,requests);
+    /* Take the content even on failure so it is reclaimed */
+    for(i=0;i<n;i++) {
+	NCZCacheEntry* entry = entries[i];
+	empties[i] = (requests[i].stat == NC_EEMPTY);
+	entry->stored = (requests[i].stat == NC_NOERR);
+	if(requests[i].stat == NC_NOERR) {
+	    entry->data = requests[i].content;
+	    entry->size = requests[i].count;
+	    entry->isfiltered = FILTERED(cache); /* Is the data being read filtered? */
+	} else {
+	    if(pooled && cache->bufpool != NULL)
+		NCZ_bufpool_put(cache->bufpool,requests[i].content);
+	    else
+		nullfree(requests[i].content);
+	    entry->data = NULL;
+	    entry->size = 0;
+	}
+	requests[i].content = NULL;
+    }
+
+done:
+    if(mypaths != NULL) {
+	for(i=0;i<n;i++) nullfree(mypaths[i]);
+	free(mypaths);
+    }
+    if(requests != NULL) {
+	for(i=0;i<n;i++) nullfree(requests[i].content);
+	free(requests);
+    }
+    return THROW(stat);
+}
+
+/**
+ * @internal Build the map keys for a set of cache entries from
+ * their indices. The key of the variable is built once for all.
+ *
+ * @param cache Pointer to parent cache
+ * @param n number of entries
+ * @param entries cache entries
+ * @param paths return the n malloc'd keys
+ *
+ * @return ::NC_NOERR No error.
+ */
+static int
+chunkpaths(NCZChunkCache* cache, size_t n, NCZCacheEntry** entries, char** paths)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    struct ChunkKey key = {NULL,NULL};
+
+    if((stat = NCZ_varkey(cache->var,&key.varkey))) goto done;
+    for(i=0;i<n;i++) {
+	if((stat = NCZ_buildchunkkey(cache->ndims,entries[i]->indices,cache->dimension_separator,&key.chunkkey))) goto done;
+	if((paths[i] = NCZ_chunkpath(key)) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	nullfree(key.chunkkey);
+	key.chunkkey = NULL;
+    }
+done:
+    nullfree(key.varkey);
+    nullfree(key.chunkkey);
+    return THROW(stat);
+}
+
+/**
+ * @internal Convert fetched raw data to real data: synthesize a
+ * missing chunk from the fill value or apply the filter chain.
+ * Safe to call from a worker thread.
+ *
+ * @param cache Pointer to parent cache
+ * @param entry cache entry
+ * @param empty 1 => chunk does not exist
+ *
+ * @return ::NC_NOERR No error.
+ * @author Dennis Heimbigner
+ */
+static int
+finish_chunk(NCZChunkCache* cache, NCZCacheEntry* entry, int empty)
+{
+    int stat = NC_NOERR;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+
     if(empty) {
 	/* fake the chunk */
         entry->modified = (file->no_write?0:1);
 	entry->size = cache->chunksize;
-        if((entry->data = (void*)malloc(entry->size)) == NULL)
+        if((entry->data = alloc_chunk_buffer(cache)) == NULL)
             {stat = NC_ENOMEM; goto done;}
         /* apply fill value */
 	assert(cache->fillchunk);
@@ -630,13 +2351,17 @@ get_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
         void* unfiltered = NULL; /* pointer to the unfiltered data */
         void* filtered = NULL; /* pointer to the filtered data */
 	size_t unflen; /* length of unfiltered data */
+	double start;
 	/* Get the filter chain to apply */
 	NClist* filterchain = (NClist*)var->filters;
 	if(nclistlength(filterchain) == 0) {stat = NC_EFILTER; goto done;}
 	/* Apply the filter chain to get the unfiltered data */
 	filtered = entry->data;
 	entry->data = NULL;
-	if((stat = NCZ_applyfilterchain(file,var,filterchain,entry->size,filtered,&unflen,&unfiltered,!ENCODING))) goto done;
+	start = NCZ_stats_clock();
+	stat = NCZ_applyfilterchain(file,var,filterchain,entry->size,filtered,&unflen,&unfiltered,!ENCODING);
+	NCZ_stats_time(cache->stats,NCZ_STAT_DECODE,NCZ_stats_clock() - start);
+	if(stat) goto done;
 	/* Fix up the cache entry */
 	entry->data = unfiltered;
 	entry->size = unflen;
@@ -644,9 +2369,373 @@ get_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
     }
 #endif
 
+done:
+    return THROW(stat);
+}
+
+/**
+ * @internal Push data from memory to file.
+ *
+ * @param cache Pointer to parent cache
+ * @param key chunk key
+ * @param entry cache entry to read into
+ *
+ * @return ::NC_NOERR No error.
+ * @author Dennis Heimbigner
+ */
+static int
+get_chunk(NCZChunkCache* cache, NCZCacheEntry* entry)
+{
+    int stat = NC_NOERR;
+    int empty = 0;
+
+    stat = fetch_chunk(cache,entry,&empty);
+    switch (stat) {
+    case NC_NOERR: break;
+    case NC_EEMPTY: stat = NC_NOERR; break;
+    default: goto done;
+    }
+    stat = finish_chunk(cache,entry,empty);
+done:
+    return THROW(stat);
+}
+
+/**************************************************/
+/* Sharding */
+
+/*
+A sharded variable packs a block of chunks (zvar->shards[d]
+chunks along dimension d) into one map object, so fine-grained
+chunking does not produce one file or S3 object per chunk. The
+shard is named like a chunk, using the indices of the shard in
+the grid of shards, but under a leading NCZ_SHARD_PREFIX key
+component (s.0.1 rather than 0.1), so a shard is never taken for
+a chunk. Its .zarray lists NCZ_SHARD_CODEC among its filters for
+the same reason (see zsync.c). Its content is the (possibly filtered) chunks
+followed by an index of (offset,nbytes) pairs, one per chunk in
+row-major order within the shard, stored as little-endian 64-bit
+integers; a missing chunk has both values set to all ones. This
+is the layout of the Zarr V3 sharding_indexed codec with the
+index at the end. Reading a chunk is two range reads: one for
+the index, which is then kept in the cache, and one for the chunk.
+Writing a chunk rewrites its shard, so modified chunks belonging
+to the same shard are written together when the cache is flushed.
+*/
+
+#define SHARD_EMPTY ((size64_t)0xFFFFFFFFFFFFFFFFULL)
+
+/* Number of chunks in a shard */
+static size64_t
+shard_nchunks(NCZChunkCache* cache)
+{
+    size_t r;
+    size64_t n = 1;
+    NCZ_VAR_INFO_T* zvar = (NCZ_VAR_INFO_T*)cache->var->format_var_info;
+    for(r=0;r<cache->ndims;r++) n *= zvar->shards[r];
+    return n;
+}
+
+/* Compute the path of the shard holding a chunk and the position of the chunk in it */
+static int
+shard_locate(NCZChunkCache* cache, NCZCacheEntry* entry, char** pathp, size64_t* posp)
+{
+    int stat = NC_NOERR;
+    size_t r;
+    size64_t pos = 0;
+    size64_t shardindices[NC_MAX_VAR_DIMS];
+    struct ChunkKey key = {NULL,NULL};
+    char* indexkey = NULL;
+    size_t keylen;
+    NCZ_VAR_INFO_T* zvar = (NCZ_VAR_INFO_T*)cache->var->format_var_info;
+
+    for(r=0;r<cache->ndims;r++) {
+	shardindices[r] = entry->indices[r] / zvar->shards[r];
+	pos = (pos * zvar->shards[r]) + (entry->indices[r] % zvar->shards[r]);
+    }
+    if(pathp) {
+	if((stat = NCZ_varkey(cache->var,&key.varkey))) goto done;
+	if((stat = NCZ_buildchunkkey(cache->ndims,shardindices,cache->dimension_separator,&indexkey))) goto done;
+	keylen = strlen(NCZ_SHARD_PREFIX)+1+strlen(indexkey)+1;
+	if((key.chunkkey = malloc(keylen)) == NULL) {stat = NC_ENOMEM; goto done;}
+	snprintf(key.chunkkey,keylen,"%s%c%s",NCZ_SHARD_PREFIX,cache->dimension_separator,indexkey);
+	if((*pathp = NCZ_chunkpath(key)) == NULL) {stat = NC_ENOMEM; goto done;}
+    }
+    if(posp) *posp = pos;
+done:
+    nullfree(indexkey);
+    nullfree(key.varkey);
+    nullfree(key.chunkkey);
+    return THROW(stat);
+}
+
+/* Convert a shard index between memory and storage order */
+static void
+shard_swapindex(size64_t nchunks, size64_t* index)
+{
+    if(!NCZ_isLittleEndian())
+	(void)NCZ_swapatomicdata((size_t)(2*nchunks*sizeof(size64_t)),index,sizeof(size64_t));
+}
+
+/* Get the index of a shard, reading it from the map on first use */
+static int
+load_shard(NCZChunkCache* cache, const char* path, NCZShard** shardp)
+{
+    int stat = NC_NOERR;
+    uintptr_t data;
+    size64_t i, nchunks, indexsize;
+    NCZShard* shard = NULL;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZMAP* map = ((NCZ_FILE_INFO_T*)file->format_file_info)->map;
+
+    if(cache->shards == NULL && (cache->shards = NC_hashmapnew(0)) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if(NC_hashmapget(cache->shards,path,strlen(path),&data))
+	{*shardp = (NCZShard*)data; goto done;}
+
+    nchunks = shard_nchunks(cache);
+    indexsize = 2*nchunks*sizeof(size64_t);
+    if((shard = calloc(1,sizeof(NCZShard))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((shard->index = malloc((size_t)indexsize)) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    switch (stat = cachelen(cache,map,path,&shard->size)) {
+    case NC_NOERR:
+	if(shard->size < indexsize) {stat = NC_ENCZARR; goto done;}
+	if((stat = cacheread(cache,map,path,shard->size - indexsize,indexsize,shard->index))) goto done;
+	shard_swapindex(nchunks,shard->index);
+	break;
+    case NC_EEMPTY: /* New shard */
+	stat = NC_NOERR;
+	shard->size = 0;
+	for(i=0;i<2*nchunks;i++) shard->index[i] = SHARD_EMPTY;
+	break;
+    default: goto done;
+    }
+    if(!NC_hashmapadd(cache->shards,(uintptr_t)shard,path,strlen(path)))
+	{stat = NC_ENOMEM; goto done;}
+    *shardp = shard; shard = NULL;
+
+done:
+    if(shard) {nullfree(shard->index); free(shard);}
+    return THROW(stat);
+}
+
+static void
+free_shards(NCZChunkCache* cache)
+{
+    size_t i;
+    if(cache->shards == NULL) return;
+    for(i=0;i<cache->shards->alloc;i++) {
+	uintptr_t data = 0;
+	const char* key = NULL;
+	if(NC_hashmapith(cache->shards,i,&data,&key) != NC_NOERR) break;
+	if(key != NULL) {
+	    NCZShard* shard = (NCZShard*)data;
+	    nullfree(shard->index);
+	    free(shard);
+	}
+    }
+    NC_hashmapfree(cache->shards);
+    cache->shards = NULL;
+}
+
+/* Read the raw data for a chunk using a range read against its shard */
+static int
+fetch_shard_chunk(NCZChunkCache* cache, NCZCacheEntry* entry, int* emptyp)
+{
+    int stat = NC_NOERR;
+    char* path = NULL;
+    size64_t pos;
+    NCZShard* shard = NULL;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZMAP* map = ((NCZ_FILE_INFO_T*)file->format_file_info)->map;
+
+    *emptyp = 0;
+    if((stat = shard_locate(cache,entry,&path,&pos))) goto done;
+    if((stat = load_shard(cache,path,&shard))) goto done;
+    if(shard->index[2*pos] == SHARD_EMPTY)
+	{*emptyp = 1; stat = NC_EEMPTY; goto done;}
+    entry->size = shard->index[(2*pos)+1];
+    entry->isfiltered = FILTERED(cache);
+    if(!entry->isfiltered && entry->size == cache->chunksize)
+	entry->data = alloc_chunk_buffer(cache);
+    else
+	entry->data = malloc(entry->size);
+    if(entry->data == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((stat = cacheread(cache,map,path,shard->index[2*pos],entry->size,entry->data))) goto done;
+    entry->stored = 1;
+
 done:
     nullfree(path);
-    return ZUNTRACE(stat);
+    return THROW(stat);
+}
+
+/**
+ * @internal Rewrite a shard replacing some of its chunks.
+ *
+ * @param cache Pointer to parent cache
+ * @param path shard path; NULL => compute from entries[0]
+ * @param n number of entries
+ * @param entries filtered entries all belonging to the shard
+ *
+ * @return ::NC_NOERR No error.
+ */
+static int
+put_shard(NCZChunkCache* cache, const char* path, size_t n, NCZCacheEntry** entries)
+{
+    int stat = NC_NOERR;
+    size_t i;
+    size64_t pos, nchunks, indexsize, oldsize, total;
+    char* mypath = NULL;
+    NCZShard* shard = NULL;
+    NCZCacheEntry** slots = NULL;
+    size64_t* index = NULL;
+    char* old = NULL;
+    char* content = NULL;
+    int keepold = 0;
+    NC_FILE_INFO_T* file = (cache->var->container)->nc4_info;
+    NCZMAP* map = ((NCZ_FILE_INFO_T*)file->format_file_info)->map;
+
+    if(path == NULL) {
+	if((stat = shard_locate(cache,entries[0],&mypath,NULL))) goto done;
+	path = mypath;
+    }
+    if((stat = load_shard(cache,path,&shard))) goto done;
+    nchunks = shard_nchunks(cache);
+    indexsize = 2*nchunks*sizeof(size64_t);
+
+    /* Place the new chunks */
+    if((slots = calloc((size_t)nchunks,sizeof(NCZCacheEntry*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(i=0;i<n;i++) {
+	if((stat = shard_locate(cache,entries[i],NULL,&pos))) goto done;
+	slots[pos] = entries[i];
+    }
+    /* Compute the new layout */
+    if((index = malloc((size_t)indexsize)) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(total=0,pos=0;pos<nchunks;pos++) {
+	size64_t len;
+	if(slots[pos] != NULL && slots[pos]->isfill)
+	    {index[2*pos] = SHARD_EMPTY; index[(2*pos)+1] = SHARD_EMPTY; continue;}
+	else if(slots[pos] != NULL)
+	    len = slots[pos]->size;
+	else if(shard->index[2*pos] != SHARD_EMPTY)
+	    {len = shard->index[(2*pos)+1]; keepold = 1;}
+	else
+	    {index[2*pos] = SHARD_EMPTY; index[(2*pos)+1] = SHARD_EMPTY; continue;}
+	index[2*pos] = total;
+	index[(2*pos)+1] = len;
+	total += len;
+    }
+    /* A shard left with no chunks need not be stored */
+    if(total == 0 && shard->size == 0) goto remember;
+    if(total == 0) {
+	switch (stat = cacheremove(cache,map,path)) {
+	case NC_NOERR: case NC_EEMPTY:
+	    stat = NC_NOERR;
+	    shard->size = 0;
+	    goto remember;
+	case NC_ENOTBUILT: stat = NC_NOERR; break; /* write the empty shard */
+	default: goto done;
+	}
+    }
+    /* Read the surviving chunks in one request */
+    oldsize = (shard->size > 0 ? shard->size - indexsize : 0);
+    if(keepold && oldsize > 0) {
+	if((old = malloc((size_t)oldsize)) == NULL)
+	    {stat = NC_ENOMEM; goto done;}
+	if((stat = cacheread(cache,map,path,0,oldsize,old))) goto done;
+    }
+    /* Assemble the new shard */
+    if((content = malloc((size_t)(total+indexsize))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    for(pos=0;pos<nchunks;pos++) {
+	if(index[2*pos] == SHARD_EMPTY) continue;
+	if(slots[pos] != NULL)
+	    memcpy(content+index[2*pos],slots[pos]->data,(size_t)slots[pos]->size);
+	else {
+	    if(shard->index[2*pos] + index[(2*pos)+1] > oldsize) {stat = NC_ENCZARR; goto done;}
+	    memcpy(content+index[2*pos],old+shard->index[2*pos],(size_t)index[(2*pos)+1]);
+	}
+    }
+    memcpy(content+total,index,(size_t)indexsize);
+    shard_swapindex(nchunks,(size64_t*)(content+total));
+    /* Writes do not truncate, and the index is found from the end */
+    if(shard->size > total+indexsize) {
+	switch (stat = cacheremove(cache,map,path)) {
+	case NC_NOERR: case NC_EEMPTY: case NC_ENOTBUILT: stat = NC_NOERR; break;
+	default: goto done;
+	}
+    }
+    if((stat = cachewrite(cache,map,path,0,total+indexsize,content))) goto done;
+    shard->size = total+indexsize;
+remember:
+    /* Remember the new index */
+    nullfree(shard->index);
+    shard->index = index; index = NULL;
+
+done:
+    nullfree(mypath);
+    nullfree(slots);
+    nullfree(index);
+    nullfree(old);
+    nullfree(content);
+    return THROW(stat);
+}
+
+/* Write out all modified chunks, rewriting each affected shard once */
+static int
+flush_shards(NCZChunkCache* cache)
+{
+    int stat = NC_NOERR;
+    size_t i,j,n;
+    size_t nentries = 0;
+    NCZCacheEntry** entries = NULL;
+    char** paths = NULL;
+    NCZCacheEntry** group = NULL;
+    size64_t before = 0, after = 0;
+
+    if((stat = lruentries(cache,&nentries,&entries))) goto done;
+    if((paths = calloc(nentries,sizeof(char*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    if((group = calloc(nentries,sizeof(NCZCacheEntry*))) == NULL)
+	{stat = NC_ENOMEM; goto done;}
+    markfill(cache,nentries,entries);
+    for(i=0;i<nentries;i++)
+	if(entries[i]->modified) before += entries[i]->size;
+    if((stat = encode_modified(cache,nentries,entries))) goto done;
+    for(i=0;i<nentries;i++)
+	if(entries[i]->modified) after += entries[i]->size;
+    /* The written chunks stay cached in their encoded form */
+    cache->used = (cache->used - before) + after;
+    for(i=0;i<nentries;i++) {
+        NCZCacheEntry* entry = entries[i];
+	if(!entry->modified) continue;
+	if((stat = shard_locate(cache,entry,&paths[i],NULL))) goto done;
+    }
+    for(i=0;i<nentries;i++) {
+	if(paths[i] == NULL) continue;
+	/* Collect the modified chunks of this shard */
+	for(n=0,j=i;j<nentries;j++) {
+	    if(paths[j] == NULL || strcmp(paths[i],paths[j]) != 0) continue;
+	    group[n++] = entries[j];
+	    if(j > i) {nullfree(paths[j]); paths[j] = NULL;}
+	}
+	if((stat = put_shard(cache,paths[i],n,group))) goto done;
+	for(j=0;j<n;j++) group[j]->modified = 0;
+	nullfree(paths[i]); paths[i] = NULL;
+    }
+
+done:
+    if(paths != NULL) {
+	for(i=0;i<nentries;i++) nullfree(paths[i]);
+	free(paths);
+    }
+    nullfree(group);
+    nullfree(entries);
+    return THROW(stat);
 }
 
 int
@@ -9,6 +9,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <errno.h>
 #include <string.h>
 #ifdef HAVE_FCNTL_H
@@ -37,15 +38,21 @@
 #include "rnd.h"
 #include "ncbytes.h"
 #include "nchttp.h"
+#include "ncrc.h"
+#include "ncblockcache.h"
 
 #define DEFAULTPAGESIZE 16384
 
+/* Blocks to read ahead once reads are sequential */
+#define DEFAULTREADAHEAD 2
+
 /* Private data */
 
 typedef struct NCHTTP {
     NC_HTTP_STATE* state;
     long long size; /* of the object */
-    NCbytes* region;
+    const char* path;
+    NCblockcache* cache; /* blocks of the object */
 } NCHTTP;
 
 /* Forward */
@@ -56,6 +63,8 @@ static int httpio_sync(ncio *const nciop);
 static int httpio_filesize(ncio* nciop, off_t* filesizep);
 static int httpio_pad_length(ncio* nciop, off_t length);
 static int httpio_close(ncio* nciop, int);
+static int httpio_readblocks(void* state, size64_t offset, size64_t count, void* buf);
+static size_t httpio_rcsize(const char* key);
 
 static long pagesize = 0;
 
@@ -99,8 +108,6 @@ done:
 
 fail:
     if(http != NULL) {
-	if(http->region)
-	    ncbytesfree(http->region);
 	free(http);
     }
     if(nciop != NULL) {
@@ -169,6 +176,18 @@ httpio_open(const char* path,
     /* Open the path and get curl handle and object size */
     if((status = nc_http_init(&http->state))) goto done;
     if((status = nc_http_size(http->state,path,&http->size))) goto done;
+    http->path = nciop->path;
+    /* Read the object through a cache of its blocks */
+    {
+	size_t readahead = DEFAULTREADAHEAD;
+	if(NC_rclookup("HTTP.READAHEAD",NULL,NULL) != NULL)
+	    readahead = httpio_rcsize("HTTP.READAHEAD");
+	if((status = ncblockcachenew((size64_t)http->size,
+				     httpio_rcsize("HTTP.BLOCKSIZE"),
+				     httpio_rcsize("HTTP.BLOCKCOUNT"),
+				     readahead,httpio_readblocks,http,&http->cache)))
+	    goto done;
+    }
 
     sizehint = pagesize;
 
@@ -232,7 +251,7 @@ httpio_close(ncio* nciop, int doUnlink)
 
     /* do cleanup  */
     if(http != NULL) {
-	ncbytesfree(http->region);
+	ncblockcachefree(http->cache);
 	free(http);
     }
     if(nciop->path != NULL) free((char*)nciop->path);
@@ -249,17 +268,15 @@ httpio_get(ncio* const nciop, off_t offset, size_t extent, int rflags, void** co
 {
     int status = NC_NOERR;
     NCHTTP* http;
+    void* region = NULL;
 
     if(nciop == NULL || nciop->pvt == NULL) {status = NC_EINVAL; goto done;}
     http = (NCHTTP*)nciop->pvt;
 
-    assert(http->region == NULL);
-    http->region = ncbytesnew();
-    ncbytessetalloc(http->region,(unsigned long)extent);
-    if((status = nc_http_read(http->state,nciop->path,offset,extent,http->region)))
+    /* The region stays valid until the next get */
+    if((status = ncblockcacheget(http->cache,(size64_t)offset,extent,&region)))
 	goto done;
-    assert(ncbyteslength(http->region) == extent);
-    if(vpp) *vpp = ncbytescontents(http->region);
+    if(vpp) *vpp = region;
 done:
     return status;
 }
@@ -276,15 +293,8 @@ httpio_move(ncio* const nciop, off_t to, off_t from, size_t nbytes, int ignored)
 static int
 httpio_rel(ncio* const nciop, off_t offset, int rflags)
 {
-    int status = NC_NOERR;
-    NCHTTP* http;
-
-    if(nciop == NULL || nciop->pvt == NULL) {status = NC_EINVAL; goto done;}
-    http = (NCHTTP*)nciop->pvt;
-    ncbytesfree(http->region);
-    http->region = NULL;
-done:
-    return status;
+    if(nciop == NULL || nciop->pvt == NULL) return NC_EINVAL;
+    return NC_NOERR; /* the cache owns the region */
 }
 
 /*
@@ -296,3 +306,33 @@ httpio_sync(ncio* const nciop)
 {
     return NC_NOERR; /* do nothing */
 }
+
+/*
+ * Read a range of blocks for the block cache with one request.
+ */
+static int
+httpio_readblocks(void* state, size64_t offset, size64_t count, void* buf)
+{
+    int status = NC_NOERR;
+    NCHTTP* http = (NCHTTP*)state;
+    NCbytes* region = ncbytesnew();
+
+    ncbytessetalloc(region,(unsigned long)count);
+    if((status = nc_http_read(http->state,http->path,offset,count,region)))
+	goto done;
+    if(ncbyteslength(region) != count) {status = NC_EIO; goto done;}
+    memcpy(buf,ncbytescontents(region),(size_t)count);
+done:
+    ncbytesfree(region);
+    return status;
+}
+
+/* Get a size from the .rc file; 0 => use the default */
+static size_t
+httpio_rcsize(const char* key)
+{
+    const char* value = NC_rclookup(key,NULL,NULL);
+    unsigned long n = 0;
+    if(value == NULL || sscanf(value,"%lu",&n) != 1) return 0;
+    return (size_t)n;
+}
@@ -14,6 +14,9 @@
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
 #ifdef _MSC_VER /* Microsoft Compilers */
 #include <io.h>
 #endif
@@ -89,6 +92,16 @@
 
 /* Private data for mmap */
 
+/* A read-only region that extends past the end of file; each one
+   outstanding has its own buffer until mmapio_rel releases it */
+typedef struct NCMMAPScratch {
+    struct NCMMAPScratch* next;
+    off_t offset;
+    size_t extent;
+    int refs; /* gets of this region not yet released */
+    char* data;
+} NCMMAPScratch;
+
 typedef struct NCMMAPIO {
     int locked; /* => we cannot realloc */
     int persist; /* => save to a file; triggered by NC_PERSIST */
@@ -97,6 +110,7 @@ typedef struct NCMMAPIO {
     off_t size;
     off_t pos;
     int mapfd;
+    NCMMAPScratch* scratch; /* outstanding read-only regions past the end of file */
 } NCMMAPIO;
 
 /* Forward */
@@ -313,7 +327,7 @@ mmapio_open(const char* path,
     void* parameters,
     ncio* *nciopp, void** const mempp)
 {
-    ncio* nciop;
+    ncio* nciop = NULL;
     int fd;
     int status;
     int oflags;
@@ -342,12 +356,13 @@ mmapio_open(const char* path,
     if(filesize < 0) {status = errno; goto unwind_open;}
     /* move pointer back to beginning of file */
     (void)lseek(fd,0,SEEK_SET);
-    if(filesize < (off_t)sizehint)
+    /* A read-only mapping must not extend past the end of file */
+    if(readwrite && filesize < (off_t)sizehint)
         filesize = (off_t)sizehint;
 
     status = mmapio_new(path, ioflags, filesize, &nciop, &mmapio);
     if(status != NC_NOERR)
-	return status;
+	{close(fd); return status;}
     mmapio->size = filesize;
 
     mmapio->mapfd = fd;
@@ -355,6 +370,11 @@ mmapio_open(const char* path,
                                     readwrite?(PROT_READ|PROT_WRITE):(PROT_READ),
 				    MAP_SHARED,
                                     mmapio->mapfd,0);
+    if(mmapio->memory == MAP_FAILED) {
+	mmapio->memory = NULL;
+	status = errno;
+	goto unwind_open;
+    }
 #ifdef DEBUG
 fprintf(stderr,"mmapio_open: initial memory: %lu/%lu\n",(unsigned long)mmapio->memory,(unsigned long)mmapio->alloc);
 #endif
@@ -485,8 +505,14 @@ mmapio_close(ncio* nciop, int doUnlink)
     assert(mmapio != NULL);
 
     /* Since we are using mmap, persisting to a file should be automatic */
-    status = munmap(mmapio->memory,mmapio->alloc);
+    if(mmapio->memory != NULL)
+        status = munmap(mmapio->memory,mmapio->alloc);
     mmapio->memory = NULL; /* so we do not try to free it */
+    while(mmapio->scratch != NULL) {
+	NCMMAPScratch* next = mmapio->scratch->next;
+	free(mmapio->scratch);
+	mmapio->scratch = next;
+    }
 
     /* Close file if it was open */
     if(mmapio->mapfd >= 0)
@@ -513,6 +539,75 @@ guarantee(ncio* nciop, off_t endpoint)
     return NC_NOERR;
 }
 
+/*
+ * A file open read-only is mapped at the size it had when it was
+ * opened, but a writer may since have appended records that the
+ * reader learns about from nc_sync. Map the file again at its new
+ * size, unless something still points into the mapping.
+ */
+static int
+mmapio_grow(ncio* nciop)
+{
+    NCMMAPIO* mmapio = (NCMMAPIO*)nciop->pvt;
+    struct stat sb;
+    off_t newalloc;
+    char* newmem;
+
+    if(fstat(mmapio->mapfd,&sb) < 0) return errno;
+    if(sb.st_size <= mmapio->size) return NC_NOERR;
+    if(sb.st_size <= mmapio->alloc) {
+	/* still within the last page mapped */
+	mmapio->size = sb.st_size;
+	return NC_NOERR;
+    }
+    if(mmapio->locked > 0) return NC_NOERR; /* mmapio_pread does it */
+    newalloc = sb.st_size;
+    if((newalloc % pagesize) != 0)
+	newalloc += (pagesize - (newalloc % pagesize));
+#ifdef HAVE_MREMAP
+    newmem = (char*)mremap(mmapio->memory,(size_t)mmapio->alloc,(size_t)newalloc,MREMAP_MAYMOVE);
+    if(newmem == MAP_FAILED) return NC_NOERR;
+#else
+    newmem = (char*)mmap(NULL,(size_t)newalloc,PROT_READ,MAP_SHARED,mmapio->mapfd,0);
+    if(newmem == MAP_FAILED) return NC_NOERR;
+    munmap(mmapio->memory,(size_t)mmapio->alloc);
+#endif
+    mmapio->memory = newmem;
+    mmapio->alloc = newalloc;
+    mmapio->size = sb.st_size;
+    return NC_NOERR;
+}
+
+/*
+ * Read extent bytes at offset of a file open read-only into buf,
+ * zero filling what lies past the end of the file.
+ */
+static int
+mmapio_pread(NCMMAPIO* mmapio, off_t offset, size_t extent, char* buf)
+{
+    while(extent > 0) {
+#ifdef HAVE_PREAD
+	ssize_t nread = pread(mmapio->mapfd,buf,extent,offset);
+#else
+	ssize_t nread = -1;
+	if(lseek(mmapio->mapfd,offset,SEEK_SET) == offset)
+	    nread = read(mmapio->mapfd,buf,extent);
+#endif
+	if(nread < 0) {
+	    if(errno == EINTR) continue;
+	    return errno;
+	}
+	if(nread == 0) {
+	    memset(buf,0,extent);
+	    break;
+	}
+	buf += nread;
+	offset += nread;
+	extent -= (size_t)nread;
+    }
+    return NC_NOERR;
+}
+
 /*
  * Request that the region (offset, extent)
  * be made available through *vpp.
@@ -524,6 +619,51 @@ mmapio_get(ncio* const nciop, off_t offset, size_t extent, int rflags, void** co
     NCMMAPIO* mmapio;
     if(nciop == NULL || nciop->pvt == NULL) return NC_EINVAL;
     mmapio = (NCMMAPIO*)nciop->pvt;
+    if(!fIsSet(nciop->ioflags, NC_WRITE)) {
+	NCMMAPScratch* region;
+	/* mmapio_rel only knows the offset, so a region past the end of
+	   file still held at this offset is shared, and cannot be
+	   replaced by a larger one */
+	for(region=mmapio->scratch;region!=NULL;region=region->next) {
+	    if(region->offset == offset) break;
+	}
+	if(region != NULL) {
+	    if(extent > region->extent) return NC_EINVAL;
+	    region->refs++;
+	    mmapio->locked++;
+	    if(vpp) *vpp = region->data;
+	    return NC_NOERR;
+	}
+	/* Point into the mapping; the file may have grown since it was
+	   mapped, and past the end of file reads as zero */
+	if(offset + (off_t)extent > mmapio->size) {
+	    status = mmapio_grow(nciop);
+	    if(status != NC_NOERR) return status;
+	}
+	if(offset + (off_t)extent > mmapio->size) {
+	    off_t avail = (offset < mmapio->size ? mmapio->size - offset : 0);
+	    region = (NCMMAPScratch*)malloc(sizeof(NCMMAPScratch)+extent);
+	    if(region == NULL) return NC_ENOMEM;
+	    region->offset = offset;
+	    region->extent = extent;
+	    region->refs = 1;
+	    region->data = (char*)(region+1);
+	    if(avail > 0)
+		memcpy(region->data,mmapio->memory+offset,(size_t)avail);
+	    /* what the mapping does not cover is read from the file */
+	    status = mmapio_pread(mmapio,offset+avail,
+				  extent-(size_t)avail,region->data+avail);
+	    if(status != NC_NOERR) {free(region); return status;}
+	    region->next = mmapio->scratch;
+	    mmapio->scratch = region;
+	    mmapio->locked++;
+	    if(vpp) *vpp = region->data;
+	    return NC_NOERR;
+	}
+	mmapio->locked++;
+	if(vpp) *vpp = mmapio->memory+offset;
+	return NC_NOERR;
+    }
     status = guarantee(nciop, offset+extent);
     mmapio->locked++;
     if(status != NC_NOERR) return status;
@@ -592,7 +732,20 @@ mmapio_rel(ncio* const nciop, off_t offset, int rflags)
     if(nciop == NULL || nciop->pvt == NULL) return NC_EINVAL;
     mmapio = (NCMMAPIO*)nciop->pvt;
     mmapio->locked--;
-    return NC_NOERR; /* do nothing */
+    /* Free the buffer of a region past the end of file */
+    {
+	NCMMAPScratch** linkp = &mmapio->scratch;
+	for(;*linkp != NULL;linkp=&(*linkp)->next) {
+	    NCMMAPScratch* region = *linkp;
+	    if(region->offset != offset) continue;
+	    if(--region->refs == 0) {
+		*linkp = region->next;
+		free(region);
+	    }
+	    break;
+	}
+    }
+    return NC_NOERR;
 }
 
 /*
@@ -169,6 +169,7 @@ NC_NOOP_inq_var_filter_info,
 
 NC_NOTNC4_def_var_quantize,
 NC_NOTNC4_inq_var_quantize,
+NC_NOSTATS_inq_var_stats,
 };
 
 const NC_Dispatch* NC3_dispatch_table = NULL; /*!< NC3 Dispatch table, moved here from ddispatch.c */
@@ -7,11 +7,18 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
 
 #include "netcdf.h"
 #include "ncio.h"
 #include "fbits.h"
+#include "ncpathmgr.h"
+#include "ncrc.h"
 
 /* With the advent of diskless io, we need to provide
    for multiple ncio packages at the same time,
@@ -46,6 +53,43 @@ extern int ffio_open(const char*,int,off_t,size_t,size_t*,void*,ncio**,void** co
      extern int memio_create(const char*,int,size_t,off_t,size_t,size_t*,void*,ncio**,void** const);
      extern int memio_open(const char*,int,off_t,size_t,size_t*,void*,ncio**,void** const);
 
+#ifdef USE_MMAP
+/* Files at least as large as the NETCDF.MMAP.MINSIZE .rc key (in
+   bytes) that are opened read-only are mapped rather than read
+   through a buffer, so that the data is converted straight from the
+   mapping into the caller's memory. This is opt-in: a file that is
+   truncated while it is mapped makes the reader fail with SIGBUS
+   where a buffered reader gets an error or zeros. */
+static off_t
+ncio_mmapminsize(void)
+{
+    const char* value = NC_rclookup("NETCDF.MMAP.MINSIZE",NULL,NULL);
+    long long minsize = 0;
+    if(value == NULL || sscanf(value,"%lld",&minsize) != 1 || minsize <= 0)
+        return 0;
+    return (off_t)minsize;
+}
+
+/* Is path a local file for which a read-only mapping should be used? */
+static int
+ncio_usemmap(const char* path, int ioflags)
+{
+    struct stat buf;
+    off_t minsize = ncio_mmapminsize();
+    if(minsize <= 0)
+        return 0;
+    /* NC_SHARE readers must see records appended after the open */
+    if(fIsSet(ioflags,NC_WRITE) || fIsSet(ioflags,NC_SHARE))
+        return 0;
+    if(NCstat(path,&buf) < 0 || !S_ISREG(buf.st_mode))
+        return 0;
+    /* A 32 bit address space cannot hold a large mapping */
+    if(sizeof(void*) < 8)
+        return 0;
+    return (buf.st_size >= minsize);
+}
+#endif /*USE_MMAP*/
+
 int
 ncio_create(const char *path, int ioflags, size_t initialsz,
                        off_t igeto, size_t igetsz, size_t *sizehintp,
@@ -103,6 +147,16 @@ ncio_open(const char *path, int ioflags,
    }
 #  endif
 #  endif /*ENABLE_BYTERANGE*/
+#  ifdef USE_MMAP
+    if(ncio_usemmap(path,ioflags)) {
+        /* Fall back to ordinary reads if the file cannot be mapped */
+        size_t sizehint = *sizehintp;
+        if(mmapio_open(path,ioflags,igeto,igetsz,&sizehint,parameters,iopp,mempp) == NC_NOERR) {
+            *sizehintp = sizehint;
+            return NC_NOERR;
+        }
+    }
+#  endif /*USE_MMAP*/
 
 #ifdef USE_STDIO
     return stdio_open(path,ioflags,igeto,igetsz,sizehintp,parameters,iopp,mempp);
@@ -129,6 +183,34 @@ ncio_get(ncio* const nciop, off_t offset, size_t extent,
     return nciop->get(nciop,offset,extent,rflags,vpp);
 }
 
+/* Without a vectored read in the layer, or when the file may be
+   written to, get the regions one at a time; callers keep extent
+   within the chunk size, as for any other get.
+   A layer's vectored read goes to the file on every call and keeps
+   nothing, so NC_SHARE readers, which must see what other processes
+   have written since the open, are as safe with it as with the
+   per-get reads of the shared layer. It is not used with NC_WRITE,
+   where a dirty buffer of this process may be newer than the file. */
+int
+ncio_getv(ncio* const nciop, size_t nregions, const off_t *offsets,
+			size_t extent, void *buf)
+{
+    char *cp = (char *)buf;
+    size_t i;
+
+    if(nciop->getv != NULL && !fIsSet(nciop->ioflags, NC_WRITE))
+        return nciop->getv(nciop,nregions,offsets,extent,buf);
+    for(i = 0; i < nregions; i++, cp += extent) {
+        void *vp;
+        int status = nciop->get(nciop,offsets[i],extent,0,&vp);
+        if(status != NC_NOERR)
+            return status;
+        (void)memcpy(cp,vp,extent);
+        (void)nciop->rel(nciop,offsets[i],0);
+    }
+    return NC_NOERR;
+}
+
 int
 ncio_move(ncio* const nciop, off_t to, off_t from, size_t nbytes, int rflags)
 {
@@ -61,6 +61,17 @@ typedef int ncio_getfunc(ncio *const nciop,
 			int rflags,
 			void **const vpp);
 
+	/*
+	 * Copy the regions (offsets[i], extent), i < nregions, one
+	 * after the other into buf. The offsets are increasing and
+	 * the regions do not overlap. Optional (may be NULL), and
+	 * only used on files open read-only, so an implementation may
+	 * read the file around its buffers.
+	 */
+typedef int ncio_getvfunc(ncio *const nciop,
+			size_t nregions, const off_t *offsets,
+			size_t extent, void *buf);
+
 	/*
 	 * Like memmove(), safely move possibly overlapping data.
 	 * Only reasonable flag value is RGN_NOLOCK.
@@ -136,6 +147,8 @@ struct ncio {
   
 	ncio_closefunc *NCIO_CONST close;
 
+	ncio_getvfunc *NCIO_CONST getv;
+
 	/*
 	 * A copy of the 'path' argument passed in to ncio_open()
 	 * or ncio_create(). Used by ncabort() to remove (unlink)
@@ -153,6 +166,7 @@ struct ncio {
 
 extern int ncio_rel(ncio* const, off_t, int);
 extern int ncio_get(ncio* const, off_t, size_t, int, void** const);
+extern int ncio_getv(ncio* const, size_t, const off_t*, size_t, void*);
 extern int ncio_move(ncio* const, off_t, off_t, size_t, int);
 extern int ncio_sync(ncio* const);
 extern int ncio_filesize(ncio* const, off_t*);
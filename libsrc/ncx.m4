@@ -175,6 +175,13 @@ define(`FillDefaultValue', `ifelse(
 #define Min(a,b) ((a) < (b) ? (a) : (b))
 #define Max(a,b) ((a) > (b) ? (a) : (b))
 
+/* number of elements the blocked getn/putn routines convert at a time,
+   and the fewest worth converting as a block */
+#ifndef NCX_BLOCK
+#define NCX_BLOCK 256
+#endif
+#define NCX_BLOCK_MIN 8
+
 #ifndef SIZEOF_UCHAR
 #ifdef  SIZEOF_UNSIGNED_CHAR
 #define SIZEOF_UCHAR SIZEOF_UNSIGNED_CHAR
@@ -300,16 +307,121 @@ static const char nada[X_ALIGN] = {0, 0, 0, 0};
 #define inline __inline
 #endif
 
+/*
+ * Vector versions of the swapn?b() loops. SSE2 is part of every x86_64
+ * cpu, so it is used whenever the compiler targets it. AVX2 is compiled
+ * in with a target attribute and used only when the cpu running the
+ * library reports it. Each returns the number of elements it swapped;
+ * the caller swaps the rest one at a time.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NCX_SSE2 1
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#include <immintrin.h>
+#define NCX_AVX2 1
+#endif
+#endif
+
+#ifdef NCX_AVX2
+static int ncx_avx2 = -1; /* -1 => not yet asked */
+
+static int
+ncx_have_avx2(void)
+{
+    if (ncx_avx2 < 0) {
+        __builtin_cpu_init();
+        ncx_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return ncx_avx2;
+}
+
+/* size is the element size: 2, 4 or 8 */
+__attribute__((target("avx2")))
+static IntType
+swapn_avx2(void *dst, const void *src, IntType nn, IntType size)
+{
+    const __m256i shuf2 = _mm256_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14,
+                                           1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+    const __m256i shuf4 = _mm256_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12,
+                                           3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+    const __m256i shuf8 = _mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,
+                                           7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+    const __m256i shuf = (size == 2 ? shuf2 : size == 4 ? shuf4 : shuf8);
+    const IntType per = 64 / size; /* two vectors per iteration */
+    const char *ip = (const char *) src;
+    char *op = (char *) dst;
+    IntType i;
+
+    for (i = 0; i + per <= nn; i += per, ip += 64, op += 64) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *) ip);
+        __m256i v1 = _mm256_loadu_si256((const __m256i *) (ip + 32));
+        _mm256_storeu_si256((__m256i *) op, _mm256_shuffle_epi8(v0, shuf));
+        _mm256_storeu_si256((__m256i *) (op + 32), _mm256_shuffle_epi8(v1, shuf));
+    }
+    return i;
+}
+#endif /* NCX_AVX2 */
+
+#ifdef NCX_SSE2
+/* SSE2 has no byte shuffle: swap the bytes of each 16 bit word, then
+   the words of each 32 or 64 bit element */
+static IntType
+swapn_sse2(void *dst, const void *src, IntType nn, IntType size)
+{
+    const IntType per = 16 / size;
+    const char *ip = (const char *) src;
+    char *op = (char *) dst;
+    IntType i;
+
+    for (i = 0; i + per <= nn; i += per, ip += 16, op += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) ip);
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        if (size == 4) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2,3,0,1));
+        } else if (size == 8) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0,1,2,3));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0,1,2,3));
+        }
+        _mm_storeu_si128((__m128i *) op, v);
+    }
+    return i;
+}
+#endif /* NCX_SSE2 */
+
+/* Swap as many leading elements as the vector kernels can handle. */
+inline static IntType
+swapn_vector(void *dst, const void *src, IntType nn, IntType size)
+{
+    IntType done = 0;
+#ifdef NCX_AVX2
+    if (nn >= 64 / size && ncx_have_avx2())
+        done = swapn_avx2(dst, src, nn, size);
+#endif
+#ifdef NCX_SSE2
+    if (nn - done >= 16 / size)
+        done += swapn_sse2((char *) dst + done * size,
+                           (const char *) src + done * size, nn - done, size);
+#endif
+    return done;
+}
+
 inline static void
 swapn2b(void *dst, const void *src, IntType nn)
 {
     /* it is OK if dst == src */
-    int i;
-    uint16_t *op = (uint16_t*) dst;
-    uint16_t *ip = (uint16_t*) src;
-    for (i=0; i<nn; i++) {
-        op[i] = ip[i];
-        op[i] = (uint16_t)SWAP2(op[i]);
+    /* memcpy, because the blocked getn/putn routines pass buffers of
+       other types, which must not be accessed through uint16_t */
+    IntType i;
+    char *op = (char*) dst;
+    const char *ip = (const char*) src;
+    for (i=swapn_vector(dst, src, nn, 2); i<nn; i++) {
+        uint16_t tmp;
+        memcpy(&tmp, ip + i*2, 2);
+        tmp = (uint16_t)SWAP2(tmp);
+        memcpy(op + i*2, &tmp, 2);
     }
 #if 0
 	char *op = dst;
@@ -348,7 +460,8 @@ inline static void
 swap4b(void *dst, const void *src)
 {
     /* copy over, make the below swap in-place */
-    uint32_t tmp = *(uint32_t*)src;
+    uint32_t tmp;
+    memcpy(&tmp, src, 4);
     tmp = SWAP4(tmp);
     memcpy(dst, &tmp, 4);
 
@@ -393,13 +506,14 @@ swap4b(void *dst, const void *src)
 inline static void
 swapn4b(void *dst, const void *src, IntType nn)
 {
-    int i;
-    uint32_t *op = (uint32_t*) dst;
-    uint32_t *ip = (uint32_t*) src;
-    for (i=0; i<nn; i++) {
-        /* copy over, make the below swap in-place */
-        op[i] = ip[i];
-        op[i] = SWAP4(op[i]);
+    IntType i;
+    char *op = (char*) dst;
+    const char *ip = (const char*) src;
+    for (i=swapn_vector(dst, src, nn, 4); i<nn; i++) {
+        uint32_t tmp;
+        memcpy(&tmp, ip + i*4, 4);
+        tmp = SWAP4(tmp);
+        memcpy(op + i*4, &tmp, 4);
     }
 
 #if 0
@@ -464,7 +578,8 @@ swap8b(void *dst, const void *src)
     op = (uint32_t*)((char*)dst+4);
     *op = SWAP4(*op);
 #else
-    uint64_t tmp = *(uint64_t*)src;
+    uint64_t tmp;
+    memcpy(&tmp, src, 8);
     tmp = SWAP8(tmp);
     memcpy(dst, &tmp, 8);
 
@@ -518,13 +633,14 @@ swapn8b(void *dst, const void *src, IntType nn)
         *op = SWAP4(*op);
     }
 #else
-    int i;
-    uint64_t *op = (uint64_t*) dst;
-    uint64_t *ip = (uint64_t*) src;
-    for (i=0; i<nn; i++) {
-        /* copy over, make the below swap in-place */
-        op[i] = ip[i];
-        op[i] = SWAP8(op[i]);
+    IntType i;
+    char *op = (char*) dst;
+    const char *ip = (const char*) src;
+    for (i=swapn_vector(dst, src, nn, 8); i<nn; i++) {
+        uint64_t tmp;
+        memcpy(&tmp, ip + i*8, 8);
+        tmp = SWAP8(tmp);
+        memcpy(op + i*8, &tmp, 8);
     }
 #endif
 
@@ -623,6 +739,18 @@ define(`Xmax',             ``X_'Upcase($1)`_MAX'')dnl
 define(`Xmin',             ``X_'Upcase($1)`_MIN'')dnl
 define(`IXmax',           ``IX_'Upcase($1)`_MAX'')dnl
 dnl
+dnl NativeX(xtype): is the external type held in memory by ix_xtype of the same size?
+define(`NativeX', `ifelse(`$1', `float',  `Xsizeof($1) == Isizeof($1) && !defined(NO_IEEE_FLOAT)',
+                          `$1', `double', `Xsizeof($1) == Isizeof($1) && !defined(NO_IEEE_FLOAT)',
+                                          `Xsizeof($1) == IXsizeof($1)')')dnl
+dnl SwapN(xtype): the swapn?b() routine for the external type
+define(`SwapN', `ifelse(`$1', `short',  `swapn2b',
+                        `$1', `ushort', `swapn2b',
+                        `$1', `int',    `swapn4b',
+                        `$1', `uint',   `swapn4b',
+                        `$1', `float',  `swapn4b',
+                                        `swapn8b')')dnl
+dnl
 define(`Fmin',  `ifelse(index(`$1',`u'), 0, `0', `(double)Imin($1)')')dnl
 define(`Dmin',  `ifelse(index(`$1',`u'), 0, `0', `(double)Imin($1)')')dnl
 define(`FXmin', `ifelse(index(`$1',`u'), 0, `0', `(double)Xmin($1)')')dnl
@@ -2645,6 +2773,48 @@ APIPrefix`x_getn_'NC_TYPE($1)_$2(const void **xpp, IntType nelems, $2 *tp)
 ')dnl
 dnl dnl dnl
 dnl
+dnl NCX_GETN_BLOCK(xtype, itype) for conversions that can never be out of
+dnl range: a block of external values is swapped at once and then converted
+dnl in a loop the compiler can vectorize. Otherwise same as NCX_GETN.
+dnl
+define(`NCX_GETN_BLOCK',dnl
+`dnl
+`#'if NativeX($1) && !(defined(_SX) && _SX != 0)
+int
+APIPrefix`x_getn_'NC_TYPE($1)_$2(const void **xpp, IntType nelems, $2 *tp)
+{
+	const char *xp = (const char *) *xpp;
+	ix_$1 tmp[NCX_BLOCK];
+
+	while (nelems >= NCX_BLOCK_MIN)
+	{
+		const IntType ni = Min(nelems, NCX_BLOCK);
+		IntType i;
+`#'ifdef WORDS_BIGENDIAN
+		(void) memcpy(tmp, xp, (size_t)ni * Xsizeof($1));
+`#'else
+		SwapN($1)(tmp, xp, ni);
+`#'endif
+		for (i = 0; i < ni; i++)
+			tp[i] = ($2) tmp[i];
+		xp += ni * Xsizeof($1);
+		tp += ni;
+		nelems -= ni;
+	}
+
+	/* a short tail is converted one value at a time */
+	for( ; nelems != 0; nelems--, xp += Xsizeof($1), tp++)
+		(void) APIPrefix`x_get_'NC_TYPE($1)_$2(xp, tp);
+
+	*xpp = (const void *)xp;
+	return NC_NOERR;
+}
+`#'else
+NCX_GETN($1, $2)dnl
+`#'endif
+')dnl
+dnl dnl dnl
+dnl
 dnl NCX_PAD_GETN_SHORT(xtype ttype)
 dnl
 define(`NCX_PAD_GETN_SHORT',dnl
@@ -2854,6 +3024,78 @@ ifelse( $1$2, intfloat,dnl
 ')dnl
 dnl dnl dnl
 dnl
+dnl NCX_PUTN_BLOCK(xtype, itype) is NCX_GETN_BLOCK for puts. A block
+dnl holding a value out of the external range (only possible for float to
+dnl double, for infinities) is redone one value at a time.
+dnl
+define(`NCX_PUTN_BLOCK',dnl
+`dnl
+`#'if NativeX($1) && !(defined(_SX) && _SX != 0)
+int
+APIPrefix`x_putn_'NC_TYPE($1)_$2(void **xpp, IntType nelems, const $2 *tp, void *fillp)
+{
+	char *xp = (char *) *xpp;
+	int status = NC_NOERR;
+	ix_$1 tmp[NCX_BLOCK];
+
+	while (nelems >= NCX_BLOCK_MIN)
+	{
+		const IntType ni = Min(nelems, NCX_BLOCK);
+		IntType i;
+ifelse(`$1$2', `doublefloat', `dnl
+		/* only a float infinity (or NaN) can fall outside the
+		 * external double range; test the exponent bits so that
+		 * the check vectorizes */
+		uint32_t nonfinite = 0;
+		for (i = 0; i < ni; i++)
+		{
+			uint32_t bits;
+			(void) memcpy(&bits, tp + i, sizeof(bits));
+			nonfinite |= ((bits & 0x7f800000) == 0x7f800000);
+		}
+		for (i = 0; i < ni; i++)
+			tmp[i] = (ix_$1) tp[i];
+		if (nonfinite != 0)
+		{
+			for (i = 0; i < ni; i++)
+			{
+				const int lstatus = APIPrefix`x_put_'NC_TYPE($1)_$2(xp + i * Xsizeof($1), tp + i, fillp);
+				if (status == NC_NOERR) /* report the first encountered error */
+					status = lstatus;
+			}
+		}
+		else
+',`dnl
+		for (i = 0; i < ni; i++)
+			tmp[i] = (ix_$1) tp[i];
+')dnl
+`#'ifdef WORDS_BIGENDIAN
+		(void) memcpy(xp, tmp, (size_t)ni * Xsizeof($1));
+`#'else
+		SwapN($1)(xp, tmp, ni);
+`#'endif
+		xp += ni * Xsizeof($1);
+		tp += ni;
+		nelems -= ni;
+	}
+
+	/* a short tail is converted one value at a time */
+	for( ; nelems != 0; nelems--, xp += Xsizeof($1), tp++)
+	{
+		const int lstatus = APIPrefix`x_put_'NC_TYPE($1)_$2(xp, tp, fillp);
+		if (status == NC_NOERR) /* report the first encountered error */
+			status = lstatus;
+	}
+
+	*xpp = (void *)xp;
+	return status;
+}
+`#'else
+NCX_PUTN($1, $2)dnl
+`#'endif
+')dnl
+dnl dnl dnl
+dnl
 dnl NCX_PAD_PUTN_SHORT(xtype, ttype)
 dnl
 define(`NCX_PAD_PUTN_SHORT',dnl
@@ -3133,11 +3375,11 @@ APIPrefix`x_getn_'NC_TYPE(short)_short(const void **xpp, IntType nelems, short *
 NCX_GETN(short, short)
 #endif
 NCX_GETN(short, schar)
-NCX_GETN(short, int)
-NCX_GETN(short, long)
-NCX_GETN(short, float)
-NCX_GETN(short, double)
-NCX_GETN(short, longlong)
+NCX_GETN_BLOCK(short, int)
+NCX_GETN_BLOCK(short, long)
+NCX_GETN_BLOCK(short, float)
+NCX_GETN_BLOCK(short, double)
+NCX_GETN_BLOCK(short, longlong)
 NCX_GETN(short, uchar)
 NCX_GETN(short, ushort)
 NCX_GETN(short, uint)
@@ -3215,14 +3457,14 @@ NCX_GETN(ushort, ushort)
 #endif
 NCX_GETN(ushort, schar)
 NCX_GETN(ushort, short)
-NCX_GETN(ushort, int)
-NCX_GETN(ushort, long)
-NCX_GETN(ushort, float)
-NCX_GETN(ushort, double)
-NCX_GETN(ushort, longlong)
+NCX_GETN_BLOCK(ushort, int)
+NCX_GETN_BLOCK(ushort, long)
+NCX_GETN_BLOCK(ushort, float)
+NCX_GETN_BLOCK(ushort, double)
+NCX_GETN_BLOCK(ushort, longlong)
 NCX_GETN(ushort, uchar)
-NCX_GETN(ushort, uint)
-NCX_GETN(ushort, ulonglong)
+NCX_GETN_BLOCK(ushort, uint)
+NCX_GETN_BLOCK(ushort, ulonglong)
 
 NCX_PAD_GETN_SHORT(ushort, schar)
 NCX_PAD_GETN_SHORT(ushort, short)
@@ -3296,10 +3538,10 @@ NCX_GETN(int, int)
 #endif
 NCX_GETN(int, schar)
 NCX_GETN(int, short)
-NCX_GETN(int, long)
-NCX_GETN(int, float)
-NCX_GETN(int, double)
-NCX_GETN(int, longlong)
+NCX_GETN_BLOCK(int, long)
+NCX_GETN_BLOCK(int, float)
+NCX_GETN_BLOCK(int, double)
+NCX_GETN_BLOCK(int, longlong)
 NCX_GETN(int, uchar)
 NCX_GETN(int, ushort)
 NCX_GETN(int, uint)
@@ -3322,7 +3564,7 @@ APIPrefix`x_putn_'NC_TYPE(int)_int(void **xpp, IntType nelems, const int *tp, vo
 NCX_PUTN(int, int)
 #endif
 NCX_PUTN(int, schar)
-NCX_PUTN(int, short)
+NCX_PUTN_BLOCK(int, short)
 NCX_PUTN(int, long)
 NCX_PUTN(int, float)
 NCX_PUTN(int, double)
@@ -3354,12 +3596,12 @@ NCX_GETN(uint, schar)
 NCX_GETN(uint, short)
 NCX_GETN(uint, int)
 NCX_GETN(uint, long)
-NCX_GETN(uint, float)
-NCX_GETN(uint, double)
-NCX_GETN(uint, longlong)
+NCX_GETN_BLOCK(uint, float)
+NCX_GETN_BLOCK(uint, double)
+NCX_GETN_BLOCK(uint, longlong)
 NCX_GETN(uint, uchar)
 NCX_GETN(uint, ushort)
-NCX_GETN(uint, ulonglong)
+NCX_GETN_BLOCK(uint, ulonglong)
 
 #if X_SIZEOF_UINT == SIZEOF_UINT
 /* optimized version */
@@ -3442,7 +3684,7 @@ NCX_GETN(float, schar)
 NCX_GETN(float, short)
 NCX_GETN(float, int)
 NCX_GETN(float, long)
-NCX_GETN(float, double)
+NCX_GETN_BLOCK(float, double)
 NCX_GETN(float, longlong)
 NCX_GETN(float, ushort)
 NCX_GETN(float, uchar)
@@ -3489,8 +3731,8 @@ APIPrefix`x_putn_'NC_TYPE(float)_float(void **xpp, IntType nelems, const float *
 }
 #endif
 NCX_PUTN(float, schar)
-NCX_PUTN(float, short)
-NCX_PUTN(float, int)
+NCX_PUTN_BLOCK(float, short)
+NCX_PUTN_BLOCK(float, int)
 NCX_PUTN(float, long)
 NCX_PUTN(float, double)
 NCX_PUTN(float, longlong)
@@ -3605,10 +3847,10 @@ APIPrefix`x_putn_'NC_TYPE(double)_double(void **xpp, IntType nelems, const doubl
 }
 #endif
 NCX_PUTN(double, schar)
-NCX_PUTN(double, short)
-NCX_PUTN(double, int)
+NCX_PUTN_BLOCK(double, short)
+NCX_PUTN_BLOCK(double, int)
 NCX_PUTN(double, long)
-NCX_PUTN(double, float)
+NCX_PUTN_BLOCK(double, float)
 NCX_PUTN(double, longlong)
 NCX_PUTN(double, uchar)
 NCX_PUTN(double, ushort)
@@ -3662,8 +3904,8 @@ APIPrefix`x_putn_'NC_TYPE(int64)_longlong(void **xpp, IntType nelems, const long
 NCX_PUTN(int64, longlong)
 #endif
 NCX_PUTN(int64, schar)
-NCX_PUTN(int64, short)
-NCX_PUTN(int64, int)
+NCX_PUTN_BLOCK(int64, short)
+NCX_PUTN_BLOCK(int64, int)
 NCX_PUTN(int64, long)
 NCX_PUTN(int64, float)
 NCX_PUTN(int64, double)
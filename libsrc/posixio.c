@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
 
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
@@ -36,6 +37,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_PREADV
+#include <sys/uio.h>
+#endif
 
 #ifndef NC_NOERR
 #define NC_NOERR 0
@@ -106,6 +110,36 @@ static int ncio_spx_close(ncio *nciop, int doUnlink);
 #define POSIXIO_DEFAULT_PAGESIZE 4096
 #endif
 
+/* Memory for the buffers kept by ncio_px; each buffer holds two
+   blocks of the chunksizehint, so the hint sets their number. */
+#ifndef POSIXIO_DEFAULT_CACHESIZE
+#define POSIXIO_DEFAULT_CACHESIZE 4194304
+#endif
+#ifndef POSIXIO_MAXBUFS
+#define POSIXIO_MAXBUFS 64
+#endif
+
+/* Vectored reads join regions no further apart than POSIXIO_MAXGAP
+   into runs of at most POSIXIO_MAXSPAN bytes read with one system
+   call; larger gaps cost more to copy than another call. Regions of
+   POSIXIO_MINIOV bytes or more are read with preadv(), using at most
+   POSIXIO_MAXIOV iovecs, smaller ones cost less to copy out of a
+   read of the whole run. */
+#ifndef POSIXIO_MAXGAP
+#define POSIXIO_MAXGAP 4096
+#endif
+#ifndef POSIXIO_MAXSPAN
+#define POSIXIO_MAXSPAN 262144
+#endif
+#ifndef POSIXIO_MINIOV
+#define POSIXIO_MINIOV 512
+#endif
+#if defined(IOV_MAX) && IOV_MAX < 256
+#define POSIXIO_MAXIOV IOV_MAX
+#else
+#define POSIXIO_MAXIOV 256
+#endif
+
 /*! Cross-platform file length.
  *
  * Some versions of Visual Studio are throwing errno 132
@@ -412,7 +446,20 @@ px_pgin(ncio *const nciop,
    of data in the buffer.
    bf_refcount - buffer reference count.
    slave - used in moves.
+   pool - buffers other than the current one that are still in
+   memory, so that access alternating between regions of the file,
+   such as between record variables, need not reread them. Parked
+   buffers never overlap each other or the current buffer, and
+   modified ones are written out when they are evicted or synced.
 */
+typedef struct ncio_px_buf {
+	off_t	bf_offset;
+	size_t	bf_extent;
+	size_t	bf_cnt;
+	void	*bf_base;
+	int	bf_rflags;
+} ncio_px_buf;
+
 typedef struct ncio_px {
 	size_t blksz;
 	off_t pos;
@@ -425,9 +472,181 @@ typedef struct ncio_px {
 	int	bf_refcount;
 	/* chain for double buffering in px_move */
 	struct ncio_px *slave;
+	/* parked buffers; least recently used first */
+	struct {
+		size_t nbufs; /* max no. of parked buffers; 0 => none */
+		size_t cnt;
+		ncio_px_buf *bufs;
+	} pool;
 } ncio_px;
 
 
+/* Write out a parked buffer if it was modified. */
+static int
+px_pool_pgout(ncio *const nciop, ncio_px *const pxp, ncio_px_buf *bp)
+{
+	int status = NC_NOERR;
+	if(fIsSet(bp->bf_rflags, RGN_MODIFIED))
+	{
+		status = px_pgout(nciop, bp->bf_offset,
+			bp->bf_cnt,
+			bp->bf_base, &pxp->pos);
+		if(status != NC_NOERR)
+			return status;
+		fClr(bp->bf_rflags, RGN_MODIFIED);
+	}
+	return status;
+}
+
+/* Remove parked buffer i, keeping the order of the rest. */
+static void
+px_pool_remove(ncio_px *const pxp, size_t i)
+{
+	assert(i < pxp->pool.cnt);
+	pxp->pool.cnt--;
+	if(i < pxp->pool.cnt)
+		(void) memmove(&pxp->pool.bufs[i], &pxp->pool.bufs[i+1],
+			(pxp->pool.cnt - i) * sizeof(ncio_px_buf));
+}
+
+/* Write out and forget the parked buffers that overlap the file
+   region (offset, extent), before the region is read into the
+   current buffer. */
+static int
+px_pool_drop(ncio *const nciop, ncio_px *const pxp,
+	off_t offset, size_t extent)
+{
+	int status = NC_NOERR;
+	size_t i;
+	for(i = 0; i < pxp->pool.cnt;)
+	{
+		ncio_px_buf *bp = &pxp->pool.bufs[i];
+		if(bp->bf_offset >= offset + (off_t)extent
+			 || offset >= bp->bf_offset + (off_t)bp->bf_extent)
+		{
+			i++;
+			continue;
+		}
+		status = px_pool_pgout(nciop, pxp, bp);
+		if(status != NC_NOERR)
+			return status;
+		free(bp->bf_base);
+		px_pool_remove(pxp, i);
+	}
+	return status;
+}
+
+/* Write out the modified parked buffers. Forget all of them if
+   invalidate is set, and otherwise the ones never written to, so
+   that a reader sees the file as it now is. */
+static int
+px_pool_sync(ncio *const nciop, ncio_px *const pxp, int invalidate)
+{
+	int status = NC_NOERR;
+	size_t i;
+	for(i = 0; i < pxp->pool.cnt;)
+	{
+		ncio_px_buf *bp = &pxp->pool.bufs[i];
+		status = px_pool_pgout(nciop, pxp, bp);
+		if(status != NC_NOERR)
+			return status;
+		if(!invalidate && fIsSet(bp->bf_rflags, RGN_WRITE))
+		{
+			i++;
+			continue;
+		}
+		free(bp->bf_base);
+		px_pool_remove(pxp, i);
+	}
+	return status;
+}
+
+/* Move the current buffer, if it holds anything, to the most
+   recently used end of the pool, and give the current buffer
+   fresh memory; if the pool is full, that of the least recently
+   used parked buffer. */
+static int
+px_pool_park(ncio *const nciop, ncio_px *const pxp)
+{
+	int status = NC_NOERR;
+	void *base = NULL;
+	ncio_px_buf *bp;
+
+	assert(pxp->bf_refcount <= 0);
+	if(pxp->bf_offset == OFF_NONE || pxp->bf_base == NULL)
+		return NC_NOERR;
+	if(pxp->pool.cnt == pxp->pool.nbufs)
+	{
+		/* evict */
+		status = px_pool_pgout(nciop, pxp, &pxp->pool.bufs[0]);
+		if(status != NC_NOERR)
+			return status;
+		base = pxp->pool.bufs[0].bf_base;
+		px_pool_remove(pxp, 0);
+	}
+	else
+	{
+		base = malloc(2 * pxp->blksz);
+		if(base == NULL)
+			return ENOMEM;
+	}
+	bp = &pxp->pool.bufs[pxp->pool.cnt++];
+	bp->bf_offset = pxp->bf_offset;
+	bp->bf_extent = pxp->bf_extent;
+	bp->bf_cnt = pxp->bf_cnt;
+	bp->bf_base = pxp->bf_base;
+	bp->bf_rflags = pxp->bf_rflags;
+
+	pxp->bf_offset = OFF_NONE;
+	pxp->bf_extent = 0;
+	pxp->bf_cnt = 0;
+	pxp->bf_base = base;
+	pxp->bf_rflags = 0;
+	return status;
+}
+
+/* If a parked buffer holds all of the file region (offset, extent),
+   make it the current buffer and park the current one in its place.
+   Returns 1 if so. */
+static int
+px_pool_get(ncio_px *const pxp, off_t offset, size_t extent)
+{
+	size_t i;
+	ncio_px_buf buf;
+
+	for(i = pxp->pool.cnt; i-- > 0;)
+	{
+		ncio_px_buf *bp = &pxp->pool.bufs[i];
+		if(offset >= bp->bf_offset
+			 && offset + (off_t)extent <= bp->bf_offset + (off_t)bp->bf_extent)
+			break;
+	}
+	if(i == (size_t)-1)
+		return 0; /* miss */
+	buf = pxp->pool.bufs[i];
+	px_pool_remove(pxp, i);
+	assert(pxp->bf_refcount <= 0);
+	if(pxp->bf_offset != OFF_NONE && pxp->bf_base != NULL)
+	{
+		/* park the current buffer in the slot just freed */
+		ncio_px_buf *bp = &pxp->pool.bufs[pxp->pool.cnt++];
+		bp->bf_offset = pxp->bf_offset;
+		bp->bf_extent = pxp->bf_extent;
+		bp->bf_cnt = pxp->bf_cnt;
+		bp->bf_base = pxp->bf_base;
+		bp->bf_rflags = pxp->bf_rflags;
+	}
+	else if(pxp->bf_base != NULL)
+		free(pxp->bf_base);
+	pxp->bf_offset = buf.bf_offset;
+	pxp->bf_extent = buf.bf_extent;
+	pxp->bf_cnt = buf.bf_cnt;
+	pxp->bf_base = buf.bf_base;
+	pxp->bf_rflags = buf.bf_rflags;
+	return 1;
+}
+
+
 /*ARGSUSED*/
 /* This function indicates the file region starting at offset may be
    released.
@@ -541,6 +760,16 @@ px_get(ncio *const nciop, ncio_px *const pxp,
 
 	if(2 * pxp->blksz < blkextent)
 		return E2BIG; /* TODO: temporary kludge */
+	if(pxp->pool.cnt > 0
+		 && (pxp->bf_offset == OFF_NONE
+			 || blkoffset < pxp->bf_offset
+			 || blkoffset + blkextent > pxp->bf_offset + (off_t)pxp->bf_extent)
+		 && px_pool_get(pxp, blkoffset, (size_t)blkextent))
+	{
+		/* hit in a parked buffer */
+		diff = offset - pxp->bf_offset;
+		goto done;
+	}
 	if(pxp->bf_offset == OFF_NONE)
 	{
 		/* Uninitialized */
@@ -566,6 +795,11 @@ px_get(ncio *const nciop, ncio_px *const pxp,
 			void *const middle =
 			 	(void *)((char *)pxp->bf_base + pxp->blksz);
 			assert(pxp->bf_extent == pxp->blksz);
+			status = px_pool_drop(nciop, pxp,
+				 pxp->bf_offset + (off_t)pxp->blksz,
+				 pxp->blksz);
+			if(status != NC_NOERR)
+				return status;
 			status = px_pgin(nciop,
 				 pxp->bf_offset + (off_t)pxp->blksz,
 				 pxp->blksz,
@@ -638,6 +872,11 @@ px_get(ncio *const nciop, ncio_px *const pxp,
 			/* page in upper */
 			void *const middle =
 			 	(void *)((char *)pxp->bf_base + pxp->blksz);
+			status = px_pool_drop(nciop, pxp,
+				 pxp->bf_offset + (off_t)pxp->blksz,
+				 pxp->blksz);
+			if(status != NC_NOERR)
+				return status;
 			status = px_pgin(nciop,
 				 pxp->bf_offset + (off_t)pxp->blksz,
 				 pxp->blksz,
@@ -685,6 +924,9 @@ px_get(ncio *const nciop, ncio_px *const pxp,
 			upper_cnt = pxp->bf_cnt;
 		}
 		/* read page below into lower half */
+		status = px_pool_drop(nciop, pxp, blkoffset, pxp->blksz);
+		if(status != NC_NOERR)
+			return status;
 		status = px_pgin(nciop,
 			 blkoffset,
 			 pxp->blksz,
@@ -708,7 +950,14 @@ px_get(ncio *const nciop, ncio_px *const pxp,
 	/* else */
 
 	/* no overlap */
-	if(fIsSet(pxp->bf_rflags, RGN_MODIFIED))
+	if(pxp->pool.nbufs > 0)
+	{
+		/* keep the current buffer in memory */
+		status = px_pool_park(nciop, pxp);
+		if(status != NC_NOERR)
+			return status;
+	}
+	else if(fIsSet(pxp->bf_rflags, RGN_MODIFIED))
 	{
 		assert(pxp->bf_refcount <= 0);
 		status = px_pgout(nciop,
@@ -722,6 +971,9 @@ px_get(ncio *const nciop, ncio_px *const pxp,
 	}
 
 pgin:
+	status = px_pool_drop(nciop, pxp, blkoffset, (size_t)blkextent);
+	if(status != NC_NOERR)
+		return status;
 	status = px_pgin(nciop,
 		 blkoffset,
 		 blkextent,
@@ -833,6 +1085,9 @@ fprintf(stderr, "\tdouble_buffr %ld %ld %ld\n",
 		pxp->slave->bf_rflags = 0;
 		pxp->slave->bf_refcount = 0;
 		pxp->slave->slave = NULL;
+		pxp->slave->pool.nbufs = 0;
+		pxp->slave->pool.cnt = 0;
+		pxp->slave->pool.bufs = NULL;
 	}
 
 	pxp->slave->pos = pxp->pos;
@@ -911,6 +1166,22 @@ fprintf(stderr, "ncio_px_move %ld %ld %ld %ld %ld\n",
 	{
 		size_t remaining = nbytes;
 
+		/* the slave reads the source from the file, and parked
+		   buffers would hide it from the slave, so write them out */
+		status = px_pool_sync(nciop, pxp, 1);
+		if(status != NC_NOERR)
+			return status;
+		if(fIsSet(pxp->bf_rflags, RGN_MODIFIED))
+		{
+			assert(pxp->bf_refcount <= 0);
+			status = px_pgout(nciop, pxp->bf_offset,
+				pxp->bf_cnt,
+				pxp->bf_base, &pxp->pos);
+			if(status != NC_NOERR)
+				return status;
+			fClr(pxp->bf_rflags, RGN_MODIFIED);
+		}
+
 if(to > from)
 {
 		off_t frm = from + nbytes;
@@ -980,6 +1251,9 @@ ncio_px_sync(ncio *const nciop)
 {
 	ncio_px *const pxp = (ncio_px *)nciop->pvt;
 	int status = NC_NOERR;
+	status = px_pool_sync(nciop, pxp, !fIsSet(nciop->ioflags, NC_WRITE));
+	if(status != NC_NOERR)
+		return status;
 	if(fIsSet(pxp->bf_rflags, RGN_MODIFIED))
 	{
 		assert(pxp->bf_refcount <= 0);
@@ -1032,6 +1306,16 @@ ncio_px_freepvt(void *const pvt)
 		pxp->bf_extent = 0;
 		pxp->bf_offset = OFF_NONE;
 	}
+
+	if(pxp->pool.bufs != NULL)
+	{
+		size_t i;
+		for(i = 0; i < pxp->pool.cnt; i++)
+			free(pxp->pool.bufs[i].bf_base);
+		free(pxp->pool.bufs);
+		pxp->pool.bufs = NULL;
+		pxp->pool.cnt = 0;
+	}
 }
 
 
@@ -1043,6 +1327,8 @@ ncio_px_freepvt(void *const pvt)
    the chunksizehint (rounded up to the nearest sizeof(double)) passed
    in from nc__create or nc__open. The rounded chunksizehint (passed
    in here in sizehintp) is going to be stored as pxp->blksize.
+   The number of buffers that may be parked besides this one is as
+   many more as fit in POSIXIO_DEFAULT_CACHESIZE.
 
    According to our "contract" we are not allowed to ask for an extent
    larger than this chunksize/sizehint/blksize from the ncio get
@@ -1072,6 +1358,18 @@ ncio_px_init2(ncio *const nciop, size_t *sizehintp, int isNew)
 		return ENOMEM;
 	/* else */
 	pxp->bf_cnt = 0;
+	/* buffers beyond the current one, allocated as they are parked */
+	pxp->pool.nbufs = POSIXIO_DEFAULT_CACHESIZE / bufsz;
+	if(pxp->pool.nbufs > POSIXIO_MAXBUFS)
+		pxp->pool.nbufs = POSIXIO_MAXBUFS;
+	if(pxp->pool.nbufs > 0)
+		pxp->pool.nbufs--;
+	if(pxp->pool.nbufs > 0)
+	{
+		pxp->pool.bufs = (ncio_px_buf *)calloc(pxp->pool.nbufs, sizeof(ncio_px_buf));
+		if(pxp->pool.bufs == NULL)
+			return ENOMEM;
+	}
 	if(isNew)
 	{
 		/* save a read */
@@ -1084,6 +1382,128 @@ ncio_px_init2(ncio *const nciop, size_t *sizehintp, int isNew)
 }
 
 
+#ifdef HAVE_PREAD
+/* Read extent bytes at offset into vp without moving the file
+   position, zero filling what lies past the end of the file. */
+static int
+px_pread(const int fd, off_t offset, size_t extent, void *const vp)
+{
+	char *cp = (char *)vp;
+	while(extent != 0)
+	{
+		const ssize_t nread = pread(fd, cp, extent, offset);
+		if(nread == -1)
+		{
+			if(errno == EINTR)
+				continue;
+			return errno;
+		}
+		if(nread == 0)
+		{
+			(void) memset(cp, 0, extent);
+			break;
+		}
+		cp += nread;
+		offset += nread;
+		extent -= (size_t)nread;
+	}
+	return NC_NOERR;
+}
+
+/* Copy the regions (offsets[i], extent) into buf straight from the
+   file. Used only for files open read-only, whose buffers never hold
+   anything newer than the file. A run of regions with small gaps
+   between them is read with one system call: when the regions are
+   small, as one read of the whole run whose gaps are then discarded,
+   and otherwise with preadv(), the gaps going to a scratch buffer.
+   Both the ncio_px and ncio_spx layers use this. */
+static int
+ncio_px_getv(ncio *const nciop, size_t nregions,
+	const off_t *offsets, size_t extent, void *buf)
+{
+	char *cp = (char *)buf;
+	char *scratch = NULL;
+	size_t i, n;
+	int status = NC_NOERR;
+#ifdef HAVE_PREADV
+	struct iovec iov[POSIXIO_MAXIOV];
+#endif
+
+	for(i = 0; i < nregions && status == NC_NOERR; i += n, cp += n * extent)
+	{
+		size_t span, j;
+
+		/* regions i .. i + n - 1 make up the run */
+		for(n = 1; i + n < nregions; n++)
+		{
+			if(extent >= POSIXIO_MINIOV && 2 * n >= POSIXIO_MAXIOV)
+				break;
+			const off_t end = offsets[i + n - 1] + (off_t)extent;
+			if(offsets[i + n] < end
+				 || offsets[i + n] - end > POSIXIO_MAXGAP
+				 || offsets[i + n] - offsets[i] + (off_t)extent > POSIXIO_MAXSPAN)
+				break;
+		}
+		span = (size_t)(offsets[i + n - 1] - offsets[i]) + extent;
+
+		if(span == n * extent)
+		{
+			/* no gaps */
+			status = px_pread(nciop->fd, offsets[i], span, cp);
+			continue;
+		}
+		if(scratch == NULL)
+		{
+			scratch = (char *)malloc(POSIXIO_MAXSPAN);
+			if(scratch == NULL)
+			{
+				status = ENOMEM;
+				break;
+			}
+		}
+#ifdef HAVE_PREADV
+		if(extent >= POSIXIO_MINIOV)
+		{
+			size_t niov = 0;
+			ssize_t nread;
+			for(j = 0; j < n; j++)
+			{
+				if(j > 0 && offsets[i + j] > offsets[i + j - 1] + (off_t)extent)
+				{
+					iov[niov].iov_base = scratch;
+					iov[niov].iov_len = (size_t)(offsets[i + j]
+						- offsets[i + j - 1]) - extent;
+					niov++;
+				}
+				iov[niov].iov_base = cp + j * extent;
+				iov[niov].iov_len = extent;
+				niov++;
+			}
+			do {
+				nread = preadv(nciop->fd, iov, (int)niov, offsets[i]);
+			} while(nread == -1 && errno == EINTR);
+			if(nread == (ssize_t)span)
+				continue;
+			if(nread == -1)
+			{
+				status = errno;
+				break;
+			}
+			/* else short, near the end of the file: fall through
+			 * to the read of the whole run */
+		}
+#endif
+		status = px_pread(nciop->fd, offsets[i], span, scratch);
+		for(j = 0; j < n && status == NC_NOERR; j++)
+			(void) memcpy(cp + j * extent,
+				scratch + (offsets[i + j] - offsets[i]), extent);
+	}
+	free(scratch);
+	return status;
+}
+#endif /* HAVE_PREAD */
+
+
 /* This is the first of a two-part initialization of the ncio struct.
    Here the rel, get, move, sync, and free function pointers are set
    to their POSIX non-NC_SHARE functions (ncio_px_*).
@@ -1102,6 +1522,11 @@ ncio_px_init(ncio *const nciop)
 	*((ncio_filesizefunc **)&nciop->filesize) = ncio_px_filesize; /* cast away const */
 	*((ncio_pad_lengthfunc **)&nciop->pad_length) = ncio_px_pad_length; /* cast away const */
 	*((ncio_closefunc **)&nciop->close) = ncio_px_close; /* cast away const */
+#ifdef HAVE_PREAD
+	*((ncio_getvfunc **)&nciop->getv) = ncio_px_getv; /* cast away const */
+#else
+	*((ncio_getvfunc **)&nciop->getv) = NULL; /* cast away const */
+#endif
 
 	pxp->blksz = 0;
 	pxp->pos = -1;
@@ -1111,6 +1536,9 @@ ncio_px_init(ncio *const nciop)
 	pxp->bf_refcount = 0;
 	pxp->bf_base = NULL;
 	pxp->slave = NULL;
+	pxp->pool.nbufs = 0;
+	pxp->pool.cnt = 0;
+	pxp->pool.bufs = NULL;
 
 }
 
@@ -1479,6 +1907,11 @@ ncio_spx_init(ncio *const nciop)
 	*((ncio_filesizefunc **)&nciop->filesize) = ncio_px_filesize; /* cast away const */
 	*((ncio_pad_lengthfunc **)&nciop->pad_length) = ncio_px_pad_length; /* cast away const */
 	*((ncio_closefunc **)&nciop->close) = ncio_spx_close; /* cast away const */
+#ifdef HAVE_PREAD
+	*((ncio_getvfunc **)&nciop->getv) = ncio_px_getv; /* cast away const */
+#else
+	*((ncio_getvfunc **)&nciop->getv) = NULL; /* cast away const */
+#endif
 
 	pxp->pos = -1;
 	pxp->bf_offset = OFF_NONE;
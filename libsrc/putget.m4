@@ -34,7 +34,8 @@ dnl
 
 static int
 readNCv(const NC3_INFO* ncp, const NC_var* varp, const size_t* start,
-        const size_t nelems, void* value, const nc_type memtype);
+        const size_t nelems, const size_t nrecs, void* value,
+        const nc_type memtype);
 static int
 writeNCv(NC3_INFO* ncp, const NC_var* varp, const size_t* start,
          const size_t nelems, const void* value, const nc_type memtype);
@@ -803,6 +804,34 @@ PUTNCVX(ulonglong, ushort)
 PUTNCVX(ulonglong, uint)
 PUTNCVX(ulonglong, ulonglong)
 
+/*
+ * A record variable whose data in each record is a contiguous piece
+ * of less than NC_GATHER_MAX bytes, and no more than the chunk size,
+ * is read NC_GATHER_RECS records at a time: the pieces are gathered
+ * into a buffer, then converted together.
+ */
+#define NC_GATHER_MAX 4096
+#define NC_GATHER_RECS 256
+
+/*
+ * Read the piece of extent bytes at offset, and at the same place in
+ * each of the following nrecs - 1 records, into buf. The offsets are
+ * all computed first so that the ncio layer can read them with one
+ * vectored read.
+ */
+static int
+getNCrecs(const NC3_INFO* ncp, off_t offset, size_t extent,
+	size_t nrecs, void *buf)
+{
+	off_t offsets[NC_GATHER_RECS];
+	size_t i;
+
+	assert(nrecs <= NC_GATHER_RECS);
+	for(i = 0; i < nrecs; i++)
+		offsets[i] = offset + (off_t)(i * ncp->recsize);
+	return ncio_getv(ncp->nciop, nrecs, offsets, extent, buf);
+}
+
 dnl
 dnl GETNCVX(XType, Type)
 dnl
@@ -810,7 +839,7 @@ define(`GETNCVX',dnl
 `dnl
 static int
 getNCvx_$1_$2(const NC3_INFO* ncp, const NC_var *varp,
-		 const size_t *start, size_t nelems, $2 *value)
+		 const size_t *start, size_t nelems, size_t nrecs, $2 *value)
 {
 	off_t offset = NC_varoffset(ncp, varp, start);
 	size_t remaining = varp->xsz * nelems;
@@ -822,6 +851,35 @@ getNCvx_$1_$2(const NC3_INFO* ncp, const NC_var *varp,
 
 	assert(value != NULL);
 
+	if(nrecs > 1)
+	{
+		/* the same piece of nrecs records, see getNCrecs() */
+		void *buf = malloc(MIN(nrecs, NC_GATHER_RECS) * remaining);
+		if(buf == NULL)
+			return NC_ENOMEM;
+		while(nrecs != 0)
+		{
+			const size_t ngot = MIN(nrecs, NC_GATHER_RECS);
+			int lstatus = getNCrecs(ncp, offset, remaining, ngot, buf);
+			if(lstatus != NC_NOERR)
+			{
+				status = lstatus;
+				break;
+			}
+
+			xp = buf;
+			lstatus = ncx_getn_$1_$2(&xp, ngot * nelems, value);
+			if(lstatus != NC_NOERR && status == NC_NOERR)
+				status = lstatus;
+
+			offset += (off_t)(ngot * ncp->recsize);
+			value += ngot * nelems;
+			nrecs -= ngot;
+		}
+		free(buf);
+		return status;
+	}
+
 	for(;;)
 	{
 		size_t extent = MIN(remaining, ncp->chunk);
@@ -1133,326 +1191,327 @@ ifelse($1, text,dnl
 
 static int
 readNCv(const NC3_INFO* ncp, const NC_var* varp, const size_t* start,
-        const size_t nelems, void* value, const nc_type memtype)
+        const size_t nelems, const size_t nrecs, void* value,
+        const nc_type memtype)
 {
     int status = NC_NOERR;
     switch (CASE(varp->type,memtype)) {
 
     case CASE(NC_CHAR,NC_CHAR):
     case CASE(NC_CHAR,NC_UBYTE):
-    return getNCvx_schar_schar(ncp,varp,start,nelems,(signed char*)value);
+    return getNCvx_schar_schar(ncp,varp,start,nelems,nrecs,(signed char*)value);
     break;
     case CASE(NC_BYTE,NC_BYTE):
-        return getNCvx_schar_schar(ncp,varp,start,nelems, (schar*)value);
+        return getNCvx_schar_schar(ncp,varp,start,nelems,nrecs, (schar*)value);
 	break;
     case CASE(NC_BYTE,NC_UBYTE):
         if (fIsSet(ncp->flags,NC_64BIT_DATA))
-            return getNCvx_schar_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+            return getNCvx_schar_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
         else
             /* for CDF-1 and CDF-2, NC_BYTE is treated the same type as uchar memtype */
-            return getNCvx_uchar_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+            return getNCvx_uchar_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_BYTE,NC_SHORT):
-        return getNCvx_schar_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_schar_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_BYTE,NC_INT):
-        return getNCvx_schar_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_schar_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_BYTE,NC_FLOAT):
-        return getNCvx_schar_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_schar_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_BYTE,NC_DOUBLE):
-        return getNCvx_schar_double(ncp,varp,start,nelems,(double *)value);
+        return getNCvx_schar_double(ncp,varp,start,nelems,nrecs,(double *)value);
 	break;
     case CASE(NC_BYTE,NC_INT64):
-        return getNCvx_schar_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_schar_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_BYTE,NC_UINT):
-        return getNCvx_schar_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_schar_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_BYTE,NC_UINT64):
-        return getNCvx_schar_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_schar_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
     	break;
     case CASE(NC_BYTE,NC_USHORT):
-        return getNCvx_schar_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_schar_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
     case CASE(NC_SHORT,NC_BYTE):
-        return getNCvx_short_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_short_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_SHORT,NC_UBYTE):
-        return getNCvx_short_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_short_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_SHORT,NC_SHORT):
-        return getNCvx_short_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_short_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_SHORT,NC_INT):
-        return getNCvx_short_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_short_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
    case CASE(NC_SHORT,NC_FLOAT):
-        return getNCvx_short_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_short_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_SHORT,NC_DOUBLE):
-        return getNCvx_short_double(ncp,varp,start,nelems,(double*)value);
+        return getNCvx_short_double(ncp,varp,start,nelems,nrecs,(double*)value);
 	break;
     case CASE(NC_SHORT,NC_INT64):
-        return getNCvx_short_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_short_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
    	break;
     case CASE(NC_SHORT,NC_UINT):
-        return getNCvx_short_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_short_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
     	break;
     case CASE(NC_SHORT,NC_UINT64):
-        return getNCvx_short_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_short_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_SHORT,NC_USHORT):
-        return getNCvx_short_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_short_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     case CASE(NC_INT,NC_BYTE):
-        return getNCvx_int_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_int_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_INT,NC_UBYTE):
-        return getNCvx_int_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_int_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_INT,NC_SHORT):
-        return getNCvx_int_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_int_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_INT,NC_INT):
-        return getNCvx_int_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_int_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_INT,NC_FLOAT):
-        return getNCvx_int_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_int_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_INT,NC_DOUBLE):
-        return getNCvx_int_double(ncp,varp,start,nelems,(double*)value);
+        return getNCvx_int_double(ncp,varp,start,nelems,nrecs,(double*)value);
 	break;
     case CASE(NC_INT,NC_INT64):
-        return getNCvx_int_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_int_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_INT,NC_UINT):
-        return getNCvx_int_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_int_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_INT,NC_UINT64):
-        return getNCvx_int_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_int_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_INT,NC_USHORT):
-        return getNCvx_int_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_int_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     case CASE(NC_FLOAT,NC_BYTE):
-        return getNCvx_float_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_float_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_FLOAT,NC_UBYTE):
-        return getNCvx_float_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_float_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_FLOAT,NC_SHORT):
-        return getNCvx_float_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_float_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_FLOAT,NC_INT):
-        return getNCvx_float_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_float_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_FLOAT,NC_FLOAT):
-        return getNCvx_float_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_float_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_FLOAT,NC_DOUBLE):
-        return getNCvx_float_double(ncp,varp,start,nelems,(double*)value);
+        return getNCvx_float_double(ncp,varp,start,nelems,nrecs,(double*)value);
 	break;
     case CASE(NC_FLOAT,NC_INT64):
-        return getNCvx_float_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_float_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_FLOAT,NC_UINT):
-        return getNCvx_float_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_float_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_FLOAT,NC_UINT64):
-        return getNCvx_float_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_float_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_FLOAT,NC_USHORT):
-        return getNCvx_float_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_float_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     case CASE(NC_DOUBLE,NC_BYTE):
-        return getNCvx_double_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_double_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_DOUBLE,NC_UBYTE):
-        return getNCvx_double_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_double_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_DOUBLE,NC_SHORT):
-        return getNCvx_double_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_double_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_DOUBLE,NC_INT):
-        return getNCvx_double_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_double_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_DOUBLE,NC_FLOAT):
-        return getNCvx_double_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_double_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_DOUBLE,NC_DOUBLE):
-        return getNCvx_double_double(ncp,varp,start,nelems,(double*)value);
+        return getNCvx_double_double(ncp,varp,start,nelems,nrecs,(double*)value);
 	break;
     case CASE(NC_DOUBLE,NC_INT64):
-        return getNCvx_double_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_double_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_DOUBLE,NC_UINT):
-        return getNCvx_double_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_double_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_DOUBLE,NC_UINT64):
-        return getNCvx_double_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_double_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_DOUBLE,NC_USHORT):
-        return getNCvx_double_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_double_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     case CASE(NC_UBYTE,NC_UBYTE):
-        return getNCvx_uchar_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_uchar_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_UBYTE,NC_BYTE):
-        return getNCvx_uchar_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_uchar_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_UBYTE,NC_SHORT):
-        return getNCvx_uchar_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_uchar_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_UBYTE,NC_INT):
-        return getNCvx_uchar_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_uchar_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_UBYTE,NC_FLOAT):
-        return getNCvx_uchar_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_uchar_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_UBYTE,NC_DOUBLE):
-        return getNCvx_uchar_double(ncp,varp,start,nelems,(double *)value);
+        return getNCvx_uchar_double(ncp,varp,start,nelems,nrecs,(double *)value);
 	break;
     case CASE(NC_UBYTE,NC_INT64):
-        return getNCvx_uchar_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_uchar_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_UBYTE,NC_UINT):
-        return getNCvx_uchar_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_uchar_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_UBYTE,NC_UINT64):
-        return getNCvx_uchar_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_uchar_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_UBYTE,NC_USHORT):
-        return getNCvx_uchar_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_uchar_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     case CASE(NC_USHORT,NC_BYTE):
-        return getNCvx_ushort_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_ushort_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_USHORT,NC_UBYTE):
-        return getNCvx_ushort_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_ushort_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_USHORT,NC_SHORT):
-        return getNCvx_ushort_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_ushort_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_USHORT,NC_INT):
-        return getNCvx_ushort_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_ushort_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_USHORT,NC_FLOAT):
-        return getNCvx_ushort_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_ushort_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_USHORT,NC_DOUBLE):
-        return getNCvx_ushort_double(ncp,varp,start,nelems,(double*)value);
+        return getNCvx_ushort_double(ncp,varp,start,nelems,nrecs,(double*)value);
 	break;
     case CASE(NC_USHORT,NC_INT64):
-        return getNCvx_ushort_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_ushort_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_USHORT,NC_UINT):
-        return getNCvx_ushort_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_ushort_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_USHORT,NC_UINT64):
-        return getNCvx_ushort_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_ushort_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_USHORT,NC_USHORT):
-        return getNCvx_ushort_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_ushort_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     case CASE(NC_UINT,NC_BYTE):
-        return getNCvx_uint_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_uint_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_UINT,NC_UBYTE):
-        return getNCvx_uint_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_uint_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_UINT,NC_SHORT):
-        return getNCvx_uint_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_uint_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_UINT,NC_INT):
-        return getNCvx_uint_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_uint_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_UINT,NC_FLOAT):
-        return getNCvx_uint_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_uint_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_UINT,NC_DOUBLE):
-        return getNCvx_uint_double(ncp,varp,start,nelems,(double*)value);
+        return getNCvx_uint_double(ncp,varp,start,nelems,nrecs,(double*)value);
 	break;
     case CASE(NC_UINT,NC_INT64):
-        return getNCvx_uint_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_uint_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_UINT,NC_UINT):
-        return getNCvx_uint_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_uint_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_UINT,NC_UINT64):
-        return getNCvx_uint_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_uint_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_UINT,NC_USHORT):
-        return getNCvx_uint_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_uint_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     case CASE(NC_INT64,NC_BYTE):
-        return getNCvx_longlong_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_longlong_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_INT64,NC_UBYTE):
-        return getNCvx_longlong_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_longlong_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_INT64,NC_SHORT):
-        return getNCvx_longlong_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_longlong_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_INT64,NC_INT):
-        return getNCvx_longlong_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_longlong_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_INT64,NC_FLOAT):
-        return getNCvx_longlong_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_longlong_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_INT64,NC_DOUBLE):
-        return getNCvx_longlong_double(ncp,varp,start,nelems,(double*)value);
+        return getNCvx_longlong_double(ncp,varp,start,nelems,nrecs,(double*)value);
 	break;
     case CASE(NC_INT64,NC_INT64):
-        return getNCvx_longlong_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_longlong_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_INT64,NC_UINT):
-        return getNCvx_longlong_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_longlong_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_INT64,NC_UINT64):
-        return getNCvx_longlong_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_longlong_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_INT64,NC_USHORT):
-        return getNCvx_longlong_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_longlong_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     case CASE(NC_UINT64,NC_BYTE):
-        return getNCvx_ulonglong_schar(ncp,varp,start,nelems,(schar*)value);
+        return getNCvx_ulonglong_schar(ncp,varp,start,nelems,nrecs,(schar*)value);
 	break;
     case CASE(NC_UINT64,NC_UBYTE):
-        return getNCvx_ulonglong_uchar(ncp,varp,start,nelems,(unsigned char*)value);
+        return getNCvx_ulonglong_uchar(ncp,varp,start,nelems,nrecs,(unsigned char*)value);
 	break;
     case CASE(NC_UINT64,NC_SHORT):
-        return getNCvx_ulonglong_short(ncp,varp,start,nelems,(short*)value);
+        return getNCvx_ulonglong_short(ncp,varp,start,nelems,nrecs,(short*)value);
 	break;
     case CASE(NC_UINT64,NC_INT):
-        return getNCvx_ulonglong_int(ncp,varp,start,nelems,(int*)value);
+        return getNCvx_ulonglong_int(ncp,varp,start,nelems,nrecs,(int*)value);
 	break;
     case CASE(NC_UINT64,NC_FLOAT):
-        return getNCvx_ulonglong_float(ncp,varp,start,nelems,(float*)value);
+        return getNCvx_ulonglong_float(ncp,varp,start,nelems,nrecs,(float*)value);
 	break;
     case CASE(NC_UINT64,NC_DOUBLE):
-        return getNCvx_ulonglong_double(ncp,varp,start,nelems,(double*)value);
+        return getNCvx_ulonglong_double(ncp,varp,start,nelems,nrecs,(double*)value);
 	break;
     case CASE(NC_UINT64,NC_INT64):
-        return getNCvx_ulonglong_longlong(ncp,varp,start,nelems,(long long*)value);
+        return getNCvx_ulonglong_longlong(ncp,varp,start,nelems,nrecs,(long long*)value);
 	break;
     case CASE(NC_UINT64,NC_UINT):
-        return getNCvx_ulonglong_uint(ncp,varp,start,nelems,(unsigned int*)value);
+        return getNCvx_ulonglong_uint(ncp,varp,start,nelems,nrecs,(unsigned int*)value);
 	break;
     case CASE(NC_UINT64,NC_UINT64):
-        return getNCvx_ulonglong_ulonglong(ncp,varp,start,nelems,(unsigned long long*)value);
+        return getNCvx_ulonglong_ulonglong(ncp,varp,start,nelems,nrecs,(unsigned long long*)value);
 	break;
     case CASE(NC_UINT64,NC_USHORT):
-        return getNCvx_ulonglong_ushort(ncp,varp,start,nelems,(unsigned short*)value);
+        return getNCvx_ulonglong_ushort(ncp,varp,start,nelems,nrecs,(unsigned short*)value);
 	break;
 
     default:
@@ -1850,7 +1909,7 @@ NC3_get_vara(int ncid, int varid,
 
     if(varp->ndims == 0) /* scalar variable */
     {
-        return( readNCv(nc3, varp, start, 1, (void*)value, memtype) );
+        return( readNCv(nc3, varp, start, 1, 1, (void*)value, memtype) );
     }
 
     if(IS_RECVAR(varp))
@@ -1860,7 +1919,7 @@ NC3_get_vara(int ncid, int varid,
         if(varp->ndims == 1 && nc3->recsize <= varp->len)
         {
             /* one dimensional && the only record variable  */
-            return( readNCv(nc3, varp, start, *edges, (void*)value, memtype) );
+            return( readNCv(nc3, varp, start, *edges, 1, (void*)value, memtype) );
         }
     }
 
@@ -1872,11 +1931,19 @@ NC3_get_vara(int ncid, int varid,
 
     if(ii == -1)
     {
-        return( readNCv(nc3, varp, start, iocount, (void*)value, memtype) );
+        return( readNCv(nc3, varp, start, iocount, 1, (void*)value, memtype) );
     }
 
     assert(ii >= 0);
 
+    if(ii == 0 && IS_RECVAR(varp) && *edges > 1
+        && iocount * varp->xsz < NC_GATHER_MAX
+        && iocount * varp->xsz <= nc3->chunk)
+    {
+        /* only the record index ripples: gather the records */
+        return( readNCv(nc3, varp, start, iocount, *edges, (void*)value, memtype) );
+    }
+
     { /* inline */
     ALLOC_ONSTACK(coord, size_t, varp->ndims);
     ALLOC_ONSTACK(upper, size_t, varp->ndims);
@@ -1891,7 +1958,7 @@ NC3_get_vara(int ncid, int varid,
     /* ripple counter */
     while(*coord < *upper)
     {
-        const int lstatus = readNCv(nc3, varp, coord, iocount, (void*)value, memtype);
+        const int lstatus = readNCv(nc3, varp, coord, iocount, 1, (void*)value, memtype);
 	if(lstatus != NC_NOERR)
         {
             if(lstatus != NC_ERANGE)
@@ -0,0 +1,133 @@
+/* This is part of the netCDF package. Copyright 2018 University
+   Corporation for Atmospheric Research/Unidata See COPYRIGHT file for
+   conditions of use. See www.unidata.ucar.edu for more info.
+
+   Test access that alternates between record variables, which the
+   posixio layer serves from several buffers at once. A small
+   chunksizehint gives each variable's part of a record buffers of
+   its own, so the data passes through buffers that are parked,
+   evicted, moved by nc_enddef and synced.
+*/
+
+#include "config.h"
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <netcdf.h>
+
+#define FILE_NAME "tst_interleave.nc"
+#define NVARS 8
+#define NRECS 12
+#define NX 700 /* ints per record of each variable */
+#define SLICE 70
+#define CHUNKSIZEHINT 1024
+
+static int data[NX];
+
+static int
+value(int v, int r, int x, int pass)
+{
+    return pass*1000000 + v*10000 + r*NX + x;
+}
+
+static int
+put_rec(int ncid, int varid, int v, int r, int pass)
+{
+    size_t start[2] = {0, 0}, count[2] = {1, NX};
+    int x;
+    start[0] = (size_t)r;
+    for (x = 0; x < NX; x++) data[x] = value(v, r, x, pass);
+    return nc_put_vara_int(ncid, varid, start, count, data);
+}
+
+/* Read every record of every variable a slice at a time,
+ * alternating between the variables; count the wrong values. */
+static int
+check_recs(int ncid, const int *varids, const int *pass)
+{
+    size_t start[2] = {0, 0}, count[2] = {1, SLICE};
+    int v, r, x, x0, bad = 0;
+    for (r = NRECS - 1; r >= 0; r--)
+        for (x0 = 0; x0 < NX; x0 += SLICE)
+            for (v = 0; v < NVARS; v++)
+            {
+                start[0] = (size_t)r;
+                start[1] = (size_t)x0;
+                if (nc_get_vara_int(ncid, varids[v], start, count, data)) return -1;
+                for (x = 0; x < SLICE; x++)
+                    if (data[x] != value(v, r, x0 + x, pass[r])) bad++;
+            }
+    return bad;
+}
+
+int
+main(int argc, char **argv)
+{
+    int ncid, ncid2, dimids[2], varids[NVARS], varid;
+    int pass[NRECS];
+    size_t hint = CHUNKSIZEHINT;
+    char name[NC_MAX_NAME + 1];
+    int v, r;
+
+    printf("\n*** Testing access alternating between record variables.\n");
+    printf("*** testing interleaved writes and reads...");
+    {
+        if (nc__create(FILE_NAME, NC_CLOBBER, 0, &hint, &ncid)) ERR;
+        if (nc_def_dim(ncid, "t", NC_UNLIMITED, &dimids[0])) ERR;
+        if (nc_def_dim(ncid, "x", NX, &dimids[1])) ERR;
+        for (v = 0; v < NVARS; v++)
+        {
+            snprintf(name, sizeof(name), "v%d", v);
+            if (nc_def_var(ncid, name, NC_INT, 2, dimids, &varids[v])) ERR;
+        }
+        if (nc_enddef(ncid)) ERR;
+        for (r = 0; r < NRECS; r++)
+        {
+            pass[r] = 0;
+            for (v = 0; v < NVARS; v++)
+                if (put_rec(ncid, varids[v], v, r, 0)) ERR;
+        }
+        if (check_recs(ncid, varids, pass)) ERR;
+
+        /* Rewrite every other record, last variable first */
+        for (r = 0; r < NRECS; r += 2)
+        {
+            pass[r] = 1;
+            for (v = NVARS - 1; v >= 0; v--)
+                if (put_rec(ncid, varids[v], v, r, 1)) ERR;
+        }
+        if (check_recs(ncid, varids, pass)) ERR;
+    }
+    SUMMARIZE_ERR;
+    printf("*** testing sync and a second reader...");
+    {
+        if (nc_sync(ncid)) ERR;
+        if (nc_open(FILE_NAME, NC_NOWRITE, &ncid2)) ERR;
+        if (check_recs(ncid2, varids, pass)) ERR;
+        if (nc_close(ncid2)) ERR;
+    }
+    SUMMARIZE_ERR;
+    printf("*** testing moving modified records in nc_enddef...");
+    {
+        /* Leave records modified in memory, then grow the header and
+         * the records so that nc_enddef moves all of them */
+        for (r = 1; r < NRECS; r += 2)
+        {
+            pass[r] = 2;
+            for (v = 0; v < NVARS; v++)
+                if (put_rec(ncid, varids[v], v, r, 2)) ERR;
+        }
+        if (nc_redef(ncid)) ERR;
+        if (nc_put_att_text(ncid, NC_GLOBAL, "title", 11, "interleaved")) ERR;
+        if (nc_def_var(ncid, "extra", NC_INT, 2, dimids, &varid)) ERR;
+        if (nc_enddef(ncid)) ERR;
+        if (check_recs(ncid, varids, pass)) ERR;
+        if (nc_close(ncid)) ERR;
+
+        hint = CHUNKSIZEHINT;
+        if (nc__open(FILE_NAME, NC_NOWRITE, &hint, &ncid)) ERR;
+        if (check_recs(ncid, varids, pass)) ERR;
+        if (nc_close(ncid)) ERR;
+    }
+    SUMMARIZE_ERR;
+    FINAL_RESULTS;
+}
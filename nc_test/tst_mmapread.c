@@ -0,0 +1,216 @@
+/* This is part of the netCDF package. Copyright 2018 University
+   Corporation for Atmospheric Research/Unidata See COPYRIGHT file for
+   conditions of use. See www.unidata.ucar.edu for more info.
+
+   Test reading classic files through a read-only file mapping, where
+   the data is converted straight from the mapping into the caller's
+   memory. Each format is read with NC_MMAP and without it, converting
+   to other types, a slab, a strided slab and a single value at a
+   time. A reader that syncs after a writer appended records must see
+   them, though they lie past the end of what was mapped.
+
+   Large files are only mapped without NC_MMAP when the
+   NETCDF.MMAP.MINSIZE .rc key asks for it: without it, a large file
+   truncated under a reader must not bring the reader down.
+*/
+
+#include "config.h"
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <netcdf.h>
+#include "ncrc.h"
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#define FILE_NAME "tst_mmapread.nc"
+#define BIG_FILE_NAME "tst_mmapread_big.nc"
+#define BIGLEN 67108864 /* what used to be mapped by default */
+#define NRECS 5
+#define NX 301 /* odd, so that the variables are padded */
+#define NAPPEND 20 /* records appended, several pages of them */
+
+static int
+value(int v, int r, int x)
+{
+    return v*10000 + r*NX + x - 5000;
+}
+
+/* Write a fixed size short and double variable and an int and float
+ * record variable. */
+static int
+create_file(int cmode)
+{
+    int ncid, dimids[2], varids[4], v, r, x;
+    size_t start[2] = {0, 0}, count[2] = {1, NX};
+    static const nc_type types[4] = {NC_SHORT, NC_DOUBLE, NC_INT, NC_FLOAT};
+    static int data[NX];
+
+    if (nc_create(FILE_NAME, cmode|NC_CLOBBER, &ncid)) return 1;
+    if (nc_def_dim(ncid, "t", NC_UNLIMITED, &dimids[0])) return 1;
+    if (nc_def_dim(ncid, "x", NX, &dimids[1])) return 1;
+    if (nc_def_var(ncid, "s", types[0], 1, &dimids[1], &varids[0])) return 1;
+    if (nc_def_var(ncid, "d", types[1], 1, &dimids[1], &varids[1])) return 1;
+    if (nc_def_var(ncid, "i", types[2], 2, dimids, &varids[2])) return 1;
+    if (nc_def_var(ncid, "f", types[3], 2, dimids, &varids[3])) return 1;
+    if (nc_enddef(ncid)) return 1;
+    for (v = 0; v < 2; v++)
+    {
+        for (x = 0; x < NX; x++) data[x] = value(v, 0, x);
+        if (nc_put_var_int(ncid, varids[v], data)) return 1;
+    }
+    for (r = 0; r < NRECS; r++)
+        for (v = 2; v < 4; v++)
+        {
+            start[0] = (size_t)r;
+            for (x = 0; x < NX; x++) data[x] = value(v, r, x);
+            if (nc_put_vara_int(ncid, varids[v], start, count, data)) return 1;
+        }
+    if (nc_close(ncid)) return 1;
+    return 0;
+}
+
+/* Read everything back in several ways; count the wrong values. */
+static int
+check_file(int omode)
+{
+    int ncid, v, r, x, bad = 0;
+    size_t start[2] = {0, 0}, count[2] = {1, NX}, index[2];
+    ptrdiff_t stride[2] = {1, 3};
+    static double ddata[NX];
+    static float fdata[NX];
+    static long long ldata[NX];
+    signed char c;
+
+    if (nc_open(FILE_NAME, omode, &ncid)) return -1;
+    for (v = 0; v < 2; v++)
+    {
+        if (nc_get_var_double(ncid, v, ddata)) return -1;
+        for (x = 0; x < NX; x++)
+            if (ddata[x] != value(v, 0, x)) bad++;
+    }
+    for (r = 0; r < NRECS; r++)
+        for (v = 2; v < 4; v++)
+        {
+            start[0] = (size_t)r;
+            start[1] = 0;
+            count[1] = NX;
+            if (nc_get_vara_float(ncid, v, start, count, fdata)) return -1;
+            for (x = 0; x < NX; x++)
+                if (fdata[x] != (float)value(v, r, x)) bad++;
+            start[1] = 1;
+            count[1] = (NX - 1)/3;
+            if (nc_get_vars_longlong(ncid, v, start, count, stride, ldata)) return -1;
+            for (x = 0; x < (int)count[1]; x++)
+                if (ldata[x] != value(v, r, 1 + 3*x)) bad++;
+            index[0] = (size_t)r;
+            index[1] = NX - 1;
+            if (nc_get_var1_longlong(ncid, v, index, ldata)) return -1;
+            if (ldata[0] != value(v, r, NX - 1)) bad++;
+        }
+    /* Values out of range still report NC_ERANGE */
+    index[0] = NRECS - 1;
+    index[1] = NX - 1;
+    if (nc_get_var1_schar(ncid, 2, index, &c) != NC_ERANGE) bad++;
+    if (nc_close(ncid)) return -1;
+    return bad;
+}
+
+/* Append records with a second ncid open for writing while a reader
+ * has the file mapped, then sync the reader and read them; count the
+ * wrong values. */
+static int
+check_append(int omode)
+{
+    int rdid, wrid, v, r, x, bad = 0;
+    size_t nrecs, start[2] = {0, 0}, count[2] = {1, NX};
+    static int data[NX];
+
+    if (nc_open(FILE_NAME, omode, &rdid)) return -1;
+    if (nc_open(FILE_NAME, NC_WRITE, &wrid)) return -1;
+    for (r = NRECS; r < NRECS + NAPPEND; r++)
+        for (v = 2; v < 4; v++)
+        {
+            start[0] = (size_t)r;
+            for (x = 0; x < NX; x++) data[x] = value(v, r, x);
+            if (nc_put_vara_int(wrid, v, start, count, data)) return -1;
+        }
+    if (nc_close(wrid)) return -1;
+
+    if (nc_sync(rdid)) return -1;
+    if (nc_inq_dimlen(rdid, 0, &nrecs)) return -1;
+    if (nrecs != NRECS + NAPPEND) bad++;
+    for (r = 0; r < (int)nrecs; r++)
+        for (v = 2; v < 4; v++)
+        {
+            start[0] = (size_t)r;
+            if (nc_get_vara_int(rdid, v, start, count, data)) return -1;
+            for (x = 0; x < NX; x++)
+                if (data[x] != value(v, r, x)) bad++;
+        }
+    if (nc_close(rdid)) return -1;
+    return bad;
+}
+
+/* Open a large sparse file read-only with the default settings,
+ * truncate it and read what is gone; the read may fail, but must not
+ * crash as a mapping of the file would. */
+static int
+check_truncated(void)
+{
+    int ncid, dimid, varid;
+    size_t index = BIGLEN - 1;
+    signed char c = 1;
+
+    if (nc_create(BIG_FILE_NAME, NC_CLOBBER, &ncid)) return 1;
+    if (nc_set_fill(ncid, NC_NOFILL, NULL)) return 1;
+    if (nc_def_dim(ncid, "x", BIGLEN, &dimid)) return 1;
+    if (nc_def_var(ncid, "b", NC_BYTE, 1, &dimid, &varid)) return 1;
+    if (nc_enddef(ncid)) return 1;
+    if (nc_put_var1_schar(ncid, varid, &index, &c)) return 1;
+    if (nc_close(ncid)) return 1;
+
+    if (nc_open(BIG_FILE_NAME, NC_NOWRITE, &ncid)) return 1;
+#ifdef HAVE_UNISTD_H
+    if (truncate(BIG_FILE_NAME, 4096)) return 1;
+#endif
+    (void)nc_get_var1_schar(ncid, varid, &index, &c);
+    (void)nc_close(ncid);
+    (void)remove(BIG_FILE_NAME);
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+#ifdef ENABLE_CDF5
+    static const int formats[] = {0, NC_64BIT_OFFSET, NC_64BIT_DATA};
+#else
+    static const int formats[] = {0, NC_64BIT_OFFSET};
+#endif
+    int f;
+
+    printf("\n*** Testing read-only mapped classic files.\n");
+    for (f = 0; f < (int)(sizeof(formats)/sizeof(formats[0])); f++)
+    {
+        printf("*** testing format %d...", f + 1);
+        if (create_file(formats[f])) ERR;
+        if (check_file(NC_NOWRITE)) ERR;
+        if (check_file(NC_NOWRITE|NC_MMAP)) ERR;
+        if (check_append(NC_NOWRITE|NC_MMAP)) ERR;
+        SUMMARIZE_ERR;
+    }
+
+    printf("*** testing that large files are not mapped by default...");
+    if (check_truncated()) ERR;
+    SUMMARIZE_ERR;
+
+    /* Map every file opened read-only */
+    printf("*** testing NETCDF.MMAP.MINSIZE...");
+    if (NC_rcfile_insert("NETCDF.MMAP.MINSIZE", "1", NULL, NULL)) ERR;
+    if (create_file(0)) ERR;
+    if (check_file(NC_NOWRITE)) ERR;
+    if (check_append(NC_NOWRITE)) ERR;
+    SUMMARIZE_ERR;
+    FINAL_RESULTS;
+}
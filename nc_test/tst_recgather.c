@@ -0,0 +1,313 @@
+/* This is part of the netCDF package. Copyright 2018 University
+   Corporation for Atmospheric Research/Unidata See COPYRIGHT file for
+   conditions of use. See www.unidata.ucar.edu for more info.
+
+   Test reading many records of small record variables, which gathers
+   the records with vectored reads and converts them in batches. The
+   file is read open read-only, shared, and writable after a change
+   that is not yet synced, when the records are read through the
+   buffers instead. The records of a file open with a chunk size
+   smaller than a record are not gathered. Gathered reads must give
+   the same values and errors as reading one record at a time, with
+   a value out of range in a single batch still reported once the
+   later batches have been read.
+*/
+
+#include "config.h"
+#include <string.h>
+#include <nc_tests.h>
+#include "err_macros.h"
+#include <netcdf.h>
+
+#define FILE_NAME "tst_recgather.nc"
+#define NRECS 600 /* more than one batch of records */
+#define NX 7 /* odd, so that the short variable is padded */
+#define NBIG 1200 /* too large for a record to be gathered */
+#define NVARS 4
+#define SMALLCHUNK 256
+#define SMALLRECS 5
+#define SMALLX 900
+#define BATCHRECS 700 /* three batches of gathered records */
+#define BATCHX 3
+
+static const nc_type types[NVARS] = {NC_DOUBLE, NC_SHORT, NC_BYTE, NC_FLOAT};
+static const size_t lens[NVARS] = {1, NX, NX, NBIG};
+
+static int
+value(int v, int r, int x)
+{
+    if (v == 1) /* short, partly in the range of schar */
+        return r*NX + x - 300;
+    if (v == 2) /* byte */
+        return (r + x) % 200 - 100;
+    return v*10000 + r*NX + x - 1000;
+}
+
+/* A one dimensional record variable, which is not the only one, and
+ * variables with a short, a padded and a large part of each record. */
+static int
+create_file(int cmode)
+{
+    int ncid, dimids[NVARS][2], varids[NVARS], v, r, x;
+    size_t start[2] = {0, 0}, count[2] = {1, 0};
+    static int data[NBIG];
+    char name[NC_MAX_NAME + 1];
+
+    if (nc_create(FILE_NAME, cmode|NC_CLOBBER, &ncid)) return 1;
+    if (nc_def_dim(ncid, "t", NC_UNLIMITED, &dimids[0][0])) return 1;
+    for (v = 0; v < NVARS; v++)
+    {
+        dimids[v][0] = dimids[0][0];
+        if (v == 0) continue;
+        snprintf(name, sizeof(name), "x%d", v);
+        if (nc_def_dim(ncid, name, lens[v], &dimids[v][1])) return 1;
+    }
+    for (v = 0; v < NVARS; v++)
+    {
+        snprintf(name, sizeof(name), "v%d", v);
+        if (nc_def_var(ncid, name, types[v], v ? 2 : 1, dimids[v], &varids[v])) return 1;
+    }
+    if (nc_enddef(ncid)) return 1;
+    for (r = 0; r < NRECS; r++)
+        for (v = 0; v < NVARS; v++)
+        {
+            start[0] = (size_t)r;
+            count[1] = lens[v];
+            for (x = 0; x < (int)lens[v]; x++) data[x] = value(v, r, x);
+            if (nc_put_vara_int(ncid, varids[v], start, count, data)) return 1;
+        }
+    if (nc_close(ncid)) return 1;
+    return 0;
+}
+
+/* Read every variable whole, and a slab of each leaving out records
+ * and values at both ends; count the wrong values. The byte variable
+ * is changed to pass in record changed, if that is not -1. */
+static int
+check_vars(int ncid, int changed, int pass)
+{
+    int v, r, x, bad = 0;
+    size_t start[2], count[2];
+    static double ddata[NRECS * NBIG];
+    static int idata[NRECS * NBIG];
+    signed char c[NRECS];
+
+    for (v = 0; v < NVARS; v++)
+    {
+        if (nc_get_var_double(ncid, v, ddata)) return -1;
+        for (r = 0; r < NRECS; r++)
+            for (x = 0; x < (int)lens[v]; x++)
+            {
+                int expect = value(v, r, x);
+                if (v == 2 && r == changed) expect = pass;
+                if (ddata[(size_t)r*lens[v] + (size_t)x] != expect) bad++;
+            }
+        start[0] = 3;
+        count[0] = NRECS - 5;
+        start[1] = lens[v] > 2 ? 1 : 0;
+        count[1] = lens[v] > 2 ? lens[v] - 2 : 1;
+        if (nc_get_vara_int(ncid, v, start, count, idata)) return -1;
+        for (r = 0; r < (int)count[0]; r++)
+            for (x = 0; x < (int)count[1]; x++)
+            {
+                int expect = value(v, r + 3, x + (int)start[1]);
+                if (v == 2 && r + 3 == changed) expect = pass;
+                if (idata[(size_t)r*count[1] + (size_t)x] != expect) bad++;
+            }
+    }
+
+    /* Values out of range still report NC_ERANGE, and the others are
+     * still converted. */
+    start[0] = 0;
+    start[1] = 0;
+    count[0] = NRECS;
+    count[1] = 1;
+    if (nc_get_vara_schar(ncid, 1, start, count, c) != NC_ERANGE) bad++;
+    for (r = 0; r < NRECS; r++)
+        if (value(1, r, 0) >= -128 && value(1, r, 0) <= 127
+            && c[r] != value(1, r, 0)) bad++;
+    return bad;
+}
+
+static int
+check_file(int omode)
+{
+    int ncid, bad;
+
+    if (nc_open(FILE_NAME, omode, &ncid)) return -1;
+    bad = check_vars(ncid, -1, 0);
+    if (nc_close(ncid)) return -1;
+    return bad;
+}
+
+/* Change a record of the byte variable in a file open for writing,
+ * and read it back before the change reaches the file. */
+static int
+check_changed(void)
+{
+    int ncid, bad;
+    size_t start[2] = {NRECS/2, 0}, count[2] = {1, NX};
+    signed char data[NX];
+
+    if (nc_open(FILE_NAME, NC_WRITE, &ncid)) return -1;
+    memset(data, 42, sizeof(data));
+    if (nc_put_vara_schar(ncid, 2, start, count, data)) return -1;
+    bad = check_vars(ncid, NRECS/2, 42);
+    if (nc_close(ncid)) return -1;
+    return bad;
+}
+
+/* Read records of more than the chunk size in a writable file open
+ * with a small chunksizehint. */
+static int
+check_smallchunk(int cmode)
+{
+    int ncid, dimids[2], varids[2], v, r, x, bad = 0;
+    size_t chunk = SMALLCHUNK;
+    size_t start[2] = {0, 0}, count[2] = {SMALLRECS, SMALLX};
+    static float data[SMALLRECS * SMALLX];
+
+    if (nc_create(FILE_NAME, cmode|NC_CLOBBER, &ncid)) return -1;
+    if (nc_def_dim(ncid, "t", NC_UNLIMITED, &dimids[0])) return -1;
+    if (nc_def_dim(ncid, "x", SMALLX, &dimids[1])) return -1;
+    if (nc_def_var(ncid, "a", NC_FLOAT, 2, dimids, &varids[0])) return -1;
+    if (nc_def_var(ncid, "b", NC_FLOAT, 2, dimids, &varids[1])) return -1;
+    if (nc_enddef(ncid)) return -1;
+    for (v = 0; v < 2; v++)
+    {
+        for (x = 0; x < SMALLRECS * SMALLX; x++) data[x] = (float)value(v, 0, x);
+        if (nc_put_vara_float(ncid, varids[v], start, count, data)) return -1;
+    }
+    if (nc_close(ncid)) return -1;
+
+    if (nc__open(FILE_NAME, NC_WRITE, &chunk, &ncid)) return -1;
+    for (v = 0; v < 2; v++)
+    {
+        if (nc_get_vara_float(ncid, varids[v], start, count, data)) return -1;
+        for (r = 0; r < SMALLRECS * SMALLX; r++)
+            if (data[r] != (float)value(v, 0, r)) bad++;
+    }
+    if (nc_close(ncid)) return -1;
+    return bad;
+}
+
+/* Value of record r, element x of the short variable of
+ * check_batches; only the one at record bad is out of the range of
+ * schar, none if bad is -1. */
+static short
+batchvalue(int r, int x, int bad)
+{
+    if (r == bad && x == 1)
+        return 1000;
+    return (short)((r*BATCHX + x) % 250 - 125);
+}
+
+/* Read a short record variable of BATCHRECS records as schar, int
+ * and double, gathered with one call and one record at a time, and
+ * compare them; count the differences. */
+static int
+compare_records(int ncid, int varid, int bad)
+{
+    int r, x, status, rstatus, nbad = 0;
+    size_t start[2] = {0, 0}, count[2] = {BATCHRECS, BATCHX};
+    static signed char cgather[BATCHRECS * BATCHX], crecs[BATCHRECS * BATCHX];
+    static int igather[BATCHRECS * BATCHX], irecs[BATCHRECS * BATCHX];
+    static double dgather[BATCHRECS * BATCHX], drecs[BATCHRECS * BATCHX];
+
+    memset(cgather, 0, sizeof(cgather));
+    memset(crecs, 0, sizeof(crecs));
+    status = nc_get_vara_schar(ncid, varid, start, count, cgather);
+    if (nc_get_vara_int(ncid, varid, start, count, igather)) return -1;
+    if (nc_get_vara_double(ncid, varid, start, count, dgather)) return -1;
+
+    rstatus = NC_NOERR;
+    count[0] = 1;
+    for (r = 0; r < BATCHRECS; r++)
+    {
+        size_t off = (size_t)r * BATCHX;
+        int lstatus;
+        start[0] = (size_t)r;
+        lstatus = nc_get_vara_schar(ncid, varid, start, count, crecs + off);
+        if (lstatus != NC_NOERR && rstatus == NC_NOERR) rstatus = lstatus;
+        if (nc_get_vara_int(ncid, varid, start, count, irecs + off)) return -1;
+        if (nc_get_vara_double(ncid, varid, start, count, drecs + off)) return -1;
+    }
+
+    if (status != rstatus) nbad++;
+    if (status != (bad < 0 ? NC_NOERR : NC_ERANGE)) nbad++;
+    for (r = 0; r < BATCHRECS; r++)
+        for (x = 0; x < BATCHX; x++)
+        {
+            size_t i = (size_t)r * BATCHX + (size_t)x;
+            short expect = batchvalue(r, x, bad);
+            if (igather[i] != irecs[i] || igather[i] != expect) nbad++;
+            if (dgather[i] != drecs[i] || dgather[i] != expect) nbad++;
+            /* the values in range are converted in every batch */
+            if (expect >= -128 && expect <= 127
+                && (cgather[i] != crecs[i] || cgather[i] != expect)) nbad++;
+        }
+    return nbad;
+}
+
+/* Write a short record variable with a value out of the range of
+ * schar in the first, a middle or the last batch of records, or in
+ * none, and compare gathered reads with reads of single records. */
+static int
+check_batches(int cmode)
+{
+    static const int bads[] = {-1, 0, 300, BATCHRECS - 1};
+    int ncid, dimids[2], varid, r, x, b, nbad = 0;
+    size_t start[2] = {0, 0}, count[2] = {1, BATCHX};
+    short data[BATCHX];
+
+    for (b = 0; b < (int)(sizeof(bads)/sizeof(bads[0])); b++)
+    {
+        if (nc_create(FILE_NAME, cmode|NC_CLOBBER, &ncid)) return -1;
+        if (nc_def_dim(ncid, "t", NC_UNLIMITED, &dimids[0])) return -1;
+        if (nc_def_dim(ncid, "x", BATCHX, &dimids[1])) return -1;
+        if (nc_def_var(ncid, "s", NC_SHORT, 2, dimids, &varid)) return -1;
+        /* a second record variable, so that the records are apart */
+        if (nc_def_var(ncid, "t", NC_DOUBLE, 1, dimids, NULL)) return -1;
+        if (nc_enddef(ncid)) return -1;
+        for (r = 0; r < BATCHRECS; r++)
+        {
+            start[0] = (size_t)r;
+            for (x = 0; x < BATCHX; x++) data[x] = batchvalue(r, x, bads[b]);
+            if (nc_put_vara_short(ncid, varid, start, count, data)) return -1;
+        }
+        if (nc_close(ncid)) return -1;
+
+        if (nc_open(FILE_NAME, NC_NOWRITE, &ncid)) return -1;
+        nbad += compare_records(ncid, varid, bads[b]);
+        if (nc_close(ncid)) return -1;
+        if (nc_open(FILE_NAME, NC_NOWRITE|NC_SHARE, &ncid)) return -1;
+        nbad += compare_records(ncid, varid, bads[b]);
+        if (nc_close(ncid)) return -1;
+    }
+    return nbad;
+}
+
+int
+main(int argc, char **argv)
+{
+#ifdef ENABLE_CDF5
+    static const int formats[] = {0, NC_64BIT_OFFSET, NC_64BIT_DATA};
+#else
+    static const int formats[] = {0, NC_64BIT_OFFSET};
+#endif
+    int f;
+
+    printf("\n*** Testing gathered reads of record variables.\n");
+    for (f = 0; f < (int)(sizeof(formats)/sizeof(formats[0])); f++)
+    {
+        printf("*** testing format %d...", f + 1);
+        if (create_file(formats[f])) ERR;
+        if (check_file(NC_NOWRITE)) ERR;
+        if (check_file(NC_NOWRITE|NC_SHARE)) ERR;
+        if (check_changed()) ERR;
+        if (check_smallchunk(formats[f])) ERR;
+        if (check_batches(formats[f])) ERR;
+        SUMMARIZE_ERR;
+    }
+    FINAL_RESULTS;
+}
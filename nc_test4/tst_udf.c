@@ -158,6 +158,13 @@ static NC_Dispatch tst_dispatcher = {
     NC_NOOP_inq_var_filter_ids,
     NC_NOOP_inq_var_filter_info,
 #endif
+#if NC_DISPATCH_VERSION >= 4
+    NC_NOTNC4_def_var_quantize,
+    NC_NOTNC4_inq_var_quantize,
+#endif
+#if NC_DISPATCH_VERSION >= 5
+    NC_NOSTATS_inq_var_stats,
+#endif
 };
 
 /* This is the dispatch object that holds pointers to all the
@@ -254,6 +261,13 @@ static NC_Dispatch tst_dispatcher_bad_version = {
     NC_NOOP_inq_var_filter_ids,
     NC_NOOP_inq_var_filter_info,
 #endif
+#if NC_DISPATCH_VERSION >= 4
+    NC_NOTNC4_def_var_quantize,
+    NC_NOTNC4_inq_var_quantize,
+#endif
+#if NC_DISPATCH_VERSION >= 5
+    NC_NOSTATS_inq_var_stats,
+#endif
 };
 
 #define NUM_UDFS 2
@@ -286,6 +300,10 @@ main(int argc, char **argv)
 
             /* Open file with our defined functions. */
             if (nc_open(FILE_NAME, mode[i], &ncid)) ERR;
+            {
+                NC_io_stats stats;
+                if (nc_inq_var_stats(ncid, 0, &stats) != NC_ENOTBUILT) ERR;
+            }
             if (nc_close(ncid)) ERR;
 
             /* Open file again and abort, which is the same as closing
@@ -155,6 +155,7 @@ static char** option_lvars = 0;		/* list of variable names specified with -v
 static bool_t option_varstruct = false;	  /* if -v set, copy structure for non-selected vars */
 static int option_compute_chunkcaches = 0; /* default, don't try still flaky estimate of
 					    * chunk cache for each variable */
+static int option_stats = 0; /* default, don't print I/O statistics */
 /* get group id in output corresponding to group igrp in input,
  * given parent group id (or root group id) parid in output. */
 static int
@@ -2143,6 +2144,14 @@ copy(char* infile, char* outfile)
 	NC_CHECK(copy_data(igrp, ogrp)); /* recursive, to handle nested groups */
     }
 
+    if(option_stats) {
+	/* Flush the output first so that its writes are counted */
+	NC_CHECK(nc_sync(ogrp));
+	fprintf(stderr,"input %s:\n",infile);
+	print_io_stats(stderr,igrp);
+	fprintf(stderr,"output %s:\n",outfile);
+	print_io_stats(stderr,ogrp);
+    }
     NC_CHECK(nc_close(igrp));
     NC_CHECK(nc_close(ogrp));
     return stat;
@@ -2217,6 +2226,7 @@ usage(void)
   [-F filterspec] specify a compression algorithm to apply to an output variable (may be repeated).\n\
   [-Ln]     set log level to n (>= 0); ignored if logging isn't enabled.\n\
   [-Mn]     set minimum chunk size to n bytes (n >= 0)\n\
+  [-Xs]     print I/O statistics of both files to stderr (NCZarr only)\n\
   infile    name of netCDF input file\n\
   outfile   name for netCDF output file\n"
 
@@ -2224,7 +2234,7 @@ usage(void)
     /* [-x]      use experimental computed estimates for variable-specific chunk caches\n\ */
 
 
-    error("%s [-k kind] [-[3|4|6|7]] [-d n] [-s] [-c chunkspec] [-u] [-w] [-[v|V] varlist] [-[g|G] grplist] [-m n] [-h n] [-e n] [-r] [-F filterspec] [-Ln] [-Mn] infile outfile\n%s\nnetCDF library version %s",
+    error("%s [-k kind] [-[3|4|6|7]] [-d n] [-s] [-c chunkspec] [-u] [-w] [-[v|V] varlist] [-[g|G] grplist] [-m n] [-h n] [-e n] [-r] [-F filterspec] [-Ln] [-Mn] [-Xs] infile outfile\n%s\nnetCDF library version %s",
 	  progname, USAGE, nc_inq_libvers());
 
 }
@@ -2248,7 +2258,7 @@ main(int argc, char**argv)
     }
 
     opterr = 1;
-    while ((c = getopt(argc, argv, "k:3467d:sum:c:h:e:rwxg:G:v:V:F:L:M:")) != -1) {
+    while ((c = getopt(argc, argv, "k:3467d:sum:c:h:e:rwxg:G:v:V:F:L:M:X:")) != -1) {
 	switch(c) {
         case 'k': /* for specifying variant of netCDF format to be generated
                      Format names:
@@ -2393,6 +2403,12 @@ main(int argc, char**argv)
 	    error("-F requires netcdf-4");
 #endif
 	    break;
+	case 'X': /* special options */
+	    if(optarg[0] == 's' || optarg[0] == 'S')
+		option_stats = 1;
+	    else
+		error("invalid value for -X option: %s", optarg);
+	    break;
 	case 'M': /* set min chunk size */
 #ifdef USE_NETCDF4
 	    if(optarg == NULL)
@@ -126,6 +126,7 @@ usage(void)
   [-w]             With client-side caching of variables for DAP URLs\n\
   [-x]             Output XML (NcML) instead of CDL\n\
   [-Xp]            Unconditionally suppress output of the properties attribute\n\
+  [-Xs]            Print I/O statistics to stderr after the dump (NCZarr only)\n\
   [-Ln]            Set log level to n (>= 0); ignore if logging not enabled.\n\
   file             Name of netCDF file (or URL if DAP access enabled)\n"
 
@@ -2363,6 +2364,9 @@ main(int argc, char *argv[])
 	    case 'p': /* suppress the properties attribute */
 	      Xp_flag = 1; /* record that this flag was set */
 	      break;
+	    case 's': /* print I/O statistics */
+	      formatting_specs.xopt_stats = 1;
+	      break;
 	    default:
 	      snprintf(errmsg,sizeof(errmsg),"invalid value for -X option: %s", optarg);
 	      goto fail;
@@ -2478,6 +2482,8 @@ main(int argc, char *argv[])
 		    do_ncdump(ncid, path);
 		}
 	    }
+	    if(formatting_specs.xopt_stats)
+		print_io_stats(stderr,ncid);
 	    NC_CHECK( nc_close(ncid) );
     }
     nullfree(path) path = NULL;
@@ -79,6 +79,7 @@ typedef struct {			/* specification for how to format dump */
 
     int xopt_inmemory;      /* Use in-memory option; testing only */
     int xopt_props ;      /* 1=>Unconditionally Suppress properties attribute */
+    int xopt_stats;       /* 1=>Print I/O statistics to stderr after the dump */
 } fspec_t;
 
 #endif	/*_NCDUMP_H_ */
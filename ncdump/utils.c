@@ -921,6 +921,64 @@ getrootid(int grpid)
     return current;
 }
 
+static void
+print_stats_line(FILE* f, const char* name, const NC_io_stats* s)
+{
+    fprintf(f,"%s: cache hits=%llu misses=%llu evictions=%llu\n",
+	    name,s->cache_hits,s->cache_misses,s->cache_evictions);
+    fprintf(f,"    map reads=%llu (%llu bytes) writes=%llu (%llu bytes) exists=%llu lens=%llu searches=%llu removes=%llu\n",
+	    s->map_reads,s->bytes_read,s->map_writes,s->bytes_written,
+	    s->map_exists,s->map_lens,s->map_searches,s->map_removes);
+    fprintf(f,"    encodes=%llu (%.6fs) decodes=%llu (%.6fs) transfers=%llu (%.6fs)\n",
+	    s->encodes,s->encode_time,s->decodes,s->decode_time,
+	    s->transfers,s->transfer_time);
+}
+
+void
+print_io_stats(FILE* f, int ncid)
+{
+    NC_io_stats stats;
+    int numgrps = 0;
+    int* grpids = NULL;
+    int g;
+
+    if(nc_inq_var_stats(ncid,NC_GLOBAL,&stats) != NC_NOERR)
+	return; /* no statistics for this format */
+    print_stats_line(f,"<file>",&stats);
+    NC_CHECK(nc_inq_grps_full(ncid,&numgrps,NULL));
+    grpids = emalloc((size_t)numgrps * sizeof(int));
+    NC_CHECK(nc_inq_grps_full(ncid,&numgrps,grpids));
+    for(g=0;g<numgrps;g++) {
+	int nvars = 0;
+	int* varids = NULL;
+	int v;
+	size_t len = 0;
+	char* grpname = NULL;
+	NC_CHECK(nc_inq_varids(grpids[g],&nvars,NULL));
+	if(nvars == 0) continue;
+	varids = emalloc((size_t)nvars * sizeof(int));
+	NC_CHECK(nc_inq_varids(grpids[g],&nvars,varids));
+	NC_CHECK(nc_inq_grpname_full(grpids[g],&len,NULL));
+	grpname = emalloc(len+1);
+	NC_CHECK(nc_inq_grpname_full(grpids[g],&len,grpname));
+	grpname[len] = '\0';
+	for(v=0;v<nvars;v++) {
+	    char varname[NC_MAX_NAME+1];
+	    char* path = NULL;
+	    NC_CHECK(nc_inq_varname(grpids[g],varids[v],varname));
+	    NC_CHECK(nc_inq_var_stats(grpids[g],varids[v],&stats));
+	    path = emalloc(len+strlen(varname)+2);
+	    snprintf(path,len+strlen(varname)+2,"%s%s%s",
+		     grpname,(strcmp(grpname,"/")==0?"":"/"),varname);
+	    print_stats_line(f,path,&stats);
+	    free(path);
+	}
+	free(grpname);
+	free(varids);
+    }
+    free(grpids);
+}
+
 #if 0
 static int
 parseFQN(int ncid, const char* fqn0, VarID* idp)
@@ -177,6 +177,12 @@ extern int nc_next_giter(ncgiter_t *iterp, int *grpid);
 extern void nc_free_giter(ncgiter_t *iterp);
 extern int getrootid(int grpid);
 
+/*
+ * Print the I/O statistics of a file and of each of its variables;
+ * formats that keep no statistics print nothing.
+ */
+extern void print_io_stats(FILE* f, int ncid);
+
 #ifdef __cplusplus
 }
 #endif
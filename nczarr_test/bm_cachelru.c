@@ -0,0 +1,110 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Microbenchmark for the LRU bookkeeping of the NCZarr chunk cache.
+   A variable with one element per chunk is read through caches
+   holding an increasing number of chunks. The average time of a
+   cache hit, and of a miss that forces an eviction, should not
+   grow with the number of cached chunks. Note that the time of a
+   miss includes probing the storage for the (never written) chunk.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "netcdf.h"
+#include "timer_utils.h"
+
+#ifdef _WIN32
+#define srandom srand
+#define random (long)rand
+#endif
+
+#define FILE_URL "file://tmp_cachelru.file#mode=nczarr,file"
+#define NHITS 200000
+#define DEFAULTSEED 1
+
+/* No. of chunks in the cache for each run */
+static size_t N[] = {1000, 4000, 16000, 0};
+
+/* Generous bounds on the average times; exceeding them means something is wrong */
+static const struct TimeRange hitrange = {0,20000};
+static const struct TimeRange evictrange = {0,500000};
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static double
+average(Nanotime* times, size_t count)
+{
+    Nanotime delta;
+    NCT_elapsedtime(&times[0],&times[1],&delta);
+    return ((double)NCT_nanoseconds(delta)) / (double)count;
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t* np = NULL;
+    double hits[3], evicts[3];
+    int run;
+
+    NCT_inittimer();
+    srandom(DEFAULTSEED);
+
+    printf("%8s %12s %12s\n","chunks","hit(ns)","evict(ns)");
+    for(run=0,np=N;*np;np++,run++) {
+	int ncid, dimid, varid, value;
+	size_t n = *np;
+	size_t i, index, chunk = 1;
+	Nanotime times[2];
+
+	CHECK(nc_create(FILE_URL,NC_NETCDF4|NC_CLOBBER,&ncid));
+	CHECK(nc_def_dim(ncid,"d",2*n,&dimid));
+	CHECK(nc_def_var(ncid,"v",NC_INT,1,&dimid,&varid));
+	CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,&chunk));
+	CHECK(nc_enddef(ncid));
+	CHECK(nc_set_var_chunk_cache(ncid,varid,n*sizeof(int),n,0.75f));
+
+	/* Fill the cache with the first n chunks */
+	for(i=0;i<n;i++)
+	    CHECK(nc_get_var1_int(ncid,varid,&i,&value));
+
+	/* Random reads of cached chunks */
+	NCT_marktime(&times[0]);
+	for(i=0;i<NHITS;i++) {
+	    index = (size_t)random() % n;
+	    CHECK(nc_get_var1_int(ncid,varid,&index,&value));
+	}
+	NCT_marktime(&times[1]);
+	hits[run] = average(times,NHITS);
+
+	/* Read the other n chunks; each one evicts the least recently used */
+	NCT_marktime(&times[0]);
+	for(i=n;i<2*n;i++)
+	    CHECK(nc_get_var1_int(ncid,varid,&i,&value));
+	NCT_marktime(&times[1]);
+	evicts[run] = average(times,n);
+
+	CHECK(nc_abort(ncid));
+	printf("%8lu %12.1f %12.1f\n",(unsigned long)n,hits[run],evicts[run]);
+	if(!NCT_rangetest((long long)hits[run],hitrange)
+	   || !NCT_rangetest((long long)evicts[run],evictrange))
+	    fprintf(stderr,"*** WARNING: unexpectedly large timing values\n");
+    }
+    /* Constant time => the largest cache costs about the same per access as the smallest */
+    printf("hit ratio %lu/%lu chunks: %.2f\n",(unsigned long)N[run-1],(unsigned long)N[0],hits[run-1]/hits[0]);
+    printf("evict ratio %lu/%lu chunks: %.2f\n",(unsigned long)N[run-1],(unsigned long)N[0],evicts[run-1]/evicts[0]);
+    return 0;
+}
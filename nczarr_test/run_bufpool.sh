@@ -0,0 +1,30 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that chunk buffers are recycled through the buffer pool.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: chunk buffer pool: $zext"
+fileargs tmp_bufpool "mode=nczarr,$zext"
+for t in 0 4 ; do
+deletemap $zext $file
+${execdir}/tst_bufpool "${fileurl}&threads=$t"
+if test "x$FEATURE_FILTERTESTS" = xyes ; then
+deletemap $zext $file
+${execdir}/tst_bufpool "${fileurl}&threads=$t" deflate
+fi
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
@@ -0,0 +1,27 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that chunks whose cache hash keys collide are written and
+# read back correctly.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: colliding cache keys: $zext"
+fileargs tmp_cachecollide "mode=nczarr,$zext"
+for s in 1 2 ; do
+deletemap $zext $file
+${execdir}/tst_cachecollide "${fileurl}&shard=$s"
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
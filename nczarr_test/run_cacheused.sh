@@ -0,0 +1,31 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that the space counted as used by the chunk cache stays
+# the sum of its chunks as they are flushed and read back.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: chunk cache space: $zext"
+fileargs tmp_cacheused "mode=nczarr,$zext"
+for s in 1 2 ; do
+deletemap $zext $file
+${execdir}/tst_cacheused "${fileurl}&shard=$s"
+if test "x$FEATURE_FILTERTESTS" = xyes ; then
+deletemap $zext $file
+${execdir}/tst_cacheused "${fileurl}&shard=$s" deflate
+fi
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
@@ -0,0 +1,38 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that consolidated metadata (.zmetadata) is written
+# when requested and that it alone suffices to open the dataset.
+
+set -e
+
+# Remove the individual metadata objects so only .zmetadata remains
+stripmeta() {
+find $1 -name .zgroup -o -name .zarray -o -name .zattrs | xargs rm -f
+test -f $1/.zmetadata
+}
+
+testcase() {
+zext=$1
+mode=$2
+echo "*** Test: write then read consolidated metadata: mode=$mode"
+fileargs tmp_consolidated_$mode "mode=$mode,consolidated,$zext"
+deletemap $zext $file
+${NCGEN} -4 -b -o "$fileurl" ${srcdir}/ref_consolidated.cdl
+${NCDUMP} -n ref_consolidated "$fileurl" > tmp_consolidated_$mode.cdl
+diff -wb ${srcdir}/ref_$3.cdl tmp_consolidated_$mode.cdl
+stripmeta $file
+fileargs tmp_consolidated_$mode "mode=$mode,$zext"
+${NCDUMP} -n ref_consolidated "$fileurl" > tmp_consolidated_${mode}_strip.cdl
+diff -wb ${srcdir}/ref_$3.cdl tmp_consolidated_${mode}_strip.cdl
+}
+
+# Only the file map allows removing objects directly
+testcase file nczarr consolidated
+testcase file zarr consolidated_zarr
+
+exit 0
@@ -0,0 +1,48 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that chunks holding only the fill value are not
+# stored when the writeemptychunks fragment key is false.
+
+set -e
+
+# Count the chunk (or shard) objects of variable v
+nobjects() {
+ls $file/v | wc -l | tr -d ' '
+}
+
+testcase() {
+zext=$1
+echo "*** Test: fill-only chunks: $zext"
+fileargs tmp_emptychunks "mode=nczarr,$zext"
+for t in 0 4 ; do
+deletemap $zext $file
+${execdir}/tst_emptychunks "${fileurl}&threads=$t"
+if test "x$zext" = xfile ; then
+# 8x8 chunks of 2x2 are all stored
+test `nobjects` = 16
+fi
+deletemap $zext $file
+${execdir}/tst_emptychunks "${fileurl}&threads=$t&writeemptychunks=false"
+if test "x$zext" = xfile ; then
+# only chunk row 1 holds data
+test `nobjects` = 4
+fi
+deletemap $zext $file
+${execdir}/tst_emptychunks "${fileurl}&threads=$t&writeemptychunks=false&shard=2"
+if test "x$zext" = xfile ; then
+# only shard row 0 holds data
+test `nobjects` = 2
+fi
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
@@ -0,0 +1,65 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that variables with non-native byte order round trip
+# and that their chunks are stored in that byte order.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: non-native byte order: $zext"
+fileargs tmp_endian "mode=nczarr,$zext"
+deletemap $zext $file
+${NCGEN} -4 -lb -o "$fileurl" ${srcdir}/ref_endian.cdl
+${NCDUMP} -n ref_endian -s "${fileurl}" > tmp_endian_$zext.cdl
+sclean tmp_endian_$zext.cdl tmp_endian_$zext.txt
+sclean ${srcdir}/ref_endian.cdl tmp_endian_ref.txt
+diff -wb tmp_endian_ref.txt tmp_endian_$zext.txt
+if test "x$zext" = xfile ; then
+# v[0][0..1] and v[7][4..5] (a data value followed by the fill value)
+test "`od -An -tx1 -N8 $file/v/0.0 | tr -d ' \n'`" = "0000000000000001"
+test "`od -An -tx1 -j16 -N8 $file/v/2.1 | tr -d ' \n'`" = "0000002e80000001"
+grep -q '"byteorder": *"dtype"' $file/v/.zarray
+fi
+}
+
+# ref_oldendian.zarr.zip was written by a version that stored the
+# chunks in native (little endian) byte order whatever the dtype said,
+# and did not record "byteorder"; it must still read back correctly,
+# and a copy of it must be stored in the declared byte order.
+testold() {
+zext=$1
+echo "*** Test: native byte order chunks of older versions: $zext"
+rm -fr ref_oldendian.zarr
+unzip -q ${srcdir}/ref_oldendian.zarr.zip
+${NCDUMP} -n ref_endian -s "file://ref_oldendian.zarr#mode=nczarr,$zext" > tmp_oldendian_$zext.cdl
+sclean tmp_oldendian_$zext.cdl tmp_oldendian_$zext.txt
+sclean ${srcdir}/ref_endian.cdl tmp_endian_ref.txt
+diff -wb tmp_endian_ref.txt tmp_oldendian_$zext.txt
+fileargs tmp_oldendian_copy "mode=nczarr,$zext"
+deletemap $zext $file
+${NCCOPY} "file://ref_oldendian.zarr#mode=nczarr,file" "$fileurl"
+# nccopy picks its own chunking, so only compare the data
+${NCDUMP} -n ref_endian "file://ref_oldendian.zarr#mode=nczarr,$zext" > tmp_oldendian_data_$zext.cdl
+${NCDUMP} -n ref_endian "${fileurl}" > tmp_oldendian_copy_$zext.cdl
+diff -wb tmp_oldendian_data_$zext.cdl tmp_oldendian_copy_$zext.cdl
+if test "x$zext" = xfile ; then
+test "`od -An -tx1 -N8 $file/v/0.0 | tr -d ' \n'`" = "0000000000000001"
+fi
+rm -fr ref_oldendian.zarr
+}
+
+testcase file
+# The fixture was written on a little endian machine
+if test "`printf 'ab' | od -An -tx2 | tr -d ' '`" = 6261 ; then
+testold file
+fi
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
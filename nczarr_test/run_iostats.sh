@@ -0,0 +1,28 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify the per-variable I/O statistics and their ncdump output.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: I/O statistics: $zext"
+fileargs tmp_iostats "mode=nczarr,$zext"
+deletemap $zext $file
+${execdir}/tst_iostats "${fileurl}" tmp_iostats.nc
+${NCDUMP} -Xs "${fileurl}" > /dev/null 2> tmp_iostats.txt
+grep -q '^<file>: cache hits=' tmp_iostats.txt
+grep -q '^/v: cache hits=0 misses=32 ' tmp_iostats.txt
+rm -f tmp_iostats.nc tmp_iostats.txt
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
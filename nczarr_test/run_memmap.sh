@@ -0,0 +1,26 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that a dataset can be built and updated in memory
+# with the mem mode word, and is stored only when persisted.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: in-memory map: $zext"
+fileargs tmp_memmap "mode=nczarr,$zext"
+for t in 0 4 ; do
+deletemap $zext $file
+${execdir}/tst_memmap "${fileurl}" "${fileurl},mem&threads=$t"
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+
+exit 0
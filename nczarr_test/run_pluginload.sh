@@ -0,0 +1,52 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that filter plugins are loaded on demand and that the
+# plugin manifest is written and then used.
+
+set -e
+
+# Work on a private copy of the plugin libraries
+EXT="${HDF5_PLUGIN_LIB##*.}"
+rm -fr tmp_plugins
+mkdir tmp_plugins
+cp ${HDF5_PLUGIN_PATH}/*.${EXT} tmp_plugins
+HDF5_PLUGIN_PATH=`pwd`/tmp_plugins
+export HDF5_PLUGIN_PATH
+
+testcase() {
+zext=$1
+echo "*** Test: on demand plugin loading: $zext"
+fileargs tmp_pluginload "mode=nczarr,$zext"
+deletemap $zext $file
+rm -f tmp_plugins/.nczplugins
+# No manifest: libraries are examined only until deflate is found
+NCZ_PLUGIN_MANIFEST=off ${execdir}/tst_pluginload create "${fileurl}"
+if test -f tmp_plugins/.nczplugins ; then
+  echo "*** FAIL: manifest written while disabled"; exit 1
+fi
+# By default the manifest is only read, never written
+${execdir}/tst_pluginload read "${fileurl}"
+if test -f tmp_plugins/.nczplugins ; then
+  echo "*** FAIL: manifest written without being requested"; exit 1
+fi
+# Record what was learned in the manifest
+NCZ_PLUGIN_MANIFEST=update ${execdir}/tst_pluginload read "${fileurl}"
+if test ! -f tmp_plugins/.nczplugins ; then
+  echo "*** FAIL: manifest not written"; exit 1
+fi
+# With the manifest, deflate needs just its filter and the default codecs
+${execdir}/tst_pluginload read "${fileurl}" 2 known
+NCZ_PLUGIN_MANIFEST=read ${execdir}/tst_pluginload create "${fileurl}" 2 known
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+rm -fr tmp_plugins
+exit 0
@@ -0,0 +1,32 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that reading row by row with chunk readahead enabled
+# produces the same results as reading without it.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: sequential read with chunk readahead: $zext"
+fileargs tmp_readahead "mode=nczarr,$zext"
+deletemap $zext $file
+${NCGEN} -4 -lb -o "$fileurl" ${srcdir}/ref_readahead.cdl
+for t in 0 4 ; do
+for r in 0 1 3 100 ; do
+${NCDUMP} -n ref_readahead -s "${fileurl}&threads=$t&readahead=$r" > tmp_readahead_${t}_${r}_$zext.cdl
+sclean tmp_readahead_${t}_${r}_$zext.cdl tmp_readahead_${t}_${r}_$zext.txt
+diff -wb ${srcdir}/ref_readahead.cdl tmp_readahead_${t}_${r}_$zext.txt
+done
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
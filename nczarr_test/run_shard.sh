@@ -0,0 +1,59 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that variables whose chunks are packed into shards
+# read and write the same as unsharded variables.
+
+set -e
+
+TC="${execdir}/tst_chunkcases -4"
+
+testcase() {
+zext=$1
+echo "*** Test: sharded write then read: $zext"
+fileargs tmp_shard "mode=nczarr,$zext"
+deletemap $zext $file
+${NCGEN} -4 -lb -o "${fileurl}&shard=2" ${srcdir}/ref_threads.cdl
+for t in 0 8 ; do
+${NCDUMP} -n ref_threads -s "${fileurl}&threads=$t" > tmp_shard_${t}_$zext.cdl
+sclean tmp_shard_${t}_$zext.cdl tmp_shard_${t}_$zext.txt
+diff -wb ${srcdir}/ref_threads.cdl tmp_shard_${t}_$zext.txt
+done
+if test "x$zext" = xfile ; then
+# 3x4 chunks => 2x2 shards, keyed apart from chunks
+test `ls $file/v | wc -l` = 4
+test `ls $file/v | grep -c '^s\.'` = 4
+fi
+# Readers that do not see the shard shape refuse the variable
+fileargs tmp_shard "mode=zarr,$zext"
+if ${NCDUMP} -v v "$fileurl" > tmp_shard_zarr_$zext.cdl 2>&1 ; then
+echo "*** FAIL: sharded variable read as pure Zarr"
+exit 1
+fi
+
+echo "*** Test: sharded partial write: $zext"
+fileargs tmp_shard_skipw "mode=nczarr,$zext"
+deletemap $zext $file
+$TC -d 6,6 -s 5,5 -p 6,6 -Ow "${fileurl}&shard=2"
+${NCDUMP} -n tmp_skipw "$fileurl" > tmp_shard_skipw_$zext.cdl
+diff -b ${srcdir}/ref_skipw.cdl tmp_shard_skipw_$zext.cdl
+
+echo "*** Test: sharded strided read: $zext"
+fileargs tmp_shard_skip "mode=nczarr,$zext"
+deletemap $zext $file
+$TC -d 6,6 -c 2,2 -Ow "${fileurl}&shard=2"
+$TC -s 5,5 -p 6,6 -Or "$fileurl" > tmp_shard_skip_$zext.txt
+diff -b ${srcdir}/ref_skip.txt tmp_shard_skip_$zext.txt
+${NCDUMP} -n tmp_skip "$fileurl" > tmp_shard_skip_$zext.cdl
+diff -b ${srcdir}/ref_skip.cdl tmp_shard_skip_$zext.cdl
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
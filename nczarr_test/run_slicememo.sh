@@ -0,0 +1,24 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that reused slice projections give the right data.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: slice projection reuse: $zext"
+fileargs tmp_slicememo "mode=nczarr,$zext"
+deletemap $zext $file
+${execdir}/tst_slicememo "${fileurl}"
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
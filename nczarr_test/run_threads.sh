@@ -0,0 +1,43 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that reading with a pool of worker threads
+# produces the same results as reading serially,
+# and likewise for writing filtered chunks.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: multi-chunk read with worker threads: $zext"
+fileargs tmp_threads "mode=nczarr,$zext"
+deletemap $zext $file
+${NCGEN} -4 -lb -o "$fileurl" ${srcdir}/ref_threads.cdl
+for t in 0 1 8 ; do
+${NCDUMP} -n ref_threads -s "${fileurl}&threads=$t" > tmp_threads_${t}_$zext.cdl
+sclean tmp_threads_${t}_$zext.cdl tmp_threads_${t}_$zext.txt
+diff -wb ${srcdir}/ref_threads.cdl tmp_threads_${t}_$zext.txt
+done
+if test "x$FEATURE_FILTERTESTS" = xyes ; then
+echo "*** Test: filtered multi-chunk write with worker threads: $zext"
+${NCDUMP} -n ref_threads "${fileurl}" > tmp_threads_$zext.cdl
+sed -e 's/v:_ChunkSizes = 5, 3 ;/&\n\t\tv:_DeflateLevel = 1 ;/' < ${srcdir}/ref_threads.cdl > tmp_threads_deflate.cdl
+for t in 0 8 ; do
+fileargs tmp_threads_deflate_$t "mode=nczarr,$zext"
+deletemap $zext $file
+${NCGEN} -4 -lb -o "${fileurl}&threads=$t" tmp_threads_deflate.cdl
+${NCDUMP} -n ref_threads "${fileurl}" > tmp_threads_deflate_${t}_$zext.cdl
+diff -wb tmp_threads_$zext.cdl tmp_threads_deflate_${t}_$zext.cdl
+done
+fi
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
@@ -81,19 +81,39 @@ testmapsearch() {
   diff -wb ${srcdir}/$ref ./$txt
 }
 
+testmapbatch() {
+  echo ""; echo "*** Test zmap batch operations -k $1"
+  extfor "$1"
+  tag=mapapi
+  base="tmp_$tag"
+  fileargs $base
+  $CMD $TR -k$1 -x "batchdata" -f $file
+}
+
+testmapfdcache() {
+  echo ""; echo "*** Test zmap open file cache -k $1"
+  extfor "$1"
+  tag=mapapi
+  base="tmp_${tag}_fd"
+  fileargs $base
+  deletemap $1 $file
+  $CMD $TR -k$1 -x create -o $file
+  $CMD $TR -k$1 -x "fdcache" -f $file
+}
+
 main() {
 echo ""
 echo "*** Map Unit Testing"
 echo ""; echo "*** Test zmap_file"
-testmapcreate file; testmapmeta file; testmapdata file; testmapsearch file
+testmapcreate file; testmapmeta file; testmapdata file; testmapsearch file; testmapbatch file; testmapfdcache file
 if test "x$FEATURE_NCZARR_ZIP" = xyes ; then
     echo ""; echo "*** Test zmap_zip"
-    testmapcreate zip; testmapmeta zip; testmapdata zip; testmapsearch zip
+    testmapcreate zip; testmapmeta zip; testmapdata zip; testmapsearch zip; testmapbatch zip
 fi
 if test "x$FEATURE_S3TESTS" = xyes ; then
   echo ""; echo "*** Test zmap_s3sdk"
   export PROFILE="-p default"
-  testmapcreate s3; testmapmeta s3; testmapdata s3; testmapsearch s3
+  testmapcreate s3; testmapmeta s3; testmapdata s3; testmapsearch s3; testmapbatch s3
 fi
 }
 
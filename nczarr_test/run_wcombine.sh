@@ -0,0 +1,33 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that partial chunk writes are combined rather than
+# reading each chunk before writing into it.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: write combining: $zext"
+fileargs tmp_wcombine "mode=nczarr,$zext"
+for t in 0 4 ; do
+deletemap $zext $file
+${execdir}/tst_wcombine "${fileurl}&threads=$t"
+deletemap $zext $file
+${execdir}/tst_wcombine "${fileurl}&threads=$t&writecombine=0" nocombine
+if test "x$FEATURE_FILTERTESTS" = xyes ; then
+deletemap $zext $file
+${execdir}/tst_wcombine "${fileurl}&threads=$t" deflate
+fi
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
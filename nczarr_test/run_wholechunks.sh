@@ -0,0 +1,26 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi 
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify reads of whole chunks that bypass the chunk cache.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: whole chunk reads: $zext"
+fileargs tmp_wholechunks "mode=nczarr,$zext"
+for t in 0 4 ; do
+deletemap $zext $file
+${execdir}/tst_wholechunks "${fileurl}&threads=$t"
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
@@ -0,0 +1,34 @@
+#!/bin/sh
+
+if test "x$srcdir" = x ; then srcdir=`pwd`; fi
+. ../test_common.sh
+
+. "$srcdir/test_nczarr.sh"
+
+# Verify that chunks written behind the writer are stored
+# in order and completely by nc_sync and nc_close.
+
+set -e
+
+testcase() {
+zext=$1
+echo "*** Test: write behind: $zext"
+fileargs tmp_writebehind "mode=nczarr,$zext"
+for t in 0 4 ; do
+# A limit of four chunks, and one of every chunk
+for wb in 1024 1000000 ; do
+deletemap $zext $file
+${execdir}/tst_writebehind "${fileurl}&threads=$t&writebehind=$wb"
+if test "x$FEATURE_FILTERTESTS" = xyes ; then
+deletemap $zext $file
+${execdir}/tst_writebehind "${fileurl}&threads=$t&writebehind=$wb" deflate
+fi
+done
+done
+}
+
+testcase file
+if test "x$FEATURE_NCZARR_ZIP" = xyes ; then testcase zip; fi
+if test "x$FEATURE_S3TESTS" = xyes ; then testcase s3; fi
+
+exit 0
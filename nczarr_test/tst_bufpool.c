@@ -0,0 +1,96 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test that the chunk buffers of a variable are recycled through
+   its buffer pool once the chunk cache is full: reading through a
+   small cache must mostly reuse the buffers of evicted chunks
+   rather than allocate new ones. With a filter, the decoded chunks
+   are offered to the pool when they are evicted.
+
+   Usage: tst_bufpool <file url> [deflate]
+*/
+
+#include "zincludes.h"
+#include "zbufpool.h"
+
+#define NT 64
+#define NX 16
+#define SKIP 40 /* row that is never written */
+#define FILL (-1)
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2], value;
+    int deflate, errors = 0;
+    size_t t, x, start[2], count[2], chunks[2] = {1,NX};
+    int data[NX];
+    NCZBufPoolStats stats;
+
+    if(argc < 2) {fprintf(stderr,"usage: tst_bufpool <url> [deflate]\n"); exit(1);}
+    deflate = (argc > 2 && strcmp(argv[2],"deflate")==0);
+
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"t",NT,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    value = FILL;
+    CHECK(nc_def_var_fill(ncid,varid,NC_FILL,&value));
+    if(deflate) CHECK(nc_def_var_deflate(ncid,varid,0,1,1));
+    CHECK(nc_enddef(ncid));
+    count[0] = 1; count[1] = NX; start[1] = 0;
+    for(t=0;t<NT;t++) {
+	if(t == SKIP) continue;
+	for(x=0;x<NX;x++) data[x] = (int)(t*NX + x);
+	start[0] = t;
+	CHECK(nc_put_vara_int(ncid,varid,start,count,data));
+    }
+    CHECK(nc_close(ncid));
+
+    /* Read one chunk at a time through a cache of four chunks */
+    CHECK(nc_open(argv[1],NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    CHECK(nc_set_var_chunk_cache(ncid,varid,4*NX*sizeof(int),4,0.75f));
+    for(t=0;t<NT;t++) {
+	start[0] = t;
+	CHECK(nc_get_vara_int(ncid,varid,start,count,data));
+	for(x=0;x<NX;x++) {
+	    int want = (t == SKIP ? FILL : (int)(t*NX + x));
+	    if(data[x] != want) {
+		fprintf(stderr,"*** FAIL: v[%lu][%lu]=%d expected %d\n",
+			(unsigned long)t,(unsigned long)x,data[x],want);
+		errors++;
+		break;
+	    }
+	}
+    }
+    CHECK(NCZ_inq_var_chunk_bufpool(ncid,varid,&stats));
+    printf("bufpool: hits=%lu misses=%lu recycled=%lu dropped=%lu\n",
+	   (unsigned long)stats.hits,(unsigned long)stats.misses,
+	   (unsigned long)stats.recycled,(unsigned long)stats.dropped);
+    /* Unfiltered chunks are read into recycled buffers; filters
+       allocate their own output, so only correctness is checked */
+    if(!deflate && (stats.hits < NT/2 || stats.misses > NT/4 || stats.recycled < NT/2)) {
+	fprintf(stderr,"*** FAIL: %lu of %lu buffers reused\n",
+		(unsigned long)stats.hits,(unsigned long)(stats.hits+stats.misses));
+	errors++;
+    }
+    CHECK(nc_close(ncid));
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: chunk buffer pool\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test chunks whose hash keys collide in the chunk cache: the hash
+   keys of the variable are masked down to a few bits, so that most
+   chunks share a key with some other chunk. Whole and partial writes,
+   flushes and reads must all still see the right data, and the
+   space counted as used must stay the sum of the cached chunks.
+
+   Usage: tst_cachecollide <file url>
+*/
+
+#include "zincludes.h"
+
+#define NT 8
+#define NX 8
+#define CT 2 /* chunk shape is CT x CT */
+#define KEYMASK 0x1ULL /* leaves two distinct keys for 16 chunks */
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static int errors = 0;
+
+static void
+checkdata(int ncid, int varid, const int* expected, const char* when)
+{
+    int back[NT*NX];
+    size_t i, used, size;
+
+    CHECK(nc_get_var_int(ncid,varid,back));
+    for(i=0;i<NT*NX;i++) {
+	if(back[i] != expected[i]) {
+	    fprintf(stderr,"*** FAIL: %s: [%lu] read %d expected %d\n",
+		    when,(unsigned long)i,back[i],expected[i]);
+	    errors++;
+	    break;
+	}
+    }
+    CHECK(NCZ_inq_var_chunk_cache_used(ncid,varid,&used,&size));
+    if(used != size) {
+	fprintf(stderr,"*** FAIL: %s: used=%lu chunks=%lu\n",
+		when,(unsigned long)used,(unsigned long)size);
+	errors++;
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2];
+    size_t i, t, chunks[2] = {CT,CT};
+    size_t start[2], count[2];
+    int data[NT*NX], row[NX];
+
+    if(argc < 2) {fprintf(stderr,"usage: tst_cachecollide <url>\n"); exit(1);}
+
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"t",NT,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    CHECK(nc_enddef(ncid));
+    CHECK(NCZ_set_var_cache_keymask(ncid,varid,KEYMASK));
+
+    /* Whole chunks */
+    for(i=0;i<NT*NX;i++) data[i] = (int)i;
+    CHECK(nc_put_var_int(ncid,varid,data));
+    checkdata(ncid,varid,data,"whole write");
+    CHECK(nc_sync(ncid));
+    checkdata(ncid,varid,data,"whole write flushed");
+
+    /* One row at a time, so that every chunk is partly written
+       before a chunk with the same key is touched */
+    count[0] = 1; count[1] = NX;
+    start[1] = 0;
+    for(t=0;t<NT;t++) {
+	for(i=0;i<NX;i++) row[i] = data[t*NX+i] = (int)(1000+t*NX+i);
+	start[0] = t;
+	CHECK(nc_put_vara_int(ncid,varid,start,count,row));
+    }
+    checkdata(ncid,varid,data,"row writes");
+
+    /* Single elements in column order */
+    count[0] = 1; count[1] = 1;
+    for(i=0;i<NX;i++) {
+	for(t=0;t<NT;t++) {
+	    int v = (int)(2000+t*NX+i);
+	    start[0] = t; start[1] = i;
+	    data[t*NX+i] = v;
+	    CHECK(nc_put_vara_int(ncid,varid,start,count,&v));
+	}
+    }
+    CHECK(nc_sync(ncid));
+    checkdata(ncid,varid,data,"element writes");
+    CHECK(nc_close(ncid));
+
+    /* What was stored must not depend on the collisions */
+    CHECK(nc_open(argv[1],NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    checkdata(ncid,varid,data,"reopened");
+    CHECK(nc_close(ncid));
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: colliding chunk cache keys\n");
+    return 0;
+}
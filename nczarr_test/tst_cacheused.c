@@ -0,0 +1,81 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the accounting of the space used by a chunk cache: flushing
+   encodes the modified chunks in place and reading decodes them
+   again, and after each the space counted as used must still be the
+   sum of the sizes of the cached chunks.
+
+   Usage: tst_cacheused <file url> [deflate]
+*/
+
+#include "zincludes.h"
+
+#define NT 8
+#define NX 8
+#define CT 2 /* chunk shape is CT x CT */
+#define NPASSES 4
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static int errors = 0;
+
+static void
+checkused(int ncid, int varid, const char* when, size_t pass)
+{
+    size_t used, size;
+    CHECK(NCZ_inq_var_chunk_cache_used(ncid,varid,&used,&size));
+    if(used != size) {
+	fprintf(stderr,"*** FAIL: pass %lu after %s: used=%lu chunks=%lu\n",
+		(unsigned long)pass,when,(unsigned long)used,(unsigned long)size);
+	errors++;
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2];
+    size_t i, pass, chunks[2] = {CT,CT};
+    int data[NT*NX], back[NT*NX];
+
+    if(argc < 2) {fprintf(stderr,"usage: tst_cacheused <url> [deflate]\n"); exit(1);}
+
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"t",NT,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    if(argc > 2 && strcmp(argv[2],"deflate")==0)
+	CHECK(nc_def_var_deflate(ncid,varid,0,1,9));
+    CHECK(nc_enddef(ncid));
+
+    /* The cache holds every chunk, so nothing is evicted */
+    for(pass=0;pass<NPASSES;pass++) {
+	for(i=0;i<NT*NX;i++) data[i] = (int)pass;
+	CHECK(nc_put_var_int(ncid,varid,data));
+	CHECK(nc_sync(ncid));
+	checkused(ncid,varid,"flush",pass);
+	CHECK(nc_get_var_int(ncid,varid,back));
+	checkused(ncid,varid,"read",pass);
+	if(memcmp(data,back,sizeof(data)) != 0) {
+	    fprintf(stderr,"*** FAIL: pass %lu: data differs\n",(unsigned long)pass);
+	    errors++;
+	}
+    }
+    CHECK(nc_close(ncid));
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: cache space accounting\n");
+    return 0;
+}
@@ -0,0 +1,92 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Write a variable of which only some chunks hold data other than
+   the fill value, then overwrite some of those chunks with the fill
+   value, and verify the data. Run with the "writeemptychunks=false"
+   fragment, the fill-only chunks must not be stored, which the
+   calling script checks.
+
+   Usage: tst_emptychunks <file url>
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "netcdf.h"
+
+#define N 8
+#define CHUNK 2
+#define DATAROWS 4 /* rows [0,DATAROWS) are written with data */
+#define CLEARROWS 2 /* rows [0,CLEARROWS) are then reset to fill */
+#define FILL (-1)
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static int data[N*N];
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2], value;
+    size_t r, c, chunks[2] = {CHUNK,CHUNK};
+    size_t start[2] = {0,0}, count[2] = {CLEARROWS,N};
+    int errors = 0;
+
+    if(argc < 2) {fprintf(stderr,"usage: tst_emptychunks <url>\n"); exit(1);}
+
+    /* Write the whole variable, mostly fill */
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"r",N,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"c",N,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    value = FILL;
+    CHECK(nc_def_var_fill(ncid,varid,NC_FILL,&value));
+    CHECK(nc_enddef(ncid));
+    for(r=0;r<N;r++)
+	for(c=0;c<N;c++)
+	    data[r*N+c] = (r < DATAROWS ? (int)(r*N+c) : FILL);
+    CHECK(nc_put_var_int(ncid,varid,data));
+    CHECK(nc_close(ncid));
+
+    /* Reset the first chunk rows to fill */
+    CHECK(nc_open(argv[1],NC_WRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    for(r=0;r<CLEARROWS*N;r++) data[r] = FILL;
+    CHECK(nc_put_vara_int(ncid,varid,start,count,data));
+    CHECK(nc_close(ncid));
+
+    /* Verify */
+    CHECK(nc_open(argv[1],NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    memset(data,0,sizeof(data));
+    CHECK(nc_get_var_int(ncid,varid,data));
+    for(r=0;r<N;r++) {
+	for(c=0;c<N;c++) {
+	    int want = (r >= CLEARROWS && r < DATAROWS ? (int)(r*N+c) : FILL);
+	    if(data[r*N+c] != want) {
+		fprintf(stderr,"*** FAIL: v[%lu][%lu]=%d expected %d\n",
+			(unsigned long)r,(unsigned long)c,data[r*N+c],want);
+		errors++;
+	    }
+	}
+    }
+    CHECK(nc_close(ncid));
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: fill-only chunks\n");
+    return 0;
+}
@@ -0,0 +1,127 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the I/O statistics of NCZarr variables and files: reading
+   each row of a variable twice through a small cache must count one
+   miss and one hit per chunk, the chunk bytes read from the map and
+   one transfer per access; the file totals must include those of
+   every variable. Other formats keep no statistics.
+
+   Usage: tst_iostats <file url> <netcdf-3 file>
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "netcdf.h"
+
+#define NT 32
+#define NX 16
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static int errors = 0;
+
+static void
+expect(const char* what, unsigned long long value, int ok)
+{
+    if(!ok) {
+	fprintf(stderr,"*** FAIL: %s=%llu\n",what,value);
+	errors++;
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, wid, dimids[2], stat;
+    size_t t, x, start[2], count[2], chunks[2] = {1,NX};
+    int data[NX];
+    NC_io_stats vstats, wstats, fstats;
+
+    if(argc < 3) {fprintf(stderr,"usage: tst_iostats <url> <file>\n"); exit(1);}
+
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"t",NT,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    CHECK(nc_def_var(ncid,"w",NC_INT,1,&dimids[1],&wid));
+    CHECK(nc_enddef(ncid));
+    count[0] = 1; count[1] = NX; start[1] = 0;
+    for(t=0;t<NT;t++) {
+	for(x=0;x<NX;x++) data[x] = (int)(t*NX + x);
+	start[0] = t;
+	CHECK(nc_put_vara_int(ncid,varid,start,count,data));
+    }
+    CHECK(nc_put_var_int(ncid,wid,data));
+    CHECK(nc_inq_var_stats(ncid,varid,&vstats));
+    expect("writes transfers",vstats.transfers,vstats.transfers == NT);
+    CHECK(nc_close(ncid));
+
+    /* Read each row twice through a cache of four chunks */
+    CHECK(nc_open(argv[1],NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    CHECK(nc_inq_varid(ncid,"w",&wid));
+    CHECK(nc_set_var_chunk_cache(ncid,varid,4*NX*sizeof(int),4,0.75f));
+    for(t=0;t<NT;t++) {
+	start[0] = t;
+	CHECK(nc_get_vara_int(ncid,varid,start,count,data));
+	CHECK(nc_get_vara_int(ncid,varid,start,count,data));
+	if(data[NX-1] != (int)(t*NX + NX-1)) {
+	    fprintf(stderr,"*** FAIL: v[%lu] wrong\n",(unsigned long)t);
+	    errors++;
+	}
+    }
+    CHECK(nc_get_var_int(ncid,wid,data));
+
+    CHECK(nc_inq_var_stats(ncid,varid,&vstats));
+    CHECK(nc_inq_var_stats(ncid,wid,&wstats));
+    CHECK(nc_inq_var_stats(ncid,NC_GLOBAL,&fstats));
+    printf("v: hits=%llu misses=%llu evictions=%llu reads=%llu bytes=%llu transfers=%llu\n",
+	   vstats.cache_hits,vstats.cache_misses,vstats.cache_evictions,
+	   vstats.map_reads,vstats.bytes_read,vstats.transfers);
+    printf("file: reads=%llu bytes=%llu writes=%llu\n",
+	   fstats.map_reads,fstats.bytes_read,fstats.map_writes);
+    expect("hits",vstats.cache_hits,vstats.cache_hits == NT);
+    expect("misses",vstats.cache_misses,vstats.cache_misses == NT);
+    expect("evictions",vstats.cache_evictions,vstats.cache_evictions >= NT-4);
+    expect("map reads",vstats.map_reads,vstats.map_reads >= NT);
+    expect("bytes read",vstats.bytes_read,vstats.bytes_read == NT*NX*sizeof(int));
+    expect("bytes written",vstats.bytes_written,vstats.bytes_written == 0);
+    expect("transfers",vstats.transfers,vstats.transfers == 2*NT);
+    expect("file hits",fstats.cache_hits,fstats.cache_hits == vstats.cache_hits + wstats.cache_hits);
+    expect("file transfers",fstats.transfers,fstats.transfers == vstats.transfers + wstats.transfers);
+    /* The file also reads its metadata */
+    expect("file reads",fstats.map_reads,fstats.map_reads > vstats.map_reads + wstats.map_reads);
+    expect("file bytes",fstats.bytes_read,fstats.bytes_read > vstats.bytes_read + wstats.bytes_read);
+    if((stat = nc_inq_var_stats(ncid,varid,NULL)) != NC_EINVAL) {
+	fprintf(stderr,"*** FAIL: NULL stats: %s\n",nc_strerror(stat));
+	errors++;
+    }
+    CHECK(nc_close(ncid));
+
+    /* Other formats keep no statistics */
+    CHECK(nc_create(argv[2],NC_CLOBBER,&ncid));
+    CHECK(nc_enddef(ncid));
+    if((stat = nc_inq_var_stats(ncid,NC_GLOBAL,&fstats)) != NC_ENOTBUILT) {
+	fprintf(stderr,"*** FAIL: netcdf-3 stats: %s\n",nc_strerror(stat));
+	errors++;
+    }
+    CHECK(nc_close(ncid));
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: I/O statistics\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the in-memory map selected by the "mem" mode word. The
+   dataset is extracted from storage on open, and is written back
+   on close only if the mode includes NC_PERSIST and the dataset
+   was not aborted.
+
+   Usage: tst_memmap <file url> <same url with the mem mode word>
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "netcdf.h"
+
+#define NT 12
+#define NX 10
+#define CHUNK 4
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static int data[NT*NX];
+static int errors = 0;
+
+static void
+create(const char* url, int mode)
+{
+    int ncid, varid, dimids[2];
+    size_t chunks[2] = {CHUNK,CHUNK};
+    size_t i;
+
+    CHECK(nc_create(url,NC_NETCDF4|NC_CLOBBER|mode,&ncid));
+    CHECK(nc_def_dim(ncid,"t",NT,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    CHECK(nc_put_att_text(ncid,NC_GLOBAL,"title",6,"memory"));
+    CHECK(nc_enddef(ncid));
+    for(i=0;i<NT*NX;i++) data[i] = (int)i;
+    CHECK(nc_put_var_int(ncid,varid,data));
+    CHECK(nc_close(ncid));
+}
+
+/* Set v[0][0] through url and either close or abort */
+static void
+update(const char* url, int mode, int value, int abort)
+{
+    int ncid, varid;
+    size_t start[2] = {0,0};
+
+    CHECK(nc_open(url,NC_WRITE|mode,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    CHECK(nc_put_var1_int(ncid,varid,start,&value));
+    if(abort)
+	CHECK(nc_abort(ncid));
+    else
+	CHECK(nc_close(ncid));
+}
+
+/* Verify the dataset at url; v[0][0] must be first */
+static void
+verify(const char* tag, const char* url, int first)
+{
+    int ncid, varid;
+    char title[16];
+    size_t i;
+
+    CHECK(nc_open(url,NC_NOWRITE,&ncid));
+    memset(title,0,sizeof(title));
+    CHECK(nc_get_att_text(ncid,NC_GLOBAL,"title",title));
+    if(strcmp(title,"memory") != 0) {
+	fprintf(stderr,"*** FAIL: %s: title=%s\n",tag,title);
+	errors++;
+    }
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    memset(data,0,sizeof(data));
+    CHECK(nc_get_var_int(ncid,varid,data));
+    for(i=0;i<NT*NX;i++) {
+	int want = (i == 0 ? first : (int)i);
+	if(data[i] != want) {
+	    fprintf(stderr,"*** FAIL: %s: v[%lu]=%d expected %d\n",
+		    tag,(unsigned long)i,data[i],want);
+	    errors++;
+	    break;
+	}
+    }
+    CHECK(nc_close(ncid));
+}
+
+int
+main(int argc, char** argv)
+{
+    const char* url;
+    const char* memurl;
+    int ncid;
+
+    if(argc < 3) {fprintf(stderr,"usage: tst_memmap <url> <memurl>\n"); exit(1);}
+    url = argv[1];
+    memurl = argv[2];
+
+    /* Without NC_PERSIST, nothing reaches storage */
+    create(memurl,0);
+    if(nc_open(url,NC_NOWRITE,&ncid) == NC_NOERR) {
+	fprintf(stderr,"*** FAIL: dataset was stored without NC_PERSIST\n");
+	nc_close(ncid);
+	errors++;
+    }
+
+    /* With NC_PERSIST, the dataset is stored on close */
+    create(memurl,NC_PERSIST);
+    verify("persisted",url,0);
+    verify("extracted",memurl,0);
+
+    /* Changes are discarded unless persisted */
+    update(memurl,0,100,0);
+    verify("not persisted",url,0);
+    update(memurl,NC_PERSIST,100,1);
+    verify("aborted",url,0);
+    update(memurl,NC_PERSIST,100,0);
+    verify("updated",url,100);
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: in-memory map\n");
+    return 0;
+}
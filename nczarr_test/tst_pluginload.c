@@ -0,0 +1,96 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test that filter plugin libraries are only loaded when a variable
+   uses one of their filters. A dataset without filters must not load
+   any library; one using deflate must load only the libraries needed
+   for it once the plugin manifest describes the plugin directory.
+
+   Usage: tst_pluginload create|read <file url> [<max loaded> [known]]
+*/
+
+#include "zincludes.h"
+#include "zfilter.h"
+
+#define NX 64
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static size_t nfiles, nknown, nloaded;
+
+static void
+getstats(const char* when)
+{
+    CHECK(NCZ_plugin_stats(&nfiles,&nknown,&nloaded));
+    printf("plugins %s: files=%lu known=%lu loaded=%lu\n",when,
+	   (unsigned long)nfiles,(unsigned long)nknown,(unsigned long)nloaded);
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, dimid, plainid, zipid, x, errors = 0;
+    int data[NX];
+    size_t maxloaded = 0;
+    int create, expectknown;
+
+    if(argc < 3) {fprintf(stderr,"usage: tst_pluginload create|read <url> [<max loaded> [known]]\n"); exit(1);}
+    create = (strcmp(argv[1],"create")==0);
+    if(argc > 3) maxloaded = (size_t)atol(argv[3]);
+    expectknown = (argc > 4 && strcmp(argv[4],"known")==0);
+
+    getstats("initial");
+    if(nfiles == 0) {fprintf(stderr,"*** FAIL: no plugin libraries found\n"); exit(1);}
+    if(nloaded != 0) {fprintf(stderr,"*** FAIL: libraries loaded before use\n"); errors++;}
+    if(expectknown && nknown != nfiles) {fprintf(stderr,"*** FAIL: manifest not used\n"); errors++;}
+
+    if(create) {
+        CHECK(nc_create(argv[2],NC_NETCDF4|NC_CLOBBER,&ncid));
+        CHECK(nc_def_dim(ncid,"x",NX,&dimid));
+        CHECK(nc_def_var(ncid,"plain",NC_INT,1,&dimid,&plainid));
+        CHECK(nc_enddef(ncid));
+        for(x=0;x<NX;x++) data[x] = x;
+        CHECK(nc_put_var_int(ncid,plainid,data));
+        getstats("unfiltered");
+        if(nloaded != 0) {fprintf(stderr,"*** FAIL: libraries loaded without filters\n"); errors++;}
+        CHECK(nc_redef(ncid));
+        CHECK(nc_def_var(ncid,"zipped",NC_INT,1,&dimid,&zipid));
+        CHECK(nc_def_var_deflate(ncid,zipid,0,1,1));
+        CHECK(nc_enddef(ncid));
+        for(x=0;x<NX;x++) data[x] = 2*x;
+        CHECK(nc_put_var_int(ncid,zipid,data));
+        CHECK(nc_close(ncid));
+    } else {
+        CHECK(nc_open(argv[2],NC_NOWRITE,&ncid));
+        CHECK(nc_inq_varid(ncid,"plain",&plainid));
+        CHECK(nc_inq_varid(ncid,"zipped",&zipid));
+        CHECK(nc_get_var_int(ncid,plainid,data));
+        for(x=0;x<NX;x++) if(data[x] != x) {errors++; break;}
+        CHECK(nc_get_var_int(ncid,zipid,data));
+        for(x=0;x<NX;x++) if(data[x] != 2*x) {errors++; break;}
+        if(errors) fprintf(stderr,"*** FAIL: data mismatch\n");
+        CHECK(nc_close(ncid));
+    }
+
+    getstats("final");
+    if(nloaded == 0) {fprintf(stderr,"*** FAIL: deflate did not load a library\n"); errors++;}
+    if(maxloaded > 0 && nloaded > maxloaded) {
+	fprintf(stderr,"*** FAIL: %lu libraries loaded; expected at most %lu\n",
+		(unsigned long)nloaded,(unsigned long)maxloaded);
+	errors++;
+    }
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: plugin loading\n");
+    return 0;
+}
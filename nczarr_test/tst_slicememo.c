@@ -0,0 +1,141 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the reuse of slice projections between transfers: hyperslabs
+   of one shape are read and written at many positions, shifted by
+   whole chunks and otherwise, with strides and with slices clipped
+   by the end of a dimension, and every value must come out right.
+
+   Usage: tst_slicememo <file url>
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "netcdf.h"
+
+#define NY 37
+#define NX 23
+#define CY 5
+#define CX 4
+
+#define VALUE(y,x) ((int)((y)*1000 + (x)))
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+/* Hyperslab shapes: count and stride in each dimension */
+static const size_t shapes[][4] = {
+    {3,7,1,1},
+    {5,4,1,1}, /* exactly one chunk */
+    {4,3,2,3},
+    {1,23,1,1},
+    {6,2,3,5},
+};
+#define NSHAPES (sizeof(shapes)/sizeof(shapes[0]))
+
+static int errors = 0;
+static int truth[NY][NX];
+
+static int
+readall(int ncid, int varid)
+{
+    size_t y, x, s;
+    int data[NY*NX];
+
+    for(s=0;s<NSHAPES;s++) {
+	size_t count[2] = {shapes[s][0],shapes[s][1]};
+	ptrdiff_t stride[2] = {(ptrdiff_t)shapes[s][2],(ptrdiff_t)shapes[s][3]};
+	size_t start[2];
+	/* Every start position, so shifts by whole chunks and by
+	   parts of chunks alternate */
+	for(start[0]=0;start[0]+(count[0]-1)*stride[0] < NY;start[0]++) {
+	    for(start[1]=0;start[1]+(count[1]-1)*stride[1] < NX;start[1]++) {
+		CHECK(nc_get_vars_int(ncid,varid,start,count,stride,data));
+		for(y=0;y<count[0];y++) {
+		    for(x=0;x<count[1];x++) {
+			size_t yy = start[0]+y*stride[0];
+			size_t xx = start[1]+x*stride[1];
+			if(data[y*count[1]+x] != truth[yy][xx]) {
+			    if(errors++ < 10)
+				fprintf(stderr,"*** FAIL: shape %lu at [%lu][%lu]: v[%lu][%lu]=%d expected %d\n",
+				    (unsigned long)s,(unsigned long)start[0],(unsigned long)start[1],
+				    (unsigned long)yy,(unsigned long)xx,data[y*count[1]+x],truth[yy][xx]);
+			}
+		    }
+		}
+	    }
+	}
+    }
+    return errors;
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2];
+    size_t y, x, start[2], count[2], chunks[2] = {CY,CX};
+    int data[NY*NX];
+
+    if(argc < 2) {fprintf(stderr,"usage: tst_slicememo <url>\n"); exit(1);}
+
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"y",NY,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    CHECK(nc_enddef(ncid));
+    /* Write in 3x5 blocks so that the writes also reuse projections */
+    count[0] = 3; count[1] = 5;
+    for(start[0]=0;start[0]<NY;start[0]+=count[0]) {
+	for(start[1]=0;start[1]<NX;start[1]+=count[1]) {
+	    size_t cy = (start[0]+count[0] > NY ? NY-start[0] : count[0]);
+	    size_t cx = (start[1]+count[1] > NX ? NX-start[1] : count[1]);
+	    size_t c[2] = {cy,cx};
+	    for(y=0;y<cy;y++)
+		for(x=0;x<cx;x++) {
+		    truth[start[0]+y][start[1]+x] = VALUE(start[0]+y,start[1]+x);
+		    data[y*cx+x] = truth[start[0]+y][start[1]+x];
+		}
+	    CHECK(nc_put_vara_int(ncid,varid,start,c,data));
+	}
+    }
+    readall(ncid,varid);
+    CHECK(nc_close(ncid));
+
+    /* Overwrite shifted 2x2 blocks, then read everything back */
+    CHECK(nc_open(argv[1],NC_WRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    count[0] = 2; count[1] = 2;
+    for(start[0]=1;start[0]+count[0]<=NY;start[0]+=3) {
+	for(start[1]=2;start[1]+count[1]<=NX;start[1]+=CX) {
+	    for(y=0;y<count[0];y++)
+		for(x=0;x<count[1];x++) {
+		    truth[start[0]+y][start[1]+x] = -VALUE(start[0]+y,start[1]+x);
+		    data[y*count[1]+x] = truth[start[0]+y][start[1]+x];
+		}
+	    CHECK(nc_put_vara_int(ncid,varid,start,count,data));
+	}
+    }
+    readall(ncid,varid);
+    CHECK(nc_close(ncid));
+
+    CHECK(nc_open(argv[1],NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    readall(ncid,varid);
+    CHECK(nc_close(ncid));
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: slice projection reuse\n");
+    return 0;
+}
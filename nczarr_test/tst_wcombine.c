@@ -0,0 +1,169 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the combining of partial chunk writes: writing a variable a
+   row at a time, round robin over its chunks, through a cache of
+   two chunks must not read any chunk, as each chunk is complete
+   before it is written out. Rewriting part of stored chunks must
+   keep the rest of their data, and with write combining turned off
+   the chunks are read before they are written into.
+
+   Usage: tst_wcombine <file url> [deflate] [nocombine]
+*/
+
+#include "zincludes.h"
+
+#define NT 16
+#define NX 16
+#define CT 4 /* chunk rows */
+#define NCHUNKS (NT/CT)
+#define SKIP (NT-1) /* row that is never written */
+#define FILL (-1)
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static int errors = 0;
+
+static int
+option(int argc, char** argv, const char* name)
+{
+    int i;
+    for(i=2;i<argc;i++) if(strcmp(argv[i],name)==0) return 1;
+    return 0;
+}
+
+static void
+putrow(int ncid, int varid, size_t t, int base)
+{
+    size_t x, start[2], count[2];
+    int data[NX];
+    for(x=0;x<NX;x++) data[x] = base + (int)(t*NX + x);
+    start[0] = t; start[1] = 0;
+    count[0] = 1; count[1] = NX;
+    CHECK(nc_put_vara_int(ncid,varid,start,count,data));
+}
+
+static unsigned long long
+mapreads(int ncid, int varid)
+{
+    NC_io_stats stats;
+    CHECK(nc_inq_var_stats(ncid,varid,&stats));
+    return stats.map_reads;
+}
+
+/* Open the variable with a cache of two chunks */
+static void
+openvar(const char* url, int mode, int* ncidp, int* varidp)
+{
+    CHECK(nc_open(url,mode,ncidp));
+    CHECK(nc_inq_varid(*ncidp,"v",varidp));
+    CHECK(nc_set_var_chunk_cache(*ncidp,*varidp,2*CT*NX*sizeof(int),2,0.75f));
+}
+
+static void
+verify(const char* url, const int* rewritten)
+{
+    int ncid, varid;
+    size_t t, x, start[2], count[2];
+    int data[NX];
+
+    openvar(url,NC_NOWRITE,&ncid,&varid);
+    count[0] = 1; count[1] = NX; start[1] = 0;
+    for(t=0;t<NT;t++) {
+	start[0] = t;
+	CHECK(nc_get_vara_int(ncid,varid,start,count,data));
+	for(x=0;x<NX;x++) {
+	    int want = (t == SKIP ? FILL : rewritten[t] + (int)(t*NX + x));
+	    if(data[x] != want) {
+		fprintf(stderr,"*** FAIL: v[%lu][%lu]=%d expected %d\n",
+			(unsigned long)t,(unsigned long)x,data[x],want);
+		errors++;
+		break;
+	    }
+	}
+    }
+    CHECK(nc_close(ncid));
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2], value;
+    int deflate, combine;
+    size_t t, c, pass, chunks[2] = {CT,NX};
+    int rewritten[NT];
+    unsigned long long reads;
+
+    if(argc < 2) {fprintf(stderr,"usage: tst_wcombine <url> [deflate] [nocombine]\n"); exit(1);}
+    deflate = option(argc,argv,"deflate");
+    combine = !option(argc,argv,"nocombine");
+    memset(rewritten,0,sizeof(rewritten));
+
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"t",NT,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    value = FILL;
+    CHECK(nc_def_var_fill(ncid,varid,NC_FILL,&value));
+    if(deflate) CHECK(nc_def_var_deflate(ncid,varid,0,1,1));
+    CHECK(nc_enddef(ncid));
+    CHECK(nc_set_var_chunk_cache(ncid,varid,2*CT*NX*sizeof(int),2,0.75f));
+
+    /* Each write covers one row of a chunk; four chunks are in progress at once */
+    for(pass=0;pass<CT;pass++) {
+	for(c=0;c<NCHUNKS;c++) {
+	    t = c*CT + pass;
+	    if(t != SKIP) putrow(ncid,varid,t,0);
+	}
+    }
+    reads = mapreads(ncid,varid);
+    printf("write: map reads=%llu\n",reads);
+    if(combine && reads != 0) {
+	fprintf(stderr,"*** FAIL: %llu chunk reads while writing whole chunks\n",reads);
+	errors++;
+    }
+    if(!combine && reads == 0) {
+	fprintf(stderr,"*** FAIL: chunks were not read before writing into them\n");
+	errors++;
+    }
+    CHECK(nc_close(ncid));
+    verify(argv[1],rewritten);
+
+    /* Rewrite one row of each stored chunk; the other rows must be kept */
+    openvar(argv[1],NC_WRITE,&ncid,&varid);
+    for(c=0;c<NCHUNKS;c++) {
+	t = c*CT + 1;
+	rewritten[t] = 1000;
+	putrow(ncid,varid,t,rewritten[t]);
+    }
+    CHECK(nc_close(ncid));
+    verify(argv[1],rewritten);
+
+    /* With combining off, a partial write reads the chunk at once */
+    openvar(argv[1],NC_WRITE,&ncid,&varid);
+    CHECK(NCZ_set_var_write_combine(ncid,varid,0));
+    rewritten[2] = 2000;
+    putrow(ncid,varid,2,rewritten[2]);
+    reads = mapreads(ncid,varid);
+    if(reads == 0) {
+	fprintf(stderr,"*** FAIL: chunk not read with write combining off\n");
+	errors++;
+    }
+    CHECK(nc_close(ncid));
+    verify(argv[1],rewritten);
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: write combining\n");
+    return 0;
+}
@@ -0,0 +1,152 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test reads that cover whole chunks when the chunk cache is too
+   small to hold all the chunks of the read, so the chunks bypass
+   the cache. Covers chunks that are contiguous in memory, chunks
+   that are not, non-native byte order, missing chunks, partial
+   edge chunks, and chunks modified in the cache but not yet written.
+
+   Usage: tst_wholechunks <file url>
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "netcdf.h"
+
+#define NT 40
+#define NX 12
+#define FILL (-1)
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+struct Var {
+    const char* name;
+    size_t nt; /* first dimension */
+    size_t chunks[2];
+    int endian;
+    size_t skip; /* rows [skip,skip+chunks[0]) are never written */
+};
+
+static struct Var vars[] = {
+{"rows",  NT,   {2,NX}, NC_ENDIAN_NATIVE, 8},  /* contiguous in memory */
+{"tiles", NT,   {4,3},  NC_ENDIAN_NATIVE, 12}, /* not contiguous */
+{"big",   NT,   {4,NX}, NC_ENDIAN_BIG,    16}, /* swapped */
+{"edge",  NT+1, {4,NX}, NC_ENDIAN_NATIVE, 0},  /* partial last chunk */
+{NULL,0,{0,0},0,0}
+};
+
+static int data[(NT+1)*NX];
+static int errors = 0;
+
+static int
+expected(const struct Var* v, size_t t, size_t x)
+{
+    if(v->skip > 0 && t >= v->skip && t < v->skip + v->chunks[0]) return FILL;
+    return (int)(t*NX + x);
+}
+
+static void
+verify(const char* tag, const struct Var* v, size_t t0, size_t nt, int override)
+{
+    size_t t, x;
+    for(t=0;t<nt;t++) {
+	for(x=0;x<NX;x++) {
+	    int want = expected(v,t0+t,x);
+	    if(t0+t == 0 && x == 0 && override) want = override;
+	    if(data[t*NX+x] != want) {
+		fprintf(stderr,"*** FAIL: %s: %s[%lu][%lu]=%d expected %d\n",
+			tag,v->name,(unsigned long)(t0+t),(unsigned long)x,data[t*NX+x],want);
+		errors++;
+		return;
+	    }
+	}
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2];
+    struct Var* v;
+    size_t start[2], count[2];
+    int value;
+
+    if(argc < 2) {fprintf(stderr,"usage: tst_wholechunks <url>\n"); exit(1);}
+
+    /* Create and write every other slab of chunks */
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    for(v=vars;v->name;v++) {
+	char dname[64];
+	int dimid;
+	snprintf(dname,sizeof(dname),"t_%s",v->name);
+	CHECK(nc_def_dim(ncid,dname,v->nt,&dimid));
+	dimids[0] = dimid;
+	CHECK(nc_def_var(ncid,v->name,NC_INT,2,dimids,&varid));
+	CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,v->chunks));
+	value = FILL;
+	CHECK(nc_def_var_fill(ncid,varid,NC_FILL,&value));
+	if(v->endian != NC_ENDIAN_NATIVE)
+	    CHECK(nc_def_var_endian(ncid,varid,v->endian));
+    }
+    CHECK(nc_enddef(ncid));
+    for(v=vars;v->name;v++) {
+	size_t t;
+	CHECK(nc_inq_varid(ncid,v->name,&varid));
+	for(t=0;t<v->nt;t++) {
+	    size_t x;
+	    if(v->skip > 0 && t >= v->skip && t < v->skip + v->chunks[0]) continue;
+	    for(x=0;x<NX;x++) data[x] = (int)(t*NX + x);
+	    start[0] = t; start[1] = 0; count[0] = 1; count[1] = NX;
+	    CHECK(nc_put_vara_int(ncid,varid,start,count,data));
+	}
+    }
+    CHECK(nc_close(ncid));
+
+    /* Read back through a cache that holds only two chunks */
+    CHECK(nc_open(argv[1],NC_WRITE,&ncid));
+    for(v=vars;v->name;v++) {
+	CHECK(nc_inq_varid(ncid,v->name,&varid));
+	CHECK(nc_set_var_chunk_cache(ncid,varid,2*v->chunks[0]*v->chunks[1]*sizeof(int),2,0.75f));
+	/* everything */
+	memset(data,0,sizeof(data));
+	CHECK(nc_get_var_int(ncid,varid,data));
+	verify("whole",v,0,v->nt,0);
+	/* an aligned slab of several chunks */
+	start[0] = 2*v->chunks[0]; start[1] = 0; count[0] = 4*v->chunks[0]; count[1] = NX;
+	memset(data,0,sizeof(data));
+	CHECK(nc_get_vara_int(ncid,varid,start,count,data));
+	verify("slab",v,start[0],count[0],0);
+	/* a slab that only partly covers its chunks */
+	start[0] = 1; count[0] = v->nt - 2;
+	memset(data,0,sizeof(data));
+	CHECK(nc_get_vara_int(ncid,varid,start,count,data));
+	verify("partial",v,start[0],count[0],0);
+	/* modify the first chunk in the cache only; reads must see it */
+	start[0] = 0; start[1] = 0;
+	value = 12345;
+	CHECK(nc_put_var1_int(ncid,varid,start,&value));
+	memset(data,0,sizeof(data));
+	CHECK(nc_get_var_int(ncid,varid,data));
+	verify("modified",v,0,v->nt,12345);
+    }
+    CHECK(nc_close(ncid));
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: whole chunk reads\n");
+    return 0;
+}
@@ -0,0 +1,126 @@
+/* This is part of the netCDF package.
+   Copyright 2018 University Corporation for Atmospheric Research/Unidata
+   See COPYRIGHT file for conditions of use.
+
+   Test the write behind of NCZarr chunks: writing a variable
+   through a cache of two chunks hands the evicted chunks to the
+   worker threads. Reading the variable back before closing it, and
+   rewriting chunks that are still being written, must see the data
+   in the order it was written; nc_sync and nc_close must then
+   leave all of it stored.
+
+   Usage: tst_writebehind <file url> [deflate]
+*/
+
+#include "zincludes.h"
+
+#define NT 64
+#define NX 16
+#define CT 4 /* chunk rows */
+#define NCHUNKS (NT/CT)
+#define FILL (-1)
+
+#define CHECK(expr) check((expr),__LINE__)
+static void
+check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static int errors = 0;
+static int rewritten[NT];
+
+static void
+putrow(int ncid, int varid, size_t t)
+{
+    size_t x, start[2], count[2];
+    int data[NX];
+    for(x=0;x<NX;x++) data[x] = rewritten[t] + (int)(t*NX + x);
+    start[0] = t; start[1] = 0;
+    count[0] = 1; count[1] = NX;
+    CHECK(nc_put_vara_int(ncid,varid,start,count,data));
+}
+
+static void
+verify(int ncid, int varid, const char* when)
+{
+    size_t t, x, start[2], count[2];
+    int data[NX];
+
+    count[0] = 1; count[1] = NX; start[1] = 0;
+    for(t=0;t<NT;t++) {
+	start[0] = t;
+	CHECK(nc_get_vara_int(ncid,varid,start,count,data));
+	for(x=0;x<NX;x++) {
+	    int want = rewritten[t] + (int)(t*NX + x);
+	    if(data[x] != want) {
+		fprintf(stderr,"*** FAIL: %s: v[%lu][%lu]=%d expected %d\n",
+			when,(unsigned long)t,(unsigned long)x,data[x],want);
+		errors++;
+		break;
+	    }
+	}
+    }
+}
+
+int
+main(int argc, char** argv)
+{
+    int ncid, varid, dimids[2], value;
+    int deflate;
+    size_t t, c, chunks[2] = {CT,NX};
+    NC_io_stats stats;
+
+    if(argc < 2) {fprintf(stderr,"usage: tst_writebehind <url> [deflate]\n"); exit(1);}
+    deflate = (argc > 2 && strcmp(argv[2],"deflate")==0);
+    memset(rewritten,0,sizeof(rewritten));
+
+    CHECK(nc_create(argv[1],NC_NETCDF4|NC_CLOBBER,&ncid));
+    CHECK(nc_def_dim(ncid,"t",NT,&dimids[0]));
+    CHECK(nc_def_dim(ncid,"x",NX,&dimids[1]));
+    CHECK(nc_def_var(ncid,"v",NC_INT,2,dimids,&varid));
+    CHECK(nc_def_var_chunking(ncid,varid,NC_CHUNKED,chunks));
+    value = FILL;
+    CHECK(nc_def_var_fill(ncid,varid,NC_FILL,&value));
+    if(deflate) CHECK(nc_def_var_deflate(ncid,varid,0,1,1));
+    CHECK(nc_enddef(ncid));
+    CHECK(nc_set_var_chunk_cache(ncid,varid,2*CT*NX*sizeof(int),2,0.75f));
+
+    for(t=0;t<NT;t++) putrow(ncid,varid,t);
+    /* Read back while the evicted chunks may still be being written */
+    verify(ncid,varid,"after write");
+
+    /* Write chunks again, some of them while their first write is in progress */
+    for(c=0;c<NCHUNKS;c++) {
+	t = c*CT + 1;
+	rewritten[t] = 1000;
+	putrow(ncid,varid,t);
+    }
+    for(c=0;c<NCHUNKS;c+=2) {
+	t = c*CT + 2;
+	rewritten[t] = 2000;
+	putrow(ncid,varid,t);
+    }
+    CHECK(nc_sync(ncid));
+    CHECK(nc_inq_var_stats(ncid,varid,&stats));
+    printf("write behind: map writes=%llu bytes written=%llu\n",stats.map_writes,stats.bytes_written);
+    if(stats.map_writes < NCHUNKS) {
+	fprintf(stderr,"*** FAIL: only %llu chunk writes\n",stats.map_writes);
+	errors++;
+    }
+    verify(ncid,varid,"after sync");
+    CHECK(nc_close(ncid));
+
+    CHECK(nc_open(argv[1],NC_NOWRITE,&ncid));
+    CHECK(nc_inq_varid(ncid,"v",&varid));
+    verify(ncid,varid,"after close");
+    CHECK(nc_close(ncid));
+
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: write behind\n");
+    return 0;
+}
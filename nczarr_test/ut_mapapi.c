@@ -11,6 +11,7 @@
 #define META2 "/meta2"
 #define DATA1 "/data1"
 #define DATA1LEN 25
+#define NBATCH 5
 
 #define PASS 1
 #define FAIL 0
@@ -35,6 +36,8 @@ static int simpledelete(void);
 static int simplemeta(void);
 static int simpledata(void);
 static int search(void);
+static int batchdata(void);
+static int fdcache(void);
 
 struct Test tests[] = {
 {"create",simplecreate},
@@ -42,6 +45,8 @@ struct Test tests[] = {
 {"simplemeta", simplemeta},
 {"simpledata", simpledata},
 {"search", search},
+{"batchdata", batchdata},
+{"fdcache", fdcache},
 {NULL,NULL}
 };
 
@@ -356,6 +361,155 @@ done:
     return THROW(stat);
 }
 
+/* Exercise the batch operations; the last key is never written */
+static int
+batchdata(void)
+{
+    int stat = NC_NOERR;
+    NCZMAP* map = NULL;
+    int data[NBATCH][DATA1LEN];
+    int partial[DATA1LEN];
+    NCZM_REQUEST requests[NBATCH+1];
+    char* keys[NBATCH+1];
+    char name[64];
+    int i,j;
+    size64_t totallen = sizeof(int)*DATA1LEN;
+
+    title(__func__);
+
+    memset(requests,0,sizeof(requests));
+    for(i=0;i<=NBATCH;i++) {
+	snprintf(name,sizeof(name),"/batch/data%d",i);
+        keys[i] = makekey(name);
+    }
+    for(i=0;i<NBATCH;i++) {
+	for(j=0;j<DATA1LEN;j++) data[i][j] = (i*DATA1LEN)+j;
+    }
+
+    if((stat = nczmap_open(impl,url,NC_WRITE,0,NULL,&map)))
+	goto done;
+    report(PASS,"open",map);
+
+    for(i=0;i<NBATCH;i++) {
+	requests[i].key = keys[i];
+	requests[i].start = 0;
+	requests[i].count = totallen;
+	requests[i].content = data[i];
+    }
+    if((stat = nczmap_writen(map,NBATCH,requests)))
+	goto done;
+    report(PASS,"writen",map);
+
+    if((stat = nczmap_close(map,0)))
+	goto done;
+    map = NULL;
+    if((stat = nczmap_open(impl,url,0,0,NULL,&map)))
+	goto done;
+    report(PASS,"re-open",map);
+
+    memset(requests,0,sizeof(requests));
+    for(i=0;i<=NBATCH;i++) requests[i].key = keys[i];
+    if((stat = nczmap_existsn(map,NBATCH+1,requests)))
+	goto done;
+    for(i=0;i<NBATCH;i++) {
+	if(requests[i].stat != NC_NOERR) report(FAIL,"existsn verify",map);
+    }
+    if(requests[NBATCH].stat != NC_EEMPTY) report(FAIL,"existsn verify missing",map);
+    report(PASS,"existsn",map);
+
+    /* Whole objects */
+    memset(requests,0,sizeof(requests));
+    for(i=0;i<=NBATCH;i++) requests[i].key = keys[i];
+    if((stat = nczmap_readn(map,NBATCH+1,requests)))
+	goto done;
+    for(i=0;i<NBATCH;i++) {
+	if(requests[i].stat != NC_NOERR || requests[i].count != totallen)
+	    report(FAIL,"readn verify",map);
+	if(memcmp(requests[i].content,data[i],totallen)!=0)
+	    report(FAIL,"readn content verify",map);
+	nullfree(requests[i].content);
+    }
+    if(requests[NBATCH].stat != NC_EEMPTY || requests[NBATCH].content != NULL)
+	report(FAIL,"readn verify missing",map);
+    report(PASS,"readn",map);
+
+    /* A byte range */
+    memset(requests,0,sizeof(requests));
+    requests[0].key = keys[NBATCH-1];
+    requests[0].start = sizeof(int);
+    requests[0].count = totallen - (2*sizeof(int));
+    requests[0].content = partial;
+    if((stat = nczmap_readn(map,1,requests)))
+	goto done;
+    if(memcmp(partial,&data[NBATCH-1][1],(size_t)requests[0].count)!=0)
+	report(FAIL,"readn range verify",map);
+    report(PASS,"readn range",map);
+
+done:
+    if(map) (void)nczmap_close(map,0);
+    for(i=0;i<=NBATCH;i++) nullfree(keys[i]);
+    return THROW(stat);
+}
+
+/* Repeated access to one object should reuse the open file */
+static int
+fdcache(void)
+{
+    int stat = NC_NOERR;
+    NCZMAP* map = NULL;
+    char* truekey = NULL;
+    int data1[DATA1LEN];
+    int readdata[DATA1LEN];
+    char* data1p = (char*)&data1[0];
+    size64_t third, totallen = sizeof(int)*DATA1LEN;
+    size_t hits = 0, misses = 0;
+    int i;
+
+    title(__func__);
+
+    for(i=0;i<DATA1LEN;i++) data1[i] = DATA1LEN - i;
+    third = (totallen+2) / 3;
+
+    if((stat = nczmap_open(impl,url,NC_WRITE,0,NULL,&map)))
+	goto done;
+    report(PASS,"open",map);
+    truekey = makekey("/fdcache/data");
+
+    /* Write in 3 slices, then read back twice */
+    for(i=0;i<3;i++) {
+	size64_t start = i * third;
+	size64_t last = (start + third > totallen ? totallen : start + third);
+	if((stat = nczmap_write(map, truekey, start, last - start, &data1p[start])))
+	    goto done;
+    }
+    for(i=0;i<2;i++) {
+	memset(readdata,0,sizeof(readdata));
+	if((stat = nczmap_read(map, truekey, 0, totallen, readdata)))
+	    goto done;
+	if(memcmp(data1,readdata,totallen)!=0)
+	    report(FAIL,"fdcache: content verify",map);
+    }
+    report(PASS,"fdcache: write+read",map);
+
+    if((stat = nczmap_file_fdstats(map,&hits,&misses)))
+	goto done;
+    /* The first write misses and creates the file; everything else hits */
+    if(hits < 4 || misses > 1)
+	report(FAIL,"fdcache: counters",map);
+    report(PASS,"fdcache: counters",map);
+
+    /* Deleting the map must close the cached files first */
+    if((stat = nczmap_close(map,1)))
+	goto done;
+    map = NULL;
+    report(PASS,"close+delete",map);
+
+done:
+    if(map) (void)nczmap_close(map,0);
+    nullfree(truekey);
+    return THROW(stat);
+}
+
 static int
 searchR(NCZMAP* map, int depth, const char* prefix0, NClist* objects)
 {
@@ -363,6 +363,7 @@ kind2impl(const char* kind)
     if(strcasecmp("s3",kind)==0) return NCZM_S3;
     else if(strcasecmp("file",kind)==0) return NCZM_FILE;
     else if(strcasecmp("zip",kind)==0) return NCZM_ZIP;
+    else if(strcasecmp("mem",kind)==0) return NCZM_MEM;
     else return NCZM_UNDEF;
 }
 
@@ -373,6 +374,7 @@ impl2kind(NCZM_IMPL impl)
     case NCZM_S3: return "s3";
     case NCZM_FILE: return "file";
     case NCZM_ZIP: return "zip";
+    case NCZM_MEM: return "mem";
     case NCZM_UNDEF: break;
     }
     return NULL;
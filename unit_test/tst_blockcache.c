@@ -0,0 +1,160 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+/**
+Test the NCblockcache data structure against an in-memory
+stand-in for an HTTP server that counts the requests made of it.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "netcdf.h"
+#include "ncblockcache.h"
+
+#define OBJSIZE 100003 /* not a multiple of the block size */
+#define BLOCKSIZE 4096
+#define NBLOCKS ((OBJSIZE+BLOCKSIZE-1)/BLOCKSIZE)
+
+#define CHECK(expr) check((expr),__LINE__)
+void check(int stat, int line)
+{
+    if(stat) {
+	fprintf(stderr,"%d: (%d)%s\n",line,stat,nc_strerror(stat));
+	fflush(stderr);
+	exit(1);
+    }
+}
+
+static int errors = 0;
+
+#define EXPECT(cond,msg) expect((cond),(msg),__LINE__)
+static void
+expect(int cond, const char* msg, int line)
+{
+    if(!cond) {
+	fprintf(stderr,"%d: *** FAIL: %s\n",line,msg);
+	errors++;
+    }
+}
+
+/* The stand-in server */
+typedef struct Server {
+    unsigned char* object;
+    size64_t size;
+    int requests;
+} Server;
+
+static int
+serve(void* state, size64_t offset, size64_t count, void* buf)
+{
+    Server* server = (Server*)state;
+    if(offset + count > server->size) return NC_EINVALCOORDS;
+    memcpy(buf,server->object+offset,(size_t)count);
+    server->requests++;
+    return NC_NOERR;
+}
+
+/* Check the bytes at offset against the object; past the end reads as 0 */
+static int
+verify(Server* server, NCblockcache* cache, size64_t offset, size_t extent)
+{
+    size_t i;
+    unsigned char* data = NULL;
+    CHECK(ncblockcacheget(cache,offset,extent,(void**)&data));
+    for(i=0;i<extent;i++) {
+	unsigned char want = (offset+i < server->size ? server->object[offset+i] : 0);
+	if(data[i] != want) {
+	    fprintf(stderr,"*** FAIL: byte %llu = %u expected %u\n",
+		    (unsigned long long)(offset+i),data[i],want);
+	    errors++;
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t i;
+    size64_t off;
+    Server server;
+    NCblockcache* cache = NULL;
+
+    server.size = OBJSIZE;
+    server.object = (unsigned char*)malloc(OBJSIZE);
+    for(i=0;i<OBJSIZE;i++) server.object[i] = (unsigned char)((i*31) % 251);
+
+    /* Reads within, across and past the end of blocks */
+    server.requests = 0;
+    CHECK(ncblockcachenew(server.size,BLOCKSIZE,8,0,serve,&server,&cache));
+    verify(&server,cache,10,100);
+    verify(&server,cache,BLOCKSIZE-10,20);
+    verify(&server,cache,3*BLOCKSIZE+5,2*BLOCKSIZE);
+    verify(&server,cache,OBJSIZE-50,200);
+    verify(&server,cache,OBJSIZE+100,10);
+    /* Larger than the cache */
+    verify(&server,cache,1000,9*BLOCKSIZE);
+    /* Cached blocks are not read again */
+    server.requests = 0;
+    verify(&server,cache,3*BLOCKSIZE,BLOCKSIZE);
+    EXPECT(server.requests == 0,"cached block was read again");
+    ncblockcachefree(cache);
+
+    /* Adjacent missing blocks are read with one request */
+    server.requests = 0;
+    CHECK(ncblockcachenew(server.size,BLOCKSIZE,8,0,serve,&server,&cache));
+    verify(&server,cache,20*BLOCKSIZE+1,4*BLOCKSIZE);
+    EXPECT(server.requests == 1,"adjacent blocks were not coalesced");
+    /* A cached block splits the missing blocks into two requests */
+    verify(&server,cache,10*BLOCKSIZE,1);
+    server.requests = 0;
+    verify(&server,cache,9*BLOCKSIZE,3*BLOCKSIZE);
+    EXPECT(server.requests == 2,"missing runs were not read separately");
+    ncblockcachefree(cache);
+
+    /* Sequential reads are read ahead */
+    server.requests = 0;
+    CHECK(ncblockcachenew(server.size,BLOCKSIZE,8,3,serve,&server,&cache));
+    for(off=0;off<OBJSIZE;off+=512) verify(&server,cache,off,512);
+    printf("sequential: %d requests for %d blocks\n",server.requests,NBLOCKS);
+    /* Each request reads the three blocks ahead */
+    EXPECT(server.requests <= NBLOCKS/3 + 1,"sequential reads were not read ahead");
+    EXPECT(cache->stats.bytes == OBJSIZE,"object was not read exactly once");
+    EXPECT(nclistlength(cache->blocks) <= 8,"cache exceeded its capacity");
+    ncblockcachefree(cache);
+
+    /* Random reads are not read ahead */
+    server.requests = 0;
+    CHECK(ncblockcachenew(server.size,BLOCKSIZE,8,3,serve,&server,&cache));
+    verify(&server,cache,11*BLOCKSIZE,16);
+    verify(&server,cache,5*BLOCKSIZE,16);
+    verify(&server,cache,17*BLOCKSIZE,16);
+    EXPECT(cache->stats.bytes == 3*BLOCKSIZE,"random reads were read ahead");
+    ncblockcachefree(cache);
+
+    /* The least recently used block is evicted */
+    server.requests = 0;
+    CHECK(ncblockcachenew(server.size,BLOCKSIZE,2,0,serve,&server,&cache));
+    verify(&server,cache,0,1);
+    verify(&server,cache,5*BLOCKSIZE,1);
+    verify(&server,cache,0,1); /* block 0 is now the most recently used */
+    verify(&server,cache,9*BLOCKSIZE,1); /* evicts block 5 */
+    server.requests = 0;
+    verify(&server,cache,0,1);
+    EXPECT(server.requests == 0,"recently used block was evicted");
+    verify(&server,cache,5*BLOCKSIZE,1);
+    EXPECT(server.requests == 1,"least recently used block was kept");
+    ncblockcachefree(cache);
+
+    free(server.object);
+    if(errors) {fprintf(stderr,"*** FAIL: %d errors\n",errors); exit(1);}
+    printf("*** PASS: block cache\n");
+    return 0;
+}
@@ -0,0 +1,272 @@
+/*********************************************************************
+ *   Copyright 2018, UCAR/Unidata
+ *   See netcdf/COPYRIGHT file for copying and redistribution conditions.
+ *********************************************************************/
+
+/**
+Test and time the vectorized ncx byte swap and conversion routines.
+
+Each routine is checked against a reference that decodes the big endian
+external bytes one value at a time, for every count up to a few vectors
+and at unaligned addresses. Then each is timed on a large array against
+the one value at a time swap and convert loop it replaces.
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "netcdf.h"
+#include "ncx.h"
+
+#include "timer_utils.h"
+
+#define MAXN 300 /* largest count checked */
+#define BIGN 65536 /* values per timing pass; the buffers stay in cache */
+#define NPASSES 500
+
+static unsigned char xbuf[BIGN*8 + 8];
+static double ibuf[BIGN + 1];
+
+static int failures = 0;
+
+#define CHECK(expr) do{if(!(expr)) {fprintf(stderr,"%d: %s\n",__LINE__,#expr); failures++;}}while(0)
+
+/* Reference decoders: assemble the big endian bytes explicitly */
+static unsigned long long
+xdecode(const unsigned char* xp, int size)
+{
+    unsigned long long v = 0;
+    int i;
+    for(i=0;i<size;i++) v = (v << 8) | xp[i];
+    return v;
+}
+
+static void
+xencode(unsigned char* xp, unsigned long long v, int size)
+{
+    int i;
+    for(i=size-1;i>=0;i--) {xp[i] = (unsigned char)(v & 0xff); v >>= 8;}
+}
+
+static short ref_short(const unsigned char* xp) {return (short)(unsigned short)xdecode(xp,2);}
+static int ref_int(const unsigned char* xp) {return (int)(unsigned int)xdecode(xp,4);}
+static float ref_float(const unsigned char* xp) {unsigned int u = (unsigned int)xdecode(xp,4); float f; memcpy(&f,&u,4); return f;}
+static double ref_double(const unsigned char* xp) {unsigned long long u = xdecode(xp,8); double d; memcpy(&d,&u,8); return d;}
+
+/* Fill n external values of the given size with varied bytes that are
+   valid (finite) numbers of every type */
+static void
+fillx(unsigned char* xp, size_t n, int size)
+{
+    size_t i;
+    for(i=0;i<n;i++) {
+        unsigned long long v = (unsigned long long)(i * 2654435761u + 12345u);
+        if(size == 4) { /* a float in [-1e6,1e6] */
+            float f = (float)((long long)(v % 2000001) - 1000000) / 7.0f;
+            unsigned int u; memcpy(&u,&f,4); v = u;
+        } else if(size == 8) {
+            double d = (double)((long long)(v % 2000001) - 1000000) / 7.0;
+            memcpy(&v,&d,8);
+        }
+        xencode(xp + i*(size_t)size, v, size);
+    }
+}
+
+/**************************************************/
+/* Check one get routine against its reference for counts 0..MAXN at
+   several alignments */
+
+#define CHECKGET(fcn, xtype, itype, xsize, ref) \
+static void \
+check_##fcn(void) \
+{ \
+    size_t n, off, i; \
+    for(off=0;off<4;off++) { \
+        for(n=0;n<=MAXN;n++) { \
+            const void* xp = xbuf + off; \
+            itype* ip = (itype*)ibuf; \
+            fillx(xbuf + off, n, xsize); \
+            CHECK(fcn(&xp, n, ip) == NC_NOERR); \
+            CHECK(xp == (const void*)(xbuf + off + n*xsize)); \
+            for(i=0;i<n;i++) \
+                CHECK(ip[i] == (itype)ref(xbuf + off + i*xsize)); \
+        } \
+    } \
+}
+
+CHECKGET(ncx_getn_short_short, short, short, 2, ref_short)
+CHECKGET(ncx_getn_short_int, short, int, 2, ref_short)
+CHECKGET(ncx_getn_short_float, short, float, 2, ref_short)
+CHECKGET(ncx_getn_int_int, int, int, 4, ref_int)
+CHECKGET(ncx_getn_int_double, int, double, 4, ref_int)
+CHECKGET(ncx_getn_int_longlong, int, long long, 4, ref_int)
+CHECKGET(ncx_getn_float_float, float, float, 4, ref_float)
+CHECKGET(ncx_getn_float_double, float, double, 4, ref_float)
+CHECKGET(ncx_getn_double_double, double, double, 8, ref_double)
+
+/* Check one put routine: encode, then decode with the reference */
+#define CHECKPUT(fcn, xtype, itype, xsize, ref) \
+static void \
+check_##fcn(void) \
+{ \
+    size_t n, off, i; \
+    for(off=0;off<4;off++) { \
+        for(n=0;n<=MAXN;n++) { \
+            void* xp = xbuf + off; \
+            itype* ip = (itype*)ibuf; \
+            for(i=0;i<n;i++) ip[i] = (itype)((long)(i * 7919u % 64000u) - 32000); \
+            CHECK(fcn(&xp, n, ip, NULL) == NC_NOERR); \
+            CHECK(xp == (void*)(xbuf + off + n*xsize)); \
+            for(i=0;i<n;i++) \
+                CHECK(ref(xbuf + off + i*xsize) == (xtype)ip[i]); \
+        } \
+    } \
+}
+
+CHECKPUT(ncx_putn_short_short, short, short, 2, ref_short)
+CHECKPUT(ncx_putn_int_short, int, short, 4, ref_int)
+CHECKPUT(ncx_putn_int_int, int, int, 4, ref_int)
+CHECKPUT(ncx_putn_float_float, float, float, 4, ref_float)
+CHECKPUT(ncx_putn_float_int, float, int, 4, ref_float)
+CHECKPUT(ncx_putn_double_float, double, float, 8, ref_double)
+CHECKPUT(ncx_putn_double_double, double, double, 8, ref_double)
+
+/* A float infinity does not fit an external double: the block holding
+   it must report NC_ERANGE and still convert its other values */
+static void
+check_putn_double_float_range(void)
+{
+    float* ip = (float*)ibuf;
+    void* xp = xbuf;
+    size_t i, n = 100;
+    for(i=0;i<n;i++) ip[i] = (float)i;
+    ip[50] = (float)HUGE_VAL;
+    CHECK(ncx_putn_double_float(&xp, n, ip, NULL) == NC_ERANGE);
+    CHECK(xp == (void*)(xbuf + n*8));
+    for(i=0;i<n;i++)
+        if(i != 50) CHECK(ref_double(xbuf + i*8) == (double)i);
+}
+
+/**************************************************/
+/* Timing: each routine against the one value at a time loop it
+   replaces, which swapped each value with shifts and then converted it */
+
+static uint16_t swap2(uint16_t a) {return (uint16_t)((a << 8) | (a >> 8));}
+static uint32_t swap4(uint32_t a) {return (a << 24) | ((a << 8) & 0x00ff0000) | ((a >> 8) & 0x0000ff00) | (a >> 24);}
+static uint64_t swap8(uint64_t a) {return ((uint64_t)swap4((uint32_t)a) << 32) | swap4((uint32_t)(a >> 32));}
+
+static short old_short(const unsigned char* xp) {uint16_t u; short v; memcpy(&u,xp,2); u = swap2(u); memcpy(&v,&u,2); return v;}
+static int old_int(const unsigned char* xp) {uint32_t u; int v; memcpy(&u,xp,4); u = swap4(u); memcpy(&v,&u,4); return v;}
+static float old_float(const unsigned char* xp) {uint32_t u; float v; memcpy(&u,xp,4); u = swap4(u); memcpy(&v,&u,4); return v;}
+static double old_double(const unsigned char* xp) {uint64_t u; double v; memcpy(&u,xp,8); u = swap8(u); memcpy(&v,&u,8); return v;}
+static void old_put_float(unsigned char* xp, float v) {uint32_t u; memcpy(&u,&v,4); u = swap4(u); memcpy(xp,&u,4);}
+static void old_put_double(unsigned char* xp, double v) {uint64_t u; memcpy(&u,&v,8); u = swap8(u); memcpy(xp,&u,8);}
+
+typedef void (*Kernel)(size_t);
+
+static void
+time_kernel(const char* tag, Kernel lib, Kernel old)
+{
+    Nanotime t[2], delta;
+    long long nlib, nold;
+    int pass;
+
+    NCT_marktime(&t[0]);
+    for(pass=0;pass<NPASSES;pass++) lib(BIGN);
+    NCT_marktime(&t[1]);
+    NCT_elapsedtime(&t[0],&t[1],&delta);
+    nlib = NCT_nanoseconds(delta);
+
+    NCT_marktime(&t[0]);
+    for(pass=0;pass<NPASSES;pass++) old(BIGN);
+    NCT_marktime(&t[1]);
+    NCT_elapsedtime(&t[0],&t[1],&delta);
+    nold = NCT_nanoseconds(delta);
+
+    printf("%-20s ncx: %7.3f ns/value  per value: %7.3f ns/value  speedup: %.2f\n",
+           tag,
+           (double)nlib/((double)NPASSES*BIGN),
+           (double)nold/((double)NPASSES*BIGN),
+           nlib > 0 ? (double)nold/(double)nlib : 0.0);
+}
+
+#define TIMEGET(fcn, itype, xsize, old) \
+static void lib_##fcn(size_t n) {const void* xp = xbuf; (void)fcn(&xp, n, (itype*)ibuf);} \
+static void old_##fcn(size_t n) \
+{ \
+    size_t i; itype* ip = (itype*)ibuf; \
+    for(i=0;i<n;i++) ip[i] = (itype)old(xbuf + i*xsize); \
+}
+
+#define TIMEPUT(fcn, xtype, itype, xsize, old) \
+static void lib_##fcn(size_t n) {void* xp = xbuf; (void)fcn(&xp, n, (const itype*)ibuf, NULL);} \
+static void old_##fcn(size_t n) \
+{ \
+    size_t i; const itype* ip = (const itype*)ibuf; \
+    for(i=0;i<n;i++) old(xbuf + i*xsize, (xtype)ip[i]); \
+}
+
+TIMEGET(ncx_getn_short_short, short, 2, old_short)
+TIMEGET(ncx_getn_int_int, int, 4, old_int)
+TIMEGET(ncx_getn_float_float, float, 4, old_float)
+TIMEGET(ncx_getn_double_double, double, 8, old_double)
+TIMEGET(ncx_getn_int_double, double, 4, old_int)
+TIMEGET(ncx_getn_float_double, double, 4, old_float)
+TIMEGET(ncx_getn_short_float, float, 2, old_short)
+TIMEPUT(ncx_putn_float_float, float, float, 4, old_put_float)
+TIMEPUT(ncx_putn_double_float, double, float, 8, old_put_double)
+
+int
+main(int argc, char** argv)
+{
+    NCT_inittimer();
+
+    printf("*** Checking ncx conversions...\n");
+    check_ncx_getn_short_short();
+    check_ncx_getn_short_int();
+    check_ncx_getn_short_float();
+    check_ncx_getn_int_int();
+    check_ncx_getn_int_double();
+    check_ncx_getn_int_longlong();
+    check_ncx_getn_float_float();
+    check_ncx_getn_float_double();
+    check_ncx_getn_double_double();
+    check_ncx_putn_short_short();
+    check_ncx_putn_int_short();
+    check_ncx_putn_int_int();
+    check_ncx_putn_float_float();
+    check_ncx_putn_float_int();
+    check_ncx_putn_double_float();
+    check_ncx_putn_double_double();
+    check_putn_double_float_range();
+    if(failures) {
+        fprintf(stderr,"*** FAIL: %d checks failed\n",failures);
+        exit(1);
+    }
+    printf("*** ok\n");
+
+    printf("*** Timing ncx conversions...\n");
+    fillx(xbuf, BIGN, 2);
+    time_kernel("getn_short_short", lib_ncx_getn_short_short, old_ncx_getn_short_short);
+    time_kernel("getn_short_float", lib_ncx_getn_short_float, old_ncx_getn_short_float);
+    fillx(xbuf, BIGN, 4);
+    time_kernel("getn_int_int", lib_ncx_getn_int_int, old_ncx_getn_int_int);
+    time_kernel("getn_int_double", lib_ncx_getn_int_double, old_ncx_getn_int_double);
+    time_kernel("getn_float_float", lib_ncx_getn_float_float, old_ncx_getn_float_float);
+    time_kernel("getn_float_double", lib_ncx_getn_float_double, old_ncx_getn_float_double);
+    fillx(xbuf, BIGN, 8);
+    time_kernel("getn_double_double", lib_ncx_getn_double_double, old_ncx_getn_double_double);
+    {
+        size_t i;
+        for(i=0;i<BIGN;i++) ((float*)ibuf)[i] = (float)i / 3.0f;
+    }
+    time_kernel("putn_float_float", lib_ncx_putn_float_float, old_ncx_putn_float_float);
+    time_kernel("putn_double_float", lib_ncx_putn_double_float, old_ncx_putn_double_float);
+    return 0;
+}